@@ -0,0 +1,111 @@
+// Blit.h
+#ifndef BLIT_H
+#define BLIT_H
+
+#include <Arduino.h>
+
+namespace NuggetsInc {
+
+enum BlitFormat : uint8_t {
+    BLIT_RGB565 = 0,   // 2 bytes per pixel, little-endian
+    BLIT_PALETTE8 = 1, // 1 byte per pixel, an index into the CMD_BLIT_PALETTE colours
+};
+
+// An image held by the sender, row-major
+struct BlitImage {
+    BlitFormat format;
+    const void* pixels; // uint16_t RGB565 or uint8_t palette indices
+    int16_t width;
+    int16_t height;
+};
+
+// CMD_BLIT payload: a stretch of pixels of a screen region, compressed.
+//
+//   format (1 byte), left, top, width (int16 little-endian)
+//   varint     offset of the first pixel in the region, row-major
+//   tokens     varint n, then one pixel repeated (n & 1) or (n >> 1) + 1
+//              literal pixels, until the payload ends
+//
+// Every fragment says where its pixels go, so fragments can arrive in any
+// order and a lost one only leaves its own pixels stale. The receiver
+// decodes straight into a BLIT_SEGMENT-pixel line buffer and draws it with
+// draw16bitRGBBitmap(); no frame buffer is needed on either side.
+//
+// CMD_BLIT_PALETTE payload: the first index, then RGB565 colours.
+class BlitEncoder {
+public:
+    BlitEncoder();
+
+    // Compresses the w x h rectangle of `image` at srcX, srcY, to be drawn at
+    // dstX, dstY. The image must stay valid until done().
+    void begin(const BlitImage& image, int16_t srcX, int16_t srcY, int16_t w, int16_t h,
+               int16_t dstX, int16_t dstY);
+    bool done() const { return position_ >= total_; }
+
+    // Writes the next fragment; returns its length, 0 once done() or if
+    // `capacity` cannot hold even one pixel
+    size_t next(uint8_t* out, size_t capacity);
+
+    static const size_t HEADER_SIZE = 7;
+
+private:
+    uint16_t pixelAt(uint32_t position) const;
+    uint32_t repeatLength(uint32_t position) const;
+
+    BlitImage image_;
+    int16_t srcX_, srcY_, width_;
+    int16_t dstX_, dstY_;
+    uint32_t position_;
+    uint32_t total_;
+};
+
+class BlitDecoder {
+public:
+    typedef void (*RowSink)(int16_t x, int16_t y, const uint16_t* pixels, int16_t w,
+                            void* context);
+
+    BlitDecoder();
+
+    // Checks the whole fragment first, so a malformed one, or one reaching
+    // off the screen, draws nothing
+    static bool validate(const uint8_t* payload, size_t length);
+    bool draw(const uint8_t* payload, size_t length, RowSink sink, void* context);
+    bool setPalette(const uint8_t* payload, size_t length);
+
+    static const int16_t BLIT_SEGMENT = 128;
+
+private:
+    uint16_t palette_[256];
+    uint16_t line_[BLIT_SEGMENT];
+};
+
+// Delta mode: remembers a hash of every TILE_SIZE square of the last image
+// and reports the ones that have changed since, merged into horizontal runs.
+// A hash collision leaves a tile stale until it changes again.
+class TileDiff {
+public:
+    typedef void (*RectVisitor)(int16_t x, int16_t y, int16_t w, int16_t h, void* context);
+
+    TileDiff();
+
+    // The next diff() reports every tile
+    void reset();
+    // Returns the number of changed tiles. Images with more than MAX_TILES
+    // tiles are reported whole every time.
+    uint16_t diff(const BlitImage& image, RectVisitor visitor, void* context);
+
+    static const int16_t TILE_SIZE = 16;
+    static const uint16_t MAX_TILES = 512; // a 536 x 220 screen is 34 x 14
+
+private:
+    uint32_t hashTile(const BlitImage& image, int16_t x, int16_t y, int16_t w, int16_t h) const;
+
+    uint32_t hashes_[MAX_TILES];
+    int16_t width_;
+    int16_t height_;
+    bool valid_;
+};
+
+} // namespace NuggetsInc
+
+#endif // BLIT_H
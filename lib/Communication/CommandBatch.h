@@ -0,0 +1,65 @@
+// CommandBatch.h
+#ifndef COMMAND_BATCH_H
+#define COMMAND_BATCH_H
+
+#include <Arduino.h>
+#include "WireFormat.h"
+#include "DisplayCodec.h"
+#include "Fragmentation.h"
+
+namespace NuggetsInc {
+
+// Payload of a CMD_BATCH frame: several display commands that the receiver
+// runs back to back and acknowledges once. Each entry is
+//
+//   commandID, payload length (1 byte), payload
+//
+// with TYPED_ENTRY set in the commandID byte when the payload holds
+// DisplayCodec binary arguments instead of text.
+//
+// The whole batch is checked before the first entry runs, so a truncated or
+// malformed batch draws nothing. Batches only go to peers that speak the
+// compact wire format; a legacy payload is text and too small anyway.
+class CommandBatch {
+public:
+    // `data` is NUL-terminated; `typed` entries are binary, `length` bytes long
+    typedef void (*Visitor)(uint8_t commandID, const char* data, size_t length, bool typed,
+                            void* context);
+
+    CommandBatch();
+
+    // False if the command does not fit in what is left of the frame
+    bool add(uint8_t commandID, const char* data = nullptr);
+    // Binary arguments; false also if the command has no DisplayCodec schema
+    bool add(uint8_t commandID, const DisplayArgs& args);
+    void clear();
+
+    uint8_t count() const { return count_; }
+    size_t size() const { return length_; }
+    bool empty() const { return count_ == 0; }
+    const uint8_t* data() const { return buffer_; }
+
+    // Calls `visitor` for every entry. Returns
+    // false without calling it at all if the batch is malformed or nests
+    // another batch.
+    static bool forEach(const uint8_t* payload, size_t length, Visitor visitor, void* context);
+    static bool validate(const uint8_t* payload, size_t length);
+
+    // One large frame, or fragments to a peer whose link only takes v1 ones
+    static const size_t CAPACITY = WIRE_MAX_PAYLOAD < Fragmenter::MAX_MESSAGE_SIZE
+                                       ? WIRE_MAX_PAYLOAD
+                                       : Fragmenter::MAX_MESSAGE_SIZE;
+    static const size_t ENTRY_OVERHEAD = 2;
+    static const uint8_t TYPED_ENTRY = 0x80;
+
+private:
+    bool append(uint8_t tag, const uint8_t* data, size_t dataLength);
+
+    uint8_t buffer_[CAPACITY];
+    size_t length_;
+    uint8_t count_;
+};
+
+} // namespace NuggetsInc
+
+#endif // COMMAND_BATCH_H
@@ -0,0 +1,84 @@
+// DisplayCodec.h
+#ifndef DISPLAY_CODEC_H
+#define DISPLAY_CODEC_H
+
+#include <Arduino.h>
+
+namespace NuggetsInc {
+
+// Arguments of the display commands that carry numbers. Colours are RGB565.
+struct CursorArgs {
+    int16_t x;
+    int16_t y;
+};
+
+struct TextSizeArgs {
+    uint8_t size;
+};
+
+struct ColorArgs {
+    uint16_t color;
+};
+
+struct RectArgs {
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+    uint16_t color;
+};
+
+struct PlotPointArgs {
+    int16_t x;
+    int16_t y;
+    uint16_t color;
+};
+
+struct BeginPlotArgs {
+    int16_t minX;
+    int16_t maxX;
+    int16_t minY;
+    int16_t maxY;
+    char xTitle[24];
+    char yTitle[24];
+};
+
+union DisplayArgs {
+    CursorArgs cursor;       // CMD_SET_CURSOR
+    TextSizeArgs textSize;   // CMD_SET_TEXT_SIZE
+    ColorArgs color;         // CMD_SET_TEXT_COLOR, CMD_FILL_SCREEN
+    RectArgs rect;           // CMD_DRAW_RECT, CMD_FILL_RECT
+    PlotPointArgs point;     // CMD_PLOT_POINT
+    BeginPlotArgs plot;      // CMD_BEGIN_PLOT
+};
+
+// Encodings of the display command arguments above, all driven by one
+// schema table (DisplayCodec.cpp) that lists each command's fields in order.
+//
+// Binary ("typed") payloads pack the fields back to back: int16 and colours
+// as 2 bytes little-endian, sizes as 1 byte and titles as a length byte and
+// the characters. Text payloads are what older firmware sends, the fields
+// in decimal separated by commas ("10,20,100,50,63488"); spaces around the
+// numbers are accepted. Commands without numeric arguments (PRINTLN and the
+// like) keep their text payloads and have no schema.
+class DisplayCodec {
+public:
+    static bool hasSchema(uint8_t commandID);
+    // "DRAW_RECT" and so on, for messages; "?" for unknown commands
+    static const char* name(uint8_t commandID);
+
+    // Return the bytes written, or 0 if the command has no schema or the
+    // output does not fit
+    static size_t encode(uint8_t commandID, const DisplayArgs& args, uint8_t* out,
+                         size_t capacity);
+    static size_t formatText(uint8_t commandID, const DisplayArgs& args, char* out,
+                             size_t capacity);
+
+    // Return false on a truncated, overlong or out-of-range payload
+    static bool decode(uint8_t commandID, const uint8_t* data, size_t length, DisplayArgs& args);
+    static bool parseText(uint8_t commandID, const char* text, DisplayArgs& args);
+};
+
+} // namespace NuggetsInc
+
+#endif // DISPLAY_CODEC_H
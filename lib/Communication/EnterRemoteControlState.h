@@ -18,12 +18,13 @@ namespace NuggetsInc
         void onEnter() override;
         void onExit() override;
         void update() override;
+        uint32_t getUpdateDelay() override;
 
     private:
         void readNFCTag();
 
-        DisplayUtils *displayUtils;
-        NFCLogic *nfcLogic;
+        DisplayUtils displayUtils;
+        NFCLogic& nfcLogic;
         uint8_t device2MAC[6];
         TagData *currentTagData;
 
@@ -0,0 +1,103 @@
+// EspNowManager.h
+#ifndef ESP_NOW_MANAGER_H
+#define ESP_NOW_MANAGER_H
+
+#include <Arduino.h>
+#include <esp_now.h>
+#include <esp_wifi_types.h>
+#include "Utils/TimeUtils.h"
+
+namespace NuggetsInc {
+
+// Owns the radio for the life of the device. Wi-Fi is brought up and ESP-NOW
+// initialised on first use and never torn down again; states that talk over
+// ESP-NOW subscribe for received frames and send outcomes instead of
+// registering callbacks of their own. While nobody is subscribed the modem
+// sleeps and promiscuous receive is off, so coming back to remote control
+// costs a power-save change rather than a radio bring-up.
+//
+// The ESP-NOW peer table lives here too. It outlives the states that add to
+// it, so once it is full the peer used least recently makes room.
+//
+// Subscriber callbacks run on the Wi-Fi task.
+class EspNowManager {
+public:
+    typedef void (*ReceiveCallback)(const uint8_t* mac, const uint8_t* data, int length,
+                                    void* context);
+    typedef void (*SendCallback)(const uint8_t* mac, bool delivered, void* context);
+    typedef void (*PromiscuousCallback)(const wifi_promiscuous_pkt_t* packet,
+                                        wifi_promiscuous_pkt_type_t type, void* context);
+
+    struct Subscriber {
+        ReceiveCallback onReceive;
+        SendCallback onSent;
+        PromiscuousCallback onPromiscuous; // management frames, or whatever the filter lets in
+        void* context;
+    };
+
+    static EspNowManager& getInstance();
+
+    // Prevent copying
+    EspNowManager(const EspNowManager&) = delete;
+    EspNowManager& operator=(const EspNowManager&) = delete;
+
+    // Brings the radio up the first time; false if ESP-NOW would not start
+    bool begin();
+    bool isReady() const { return ready_; }
+
+    // Main loop only. The radio is kept awake while anyone is subscribed.
+    // unsubscribe() waits for a callback still running on the Wi-Fi task, so
+    // the context may be destroyed as soon as it returns.
+    bool subscribe(const Subscriber& subscriber);
+    void unsubscribe(void* context);
+
+    // Adds `mac` to the ESP-NOW peer table on the current channel
+    bool ensurePeer(const uint8_t mac[6]);
+
+    uint8_t getChannel() const { return channel_; }
+    bool setChannel(uint8_t channel);
+    // The channels the configured country allows
+    static void allowedChannels(uint8_t& first, uint8_t& last);
+    void setPromiscuousFilter(uint32_t mask);
+
+    // Every node starts here, and goes back here when a switched channel goes
+    // quiet, so a node that restarts finds the others again
+    static const uint8_t HOME_CHANNEL = 1;
+    static const uint8_t MAX_CHANNEL = 14;
+    static const uint8_t MAX_SUBSCRIBERS = 4;
+    // The broadcast address takes one of the driver's slots
+    static const uint8_t MAX_PEERS = ESP_NOW_MAX_TOTAL_PEER_NUM - 1;
+    static const uint32_t WIFI_SETTLE_MS = 80;
+
+private:
+    EspNowManager();
+
+    struct Peer {
+        uint8_t mac[6];
+        bool used;
+        msec32 lastUsedMs;
+    };
+
+    static void onDataSent(const uint8_t* mac, esp_now_send_status_t status);
+    static void onDataReceived(const uint8_t* mac, const uint8_t* data, int length);
+    static void onPromiscuous(void* buffer, wifi_promiscuous_pkt_type_t type);
+    // Copies the subscribers for a callback and marks one as running
+    uint8_t beginDispatch(Subscriber* out);
+    void endDispatch();
+    void setAwake(bool awake);
+    // Promiscuous receive is on only while a subscriber has onPromiscuous
+    void updatePromiscuous();
+    Peer* findPeer(const uint8_t mac[6]);
+
+    Subscriber subscribers_[MAX_SUBSCRIBERS];
+    uint8_t subscriberCount_;
+    volatile uint8_t dispatching_;
+    Peer peers_[MAX_PEERS];
+    uint8_t channel_;
+    bool ready_;
+    bool promiscuous_;
+};
+
+} // namespace NuggetsInc
+
+#endif // ESP_NOW_MANAGER_H
@@ -0,0 +1,109 @@
+// Fragmentation.h
+#ifndef FRAGMENTATION_H
+#define FRAGMENTATION_H
+
+#include <Arduino.h>
+#include "WireFormat.h"
+#include "Utils/TimeUtils.h"
+
+namespace NuggetsInc {
+
+// Payloads too large for one frame travel as CMD_FRAGMENT commands, each
+// acked and retransmitted like any other, so a transfer streams through the
+// send window instead of waiting on every piece. Fragment payload:
+//
+//   transfer ID     2 bytes little-endian, per sender
+//   index, count    1 byte each
+//   commandID       of the whole message
+//   flags           FLAG_TYPED for DisplayCodec binary payloads
+//   total length    2 bytes little-endian
+//   data            DATA_PER_FRAGMENT bytes, less in the last fragment
+//
+// Fragments carry binary headers, so only compact peers can take them. They
+// are sized for a v1 frame with a full routing block, whatever frames the
+// link takes, so every node cuts and joins them the same way and they get
+// through relays as well as direct.
+class Fragmenter {
+public:
+    // Fragments needed for `length` bytes, 0 if it is over MAX_MESSAGE_SIZE
+    static uint8_t count(size_t length);
+    // Writes fragment `index` of `data` to `out`; returns the payload length,
+    // 0 if it does not fit
+    static size_t write(uint16_t transferID, uint8_t commandID, bool typed, const uint8_t* data,
+                        size_t length, uint8_t index, uint8_t* out, size_t capacity);
+    // The command a fragment payload belongs to, 0 if it is too short
+    static uint8_t commandOf(const uint8_t* payload, size_t length);
+
+    static const uint8_t FLAG_TYPED = 0x01;
+    static const size_t HEADER_SIZE = 8;
+    // Header and data fill the payload of a routed v1 frame after
+    // WIRE_MAX_HOPS relays
+    static const size_t MAX_FRAGMENT_SIZE =
+        WIRE_V1_PAYLOAD - WireFormat::ROUTING_SIZE - 6 * WIRE_MAX_HOPS;
+    static const size_t DATA_PER_FRAGMENT = MAX_FRAGMENT_SIZE - HEADER_SIZE;
+    static const size_t MAX_MESSAGE_SIZE = 1024;
+    static const uint8_t MAX_FRAGMENTS =
+        (MAX_MESSAGE_SIZE + DATA_PER_FRAGMENT - 1) / DATA_PER_FRAGMENT;
+};
+
+// Puts fragments back together in a fixed pool of SLOTS buffers, one
+// transfer each. A transfer that has not completed TIMEOUT_MS after its last
+// fragment is abandoned: its buffer goes to the next transfer that needs
+// one, and later fragments with its transfer ID start afresh.
+class Reassembler {
+public:
+    enum Result {
+        ACCEPTED,
+        MALFORMED,
+        NO_BUFFER
+    };
+
+    struct Message {
+        uint8_t commandID;
+        bool typed;
+        uint16_t length;
+        char data[Fragmenter::MAX_MESSAGE_SIZE + 1]; // NUL-terminated, like WireMessage
+    };
+
+    struct Stats {
+        uint32_t completed;
+        uint32_t timedOut;
+        uint32_t malformed;
+        uint32_t noBuffer; // every slot held by a transfer still in time
+    };
+
+    Reassembler();
+
+    // Main loop. Returns the message once its last fragment is in; it stays
+    // valid until the next call. `result` says whether the fragment was
+    // taken in; one that was not should not be acked.
+    const Message* add(const uint8_t source[6], const uint8_t* payload, size_t length,
+                       msec32 nowMs, Result& result);
+    void reset();
+
+    Stats getStats() const { return stats_; }
+
+    static const uint8_t SLOTS = 2;
+    static const msec32 TIMEOUT_MS = 2000;
+
+private:
+    struct Slot {
+        bool used;
+        uint8_t source[6];
+        uint16_t transferID;
+        uint8_t count;
+        uint32_t received; // a bit per fragment
+        msec32 lastMs;
+        Message message;
+    };
+
+    Slot* find(const uint8_t source[6], uint16_t transferID, msec32 nowMs);
+    Slot* claim(msec32 nowMs);
+
+    Slot slots_[SLOTS];
+    Stats stats_;
+};
+
+} // namespace NuggetsInc
+
+#endif // FRAGMENTATION_H
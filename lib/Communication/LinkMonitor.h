@@ -0,0 +1,117 @@
+// LinkMonitor.h
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+#include <Arduino.h>
+#include <esp_wifi_types.h>
+#include "EspNowManager.h"
+#include "Utils/TimeUtils.h"
+
+namespace NuggetsInc {
+
+// Link quality of each ESP-NOW peer:
+//
+//   - RSSI of every frame the peer sends, from the promiscuous receive
+//     metadata, since the ESP-NOW receive callback does not carry it
+//   - the MAC-layer outcome of every frame sent to it, from the ESP-NOW send
+//     callback; the driver's own retries are already behind that
+//   - the round trip of acked commands, from RemoteService
+//
+// The first two arrive on the Wi-Fi task, so everything is kept under a lock.
+class LinkMonitor {
+public:
+    struct Link {
+        uint8_t mac[6];
+        bool used;
+        int8_t rssiLast;
+        int8_t rssiMin;
+        int8_t rssiMax;
+        int16_t rssiAvg16; // smoothed, in 1/16 dBm
+        uint32_t rxFrames;
+        uint32_t txFrames;
+        uint32_t txFailed;
+        uint32_t srttUs;   // 0 until measured
+        msec32 lastHeardMs;
+    };
+
+    LinkMonitor();
+
+    // Only tracked peers are recorded; the first MAX_LINKS are kept
+    void track(const uint8_t mac[6]);
+    void reset();
+
+    // Wi-Fi task
+    void recordRssi(const uint8_t mac[6], int8_t rssi);
+    void recordSend(const uint8_t mac[6], bool delivered);
+    // Main loop
+    void recordRtt(const uint8_t mac[6], uint32_t rttUs);
+
+    // Copies the tracked links; returns how many
+    uint8_t snapshot(Link* out, uint8_t capacity) const;
+    void report(Print& out) const;
+
+    // The sender of an ESP-NOW frame seen by the promiscuous callback, or
+    // nullptr for any other frame
+    static const uint8_t* espNowSender(const wifi_promiscuous_pkt_t* packet,
+                                       wifi_promiscuous_pkt_type_t type);
+
+    static const uint8_t MAX_LINKS = 8;
+
+private:
+    Link* find(const uint8_t mac[6]);
+
+    Link links_[MAX_LINKS];
+};
+
+// Channel survey: the radio dwells on each allowed channel in turn while the
+// promiscuous callback adds up the airtime of everything heard there, foreign
+// networks and ESP-NOW alike. Airtime is estimated from each frame's length
+// and PHY rate.
+class ChannelSurvey {
+public:
+    struct Result {
+        uint32_t frames;
+        uint32_t airtimeUs;
+        uint32_t dwellMs;
+        int8_t rssiMax;
+    };
+
+    ChannelSurvey();
+
+    void begin(uint8_t first, uint8_t last, msec32 nowMs);
+    bool active() const { return active_; }
+    bool complete() const { return complete_; }
+    // The channel being listened to
+    uint8_t channel() const { return channel_; }
+    // Closes the current channel and moves on; false once every channel is done
+    bool advance(msec32 nowMs);
+
+    // Wi-Fi task
+    void record(const wifi_pkt_rx_ctrl_t& rx);
+
+    uint8_t first() const { return first_; }
+    uint8_t last() const { return last_; }
+    Result result(uint8_t channel) const;
+    // Share of the dwell the channel was busy, in per mille
+    uint16_t busyPermille(uint8_t channel) const;
+    // The quietest channel; `current` unless another is clearly quieter
+    uint8_t recommend(uint8_t current) const;
+
+    static const uint8_t MAX_CHANNEL = EspNowManager::MAX_CHANNEL;
+    // A channel has to be this much less busy than the current one to be
+    // worth the switch
+    static const uint16_t SWITCH_MARGIN_PERMILLE = 50;
+
+private:
+    Result results_[MAX_CHANNEL + 1];
+    uint8_t first_;
+    uint8_t last_;
+    uint8_t channel_;
+    msec32 channelStartMs_;
+    volatile bool active_;
+    bool complete_;
+};
+
+} // namespace NuggetsInc
+
+#endif // LINK_MONITOR_H
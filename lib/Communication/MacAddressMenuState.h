@@ -22,7 +22,7 @@ private:
     void scrollUp();
     void scrollDown();
     
-    DisplayUtils* displayUtils;
+    DisplayUtils displayUtils;
     std::vector<String> macAddresses;
     int selectedIndex;
     int scrollOffset;
@@ -40,6 +40,11 @@ enum DisplayCommandID : uint8_t {
     CMD_PLOT_POINT            = 0x15,
     CMD_RELAY_CONNECTION      = 0x16,
     CMD_SYNC_NODES            = 0x17,
+    CMD_BATCH                 = 0x18, // several of the above, see CommandBatch.h
+    CMD_BLIT                  = 0x19, // compressed image fragment, see Blit.h
+    CMD_BLIT_PALETTE          = 0x1A, // colours for BLIT_PALETTE8 fragments
+    CMD_SET_CHANNEL           = 0x1B, // move to the ESP-NOW channel in the one payload byte
+    CMD_FRAGMENT              = 0x1C, // part of a larger command, see Fragmentation.h
 };
 #pragma pack(pop)
 
@@ -0,0 +1,125 @@
+// NodeSync.h
+#ifndef NODE_SYNC_H
+#define NODE_SYNC_H
+
+#include <Arduino.h>
+#include <esp_err.h>
+#include <vector>
+#include "RxQueue.h"
+#include "TimerService.h"
+#include "WireFormat.h"
+#include "Utils/TimeUtils.h"
+
+namespace NuggetsInc {
+
+// Sends the stored node list to every node at once and collects their acks.
+//
+// Each node gets its own CMD_SYNC_NODES frame, routed to it so that only it
+// acts on it and acks it, and the frames go out back to back rather than one
+// per timer tick. A node that has not acked within RETRY_MS is sent its
+// frame again with the same messageID, which its replay window acks without
+// acting on twice, until MAX_ATTEMPTS frames have gone unanswered. A fleet
+// that answers is synced in a few milliseconds and one that does not gives
+// up in under half a second.
+//
+// The frames are unicast, not sent to the broadcast address: the radio acks
+// and retries unicast frames itself, and legacy nodes need a legacy frame
+// with a shorter list than compact ones get. A node not heard from yet is
+// sent the legacy frame; if its ack shows it speaks compact, it is sent the
+// whole list again under a new messageID. A node left with part of the list
+// is reported as NODE_PARTIAL rather than synced.
+//
+// messageIDs come from WireFormat's device-wide sequence, which
+// RemoteService draws from as well, so that no node's ReplayWindow takes a
+// sync for a command it has already seen.
+//
+// Acks are queued by the receive callback on the Wi-Fi task and handled on
+// the main loop by poll().
+class NodeSync {
+public:
+    enum NodeStatus : uint8_t {
+        NODE_WAITING, // not sent yet, or the radio had no room for it
+        NODE_SENT,
+        NODE_SYNCED,
+        NODE_PARTIAL, // acked, but its frames only held the first `addresses`
+        NODE_FAILED   // MAX_ATTEMPTS frames went unacked
+    };
+
+    struct Node {
+        uint8_t mac[6];
+        NodeStatus status;
+        uint8_t attempts;
+        uint32_t messageID;
+        msec32 firstSentMs;
+        msec32 retryAtMs;
+        uint16_t rttMs; // first frame to ack, once synced
+        // Of the list, in the shortest frame sent under messageID: all the
+        // node is sure to have once it acks
+        uint8_t addresses;
+    };
+
+    NodeSync();
+    ~NodeSync();
+
+    // Prevent copying
+    NodeSync(const NodeSync&) = delete;
+    NodeSync& operator=(const NodeSync&) = delete;
+
+    // Main loop. Sends to every node in `macAddresses` (the first
+    // MAX_NODES); false if there is none or the radio is not up.
+    bool start(const std::vector<String>& macAddresses);
+    // Main loop: takes in acks and sends whatever retries are due
+    void poll();
+    void stop();
+
+    bool isRunning() const { return running_; }
+    uint8_t getNodeCount() const { return nodeCount_; }
+    const Node& getNode(uint8_t index) const { return nodes_[index]; }
+    uint8_t countNodes(NodeStatus status) const;
+    // From start() to the last node synced or given up on
+    uint32_t getElapsedMs() const;
+    // True once after any node's status has changed
+    bool takeChanged();
+
+    static const uint8_t MAX_NODES = 12;
+    static const uint8_t MAX_ATTEMPTS = 4;
+    static const uint32_t RETRY_MS = 100;
+    static const uint32_t BUSY_RETRY_MS = 5; // after the radio's queue was full
+    static const uint8_t RX_BATCH = 8;
+
+private:
+    esp_err_t send(Node& node);
+    // Sends and counts the attempt, or puts it off if the radio is busy
+    void transmit(Node& node, msec32 nowMs);
+    void retransmitDue(msec32 nowMs);
+    void drainReceived();
+    void handleAck(const uint8_t source[6], uint32_t messageID);
+    void finishIfDone();
+    void armRetryTimer();
+    // The node list cut at the last address that fits a frame to `mac` in
+    // `version`, and how many addresses that leaves
+    size_t listLengthFor(const uint8_t mac[6], WireVersion version, uint8_t& addresses) const;
+
+    static void onFrameReceived(const uint8_t* mac, const uint8_t* data, int length,
+                                void* context);
+    static void onRetryDue(void* context);
+
+    Node nodes_[MAX_NODES];
+    uint8_t nodeCount_;
+    uint8_t selfMac_[6];
+    // Comma-separated, as RemoteControlState::handleSyncNodes reads it
+    char list_[MAX_NODES * 18];
+    size_t listLength_;
+
+    bool running_;
+    bool subscribed_;
+    bool changed_;
+    msec32 startMs_;
+    msec32 finishMs_;
+    TimerService::TimerId retryTimer_;
+    RxPool<0> rxQueue_; // acks only, which always fit a v1 buffer
+};
+
+} // namespace NuggetsInc
+
+#endif // NODE_SYNC_H
@@ -6,7 +6,9 @@
 #include "DisplayUtils.h"
 #include "StateFactory.h"
 #include "Config.h"
+#include "TimerService.h"
 #include "Communication/MessageTypes.h"
+#include "Communication/DisplayCodec.h"
 
 namespace NuggetsInc {
     class RemoteService; // Forward declaration
@@ -37,7 +39,7 @@ namespace NuggetsInc
             UNKNOWN
         };
 
-        RemoteControlState(uint8_t *macAddress = nullptr);
+        RemoteControlState(const uint8_t *macAddress = nullptr);
         ~RemoteControlState() override;
 
         void onEnter() override;
@@ -51,28 +53,46 @@ namespace NuggetsInc
         void handleAddToTerminalDisplay(const String& message);
         void handlePrintln(const String& message);
         void handlePrint(const String& message);
-        void handleSetCursor(const char* data);
-        void handleSetTextSize(const char* data);
-        void handleSetTextColor(const char* data);
-        void handleFillScreen(const char* data);
-        void handleDrawRect(const char* data);
-        void handleFillRect(const char* data);
-        void handleBeginPlot(const char* data);
-        void handlePlotPoint(const char* data);
+        void handleSetCursor(const CursorArgs& args);
+        void handleSetTextSize(const TextSizeArgs& args);
+        void handleSetTextColor(const ColorArgs& args);
+        void handleFillScreen(const ColorArgs& args);
+        void handleDrawRect(const RectArgs& args);
+        void handleFillRect(const RectArgs& args);
+        void handleBeginPlot(const BeginPlotArgs& args);
+        void handlePlotPoint(const PlotPointArgs& args);
         void handleSyncNodes(const char* data);
+        // One decoded row segment of a CMD_BLIT fragment
+        void handleBlitRow(int16_t x, int16_t y, const uint16_t* pixels, int16_t w);
 
         // Get active instance for RemoteService
         static RemoteControlState* getActiveInstance() { return activeInstance; }
 
+        // The link diagnostics screen covers the peer's drawing while it is up
+        bool isShowingLinkView() const { return linkView_; }
+
+        static const uint32_t LINK_VIEW_REFRESH_MS = 1000;
+        static const uint8_t LINK_VIEW_MAX_LINKS = 3;
+
     private:
-        void handleInput(EventType eventType);
+        void handleInput(const Event& event);
+
+        // Link diagnostics: BACK opens and closes it, SET surveys the
+        // channels, A1 moves everyone to the quietest one
+        void openLinkView();
+        void closeLinkView();
+        void handleLinkViewInput(const Event& event);
+        void drawLinkView();
+        static void onLinkViewDue(void* context);
 
         // Private members
 
         static RemoteControlState *activeInstance;
-        DisplayUtils *displayUtils;
+        DisplayUtils displayUtils;
         RemoteService *remoteService_;
         uint8_t device2MAC[6];
+        bool linkView_;
+        TimerService::TimerId linkViewTimer_;
     };
 } // namespace NuggetsInc
 
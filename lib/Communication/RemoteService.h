@@ -3,63 +3,371 @@
 
 #include <Arduino.h>
 #include <esp_now.h>
-#include <map>
 #include "MessageTypes.h"
+#include "WireFormat.h"
+#include "CommandBatch.h"
+#include "DisplayCodec.h"
+#include "Blit.h"
+#include "EspNowManager.h"
+#include "Fragmentation.h"
+#include "LinkMonitor.h"
+#include "ReplayWindow.h"
+#include "RoutingTable.h"
+#include "RxQueue.h"
+#include "TimerService.h"
 #include "Utils/TimeUtils.h"
 
 namespace NuggetsInc {
 
-// Simplified Remote communication service - direct sends only
+// Remote communication service - direct sends to one target device.
+//
+// Commands are delivered reliably: each gets the next sequence number, up to
+// WINDOW_SIZE of them are in flight at once, and each is retransmitted until
+// the peer acks it or its timeout passes. The retransmission timeout follows
+// the measured round trip (RFC 6298 smoothing, Karn's rule, doubling on every
+// retry). Nothing blocks: sends are queued and poll(), called from the main
+// loop, retires acked commands, retransmits overdue ones and runs the
+// completion callbacks.
+//
+// Commands are queued in one of three lanes: control (input and link
+// management), interactive display and bulk (plots and images). The window
+// is filled in strict priority order, so a button press overtakes whatever
+// display traffic is still waiting; within a lane commands keep their order.
+// A lane passed over STARVATION_LIMIT times in a row goes next regardless, and
+// a few queue slots and one window slot are kept for control commands alone.
+//
+// Flow control: every compact ack carries the receiver's credit, the receive
+// buffers it has free for frames the size of the sender's link less
+// RX_CREDIT_RESERVE. The window shrinks to the
+// target's last credit, down to a single frame that keeps acks, and with them
+// fresh credit, coming. Peers that send no credit get the full window.
+// While the window is closed, a newly queued CMD_PLOT_POINT replaces one
+// still waiting rather than queue behind it.
+//
+// A payload too large for one frame goes to a compact peer in CMD_FRAGMENT
+// commands, all queued at once so they share the window like any other
+// traffic; the peer acks each one and puts the whole back together in its
+// Reassembler before running it.
+//
+// Frames grow to what both ends of the link take (see WireFormat): batches,
+// blits and palettes fill up to maxPayload() a frame, and commands that fit
+// one frame no longer need fragments.
+//
+// Received frames are only queued by the ESP-NOW callback (see RxQueue);
+// poll() decodes, acks and draws them on the main loop, RX_BATCH at a time.
+//
+// The service also relays for the mesh: routed frames addressed to another
+// node get this node appended to their path and go on to the next hop from
+// the RoutingTable, and every ANNOUNCE_INTERVAL_MS the table is broadcast
+// in a CMD_RELAY_CONNECTION frame so neighbours learn what lies beyond. A
+// target that is out of direct range is reached the same way.
+//
+// Link quality of every peer is kept in a LinkMonitor. A channel survey
+// listens to each allowed channel in turn; switchChannel() then moves the
+// target, any neighbour that hears the CMD_SET_CHANNEL broadcast and finally
+// this node. A node that hears nobody on its new channel within
+// CHANNEL_CONFIRM_MS, or nobody at all for CHANNEL_SILENCE_MS, goes back to
+// EspNowManager::HOME_CHANNEL, where every node starts.
+//
+// The radio itself belongs to EspNowManager: begin() subscribes to it and
+// the destructor unsubscribes, leaving Wi-Fi, ESP-NOW and the peer table up
+// for the next session.
 class RemoteService {
 public:
+    // Main loop: `delivered` is false when the command ran out of retries or time
+    typedef void (*SendCallback)(uint32_t messageID, bool delivered, void* context);
+
+    struct DeliveryStats {
+        uint32_t queued;
+        uint32_t delivered;
+        uint32_t failed;
+        uint32_t retransmissions;
+        uint32_t rejected;   // queue full
+        uint32_t coalesced;  // plot points replaced by a newer one before going out
+        uint32_t fragmented; // payloads sent in more than one frame
+        uint32_t creditStalls; // times the target's credit closed the window
+        uint32_t credit;     // the target's last credit, WINDOW_SIZE until it sends one
+        uint32_t srttUs;     // smoothed round trip, 0 before the first sample
+        uint32_t rtoMs;
+    };
+
+    struct RoutingStats {
+        uint32_t forwarded;
+        uint32_t looped;       // dropped: the path already held this node
+        uint32_t hopLimit;     // dropped: no room left in the path
+        uint32_t noRoute;      // sent straight to the destination on the off chance
+        uint32_t sendFailures;
+        uint32_t forwardUsMax; // frame received to frame passed on
+        uint32_t forwardUsTotal;
+    };
+
+    // Transmit priority, highest first
+    enum Lane : uint8_t { LANE_CONTROL, LANE_INTERACTIVE, LANE_BULK, LANE_COUNT };
+
+    struct LaneStats {
+        uint32_t queued;
+        uint32_t sent;       // first transmissions
+        uint32_t delivered;
+        uint32_t failed;
+        uint32_t rejected;   // no slot left for the lane
+        uint32_t promoted;   // sent ahead of a higher lane so as not to starve
+        uint32_t waitMsMax;  // queued to first transmission
+        uint32_t waitMsTotal;
+    };
+
     RemoteService();
     ~RemoteService();
 
     // Initialize ESP-NOW and set target device
     bool begin(const uint8_t* targetMac);
+    // Both queue the command and return at once; false if the queue is full.
+    // It is retried until acked or until timeoutMs has passed.
     bool sendCommand(uint8_t commandID, const char* data = nullptr, uint32_t timeoutMs = 2000);
-    bool sendCommandNonBlocking(uint8_t commandID, const char* data = nullptr);
+    bool sendCommandNonBlocking(uint8_t commandID, const char* data = nullptr,
+                                SendCallback onComplete = nullptr, void* context = nullptr);
+    // Up to Fragmenter::MAX_MESSAGE_SIZE bytes of arguments, text or, when
+    // `typed`, DisplayCodec binary; more than one frame's worth needs a
+    // compact peer. `onComplete` runs once, for the whole payload.
+    bool sendPayload(uint8_t commandID, const uint8_t* data, size_t length, bool typed,
+                     SendCallback onComplete = nullptr, void* context = nullptr,
+                     uint32_t timeoutMs = DEFAULT_TIMEOUT_MS);
+    // Binary arguments to a compact peer, the equivalent text otherwise
+    bool sendDisplayCommand(uint8_t commandID, const DisplayArgs& args);
+    // One CMD_BATCH frame to a compact peer, one frame per command otherwise
+    bool sendBatch(const CommandBatch& batch);
+    // Streams `image` to the peer's screen at dstX, dstY in CMD_BLIT
+    // fragments, a few queue slots at a time from poll(); compact peers only.
+    // The image must stay valid until isBlitting() is false. With `delta`,
+    // only the tiles that changed since the previous delta blit are sent.
+    bool sendBlit(const BlitImage& image, int16_t dstX, int16_t dstY, bool delta = false);
+    // Sets the peer's palette entries from `first` on, in as many frames as
+    // they take; all are queued or none. Compact peers only.
+    bool sendBlitPalette(const uint16_t* colors, uint8_t first, uint16_t count);
+    bool isBlitting() const;
+    // Main loop: completes acked commands and retransmits overdue ones
+    void poll();
     bool isPeerConnected() const { return isPeerAdded_; }
+    // Largest payload one frame to the target takes, by format, link frame
+    // size and route
+    uint16_t maxPayload() const;
     String getTargetMacString() const;
+    DeliveryStats getDeliveryStats() const;
+    RxQueue::Stats getReceiveStats() const;
+    Reassembler::Stats getReassemblyStats() const { return reassembler_.getStats(); }
+    RoutingStats getRoutingStats() const { return routingStats_; }
+    LaneStats getLaneStats(Lane lane) const { return laneStats_[lane]; }
+    void reportLanes(Print& out) const;
+    static Lane laneFor(uint8_t commandID);
+    void reportRoutes(Print& out) const;
+
+    uint8_t getLinks(LinkMonitor::Link* out, uint8_t capacity) const {
+        return links_.snapshot(out, capacity);
+    }
+    // Links, the channel and the last survey
+    void reportLinks(Print& out) const;
+    // Listens to each allowed channel for SURVEY_DWELL_MS, then returns to
+    // the current one; commands wait meanwhile. False if busy.
+    bool startChannelSurvey();
+    bool isSurveying() const { return survey_.active(); }
+    const ChannelSurvey& getSurvey() const { return survey_; }
+    // Compact peers only; false if a switch or survey is under way
+    bool switchChannel(uint8_t channel);
+    uint8_t getChannel() const { return channel_; }
+    // The channel being switched to, 0 if none
+    uint8_t getPendingChannel() const { return pendingChannel_; }
+
+    static const uint8_t QUEUE_SIZE = 16;
+    static const uint8_t WINDOW_SIZE = 8;
+    static const uint8_t MAX_ATTEMPTS = 6;
+    static const uint32_t DEFAULT_TIMEOUT_MS = 2000;
+    static const uint32_t INITIAL_RTO_MS = 100;
+    static const uint32_t MIN_RTO_MS = 10;
+    static const uint32_t MAX_RTO_MS = 1000;
+    static const uint8_t RX_BATCH = 8;
+    static const uint32_t ANNOUNCE_INTERVAL_MS = 5000;
+    static const uint32_t ANNOUNCE_SLACK_MS = 1000;
+    // A target still unacked after this many attempts has its route dropped
+    static const uint8_t ROUTE_FAILURE_ATTEMPTS = 3;
+    static const uint8_t MAX_BLIT_REGIONS = 32;
+    static const uint8_t BLIT_RESERVED_SLOTS = 4; // queue slots a blit leaves to other commands
+    static const uint32_t SURVEY_DWELL_MS = 150;
+    static const uint32_t CHANNEL_SWITCH_DELAY_MS = 200; // for the ack and broadcast to get out
+    static const uint32_t CHANNEL_CONFIRM_MS = 2000;
+    static const uint32_t CHANNEL_CONFIRM_INTERVAL_MS = 250; // announcements while confirming
+    static const uint32_t CHANNEL_SILENCE_MS = 3 * ANNOUNCE_INTERVAL_MS;
+    static const uint8_t CONTROL_RESERVED_SLOTS = 2;  // queue slots other lanes leave free
+    static const uint8_t CONTROL_RESERVED_WINDOW = 1; // likewise in the window
+    static const uint8_t STARVATION_LIMIT = 8;
+    // Receive buffers left out of the credit we advertise, for the one frame
+    // a sender out of credit still sends and for other peers' traffic
+    static const uint8_t RX_CREDIT_RESERVE = 2;
+    // Receive buffers for frames over WIRE_V1_FRAME, which only a v2 build
+    // takes: a few full frames of credit on a v2 link on top of the reserve
+    static const uint8_t RX_LARGE_BUFFERS = WIRE_MAX_FRAME > WIRE_V1_FRAME ? 6 : 0;
+    static const uint8_t MAX_FRAGMENTED_SENDS = 2;
 
 private:
+    struct Outgoing {
+        enum Status : uint8_t { FREE, QUEUED, IN_FLIGHT, ACKED };
+        Status status;
+        Lane lane;
+        uint8_t attempts;
+        uint32_t queuedMs;
+        uint32_t timeoutMs;
+        uint32_t retransmitAtMs;
+        uint32_t sentUs;
+        uint32_t ackUs;
+        SendCallback onComplete;
+        void* context;
+        // Re-encoded on every attempt, in whatever format the peer speaks by then
+        WireMessage message;
+    };
+
     uint8_t targetMAC_[6];
     uint8_t* selfMAC_;
     bool isPeerAdded_;
     
-    // ESP-NOW callbacks
-    static void onDataSentCallback(const uint8_t *mac_addr, esp_now_send_status_t status);
-    static void onDataRecvCallback(const uint8_t *mac_addr, const uint8_t *incomingData, int len);
+    // EspNowManager callbacks, on the Wi-Fi task
+    static void onFrameReceived(const uint8_t* mac, const uint8_t* data, int length,
+                                void* context);
+    static void onFrameSent(const uint8_t* mac, bool delivered, void* context);
+    static void onPromiscuousFrame(const wifi_promiscuous_pkt_t* packet,
+                                   wifi_promiscuous_pkt_type_t type, void* context);
     
+    // From the device-wide sequence (WireFormat::nextMessageID()), moved on
+    // to millis() at begin(), so a new session does not reuse IDs the peer
+    // may still remember
+    uint32_t nextMessageID();
+
+    // Reliable delivery
+    bool queueCommand(const WireMessage& message, uint32_t timeoutMs, SendCallback onComplete,
+                      void* context);
+    void transmit(Outgoing& slot);
+    void complete(Outgoing& slot, bool delivered);
+    void handleAck(uint32_t messageID, uint32_t receivedUs);
+    void sampleRtt(uint32_t rttUs);
+    uint32_t backedOffRto(uint8_t attempts) const;
+    void scheduleRetransmit();
+    static void onRetransmitDue(void* context);
+    // The oldest queued command of the lane that goes next, or nullptr
+    Outgoing* nextToSend(uint8_t inFlight);
+    // Flow control: how many frames the target lets us have in flight, and
+    // the credit we give a sender we ack, in frames of its link's size
+    uint8_t creditWindow() const;
+    uint8_t rxCredit(const uint8_t senderMac[6]) const;
+    // Replaces the newest waiting plot point with `message`; false if there
+    // is none
+    bool coalesce(const WireMessage& message);
+
+    Outgoing outgoing_[QUEUE_SIZE];
+    LaneStats laneStats_[LANE_COUNT];
+    uint8_t passedOver_[LANE_COUNT]; // window slots in a row that went to a higher lane
+    uint32_t srttUs_;
+    uint32_t rttvarUs_;
+    uint32_t rtoMs_;
+    TimerService::TimerId retransmitTimer_;
+    uint32_t retransmitDueMs_;
+    bool polling_; // a completion callback is queueing from inside poll()
+    DeliveryStats stats_;
+    uint8_t peerCredit_;
+    bool windowClosed_; // commands were left waiting by the last poll()
+    bool creditBound_;  // and the target's credit was what held them
+
+    // Blit streaming: the regions still to send, fed to the queue by poll()
+    struct BlitRegion {
+        int16_t x, y, w, h;
+    };
+    void feedBlit();
+    static void queueBlitRegion(int16_t x, int16_t y, int16_t w, int16_t h, void* context);
+    static void onBlitFragmentDone(uint32_t messageID, bool delivered, void* context);
+    static void drawBlitRow(int16_t x, int16_t y, const uint16_t* pixels, int16_t w,
+                            void* context);
+
+    // Fragmented sends still waiting on some of their fragments
+    struct FragmentedSend {
+        bool used;
+        bool failed;
+        uint8_t remaining;
+        uint32_t firstMessageID;
+        SendCallback onComplete;
+        void* context;
+        RemoteService* service;
+    };
+    static void onFragmentDone(uint32_t messageID, bool delivered, void* context);
+    FragmentedSend fragmentedSends_[MAX_FRAGMENTED_SENDS];
+    uint16_t nextTransferID_;
+    Reassembler reassembler_;
+
+    BlitImage blitImage_;
+    int16_t blitDstX_;
+    int16_t blitDstY_;
+    BlitRegion blitRegions_[MAX_BLIT_REGIONS];
+    uint8_t blitRegionCount_;
+    uint8_t blitNextRegion_;
+    BlitEncoder blitEncoder_;
+    TileDiff blitTiles_;
+    BlitDecoder blitDecoder_;
+
     // Message handling
-    void processReceivedMessage(const uint8_t* senderMac, const struct_message& msg);
+    void drainReceived();
+    // `msg` is drainReceived()'s own copy; forward() adds this node to its path
+    void processReceivedMessage(const uint8_t* senderMac, WireMessage& msg,
+                                uint32_t receivedUs);
     bool isDuplicateMessage(const uint8_t src[6], uint32_t messageID);
-    void sendAck(const struct_message& originalMsg, const uint8_t* senderMac);
-    bool isDestinationForSelf(const struct_message& msg);
+    void sendAck(const WireMessage& originalMsg, const uint8_t* senderMac);
+    bool isDestinationForSelf(const WireMessage& msg);
+    // Encodes in the format the peer speaks and hands the frame to ESP-NOW.
+    // The frame size fields of `msg` are stamped in place rather than on a
+    // copy: a WireMessage is as large as the largest frame.
+    esp_err_t sendFrame(const uint8_t* peerMac, WireMessage& msg);
+    // sendFrame() through the next hop when `destination` is out of range;
+    // sets the routing fields of `msg` for the path it takes
+    esp_err_t sendTo(const uint8_t* destination, WireMessage& msg);
+    bool ensurePeer(const uint8_t mac[6]);
+
+    // Mesh
+    void learnRoutes(const uint8_t* senderMac, const WireMessage& msg);
+    void forward(const uint8_t* senderMac, WireMessage& msg, uint32_t receivedUs);
+    void announceRoutes();
+    // Unacked, in the compact format
+    void broadcastCommand(uint8_t commandID, const uint8_t* payload, size_t length);
+    static void onAnnounceDue(void* context);
+    RoutingTable routes_;
+    RoutingStats routingStats_;
+
+    // Link quality and channels
+    void followChannelSwitch(const WireMessage& msg);
+    void scheduleChannelSwitch(uint8_t channel);
+    void tuneTo(uint8_t channel);
+    void finishSurvey();
+    static void onChannelSwitchAcked(uint32_t messageID, bool delivered, void* context);
+    static void onChannelSwitchDue(void* context);
+    static void onChannelConfirmDue(void* context);
+    static void onSurveyStep(void* context);
+    LinkMonitor links_;
+    ChannelSurvey survey_;
+    uint8_t channel_;
+    uint8_t pendingChannel_;
+    TimerService::TimerId channelTimer_; // the switch, then its confirmation
+    TimerService::TimerId surveyTimer_;
+    msec32 switchedAtMs_;
+    msec32 lastHeardMs_;
+    bool heardSinceSwitch_;
     
     // Display command processing
-    void processDisplayCommand(uint8_t commandID, const char* data);
+    // `data` is text, or DisplayCodec arguments when `typed`
+    void processDisplayCommand(uint8_t commandID, const char* data, size_t length, bool typed);
+    static void runBatchedCommand(uint8_t commandID, const char* data, size_t length, bool typed,
+                                  void* context);
 
     // Utility functions
     static String macToString(const uint8_t mac[6]);
     static uint8_t* stringToMac(const String& s, uint8_t out[6]);
     bool isZeroMac(const uint8_t mac[6]);
 
-    // Deduplication cache
-    struct MsgKey {
-        uint8_t mac[6];
-        uint32_t id;
-    };
-    struct MsgKeyCmp {
-        bool operator()(const MsgKey& a, const MsgKey& b) const {
-            int c = memcmp(a.mac, b.mac, 6);
-            return c < 0 || (c == 0 && a.id < b.id);
-        }
-    };
-    std::map<MsgKey, msec32, MsgKeyCmp> recentMsgCache_;
-
-    // Static instance for callbacks
-    static RemoteService* activeInstance_;
+    // Deduplication of received commands
+    ReplayWindow replayWindow_;
+    RxPool<RX_LARGE_BUFFERS> rxQueue_;
 };
 
 } // namespace NuggetsInc
@@ -0,0 +1,52 @@
+// ReplayWindow.h
+#ifndef REPLAY_WINDOW_H
+#define REPLAY_WINDOW_H
+
+#include <Arduino.h>
+#include "Utils/TimeUtils.h"
+
+namespace NuggetsInc {
+
+// Duplicate detection for received commands, in the style of IPsec
+// anti-replay. Each sender gets the highest sequence number seen from it and
+// a 64-bit bitmap of which of the 64 numbers below that have arrived, so a
+// check is a table lookup and a shift. Nothing is allocated.
+//
+// Anything more than WINDOW_BITS behind the highest number counts as a
+// duplicate, except that a sender which has been quiet for SESSION_IDLE_MS,
+// or jumps back by more than RESET_DISTANCE, is taken to have restarted and
+// starts a fresh window. When the table is full the sender heard from least
+// recently is forgotten.
+class ReplayWindow {
+public:
+    ReplayWindow();
+
+    // True if `sequence` from `sender` was seen before; records it otherwise
+    bool isReplay(const uint8_t sender[6], uint32_t sequence);
+    // Unrecords `sequence`, for a command that was dropped rather than acted
+    // on, so that its retransmission is taken
+    void forget(const uint8_t sender[6], uint32_t sequence);
+    void reset();
+
+    static const uint8_t MAX_SENDERS = 8;
+    static const uint8_t WINDOW_BITS = 64;
+    static const msec32 SESSION_IDLE_MS = 2000;
+    static const uint32_t RESET_DISTANCE = 1024;
+
+private:
+    struct Sender {
+        uint8_t mac[6];
+        bool used;
+        uint32_t highest;
+        uint64_t seen; // bit n: highest - n has arrived
+        msec32 lastSeenMs;
+    };
+
+    Sender& lookup(const uint8_t mac[6], bool& isNew);
+
+    Sender senders_[MAX_SENDERS];
+};
+
+} // namespace NuggetsInc
+
+#endif // REPLAY_WINDOW_H
@@ -0,0 +1,73 @@
+// RoutingTable.h
+#ifndef ROUTING_TABLE_H
+#define ROUTING_TABLE_H
+
+#include <Arduino.h>
+#include "Utils/TimeUtils.h"
+
+namespace NuggetsInc {
+
+// Next-hop routes for the ESP-NOW mesh, learned from what is heard:
+//
+//   - every frame makes its sender a neighbour (one hop)
+//   - a routed frame shows its origin, and each relay on its path, to be
+//     reachable through the neighbour that passed it on
+//   - CMD_RELAY_CONNECTION announcements list the routes of the neighbour
+//     that broadcast them, which are one hop further from here
+//
+// A destination keeps the shortest route heard, refreshed by anything that
+// confirms it; routes not confirmed for ROUTE_TIMEOUT_MS are ignored and,
+// when the table is full, the stalest one is replaced.
+//
+// Announcements carry each route's next hop, and a route the neighbour has
+// through us is skipped (split horizon), so two neighbours do not keep a
+// lost destination alive between them. A loop of three or more nodes still
+// can: each announcement adds a hop, so the route is dropped from
+// announcements once it reaches MAX_ROUTE_HOPS and expires ROUTE_TIMEOUT_MS
+// later, at worst (MAX_ROUTE_HOPS - 1) announcement intervals plus
+// ROUTE_TIMEOUT_MS after the destination went quiet.
+class RoutingTable {
+public:
+    struct Route {
+        uint8_t destination[6];
+        uint8_t nextHop[6];
+        uint8_t hops; // 1 for a neighbour
+        bool used;
+        msec32 lastSeenMs;
+        uint32_t srttUs; // smoothed round trip to the destination, 0 until measured
+    };
+
+    RoutingTable();
+
+    void learn(const uint8_t destination[6], const uint8_t nextHop[6], uint8_t hops,
+               msec32 nowMs);
+    // CMD_RELAY_CONNECTION payload from `neighbour`; false if malformed
+    bool learnAnnouncement(const uint8_t neighbour[6], const uint8_t* payload, size_t length,
+                           const uint8_t self[6], msec32 nowMs);
+    // Writes the routes worth announcing, ANNOUNCE_ENTRY_SIZE bytes each;
+    // returns the length
+    size_t announcement(uint8_t* out, size_t capacity, msec32 nowMs) const;
+
+    // False if there is no fresh route to `destination`
+    bool nextHop(const uint8_t destination[6], msec32 nowMs, uint8_t out[6],
+                 uint8_t& hops) const;
+    // The destination stopped answering through its route
+    void forget(const uint8_t destination[6]);
+    void recordRtt(const uint8_t destination[6], uint32_t rttUs);
+
+    void report(Print& out, msec32 nowMs) const;
+
+    static const uint8_t MAX_ROUTES = 16;
+    static const msec32 ROUTE_TIMEOUT_MS = 30000;
+    static const size_t ANNOUNCE_ENTRY_SIZE = 13; // destination, hops, next hop
+
+private:
+    Route* find(const uint8_t destination[6]);
+    const Route* find(const uint8_t destination[6]) const;
+
+    Route routes_[MAX_ROUTES];
+};
+
+} // namespace NuggetsInc
+
+#endif // ROUTING_TABLE_H
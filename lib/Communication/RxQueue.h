@@ -0,0 +1,96 @@
+// RxQueue.h
+#ifndef RX_QUEUE_H
+#define RX_QUEUE_H
+
+#include <Arduino.h>
+#include <esp_now.h>
+#include <atomic>
+#include "RingBuffer.h"
+#include "WireFormat.h"
+
+namespace NuggetsInc {
+
+struct RxFrame {
+    uint8_t srcMac[6];
+    uint16_t length;
+    uint32_t receivedUs;
+    uint8_t* data; // the buffer's storage, WIRE_V1_FRAME or WIRE_MAX_FRAME bytes
+};
+
+// Hands received ESP-NOW frames from the Wi-Fi task to the main loop.
+//
+// The frames live in a fixed pool. The receive callback takes a free buffer,
+// copies the frame in (the driver reuses its own buffer once the callback
+// returns) and queues the buffer's index; the main loop decodes the frame
+// where it lies and gives the buffer back. Both the free lists and the queue
+// are lock-free RingBuffers, so the Wi-Fi task never waits on the main loop.
+// A frame that finds no free buffer is dropped and counted.
+//
+// Most frames are acks and short commands, so the pool is POOL_SIZE buffers
+// of WIRE_V1_FRAME bytes and only a few of WIRE_MAX_FRAME for the longer
+// frames a v2 link carries; a short frame takes a large buffer only when the
+// small ones are all in use. RxPool declares the storage, RxQueue does the
+// rest.
+class RxQueue {
+public:
+    struct Stats {
+        uint32_t received;
+        uint32_t dropped;   // pool exhausted
+        uint32_t depth;     // frames waiting now
+        uint32_t highWater; // most frames ever waiting
+        uint32_t capacity;  // buffers in all
+    };
+
+    // Prevent copying
+    RxQueue(const RxQueue&) = delete;
+    RxQueue& operator=(const RxQueue&) = delete;
+
+    // Wi-Fi task. False if the frame was dropped.
+    bool push(const uint8_t srcMac[6], const uint8_t* data, int len);
+
+    // Main loop: the oldest waiting frame, or nullptr. Every frame taken
+    // must be given back with release().
+    RxFrame* acquire();
+    void release(RxFrame* frame);
+
+    Stats getStats() const;
+    // Buffers free for the next frames of up to `frameSize` bytes
+    uint32_t available(uint16_t frameSize) const;
+
+    static const size_t POOL_SIZE = 16;        // WIRE_V1_FRAME bytes each
+    static const size_t MAX_LARGE_BUFFERS = 8; // WIRE_MAX_FRAME bytes each
+
+protected:
+    // `storage` is POOL_SIZE small buffers followed by `largeBuffers` large ones
+    RxQueue(RxFrame* frames, uint8_t* storage, uint8_t largeBuffers);
+
+private:
+    RxFrame* pool;
+    uint8_t largeCount;
+    RingBuffer<uint8_t, POOL_SIZE> freeSmall;
+    RingBuffer<uint8_t, MAX_LARGE_BUFFERS> freeLarge;
+    RingBuffer<uint8_t, 2 * POOL_SIZE> ready;
+    std::atomic<uint32_t> received;
+    std::atomic<uint32_t> dropped;
+    std::atomic<uint32_t> highWater;
+
+    static_assert(POOL_SIZE + MAX_LARGE_BUFFERS <= 2 * POOL_SIZE, "ready must hold every buffer");
+};
+
+// An RxQueue with `LargeBuffers` buffers for frames over WIRE_V1_FRAME; none
+// for a receiver that only takes acks, and none are needed in a v1 build
+template <uint8_t LargeBuffers>
+class RxPool : public RxQueue {
+    static_assert(LargeBuffers <= MAX_LARGE_BUFFERS, "too many large buffers");
+
+public:
+    RxPool() : RxQueue(frames, storage, LargeBuffers) {}
+
+private:
+    RxFrame frames[POOL_SIZE + LargeBuffers];
+    uint8_t storage[POOL_SIZE * WIRE_V1_FRAME + LargeBuffers * WIRE_MAX_FRAME];
+};
+
+} // namespace NuggetsInc
+
+#endif // RX_QUEUE_H
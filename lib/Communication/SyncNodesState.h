@@ -3,9 +3,8 @@
 
 #include "State.h"
 #include "DisplayUtils.h"
+#include "NodeSync.h"
 #include <vector>
-#include <WiFi.h>
-#include <esp_now.h>
 
 namespace NuggetsInc {
 
@@ -19,22 +18,18 @@ public:
     void update() override;
 
 private:
-    DisplayUtils* displayUtils;
+    DisplayUtils displayUtils;
     std::vector<String> macAddresses;
-    int currentBroadcastIndex;
-    unsigned long lastBroadcastTime;
-    unsigned long broadcastStartTime;
-    bool broadcastInProgress;
-    bool broadcastComplete;
-    
-    static const unsigned long BROADCAST_INTERVAL = 1000; 
-    static const unsigned long BROADCAST_TIMEOUT = 10000; 
-    
+    NodeSync* nodeSync;
+    bool syncStarted;
+
+    static const int16_t NODE_LIST_Y = 60;
+    static const int16_t NODE_LINE_HEIGHT = 11;
+
     void loadMacAddresses();
-    void startBroadcast();
-    void broadcastToNextNode();
-    void sendSyncCommand(const String& targetMac);
+    void startSync();
     void updateDisplay();
+    void drawNode(const NodeSync::Node& node, int16_t y);
 
     static SyncNodesState* activeInstance;
 };
@@ -0,0 +1,175 @@
+// WireFormat.h
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <Arduino.h>
+#include <esp_now.h>
+#include "MessageTypes.h"
+
+namespace NuggetsInc {
+
+// What goes over ESP-NOW, independent of the encoding used for it
+enum WireFrameType : uint8_t {
+    WIRE_CMD = 1,
+    WIRE_ACK = 2,
+};
+
+// Encoding spoken by a peer
+enum WireVersion : uint8_t {
+    WIRE_UNKNOWN = 0,
+    WIRE_LEGACY,  // the fixed 205-byte struct_message
+    WIRE_COMPACT, // the variable-length frame below
+};
+
+// ESP-NOW v1 frames stop at 250 bytes. ESP-NOW v2 (ESP-IDF 5.4 and later)
+// takes up to 1470, but only between two nodes that both run it, so frames
+// over the v1 size only go to peers that have said they take them.
+static const uint16_t WIRE_V1_FRAME = 250;
+#ifdef ESP_NOW_MAX_DATA_LEN_V2
+static const uint16_t WIRE_MAX_FRAME = ESP_NOW_MAX_DATA_LEN_V2;
+#else
+static const uint16_t WIRE_MAX_FRAME = WIRE_V1_FRAME;
+#endif
+// Longest header of an unrouted compact command, with the frame-size
+// trailer a command may carry to a peer that asked for it
+static const uint16_t WIRE_COMPACT_OVERHEAD = 12;
+// Largest payload a WireMessage holds: an unrouted compact command this big
+// fills the largest frame exactly. A v1 frame takes WIRE_V1_PAYLOAD, the
+// legacy format at most 49.
+static const uint16_t WIRE_V1_PAYLOAD = WIRE_V1_FRAME - WIRE_COMPACT_OVERHEAD;
+static const uint16_t WIRE_MAX_PAYLOAD = WIRE_MAX_FRAME - WIRE_COMPACT_OVERHEAD;
+static const uint8_t WIRE_MAX_HOPS = 7;
+
+struct WireMessage {
+    WireFrameType type;
+    uint32_t messageID;
+    uint8_t commandID;
+    // The payload holds DisplayCodec binary arguments rather than text
+    bool typed;
+
+    // Routing, only when `routed`: the node that created the message, where
+    // it is going and the nodes it has passed through
+    bool routed;
+    uint8_t origin[6];
+    uint8_t destination[6];
+    uint8_t hopCount;
+    uint8_t hops[WIRE_MAX_HOPS][6];
+
+    uint16_t payloadLength;
+    char payload[WIRE_MAX_PAYLOAD + 1]; // NUL-terminated, so text payloads can be used as is
+
+    // Acks only, compact format: how many more frames the sender of the
+    // command may have in flight towards the receiver
+    bool hasCredit;
+    uint8_t credit;
+
+    // Compact format: the largest frame the sender takes, 0 if not sent,
+    // and whether it wants the receiver's in return
+    uint16_t frameSize;
+    bool frameSizeRequest;
+};
+
+// Compact frame, version 1:
+//
+//   byte 0     0xE0 | version
+//   byte 1     frame type in the low nibble, flags in the high nibble
+//              (FLAG_ROUTED, FLAG_TYPED for DisplayCodec binary payloads,
+//              FLAG_CREDIT, FLAG_FRAME_SIZE)
+//   varint     messageID
+//   CMD only:  commandID, then a varint payload length and the payload
+//   routed:    origin[6], destination[6], hop count, hops[count][6]
+//   ACK with FLAG_CREDIT: the receiver's credit, one byte
+//   FLAG_FRAME_SIZE: the sender's largest frame, 2 bytes little-endian, with
+//              FRAME_SIZE_REQUEST set when it wants the receiver's back
+//
+// A tap on the remote is 7 bytes and an ack 5 (6 with credit), against 205
+// for both in the legacy format. Version 1 decoders ignore FLAG_CREDIT,
+// FLAG_FRAME_SIZE and the trailing bytes they add. Legacy frames are
+// recognised by their exact size and the "cmd"/"ack" text at their
+// messageType offset; compact frames are padded by a byte on the rare
+// occasion they would come out at that size.
+//
+// Peers are assumed legacy until they show otherwise. Legacy frames sent by
+// this firmware carry a marker after the messageType text, which older
+// firmware ignores; a peer that sees it answers in the compact format, and
+// from then on both ends use it.
+//
+// Frame sizes are settled per link the same way, on the first compact
+// frames: a node that could send more than a v1 frame asks each neighbour
+// for its frame size (FRAME_SIZE_REQUEST), up to FRAME_SIZE_REQUESTS times,
+// and every node answers a request on its next frame to the one asking.
+// Both ends then send frames up to the smaller of their two sizes; a peer
+// that never answers is held to v1 frames.
+class WireFormat {
+public:
+    static const uint8_t COMPACT_MAGIC = 0xE0;
+    static const uint8_t COMPACT_VERSION = 1;
+    static const uint8_t FLAG_ROUTED = 0x10;
+    static const uint8_t FLAG_TYPED = 0x20;
+    static const uint8_t FLAG_CREDIT = 0x40;
+    static const uint8_t FLAG_FRAME_SIZE = 0x80;
+    static const uint16_t FRAME_SIZE_REQUEST = 0x8000;
+    static const uint8_t FRAME_SIZE_REQUESTS = 8;
+    static const uint8_t MAX_LEGACY_PAYLOAD = sizeof(struct_message::data) - 1;
+    // Enough for any frame encode() produces
+    static const size_t MAX_FRAME_SIZE = WIRE_MAX_FRAME;
+    // Origin, destination and hop count of a routed compact frame, before
+    // the hops themselves
+    static const uint8_t ROUTING_SIZE = 13;
+
+    static void initCommand(WireMessage& message, uint32_t messageID, uint8_t commandID,
+                            const char* payload = nullptr);
+    // Binary payload, which only the compact format can carry
+    static void initCommand(WireMessage& message, uint32_t messageID, uint8_t commandID,
+                            const uint8_t* payload, size_t length);
+    static void initAck(WireMessage& message, uint32_t messageID);
+
+    // Returns the frame length, or 0 if the message does not fit the
+    // format (a legacy payload over 49 bytes, for instance). `self` is the
+    // legacy SenderMac.
+    static size_t encode(const WireMessage& message, WireVersion version, const uint8_t self[6],
+                         uint8_t* out, size_t capacity);
+    // `version` is set to the format the frame was in; `advertisesCompact`
+    // says whether a legacy frame came from firmware that also speaks the
+    // compact format.
+    static bool decode(const uint8_t* data, int len, WireMessage& message, WireVersion& version,
+                       bool& advertisesCompact);
+
+    // The encoding to use towards a peer, learned from what it sent us
+    static WireVersion peerVersion(const uint8_t mac[6]);
+    static void notePeerVersion(const uint8_t mac[6], WireVersion version);
+
+    // Largest frame the link to a peer takes, WIRE_V1_FRAME until it has said
+    static uint16_t peerFrameSize(const uint8_t mac[6]);
+    // Largest payload of an unrouted command to a peer, in the format it speaks
+    static uint16_t maxPayload(const uint8_t mac[6]);
+    // The frame size a received message carries, if any, from `mac`
+    static void notePeerFrameSize(const uint8_t mac[6], const WireMessage& message);
+    // Puts our frame size on a compact frame to `mac` when the peer has
+    // asked for it, or when we still want the peer's
+    static void advertiseFrameSize(const uint8_t mac[6], WireMessage& message);
+
+    // Command messageIDs come from one sequence for the whole device: a
+    // peer's ReplayWindow knows us by MAC alone, whichever service sends.
+    // A sender starting a session calls beginMessageIDs(), which moves the
+    // sequence on to millis() if it is behind, so IDs never go back within a
+    // boot however quickly sessions follow each other. Never 0, which marks
+    // unacked broadcasts. Main loop only.
+    static void beginMessageIDs();
+    static uint32_t nextMessageID();
+    // The ID nextMessageID() last returned
+    static uint32_t lastMessageID();
+
+    static const uint8_t MAX_KNOWN_PEERS = 20;
+
+private:
+    static size_t encodeLegacy(const WireMessage& message, const uint8_t self[6], uint8_t* out,
+                               size_t capacity);
+    static size_t encodeCompact(const WireMessage& message, uint8_t* out, size_t capacity);
+    static bool decodeLegacy(const uint8_t* data, WireMessage& message, bool& advertisesCompact);
+    static bool decodeCompact(const uint8_t* data, int len, WireMessage& message);
+};
+
+} // namespace NuggetsInc
+
+#endif // WIRE_FORMAT_H
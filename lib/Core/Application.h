@@ -2,6 +2,10 @@
 #define APPLICATION_H
 
 #include "State.h"
+#include "StateFactory.h"
+#include "TimerService.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 namespace NuggetsInc {
 
@@ -15,12 +19,56 @@ public:
 
     void init();
     void run();
+    // Navigation. States come from StateFactory; a state that is left is
+    // destroyed in place unless it is retained.
+    //
+    // changeState() replaces the current state. pushState() enters a state
+    // on top of a retained current state, which is suspended until the new
+    // one is popped; over any other state it behaves like changeState().
+    // Entering a state that is already on the stack returns to it instead,
+    // leaving everything above it.
     void changeState(AppState* newState);
+    void pushState(AppState* newState);
+    void popState();
+    void popToRoot();
+
+    // Instead of delay(): the current state has drawn a message and wants it
+    // to stay up. holdState() stops updating the state for holdMs while the
+    // loop keeps servicing timers, radio and input, so nothing is dropped.
+    // changeStateAfter() also changes to `next` once the time is up, as
+    // changeState(StateFactory::createState(next, peerMac)) would. Any
+    // navigation in the meantime ends the hold.
+    void holdState(uint32_t holdMs);
+    void changeStateAfter(uint32_t holdMs, StateType next, const uint8_t* peerMac = nullptr);
+
+    // Wake the main loop so the current state is updated now. Safe from any
+    // task; use wakeFromISR() inside interrupt handlers.
+    void wake();
+    static void wakeFromISR();
 
 private:
     Application(); // Private constructor
 
-    AppState* currentState;
+    AppState* currentState() const;
+    void leaveState(AppState* state);
+    bool returnTo(AppState* state);
+    void cancelHold();
+    static void onHoldExpired(void* context);
+
+    // Retained states only sit below the top, so the depth is bounded by
+    // how deeply the menus nest
+    static const uint8_t NAV_STACK_DEPTH = 6;
+    AppState* navStack[NAV_STACK_DEPTH];
+    uint8_t navDepth;
+
+    bool holding;
+    TimerService::TimerId holdTimer;
+    bool hasPendingState;
+    StateType pendingState;
+    bool hasPendingMac;
+    uint8_t pendingMac[6];
+
+    TaskHandle_t loopTaskHandle;
 };
 
 } // namespace NuggetsInc
@@ -32,9 +32,6 @@ public:
 
     void goToDeepSleep();
 
-    // Update device state and generate events
-    void update();
-
     #define SCREEN_WIDTH 536
     #define SCREEN_HEIGHT 220
 
@@ -65,34 +62,13 @@ public:
 
 private:
     Device(); // Private constructor
+    static void finishDeepSleep(void* context);
+
+    // How long the motor buzzes before the device goes to sleep
+    static const uint32_t SLEEP_VIBRATION_MS = 500;
+
     Arduino_DataBus* bus;
     Arduino_GFX* gfx;
-
-    // Input state tracking
-    bool upPressed;
-    bool downPressed;
-    bool leftPressed;
-    bool rightPressed;
-    bool selectPressed;
-    bool backPressed;
-    bool actionOnePressed;
-    bool actionTwoPressed;
-
-    // Debounce tracking
-    unsigned long lastUpPressTime;
-    unsigned long lastDownPressTime;
-    unsigned long lastLeftPressTime;
-    unsigned long lastRightPressTime;
-    unsigned long lastSelectPressTime;
-    unsigned long lastBackPressTime;
-    unsigned long lastActionOnePressTime;
-    unsigned long lastActionTwoPressTime;
-    
-    const unsigned long debounceInterval = 200; 
-
-    // Variables for long press detection
-    unsigned long lastBackButtonPressTime;  
-    const unsigned long doublePressThreshold = 500;
 };
 
 } // namespace NuggetsInc
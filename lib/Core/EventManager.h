@@ -1,8 +1,10 @@
 #ifndef EVENTMANAGER_H
 #define EVENTMANAGER_H
 
-#include <queue>
-#include <functional>
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "RingBuffer.h"
 
 namespace NuggetsInc {
 
@@ -15,12 +17,30 @@ enum EventType {
     EVENT_SELECT,
     EVENT_BACK,
     EVENT_ACTION_ONE,
-    EVENT_ACTION_TWO
+    EVENT_ACTION_TWO,
+    EVENT_RELEASE,      // data: EventType of the released button
+    EVENT_LONG_PRESS,   // data: EventType of the held button
+    EVENT_CHORD,        // data: mask of held buttons
+    EVENT_SLEEP_REQUEST // handled by getNextEvent(), never returned
+};
+
+// Where an event was produced
+enum EventSource : uint8_t {
+    EVENT_SOURCE_UNKNOWN = 0,
+    EVENT_SOURCE_BUTTON,
+    EVENT_SOURCE_IR,
+    EVENT_SOURCE_ESPNOW,
+    EVENT_SOURCE_NFC,
+    EVENT_SOURCE_TIMER,
+    EVENT_SOURCE_SYSTEM
 };
 
 struct Event {
     EventType type;
-    // Additional event data can be added here
+    uint8_t source;       // EventSource
+    uint16_t data;        // type-specific payload
+    uint32_t timestampUs; // micros() when produced; stamped on queueing if left 0
+    uint32_t queuedUs;    // micros() when queued; always set by EventManager
 };
 
 class EventManager {
@@ -31,13 +51,38 @@ public:
     EventManager(const EventManager&) = delete;
     EventManager& operator=(const EventManager&) = delete;
 
-    void queueEvent(const Event& event);
+    static const size_t QUEUE_CAPACITY = 32;
+
+    // Safe from any task. Returns false (and counts an overflow) when full.
+    bool queueEvent(const Event& event);
+    // Same as queueEvent, for use inside interrupt handlers.
+    bool queueEventFromISR(const Event& event);
+
+    // Main loop only. A queued EVENT_SLEEP_REQUEST puts the device to sleep
+    // here, so other tasks never tear down what the main loop is using.
     bool getNextEvent(Event& event);
     void clearEvents();
 
+    // Task notified whenever an event is queued
+    void setConsumerTask(TaskHandle_t task) { consumerTask = task; }
+
+    // Microseconds between an event being produced and now
+    static uint32_t eventAgeUs(const Event& event) { return (uint32_t)micros() - event.timestampUs; }
+
+    // Diagnostics
+    uint32_t getOverflowCount() const { return overflowCount.load(std::memory_order_relaxed); }
+    uint32_t getHighWaterMark() const { return highWaterMark.load(std::memory_order_relaxed); }
+    size_t getPendingCount() const { return eventQueue.size(); }
+    void resetCounters();
+
 private:
     EventManager();
-    std::queue<Event> eventQueue;
+    bool enqueue(const Event& event);
+
+    RingBuffer<Event, QUEUE_CAPACITY> eventQueue;
+    std::atomic<uint32_t> overflowCount;
+    std::atomic<uint32_t> highWaterMark;
+    TaskHandle_t consumerTask;
 };
 
 } // namespace NuggetsInc
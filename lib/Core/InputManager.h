@@ -0,0 +1,101 @@
+#ifndef INPUTMANAGER_H
+#define INPUTMANAGER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "EventManager.h"
+
+namespace NuggetsInc {
+
+// Event.data layout for button events:
+//   EVENT_UP..EVENT_ACTION_TWO   low byte = the same EventType, INPUT_FLAG_REPEAT
+//                                set on auto-repeats
+//   EVENT_RELEASE, EVENT_LONG_PRESS  low byte = EventType of the button
+//   EVENT_CHORD                  mask of held buttons (1 << InputButton)
+static const uint16_t INPUT_FLAG_REPEAT = 0x8000;
+
+static inline EventType buttonEventOf(const Event& event) {
+    return static_cast<EventType>(event.data & 0xFF);
+}
+
+static inline bool isRepeat(const Event& event) {
+    return (event.data & INPUT_FLAG_REPEAT) != 0;
+}
+
+enum InputButton {
+    INPUT_UP,
+    INPUT_DOWN,
+    INPUT_LEFT,
+    INPUT_RIGHT,
+    INPUT_CENTER,
+    INPUT_SET,
+    INPUT_BACK,
+    INPUT_ACTION_ONE,
+    INPUT_ACTION_TWO,
+    INPUT_BUTTON_COUNT
+};
+
+// Interrupt-driven button input.
+//
+// Every button pin raises a CHANGE interrupt that only wakes the input task.
+// The task then samples the pins once per tick, debouncing each with a small
+// integrator, until every pin has settled; while nothing moves it sleeps on
+// its notification, waking early only for long-press and auto-repeat
+// deadlines. Debounced transitions are published to EventManager.
+class InputManager {
+public:
+    static InputManager& getInstance();
+
+    // Prevent copying
+    InputManager(const InputManager&) = delete;
+    InputManager& operator=(const InputManager&) = delete;
+
+    // Configure the pins, attach interrupts and start the input task
+    void begin();
+    void end();
+
+    bool isPressed(InputButton button) const;
+    uint16_t getHeldMask() const { return heldMask; }
+
+    static const uint8_t DEBOUNCE_SAMPLES = 4;          // 1 ms per sample
+    static const uint32_t LONG_PRESS_MS = 600;
+    static const uint32_t REPEAT_DELAY_MS = 400;
+    static const uint32_t REPEAT_INTERVAL_MS = 100;
+    static const uint32_t DOUBLE_PRESS_THRESHOLD_MS = 500;
+
+private:
+    InputManager();
+
+    static void IRAM_ATTR onPinChange(void* arg);
+    static void inputTask(void* parameter);
+
+    // Samples every pin once; returns true when all of them have settled
+    bool sample(uint32_t nowMs);
+    void onPressed(InputButton button, uint32_t nowMs);
+    void onReleased(InputButton button, uint32_t nowMs);
+    // Long-press and auto-repeat; returns ms until the next deadline
+    uint32_t serviceHeld(uint32_t nowMs);
+    uint32_t edgeTimestamp(InputButton button) const;
+
+    struct ButtonState {
+        uint8_t integrator;
+        bool pressed;
+        bool longPressSent;
+        uint32_t pressedAtMs;
+        uint32_t nextRepeatMs;
+    };
+
+    TaskHandle_t inputTaskHandle;
+    ButtonState buttons[INPUT_BUTTON_COUNT];
+    volatile uint16_t heldMask;
+    uint32_t lastBackPressMs;
+
+    // micros() of the first edge of each bounce burst, written by the ISR
+    volatile uint32_t edgeUs[INPUT_BUTTON_COUNT];
+    volatile bool edgeLatched[INPUT_BUTTON_COUNT];
+};
+
+} // namespace NuggetsInc
+
+#endif // INPUTMANAGER_H
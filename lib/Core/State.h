@@ -6,12 +6,26 @@
 
 namespace NuggetsInc {
 
+// Returned by getUpdateDelay() when a state has nothing to do until woken
+static const uint32_t UPDATE_ON_EVENT = 0xFFFFFFFF;
+
 class AppState {
 public:
     virtual ~AppState() {}
     virtual void onEnter() = 0;
     virtual void onExit() = 0;
     virtual void update() = 0;
+
+    // How long (ms) the main loop may sleep before update() has to run
+    // again. The loop is always woken early by input, radio traffic, NFC and
+    // state changes, so only states with timed work need to override this.
+    virtual uint32_t getUpdateDelay() { return UPDATE_ON_EVENT; }
+
+    // Only retained states (see StateFactory) are ever suspended: when a
+    // state is pushed over them and when they become current again. The
+    // screen belongs to the other state in between, so onResume() repaints.
+    virtual void onSuspend() {}
+    virtual void onResume() { onEnter(); }
 };
 
 } // namespace NuggetsInc
@@ -23,12 +23,37 @@ enum StateType {
     SETTINGS_STATE,
     MAC_ADDRESS_MENU_STATE,
     SYNC_NODES_STATE,
+
+    STATE_TYPE_COUNT
 };
 
+// Every state is constructed in place in static storage, so navigating never
+// touches the heap. There are two slots: one sized for the largest state and
+// one for ClearState. Each transition goes current -> ClearState -> next, so
+// the outgoing state is always destroyed before the next one is built in the
+// shared slot.
+//
+// The menus other screens return to (MENU, NFC_OPTIONS, IR_OPTIONS and
+// APPLICATION) are retained instead: each has a resident instance, built on
+// first use and never destroyed, that is returned directly without going
+// through ClearState. Application keeps them suspended under the states
+// pushed from them.
+//
+// States returned here must be released with destroyState(), never delete.
 class StateFactory {
 public:
-    static AppState* createState(StateType type);
-    static AppState* createActualState(StateType type);
+    // Returns a ClearState that blanks the screen and then enters `type`.
+    // `peerMac` is handed to states that talk to a paired device.
+    static AppState* createState(StateType type, const uint8_t* peerMac = nullptr);
+    static AppState* createActualState(StateType type, const uint8_t* peerMac = nullptr);
+    // Destroys transient states; retained ones are left alone
+    static void destroyState(AppState* state);
+    static bool isRetained(const AppState* state);
+    // The type a live state was created as, for diagnostics
+    static StateType typeOf(const AppState* state);
+
+    // Bytes reserved for states, for diagnostics
+    static size_t storageSize();
 };
 
 } // namespace NuggetsInc
@@ -0,0 +1,100 @@
+#ifndef TIMERSERVICE_H
+#define TIMERSERVICE_H
+
+#include <Arduino.h>
+
+namespace NuggetsInc {
+
+// One-shot and periodic callbacks run on the main loop.
+//
+// Timers sit in a fixed-size min-heap ordered by due time, so the loop can
+// sleep exactly until the earliest one. Callbacks run from Application::run()
+// before the current state is updated and may schedule or cancel timers,
+// change state, or draw. Scheduling and cancelling are safe from any task;
+// nothing is allocated.
+//
+// Pass the owning object as the context so its timers can be dropped with
+// cancelAll(); Application does that for every state it leaves.
+//
+// Periodic work should be registered as a Job. A job's slack lets it run a
+// little late so that it shares a wakeup with whatever else is due: the loop
+// sleeps until the first moment some timer would run out of slack, then runs
+// everything that is due. A job that starts later than its deadline is
+// counted as a miss; the first miss is logged straight away and the totals
+// when the job is cancelled, and report() lists them for the live jobs.
+class TimerService {
+public:
+    typedef void (*Callback)(void* context);
+    typedef uint16_t TimerId;
+
+    struct Job {
+        const char* name;    // for logs and report(); a string literal
+        uint32_t periodMs;
+        uint32_t slackMs;    // how late the job may run to share a wakeup
+        uint32_t deadlineMs; // later than this after its due time is a miss; 0 for one period
+    };
+
+    static const TimerId INVALID_TIMER = 0;
+    static const uint8_t MAX_TIMERS = 16;
+    // Returned by msUntilNext() when nothing is scheduled
+    static const uint32_t NO_TIMER = 0xFFFFFFFF;
+
+    static TimerService& getInstance();
+
+    // Prevent copying
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+
+    // Return INVALID_TIMER when all MAX_TIMERS slots are taken
+    TimerId scheduleOnce(uint32_t delayMs, Callback callback, void* context);
+    TimerId schedulePeriodic(uint32_t periodMs, Callback callback, void* context);
+    TimerId schedulePeriodic(const Job& job, Callback callback, void* context);
+
+    bool cancel(TimerId id);
+    void cancelAll(void* context);
+
+    // Main loop only: runs every callback that has come due
+    void runDue();
+    // How long the loop may sleep: until the first timer runs out of slack
+    uint32_t msUntilNext();
+
+    // Deadline misses over the life of the device
+    uint32_t getMissedDeadlines() const { return missedDeadlines; }
+    // Runs, misses and worst lateness of every live job
+    void report(Print& out);
+
+private:
+    TimerService();
+
+    struct Timer {
+        uint32_t dueMs;
+        uint32_t periodMs;   // 0 for one-shot timers
+        uint32_t slackMs;
+        uint32_t deadlineMs; // 0 when the timer is not a Job
+        Callback callback;
+        void* context;
+        const char* name;
+        uint32_t runs;
+        uint32_t misses;
+        uint32_t worstLateMs;
+        TimerId id;
+    };
+
+    TimerId schedule(uint32_t delayMs, const Job& job, Callback callback, void* context);
+    void recordLateness(Timer& timer, uint32_t lateMs);
+    static void reportRemoved(const Timer& timer);
+    // Heap helpers; the caller holds the lock
+    void insert(const Timer& timer);
+    void removeAt(uint8_t index);
+    void siftUp(uint8_t index);
+    void siftDown(uint8_t index);
+
+    Timer timers[MAX_TIMERS];
+    uint8_t count;
+    TimerId nextId;
+    uint32_t missedDeadlines;
+};
+
+} // namespace NuggetsInc
+
+#endif // TIMERSERVICE_H
@@ -0,0 +1,49 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <Arduino.h>
+
+namespace NuggetsInc {
+
+// On-device benchmarks. They are only compiled in with -DNUGGETS_BENCHMARKS
+// (the T-Display-AMOLED-bench environment) and run once during
+// Application::init(), before the first state is entered. Results are
+// printed to Serial.
+#ifdef NUGGETS_BENCHMARKS
+
+void runBenchmarks();
+
+// Cycles StateFactory through STATE_BENCHMARK_TRANSITIONS transitions and
+// reports the time per transition and the heap before and after
+void runStateBenchmark();
+
+static const uint32_t STATE_BENCHMARK_TRANSITIONS = 10000;
+
+// Enters the main menu, then pushes and pops a retained submenu over it,
+// timing the push (full draw) and the pop back to the suspended menu
+void runNavigationBenchmark();
+
+static const uint32_t NAVIGATION_BENCHMARK_ROUNDS = 200;
+
+// Feeds the same stream of received frames, fresh commands mixed with
+// retransmissions, to ReplayWindow and to the std::map cache it replaced,
+// and reports the time per frame, allocations and wrong verdicts
+void runReplayBenchmark();
+
+static const uint32_t REPLAY_BENCHMARK_FRAMES = 20000;
+static const uint8_t REPLAY_BENCHMARK_SENDERS = 4;
+static const uint32_t REPLAY_BENCHMARK_FRAME_SPACING_MS = 5;
+
+// Decodes a mix of display commands from their text form with sscanf, as
+// RemoteControlState used to, with DisplayCodec::parseText and from the
+// binary form, and reports the time per command and the bytes each form takes
+void runDisplayCodecBenchmark();
+
+static const uint32_t DISPLAY_CODEC_BENCHMARK_COMMANDS = 20000;
+static const uint32_t DISPLAY_CODEC_BENCHMARK_SAMPLES = 256;
+
+#endif // NUGGETS_BENCHMARKS
+
+} // namespace NuggetsInc
+
+#endif // BENCHMARKS_H
@@ -0,0 +1,42 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <Arduino.h>
+
+namespace NuggetsInc {
+
+// Microsecond latencies in buckets four to a power of two, so quantiles
+// are reported within about 12% of the true value. Counts are 16 bit: when
+// one would overflow, every bucket is halved, which keeps the shape of the
+// distribution while slowly ageing out old samples.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint32_t us);
+    void reset();
+
+    // Samples recorded since the last reset, not affected by halving
+    uint32_t count() const { return samples; }
+    // Upper bound of the bucket holding the pct-th percentile
+    uint32_t percentile(uint8_t pct) const;
+    uint32_t max() const { return maxUs; }
+
+    // One report line: label, count, p50, p99 and max
+    void print(Print& out, const char* label) const;
+
+    // Values from 2^24 us (about 16 s) up share the last bucket
+    static const int BUCKETS = 92;
+
+private:
+    static int bucketFor(uint32_t us);
+    static uint32_t bucketUpperBound(int index);
+
+    uint16_t buckets[BUCKETS];
+    uint32_t samples;
+    uint32_t maxUs;
+};
+
+} // namespace NuggetsInc
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,73 @@
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#include <Arduino.h>
+#include "EventManager.h"
+#include "LatencyHistogram.h"
+
+// Input-to-radio latency of remote control mode, compiled in with
+// -DNUGGETS_BENCHMARKS. Every button press that RemoteControlState turns
+// into a command is followed through four timestamps: the GPIO edge, its
+// event being queued, esp_now_send() returning and the peer's ack (which
+// echoes the messageID) arriving. Press SELECT in remote control mode to
+// show the distributions on screen and print them to Serial.
+#ifdef NUGGETS_BENCHMARKS
+
+namespace NuggetsInc {
+
+class DisplayUtils;
+
+class LatencyProbe {
+public:
+    static LatencyProbe& getInstance();
+
+    // Prevent copying
+    LatencyProbe(const LatencyProbe&) = delete;
+    LatencyProbe& operator=(const LatencyProbe&) = delete;
+
+    // Main loop: `event` is about to be sent as a command
+    void beginSample(const Event& event);
+    // Main loop: esp_now_send() returned for the command of the open sample
+    void commandSent(uint32_t messageID, bool accepted);
+    // The peer's ack for messageID came off the radio at receivedUs
+    void ackReceived(uint32_t messageID, uint32_t receivedUs);
+
+    void report(Print& out);
+    void show(DisplayUtils& display);
+    void reset();
+
+    // Commands still waiting for their ack; older ones count as lost
+    static const uint8_t MAX_IN_FLIGHT = 16;
+
+private:
+    LatencyProbe();
+
+    struct Sample {
+        uint32_t messageID;
+        uint32_t edgeUs;
+        uint32_t sentUs;
+        bool waiting;
+    };
+
+    bool hasOpenSample;
+    Event openEvent;
+    uint32_t dispatchUs;
+
+    Sample inFlight[MAX_IN_FLIGHT];
+    uint8_t nextSlot;
+
+    LatencyHistogram edgeToQueued;
+    LatencyHistogram queuedToDispatch;
+    LatencyHistogram dispatchToSent;
+    LatencyHistogram sentToAck;
+    LatencyHistogram edgeToAck;
+    uint32_t sendFailures;
+    uint32_t lostAcks;
+    uint32_t unmatchedAcks;
+};
+
+} // namespace NuggetsInc
+
+#endif // NUGGETS_BENCHMARKS
+
+#endif // LATENCY_PROBE_H
@@ -0,0 +1,96 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+#include "StateFactory.h"
+#include "LatencyHistogram.h"
+
+// Main-loop profiling. Only compiled in with -DNUGGETS_PROFILING; without it
+// the class does not exist and PROFILE_BLOCKING() expands to nothing, so
+// none of this costs a byte. With it, every loop iteration costs a few
+// micros() calls and histogram increments, cheap enough to leave on.
+//
+// Send "prof" over the USB serial console to print the report and
+// "prof reset" to start a new measurement window.
+#ifdef NUGGETS_PROFILING
+
+namespace NuggetsInc {
+
+class Profiler {
+public:
+    static Profiler& getInstance();
+
+    // Prevent copying
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Starts the measurement window and the serial console poll
+    void begin();
+
+    // Called by Application::run(). busyUs is the time from waking to going
+    // back to sleep.
+    void recordLoop(uint32_t busyUs);
+    void recordTimers(uint32_t us);
+    void recordUpdate(StateType type, uint32_t us);
+
+    // Time spent in a call that blocks the main loop (bus transfers, tone
+    // delays). `site` must be a string literal; sites are told apart by
+    // address. Use PROFILE_BLOCKING() rather than calling this directly.
+    void recordBlocking(const char* site, uint32_t us);
+
+    void dump(Print& out);
+    void reset();
+
+    static const uint8_t MAX_BLOCKING_SITES = 12;
+    static const uint32_t CONSOLE_POLL_MS = 500;
+
+private:
+    Profiler();
+
+    struct BlockingSite {
+        const char* name;
+        uint32_t count;
+        uint32_t totalUs;
+        uint32_t maxUs;
+    };
+
+    static void pollConsole(void* context);
+    void handleCommand(const char* command);
+
+    LatencyHistogram loopTimes;
+    LatencyHistogram timerTimes;
+    LatencyHistogram updateTimes[STATE_TYPE_COUNT];
+    uint32_t loops;
+    uint64_t busyUs;
+    uint32_t windowStartMs;
+
+    BlockingSite blocking[MAX_BLOCKING_SITES];
+    uint8_t blockingCount;
+    uint32_t blockingDropped;
+
+    char command[24];
+    uint8_t commandLength;
+};
+
+// Times the enclosing scope as a blocking call
+class BlockingScope {
+public:
+    explicit BlockingScope(const char* site) : site(site), startUs(micros()) {}
+    ~BlockingScope() { Profiler::getInstance().recordBlocking(site, micros() - startUs); }
+
+private:
+    const char* site;
+    uint32_t startUs;
+};
+
+} // namespace NuggetsInc
+
+#define PROFILE_BLOCKING(site) NuggetsInc::BlockingScope profileBlockingScope(site)
+
+#else
+
+#define PROFILE_BLOCKING(site) do { } while (0)
+
+#endif // NUGGETS_PROFILING
+
+#endif // PROFILER_H
@@ -2,7 +2,6 @@
 #define APPLICATION_STATE_H
 
 #include "State.h"
-#include "DisplayUtils.h"
 
 namespace NuggetsInc
 {
@@ -20,12 +19,13 @@ namespace NuggetsInc
     private:
         void displayMenu();
         void executeSelection();
+        void moveSelection(int step);
+        void drawMenuItem(int index);
 
         static const int menuItems = 1; // Initially, only Snake Game
-        String menu[menuItems];
+        static const int rowHeight = 30;
+        const char* menu[menuItems];
         int menuIndex;
-
-        DisplayUtils *displayUtils;
     };
 
 } // namespace NuggetsInc
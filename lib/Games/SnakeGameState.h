@@ -3,6 +3,7 @@
 
 #include "State.h"
 #include "Device.h" 
+#include "TimerService.h"
 
 namespace NuggetsInc {
 
@@ -16,8 +17,10 @@ public:
     void update() override;
 
 private:
+    static void onTick(void* context);
     void initGame();
-    void updateSnake();
+    // Returns false when the move ended the game
+    bool updateSnake();
     void drawGame();
     void spawnApple();
     void gameOver();
@@ -39,8 +42,12 @@ private:
     Point prevApple;
     int snakeDirection; // 0=up, 1=right, 2=down, 3=left
 
-    unsigned long lastUpdateTime;
+    TimerService::TimerId tickTimer;
     unsigned long updateInterval;
+    // A tick may run this late to share a wakeup; later than the deadline
+    // is a visible stutter
+    static const uint32_t TICK_SLACK_MS = 10;
+    static const uint32_t TICK_DEADLINE_MS = 50;
 
     int score;
     bool updateScore;
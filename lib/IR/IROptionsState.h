@@ -2,7 +2,6 @@
 #define IR_OPTIONS_STATE_H
 
 #include "State.h"
-#include "DisplayUtils.h"
 
 namespace NuggetsInc {
 
@@ -18,12 +17,13 @@ public:
 private:
     void displayMenu();
     void executeSelection();
+    void moveSelection(int step);
+    void drawMenuItem(int index);
 
     static const int menuItems = 1; // Two options: Remote Browser and Setup New Remote
-    String menu[menuItems];
+    static const int rowHeight = 30;
+    const char* menu[menuItems];
     int menuIndex;
-
-    DisplayUtils* displayUtils;
 };
 
 } // namespace NuggetsInc
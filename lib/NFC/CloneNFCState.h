@@ -20,6 +20,7 @@ public:
     void onEnter() override;
     void onExit() override;
     void update() override;
+    uint32_t getUpdateDelay() override;
 
 private:
     // NFC functions
@@ -33,8 +34,8 @@ private:
     bool cloneTagData;          // (This flag may be repurposed or removed)
     bool displayNeedsRefresh;
     Tab currentTabWindow;
-    NFCLogic* nfcLogic;
-    DisplayUtils* displayUtils;
+    NFCLogic& nfcLogic;
+    DisplayUtils displayUtils;
     TagData* currentTagData;
     void displayTagInformation();
     std::vector<Tab> tabs;
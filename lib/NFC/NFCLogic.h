@@ -9,22 +9,51 @@
 #include "TagData.h"
 
 namespace NuggetsInc {
+// One NFCLogic drives the PN532 for every NFC state. It is shared rather than
+// owned per state because Adafruit_PN532 allocates its bus device on
+// construction and never frees it.
 class NFCLogic {
 public:
-    NFCLogic(uint8_t irqPin, uint8_t resetPin);
-    ~NFCLogic();
+    static NFCLogic& getInstance();
+
+    // Prevent copying
+    NFCLogic(const NFCLogic&) = delete;
+    NFCLogic& operator=(const NFCLogic&) = delete;
 
     bool initialize();
 
     bool isTagPresent();
     const std::vector<uint8_t>& readRawData();
 
+    // Event-driven tag detection: the PN532 is armed to report the next tag
+    // entering the field on its IRQ line, which wakes the main loop. Returns
+    // true when the caller should look for a tag (call isTagPresent() etc.):
+    // right after the IRQ fired, or every TAG_CHECK_FALLBACK_MS in case the
+    // line is not wired. Re-arms itself on the next call.
+    bool tagCheckDue();
+    // Milliseconds until tagCheckDue() could next return true
+    uint32_t msUntilTagCheck() const;
+    void stopTagDetection();
+
+    static const uint32_t TAG_CHECK_FALLBACK_MS = 500;
+
     bool writeTagData(const TagData& tagData);
     bool overwriteRecords(uint16_t tagType);
 
 private:
+    NFCLogic(uint8_t irqPin, uint8_t resetPin);
+    ~NFCLogic();
+
+    static void IRAM_ATTR onIrq(void* arg);
+
     Adafruit_PN532 nfc;
     bool authenticated;
+
+    uint8_t irqPin;
+    bool irqAttached;
+    bool detectionArmed;
+    volatile bool irqFired;
+    uint32_t lastTagCheckMs;
 };
 
 } // namespace NuggetsInc
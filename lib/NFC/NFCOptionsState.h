@@ -2,7 +2,6 @@
 #define NFC_OPTIONS_STATE_H
 
 #include "State.h"
-#include "DisplayUtils.h"
 
 namespace NuggetsInc {
 
@@ -18,12 +17,13 @@ public:
 private:
     void displayMenu();
     void executeSelection();
+    void moveSelection(int step);
+    void drawMenuItem(int index);
 
     static const int menuItems = 2; // Two options: Setup NFC Device and Clone NFC Chip
-    String menu[menuItems];
+    static const int rowHeight = 30;
+    const char* menu[menuItems];
     int menuIndex;
-
-    DisplayUtils* displayUtils;
 };
 
 } // namespace NuggetsInc
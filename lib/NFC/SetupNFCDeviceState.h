@@ -18,10 +18,11 @@ namespace NuggetsInc
         void onEnter() override;
         void onExit() override;
         void update() override;
+        uint32_t getUpdateDelay() override;
 
     private:
-        NFCLogic *nfcLogic;
-        DisplayUtils *displayUtils;
+        NFCLogic& nfcLogic;
+        DisplayUtils displayUtils;
 
         bool macAddressFound;    
         bool readingStarted;   
@@ -42,6 +43,8 @@ namespace NuggetsInc
         char incrementHexDigit(char digit);
         char decrementHexDigit(char digit);
 
+        static const unsigned long MAC_RESPONSE_WINDOW_MS = 50;
+
         void displaySetupInstructions();
         void readNFCTag();
     };
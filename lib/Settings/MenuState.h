@@ -3,7 +3,6 @@
 #define MENUSTATE_H
 
 #include "State.h"
-#include "DisplayUtils.h"
 #include <vector>
 #include <string>
 
@@ -21,12 +20,13 @@ public:
 private:
     void displayMenu();
     void executeSelection();
+    void moveSelection(int step);
+    void drawMenuItem(int index);
 
     static const int menuItems = 8;
-    String menu[menuItems];
+    static const int rowHeight = 30;
+    const char* menu[menuItems];
     int menuIndex;
-
-    DisplayUtils* displayUtils;
 };
 
 } // namespace NuggetsInc
@@ -19,8 +19,9 @@ namespace NuggetsInc
         void update() override;
 
     private:
+        static void onRefresh(void* context);
+        void refreshBattery();
         float calculateBatteryPercentage(float voltage); // Declare the function here
-        unsigned long lastUpdateTime;
     };
 
 } // namespace NuggetsInc
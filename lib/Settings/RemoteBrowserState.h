@@ -3,7 +3,6 @@
 #define REMOTE_BROWSER_STATE_H
 
 #include "State.h"
-#include "DisplayUtils.h"
 #include <Arduino.h> 
 
 namespace NuggetsInc
@@ -17,9 +16,6 @@ namespace NuggetsInc
         void onEnter() override;
         void onExit() override;
         void update() override;
-
-    private:
-        DisplayUtils* displayUtils;
     };
 }
 
@@ -21,7 +21,7 @@ namespace NuggetsInc
         void update() override;
 
     private:
-        DisplayUtils* displayUtils;
+        DisplayUtils displayUtils;
         RemoteData remotes[NuggetsInc::MAX_REMOTE_SLOTS];
         uint8_t selectedSlot;
         bool slotSelected;
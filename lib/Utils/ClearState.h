@@ -8,8 +8,9 @@ namespace NuggetsInc {
 
     class ClearState : public AppState {
     public:
-        // Constructor accepts the next state as a parameter
-        explicit ClearState(StateType nextState);
+        // Constructor accepts the next state as a parameter, and the MAC of
+        // the paired device for states that need one
+        explicit ClearState(StateType nextState, const uint8_t* peerMac = nullptr);
 
         void onEnter() override;
         void update() override;
@@ -17,6 +18,8 @@ namespace NuggetsInc {
 
     private:
         StateType nextState;  // Stores the next state to transition to
+        uint8_t peerMac[6];
+        bool hasPeerMac;
     };
 }
 
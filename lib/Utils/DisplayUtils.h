@@ -31,6 +31,7 @@ namespace NuggetsInc
         void fillScreen(uint16_t color);
         void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
         void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+        void drawBitmap(int16_t x, int16_t y, const uint16_t *pixels, int16_t w, int16_t h);
 
         void beginPlot(const String &xTitle, const String &yTitle, int minX, int maxX, int minY, int maxY);
         void plotPoint(int xValue, int yValue, uint16_t color);
@@ -39,8 +40,9 @@ namespace NuggetsInc
         Arduino_GFX *gfx;
         String previousMessage;
 
+        // The graph is redrawn after this many points; the points themselves
+        // live only on screen, so a DisplayUtils stays small enough to embed
         static const uint16_t maxPlotPoints = 2000;
-        int plotBuffer[maxPlotPoints];  // stores y-values of points
         uint16_t plotCount;             // number of plotted points
         int plotMin;                    // minimum y-value seen
         int plotMax;                    // maximum y-value seen
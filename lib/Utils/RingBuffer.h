@@ -0,0 +1,111 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace NuggetsInc {
+
+// Fixed-capacity, lock-free ring buffer (bounded MPMC queue).
+//
+// Every slot carries a sequence number that tells producers and consumers
+// whether it is free or filled, so any number of tasks and ISRs can push
+// concurrently without a mutex or critical section. Storage lives inside the
+// object; nothing is ever allocated. Capacity must be a power of two.
+//
+// push() never blocks or spins on another context: if a producer that was
+// interrupted mid-push still owns the next slot, the consumer simply sees an
+// empty queue until that producer resumes and publishes it.
+template <typename T, size_t Capacity>
+class RingBuffer {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    RingBuffer() : head(0), tail(0) {
+        for (uint32_t i = 0; i < Capacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Prevent copying
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    // Safe from tasks and ISRs. Returns false when the buffer is full.
+    IRAM_ATTR bool push(const T& item) {
+        uint32_t pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[pos & kMask];
+            uint32_t seq = slot.sequence.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(seq - pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = item;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Returns false when the buffer is empty.
+    bool pop(T& item) {
+        uint32_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[pos & kMask];
+            uint32_t seq = slot.sequence.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(seq - (pos + 1));
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    item = slot.value;
+                    slot.sequence.store(pos + Capacity, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Drops everything currently queued. Consumer side only.
+    void clear() {
+        T discarded;
+        while (pop(discarded)) {
+        }
+    }
+
+    // Approximate while producers are active.
+    size_t size() const {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t used = t - h;
+        return used > Capacity ? Capacity : used;
+    }
+
+    bool empty() const { return size() == 0; }
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    static const uint32_t kMask = Capacity - 1;
+
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        T value;
+    };
+
+    Slot slots[Capacity];
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+};
+
+} // namespace NuggetsInc
+
+#endif // RING_BUFFER_H
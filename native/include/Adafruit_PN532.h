@@ -0,0 +1,33 @@
+// Adafruit_PN532.h - host stand-in for the PN532 NFC reader
+//
+// Reads and writes go to the tag image held by NativeHal (see
+// NativeHal::presentTag), which models an NTAG21x page array. The IRQ line is
+// driven like the real chip: low while a response is pending.
+#ifndef NATIVE_ADAFRUIT_PN532_H
+#define NATIVE_ADAFRUIT_PN532_H
+
+#include "Arduino.h"
+
+#define PN532_MIFARE_ISO14443A (0x00)
+
+class Adafruit_PN532 {
+public:
+    Adafruit_PN532(uint8_t irq, uint8_t reset) : irq_(irq), reset_(reset) {}
+
+    bool begin() { return true; }
+    uint32_t getFirmwareVersion();
+    bool SAMConfig() { return true; }
+
+    bool readPassiveTargetID(uint8_t cardBaudRate, uint8_t* uid, uint8_t* uidLength, uint16_t timeout = 0);
+    // Starts InListPassiveTarget without waiting; IRQ goes low once a tag answers
+    bool startPassiveTargetIDDetection(uint8_t cardBaudRate);
+    bool readDetectedPassiveTargetID(uint8_t* uid, uint8_t* uidLength);
+    uint8_t ntag2xx_ReadPage(uint8_t page, uint8_t* buffer);
+    uint8_t ntag2xx_WritePage(uint8_t page, uint8_t* data);
+
+private:
+    uint8_t irq_;
+    uint8_t reset_;
+};
+
+#endif // NATIVE_ADAFRUIT_PN532_H
@@ -0,0 +1,113 @@
+// Arduino_GFX.h - host stand-in for moononournation/Arduino_GFX
+//
+// Renders into an in-memory RGB565 framebuffer. Text is drawn as solid
+// 5x7 glyph cells (scaled by the text size) so layout, clipping and damage
+// can be inspected without a font; the framebuffer can be dumped as a PPM.
+#ifndef NATIVE_ARDUINO_GFX_H
+#define NATIVE_ARDUINO_GFX_H
+
+#include <mutex>
+#include <vector>
+#include "Arduino.h"
+
+#define BLACK 0x0000
+#define NAVY 0x000F
+#define DARKGREEN 0x03E0
+#define DARKCYAN 0x03EF
+#define MAROON 0x7800
+#define PURPLE 0x780F
+#define OLIVE 0x7BE0
+#define LIGHTGREY 0xC618
+#define DARKGREY 0x7BEF
+#define BLUE 0x001F
+#define GREEN 0x07E0
+#define CYAN 0x07FF
+#define RED 0xF800
+#define MAGENTA 0xF81F
+#define YELLOW 0xFFE0
+#define WHITE 0xFFFF
+#define ORANGE 0xFD20
+
+class Arduino_GFX : public Print {
+public:
+    Arduino_GFX(int16_t w, int16_t h);
+    virtual ~Arduino_GFX() {}
+
+    virtual bool begin(int32_t speed = 0);
+
+    int16_t width() const { return width_; }
+    int16_t height() const { return height_; }
+    void setRotation(uint8_t rotation) { rotation_ = rotation; }
+
+    void startWrite() {}
+    void endWrite() {}
+
+    void fillScreen(uint16_t color);
+    void drawPixel(int16_t x, int16_t y, uint16_t color);
+    void writePixel(int16_t x, int16_t y, uint16_t color) { drawPixel(x, y, color); }
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+    void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void draw16bitRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap, int16_t w, int16_t h);
+    void draw16bitRGBBitmap(int16_t x, int16_t y, const uint16_t* bitmap, int16_t w, int16_t h);
+
+    void setCursor(int16_t x, int16_t y) { flushTrace(); cursorX_ = x; cursorY_ = y; }
+    int16_t getCursorX() const { return cursorX_; }
+    int16_t getCursorY() const { return cursorY_; }
+    void setTextSize(uint8_t size) { textSize_ = size ? size : 1; }
+    void setTextColor(uint16_t color) { textColor_ = color; textBg_ = color; }
+    void setTextColor(uint16_t color, uint16_t bg) { textColor_ = color; textBg_ = bg; }
+    void setTextWrap(bool wrap) { wrap_ = wrap; }
+
+    void getTextBounds(const char* str, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h);
+    void getTextBounds(const String& str, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h);
+
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+    // Host-side inspection helpers
+    uint16_t pixel(int16_t x, int16_t y) const;
+    const std::vector<uint16_t>& framebuffer() const { return framebuffer_; }
+    uint64_t pixelsWritten() const { return pixelsWritten_; }
+    bool dumpPPM(const char* path) const;
+
+protected:
+    // With NUGGETS_TRACE_TEXT set, drawn text is echoed to stderr line by line
+    void flushTrace();
+    void fillClipped(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+
+    int16_t width_;
+    int16_t height_;
+    uint8_t rotation_ = 0;
+    int16_t cursorX_ = 0;
+    int16_t cursorY_ = 0;
+    uint8_t textSize_ = 1;
+    uint16_t textColor_ = WHITE;
+    uint16_t textBg_ = WHITE;
+    bool wrap_ = true;
+    uint64_t pixelsWritten_ = 0;
+    std::vector<uint16_t> framebuffer_;
+    std::string traceLine_;
+    mutable std::mutex mutex_;
+};
+
+class Arduino_DataBus {
+public:
+    virtual ~Arduino_DataBus() {}
+    virtual bool begin(int32_t speed = 0) { (void)speed; return true; }
+    void beginWrite() {}
+    void endWrite() {}
+    void writeCommand(uint8_t command) { lastCommand_ = command; }
+    void write(uint8_t value) { lastData_ = value; }
+
+    uint8_t lastCommand() const { return lastCommand_; }
+    uint8_t lastData() const { return lastData_; }
+
+private:
+    uint8_t lastCommand_ = 0;
+    uint8_t lastData_ = 0;
+};
+
+#endif // NATIVE_ARDUINO_GFX_H
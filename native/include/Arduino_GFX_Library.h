@@ -0,0 +1,30 @@
+// Arduino_GFX_Library.h - host stand-in for the T-Display-AMOLED panel
+#ifndef NATIVE_ARDUINO_GFX_LIBRARY_H
+#define NATIVE_ARDUINO_GFX_LIBRARY_H
+
+#include "Arduino_GFX.h"
+
+class Arduino_ESP32QSPI : public Arduino_DataBus {
+public:
+    Arduino_ESP32QSPI(int8_t cs, int8_t sck, int8_t d0, int8_t d1, int8_t d2, int8_t d3) {
+        (void)cs; (void)sck; (void)d0; (void)d1; (void)d2; (void)d3;
+    }
+};
+
+// RM67162 AMOLED, 240x536 native; rotation 1/3 gives the landscape 536x240
+// layout the firmware draws in.
+class Arduino_RM67162 : public Arduino_GFX {
+public:
+    Arduino_RM67162(Arduino_DataBus* bus, int8_t rst = -1, uint8_t rotation = 0)
+        : Arduino_GFX((rotation & 1) ? 536 : 240, (rotation & 1) ? 240 : 536), bus_(bus) {
+        (void)rst;
+        setRotation(rotation);
+    }
+
+    bool begin(int32_t speed = 0) override { return bus_ ? bus_->begin(speed) : false; }
+
+private:
+    Arduino_DataBus* bus_;
+};
+
+#endif // NATIVE_ARDUINO_GFX_LIBRARY_H
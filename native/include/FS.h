@@ -0,0 +1,69 @@
+// FS.h - host stand-in for the ESP32 Arduino filesystem classes
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "Arduino.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+class File : public Stream {
+public:
+    File() {}
+    File(FILE* handle, const std::string& path) : handle_(handle, &File::closeHandle), path_(path) {}
+
+    explicit operator bool() const { return handle_ != nullptr; }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+    size_t read(uint8_t* buffer, size_t size);
+    bool seek(uint32_t position);
+    size_t position() const;
+    size_t size() const;
+    void close() { handle_.reset(); }
+    const char* path() const { return path_.c_str(); }
+
+private:
+    static void closeHandle(FILE* handle) { if (handle) fclose(handle); }
+
+    std::shared_ptr<FILE> handle_;
+    std::string path_;
+};
+
+class FS {
+public:
+    explicit FS(const char* root) : root_(root) {}
+
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) {
+        return open(path.c_str(), mode, create);
+    }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool mkdir(const char* path);
+
+protected:
+    std::string resolve(const char* path) const;
+
+    std::string root_;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif // NATIVE_FS_H
@@ -0,0 +1,45 @@
+// HardwareSerial.h - host stand-in for the ESP32 UARTs
+//
+// Serial writes to stdout. Input for either port can be injected by the host
+// runner (NativeHal::injectSerialInput) to simulate a console or a device
+// wired to the UART2 pins.
+#ifndef NATIVE_HARDWARE_SERIAL_H
+#define NATIVE_HARDWARE_SERIAL_H
+
+#include <deque>
+#include <mutex>
+#include "Print.h"
+
+#define SERIAL_8N1 0x800001c
+
+class HardwareSerial : public Stream {
+public:
+    explicit HardwareSerial(int port) : port_(port) {}
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+    void end();
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    operator bool() const { return true; }
+
+    // Host-side helpers
+    void inject(const char* data, size_t length);
+    void setEcho(bool echo) { echo_ = echo; }
+
+private:
+    int port_;
+    bool echo_ = true;
+    std::mutex mutex_;
+    std::deque<uint8_t> rx_;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial2;
+
+#endif // NATIVE_HARDWARE_SERIAL_H
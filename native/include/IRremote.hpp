@@ -0,0 +1,52 @@
+// IRremote.hpp - host stand-in for z3t0/IRremote 4.x
+#ifndef NATIVE_IRREMOTE_HPP
+#define NATIVE_IRREMOTE_HPP
+
+#include "Arduino.h"
+
+#define MICROS_PER_TICK 50
+#define RAW_BUFFER_LENGTH 200
+
+typedef uint_fast8_t IRRawlenType;
+typedef uint16_t IRRawbufType;
+
+struct irparams_struct {
+    IRRawlenType rawlen;
+    IRRawbufType rawbuf[RAW_BUFFER_LENGTH];
+};
+
+class IRrecv {
+public:
+    void begin(uint_fast8_t receivePin, bool enableLEDFeedback = false) { (void)receivePin; (void)enableLEDFeedback; active_ = true; }
+    void stop() { active_ = false; }
+    void resume() { pending_ = false; }
+    bool isIdle() { return true; }
+    bool decode();
+    void registerReceiveCompleteCallback(void (*callback)()) { callback_ = callback; }
+
+    irparams_struct irparams = {};
+
+    // Host-side helper: queue a captured frame for the next decode()
+    void inject(const uint16_t* rawMicros, uint8_t length);
+
+private:
+    bool active_ = false;
+    bool pending_ = false;
+    void (*callback_)() = nullptr;
+};
+
+class IRsend {
+public:
+    void begin(uint_fast8_t sendPin) { (void)sendPin; }
+    void sendRaw(const uint16_t* buffer, uint_fast16_t length, uint_fast8_t khz);
+
+    uint32_t framesSent() const { return framesSent_; }
+
+private:
+    uint32_t framesSent_ = 0;
+};
+
+extern IRrecv IrReceiver;
+extern IRsend IrSender;
+
+#endif // NATIVE_IRREMOTE_HPP
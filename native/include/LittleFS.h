@@ -0,0 +1,27 @@
+// LittleFS.h - host stand-in for the ESP32 LittleFS partition
+//
+// Files live under a host directory (NUGGETS_NATIVE_FS, default
+// ./.native_fs) so stored MAC addresses and IR slots persist between runs.
+#ifndef NATIVE_LITTLEFS_H
+#define NATIVE_LITTLEFS_H
+
+#include "FS.h"
+
+class LittleFSFS : public fs::FS {
+public:
+    LittleFSFS();
+
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+               const char* partitionLabel = "spiffs");
+    void end() { mounted_ = false; }
+    bool format();
+    size_t totalBytes() { return 1024 * 1024; }
+    size_t usedBytes();
+
+private:
+    bool mounted_ = false;
+};
+
+extern LittleFSFS LittleFS;
+
+#endif // NATIVE_LITTLEFS_H
@@ -0,0 +1,77 @@
+// NativeHal.h - control surface for the host stand-ins
+//
+// The firmware never includes this header. The host runner and the host
+// benchmarks use it to drive the simulated hardware: button pins, the ADC,
+// serial input, the NFC tag in the field and the peers on the ESP-NOW bus.
+#ifndef NATIVE_HAL_H
+#define NATIVE_HAL_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace NativeHal {
+
+// --- GPIO -------------------------------------------------------------------
+
+// Drives an input pin; attached interrupts fire on the calling thread.
+void setPinLevel(uint8_t pin, int level);
+int getPinLevel(uint8_t pin);
+void setAnalogValue(uint8_t pin, uint16_t value);
+
+// --- Serial -----------------------------------------------------------------
+
+void injectSerialInput(int port, const char* text);
+void setSerialEcho(bool echo);
+
+// --- NFC --------------------------------------------------------------------
+
+// Places an NTAG21x image (4 bytes per page, 7-byte UID) in the reader field.
+void presentTag(const std::vector<uint8_t>& pages);
+void removeTag();
+std::vector<uint8_t> tagImage();
+
+// Builds a blank, NDEF-formatted NTAG213/215/216 image.
+std::vector<uint8_t> makeBlankNtag(int type);
+
+// --- ESP-NOW bus ------------------------------------------------------------
+
+typedef std::function<void(const uint8_t* srcMac, const uint8_t* data, int len)> PeerHandler;
+
+struct BusStats {
+    uint32_t framesSent;      // esp_now_send calls accepted from the node
+    uint32_t framesDelivered; // frames handed to a simulated peer
+    uint32_t framesLost;      // frames dropped by the loss model or a channel mismatch
+    uint32_t framesReceived;  // frames delivered to the node's receive callback
+    uint32_t bytesSent;       // payload bytes of framesSent
+    uint32_t bytesReceived;   // payload bytes of framesReceived
+};
+
+void setSelfMac(const uint8_t mac[6]);
+
+// Attaches a simulated peer. The handler runs on the bus thread for every
+// frame the node sends to that MAC (or to the broadcast address).
+void attachPeer(const uint8_t mac[6], PeerHandler handler, uint8_t channel = 1, int8_t rssi = -55);
+void detachPeer(const uint8_t mac[6]);
+void setPeerChannel(const uint8_t mac[6], uint8_t channel);
+
+// Sends a frame from a simulated peer to the node.
+void deliverFrame(const uint8_t srcMac[6], const uint8_t* data, int len);
+
+// Link model: independent per-frame loss and one-way latency.
+void setLinkLoss(double probability);
+void setLinkLatencyUs(uint32_t latencyUs);
+// Airtime at a faster PHY rate than ESP-NOW's default 1 Mbit/s
+void setPhyRateMbps(uint32_t mbps);
+// Background traffic seen on a channel by the promiscuous callback.
+void setChannelNoise(uint8_t channel, uint32_t framesPerSecond);
+
+BusStats busStats();
+void resetBusStats();
+
+// Blocks until every queued frame has been delivered.
+void flushBus();
+
+} // namespace NativeHal
+
+#endif // NATIVE_HAL_H
@@ -0,0 +1,7 @@
+// String.h - the firmware includes <String.h> for the Arduino String class
+#ifndef NATIVE_STRING_H
+#define NATIVE_STRING_H
+
+#include "WString.h"
+
+#endif // NATIVE_STRING_H
@@ -0,0 +1,101 @@
+// WString.h - host stand-in for the Arduino String class
+#ifndef NATIVE_WSTRING_H
+#define NATIVE_WSTRING_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+class String {
+public:
+    String() {}
+    String(const char* cstr) : s_(cstr ? cstr : "") {}
+    String(const std::string& str) : s_(str) {}
+    String(const String& other) = default;
+    String(String&& other) = default;
+    explicit String(char c) : s_(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10) { fromUnsigned(value, base); }
+    explicit String(int value, unsigned char base = 10) { fromSigned(value, base); }
+    explicit String(unsigned int value, unsigned char base = 10) { fromUnsigned(value, base); }
+    explicit String(long value, unsigned char base = 10) { fromSigned(value, base); }
+    explicit String(unsigned long value, unsigned char base = 10) { fromUnsigned(value, base); }
+    explicit String(long long value, unsigned char base = 10) { fromSigned(value, base); }
+    explicit String(unsigned long long value, unsigned char base = 10) { fromUnsigned(value, base); }
+    explicit String(float value, unsigned int decimalPlaces = 2) { fromDouble(value, decimalPlaces); }
+    explicit String(double value, unsigned int decimalPlaces = 2) { fromDouble(value, decimalPlaces); }
+
+    String& operator=(const String& other) = default;
+    String& operator=(String&& other) = default;
+    String& operator=(const char* cstr) { s_ = cstr ? cstr : ""; return *this; }
+
+    unsigned int length() const { return (unsigned int)s_.size(); }
+    bool isEmpty() const { return s_.empty(); }
+    const char* c_str() const { return s_.c_str(); }
+    void reserve(unsigned int size) { s_.reserve(size); }
+
+    char charAt(unsigned int index) const { return index < s_.size() ? s_[index] : 0; }
+    void setCharAt(unsigned int index, char c) { if (index < s_.size()) s_[index] = c; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char& operator[](unsigned int index) { return s_[index]; }
+
+    bool equals(const String& other) const { return s_ == other.s_; }
+    bool equals(const char* cstr) const { return s_ == (cstr ? cstr : ""); }
+    bool equalsIgnoreCase(const String& other) const;
+    bool startsWith(const String& prefix) const { return s_.compare(0, prefix.s_.size(), prefix.s_) == 0; }
+    bool endsWith(const String& suffix) const;
+
+    int indexOf(char c, unsigned int from = 0) const { return toIndex(s_.find(c, from)); }
+    int indexOf(const char* str, unsigned int from = 0) const { return toIndex(s_.find(str, from)); }
+    int indexOf(const String& str, unsigned int from = 0) const { return toIndex(s_.find(str.s_, from)); }
+    int lastIndexOf(char c) const { return toIndex(s_.rfind(c)); }
+
+    String substring(unsigned int from) const { return from < s_.size() ? String(s_.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const;
+
+    void trim();
+    void toUpperCase();
+    void toLowerCase();
+    void remove(unsigned int index) { if (index < s_.size()) s_.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < s_.size()) s_.erase(index, count); }
+    void replace(const String& find, const String& replacement);
+
+    long toInt() const { return std::strtol(s_.c_str(), nullptr, 10); }
+    float toFloat() const { return std::strtof(s_.c_str(), nullptr); }
+
+    bool concat(const String& str) { s_ += str.s_; return true; }
+    String& operator+=(const String& str) { s_ += str.s_; return *this; }
+    String& operator+=(const char* cstr) { if (cstr) s_ += cstr; return *this; }
+    String& operator+=(char c) { s_ += c; return *this; }
+    String& operator+=(int value) { return *this += String(value); }
+    String& operator+=(unsigned int value) { return *this += String(value); }
+    String& operator+=(long value) { return *this += String(value); }
+    String& operator+=(unsigned long value) { return *this += String(value); }
+
+    bool operator==(const String& other) const { return s_ == other.s_; }
+    bool operator==(const char* cstr) const { return equals(cstr); }
+    bool operator!=(const String& other) const { return s_ != other.s_; }
+    bool operator!=(const char* cstr) const { return !equals(cstr); }
+    bool operator<(const String& other) const { return s_ < other.s_; }
+
+    const std::string& str() const { return s_; }
+
+private:
+    static int toIndex(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+    void fromSigned(long long value, unsigned char base);
+    void fromUnsigned(unsigned long long value, unsigned char base);
+    void fromDouble(double value, unsigned int decimalPlaces);
+
+    std::string s_;
+};
+
+String operator+(const String& lhs, const String& rhs);
+String operator+(const String& lhs, const char* rhs);
+String operator+(const char* lhs, const String& rhs);
+String operator+(const String& lhs, char rhs);
+String operator+(const String& lhs, int rhs);
+String operator+(const String& lhs, unsigned int rhs);
+String operator+(const String& lhs, long rhs);
+String operator+(const String& lhs, unsigned long rhs);
+
+#endif // NATIVE_WSTRING_H
@@ -0,0 +1,31 @@
+// WiFi.h - host stand-in for the ESP32 Arduino WiFi class
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+#include "Arduino.h"
+#include "esp_wifi.h"
+
+#define WIFI_OFF WIFI_MODE_NULL
+#define WIFI_STA WIFI_MODE_STA
+#define WIFI_AP WIFI_MODE_AP
+#define WIFI_AP_STA WIFI_MODE_APSTA
+
+class WiFiClass {
+public:
+    bool mode(wifi_mode_t mode);
+    wifi_mode_t getMode() const { return mode_; }
+    bool disconnect(bool wifiOff = false, bool eraseAp = false);
+    bool setSleep(bool enabled);
+    bool getSleep() const { return sleep_; }
+    String macAddress();
+    uint8_t* macAddress(uint8_t* mac);
+    int32_t channel();
+
+private:
+    wifi_mode_t mode_ = WIFI_MODE_NULL;
+    bool sleep_ = true;
+};
+
+extern WiFiClass WiFi;
+
+#endif // NATIVE_WIFI_H
@@ -0,0 +1,18 @@
+// Wire.h - host stand-in for the ESP32 I2C driver
+#ifndef NATIVE_WIRE_H
+#define NATIVE_WIRE_H
+
+#include "Arduino.h"
+
+class TwoWire {
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) {
+        (void)sda; (void)scl; (void)frequency;
+        return true;
+    }
+    void end() {}
+};
+
+extern TwoWire Wire;
+
+#endif // NATIVE_WIRE_H
@@ -0,0 +1,12 @@
+// driver/gpio.h - host stand-in for the ESP-IDF GPIO driver types
+#ifndef NATIVE_DRIVER_GPIO_H
+#define NATIVE_DRIVER_GPIO_H
+
+#include "esp_err.h"
+
+typedef int gpio_num_t;
+
+#define GPIO_NUM_0 0
+#define GPIO_NUM_MAX 49
+
+#endif // NATIVE_DRIVER_GPIO_H
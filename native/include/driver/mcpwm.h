@@ -0,0 +1,27 @@
+// driver/mcpwm.h - host stand-in for the ESP-IDF legacy MCPWM driver
+#ifndef NATIVE_DRIVER_MCPWM_H
+#define NATIVE_DRIVER_MCPWM_H
+
+#include <cstdint>
+#include "esp_err.h"
+
+typedef enum { MCPWM_UNIT_0 = 0, MCPWM_UNIT_1 } mcpwm_unit_t;
+typedef enum { MCPWM_TIMER_0 = 0, MCPWM_TIMER_1, MCPWM_TIMER_2 } mcpwm_timer_t;
+typedef enum { MCPWM_OPR_A = 0, MCPWM_OPR_B } mcpwm_generator_t;
+typedef enum { MCPWM0A = 0, MCPWM0B } mcpwm_io_signals_t;
+typedef enum { MCPWM_UP_COUNTER = 1, MCPWM_DOWN_COUNTER, MCPWM_UP_DOWN_COUNTER } mcpwm_counter_type_t;
+typedef enum { MCPWM_DUTY_MODE_0 = 0, MCPWM_DUTY_MODE_1 } mcpwm_duty_type_t;
+
+typedef struct {
+    uint32_t frequency;
+    float cmpr_a;
+    float cmpr_b;
+    mcpwm_duty_type_t duty_mode;
+    mcpwm_counter_type_t counter_mode;
+} mcpwm_config_t;
+
+static inline esp_err_t mcpwm_gpio_init(mcpwm_unit_t, mcpwm_io_signals_t, int) { return ESP_OK; }
+static inline esp_err_t mcpwm_init(mcpwm_unit_t, mcpwm_timer_t, const mcpwm_config_t*) { return ESP_OK; }
+static inline esp_err_t mcpwm_set_signal_low(mcpwm_unit_t, mcpwm_timer_t, mcpwm_generator_t) { return ESP_OK; }
+
+#endif // NATIVE_DRIVER_MCPWM_H
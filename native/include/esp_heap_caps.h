@@ -0,0 +1,19 @@
+// esp_heap_caps.h - host stand-in for ESP-IDF heap statistics
+//
+// Figures come from glibc's allocator, so fragmentation numbers are only
+// meaningful relative to each other within one host run.
+#ifndef NATIVE_ESP_HEAP_CAPS_H
+#define NATIVE_ESP_HEAP_CAPS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+
+#endif // NATIVE_ESP_HEAP_CAPS_H
@@ -0,0 +1,64 @@
+// esp_now.h - host stand-in for the ESP-IDF ESP-NOW API (v4.4 callbacks)
+//
+// Frames travel over the in-process bus in NativeHal: simulated peers can be
+// attached there, and callbacks are delivered from a dedicated "Wi-Fi task"
+// thread just like on the target.
+#ifndef NATIVE_ESP_NOW_H
+#define NATIVE_ESP_NOW_H
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+#include "esp_wifi_types.h"
+
+#define ESP_NOW_ETH_ALEN 6
+#define ESP_NOW_KEY_LEN 16
+#define ESP_NOW_MAX_TOTAL_PEER_NUM 20
+#define ESP_NOW_MAX_DATA_LEN 250
+// ESP-IDF 5.4 and later, where ESP-NOW v2 frames are larger; build with
+// -DNATIVE_ESP_NOW_V2 to stand in for it
+#ifdef NATIVE_ESP_NOW_V2
+#define ESP_NOW_MAX_DATA_LEN_V2 1470
+#endif
+
+#define ESP_ERR_ESPNOW_BASE (0x3000 + 100)
+#define ESP_ERR_ESPNOW_NOT_INIT (ESP_ERR_ESPNOW_BASE + 1)
+#define ESP_ERR_ESPNOW_ARG (ESP_ERR_ESPNOW_BASE + 2)
+#define ESP_ERR_ESPNOW_NO_MEM (ESP_ERR_ESPNOW_BASE + 3)
+#define ESP_ERR_ESPNOW_FULL (ESP_ERR_ESPNOW_BASE + 4)
+#define ESP_ERR_ESPNOW_NOT_FOUND (ESP_ERR_ESPNOW_BASE + 5)
+#define ESP_ERR_ESPNOW_INTERNAL (ESP_ERR_ESPNOW_BASE + 6)
+#define ESP_ERR_ESPNOW_EXIST (ESP_ERR_ESPNOW_BASE + 7)
+#define ESP_ERR_ESPNOW_IF (ESP_ERR_ESPNOW_BASE + 8)
+
+typedef enum {
+    ESP_NOW_SEND_SUCCESS = 0,
+    ESP_NOW_SEND_FAIL,
+} esp_now_send_status_t;
+
+typedef struct esp_now_peer_info {
+    uint8_t peer_addr[ESP_NOW_ETH_ALEN];
+    uint8_t lmk[ESP_NOW_KEY_LEN];
+    uint8_t channel;
+    wifi_interface_t ifidx;
+    bool encrypt;
+    void* priv;
+} esp_now_peer_info_t;
+
+typedef void (*esp_now_recv_cb_t)(const uint8_t* mac_addr, const uint8_t* data, int data_len);
+typedef void (*esp_now_send_cb_t)(const uint8_t* mac_addr, esp_now_send_status_t status);
+
+esp_err_t esp_now_init();
+esp_err_t esp_now_deinit();
+esp_err_t esp_now_get_version(uint32_t* version);
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb);
+esp_err_t esp_now_unregister_recv_cb();
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb);
+esp_err_t esp_now_unregister_send_cb();
+esp_err_t esp_now_send(const uint8_t* peer_addr, const uint8_t* data, size_t len);
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer);
+esp_err_t esp_now_del_peer(const uint8_t* peer_addr);
+esp_err_t esp_now_mod_peer(const esp_now_peer_info_t* peer);
+bool esp_now_is_peer_exist(const uint8_t* peer_addr);
+
+#endif // NATIVE_ESP_NOW_H
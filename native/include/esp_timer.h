@@ -0,0 +1,9 @@
+// esp_timer.h - host stand-in for the ESP-IDF high resolution timer
+#ifndef NATIVE_ESP_TIMER_H
+#define NATIVE_ESP_TIMER_H
+
+#include <cstdint>
+
+int64_t esp_timer_get_time();
+
+#endif // NATIVE_ESP_TIMER_H
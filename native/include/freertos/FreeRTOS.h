@@ -0,0 +1,50 @@
+// freertos/FreeRTOS.h - host stand-in for the ESP-IDF FreeRTOS port
+//
+// Tasks are std::threads, one tick is one millisecond, and critical sections
+// are recursive mutexes. "ISR" variants are plain calls from whichever host
+// thread simulates the interrupt.
+#ifndef NATIVE_FREERTOS_H
+#define NATIVE_FREERTOS_H
+
+#include <cstdint>
+#include <mutex>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t)1)
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdPASS (pdTRUE)
+#define pdFAIL (pdFALSE)
+#define errQUEUE_FULL ((BaseType_t)0)
+#define errQUEUE_EMPTY ((BaseType_t)0)
+
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+struct NativeMux {
+    std::recursive_mutex mutex;
+};
+typedef NativeMux portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+
+static inline void vPortEnterCritical(portMUX_TYPE* mux) { mux->mutex.lock(); }
+static inline void vPortExitCritical(portMUX_TYPE* mux) { mux->mutex.unlock(); }
+
+#define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) vPortExitCritical(mux)
+#define taskENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define taskEXIT_CRITICAL(mux) vPortExitCritical(mux)
+#define portYIELD_FROM_ISR(...) ((void)0)
+
+BaseType_t xPortInIsrContext();
+
+#endif // NATIVE_FREERTOS_H
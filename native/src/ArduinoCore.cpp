@@ -0,0 +1,285 @@
+// ArduinoCore.cpp - host stand-in for the ESP32 Arduino core, GPIO and SoC services
+#include "Arduino.h"
+#include "NativeHal.h"
+#include "Wire.h"
+#include "esp_heap_caps.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+
+#include <atomic>
+#include <chrono>
+#include <malloc.h>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const Clock::time_point& bootTime() {
+    static const Clock::time_point t = Clock::now();
+    return t;
+}
+
+struct PinState {
+    int level = HIGH;
+    uint8_t mode = INPUT;
+    uint16_t analog = 0;
+    void (*handler)(void*) = nullptr;
+    void (*plainHandler)(void) = nullptr;
+    void* arg = nullptr;
+    int edge = 0;
+};
+
+const int kPinCount = 64;
+PinState pins[kPinCount];
+std::mutex pinMutex;
+
+std::mt19937& rng() {
+    static std::mt19937 engine(12345);
+    return engine;
+}
+
+size_t baselineHeapInUse = 0;
+
+size_t heapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks;
+#else
+    struct mallinfo info = mallinfo();
+    return (size_t)info.uordblks;
+#endif
+}
+
+size_t heapFreeInArena() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return info.fordblks;
+#else
+    struct mallinfo info = mallinfo();
+    return (size_t)info.fordblks;
+#endif
+}
+
+// Model the ESP32-S3's ~320 KB of internal heap so the numbers printed by
+// the firmware stay in a familiar range.
+const size_t kSimulatedHeap = 320 * 1024;
+size_t minimumFree = kSimulatedHeap;
+
+} // namespace
+
+unsigned long millis() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - bootTime()).count();
+}
+
+unsigned long micros() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - bootTime()).count();
+}
+
+int64_t esp_timer_get_time() {
+    return (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - bootTime()).count();
+}
+
+void delay(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin >= kPinCount) return;
+    std::lock_guard<std::mutex> lock(pinMutex);
+    pins[pin].mode = mode;
+    if (mode == INPUT_PULLUP) pins[pin].level = HIGH;
+    if (mode == INPUT_PULLDOWN) pins[pin].level = LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin >= kPinCount) return;
+    std::lock_guard<std::mutex> lock(pinMutex);
+    pins[pin].level = value ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+    if (pin >= kPinCount) return LOW;
+    std::lock_guard<std::mutex> lock(pinMutex);
+    return pins[pin].level;
+}
+
+uint16_t analogRead(uint8_t pin) {
+    if (pin >= kPinCount) return 0;
+    std::lock_guard<std::mutex> lock(pinMutex);
+    return pins[pin].analog;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {
+    if (pin >= kPinCount) return;
+    std::lock_guard<std::mutex> lock(pinMutex);
+    pins[pin].plainHandler = handler;
+    pins[pin].handler = nullptr;
+    pins[pin].arg = nullptr;
+    pins[pin].edge = mode;
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode) {
+    if (pin >= kPinCount) return;
+    std::lock_guard<std::mutex> lock(pinMutex);
+    pins[pin].handler = handler;
+    pins[pin].plainHandler = nullptr;
+    pins[pin].arg = arg;
+    pins[pin].edge = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin >= kPinCount) return;
+    std::lock_guard<std::mutex> lock(pinMutex);
+    pins[pin].handler = nullptr;
+    pins[pin].plainHandler = nullptr;
+    pins[pin].edge = 0;
+}
+
+long random(long howBig) {
+    if (howBig <= 0) return 0;
+    return (long)(rng()() % (unsigned long)howBig);
+}
+
+long random(long howSmall, long howBig) {
+    if (howSmall >= howBig) return howSmall;
+    return howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed) {
+    rng().seed((std::mt19937::result_type)seed);
+}
+
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() {
+    return (uint32_t)heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    return (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+    return (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT);
+}
+
+void EspClass::restart() {
+    Serial.println("[native] ESP.restart()");
+    fflush(stdout);
+    _exit(0);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    (void)caps;
+    if (baselineHeapInUse == 0) baselineHeapInUse = heapInUse();
+    size_t used = heapInUse() > baselineHeapInUse ? heapInUse() - baselineHeapInUse : 0;
+    size_t freeBytes = used < kSimulatedHeap ? kSimulatedHeap - used : 0;
+    if (freeBytes < minimumFree) minimumFree = freeBytes;
+    return freeBytes;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    // glibc does not expose its largest free chunk; the free bytes held inside
+    // the arena (holes left behind by frees) are the fragmented part.
+    size_t freeBytes = heap_caps_get_free_size(caps);
+    size_t holes = heapFreeInArena();
+    return freeBytes > holes ? freeBytes - holes : 0;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    heap_caps_get_free_size(caps);
+    return minimumFree;
+}
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case 0x3000 + 101: return "ESP_ERR_ESPNOW_NOT_INIT";
+        case 0x3000 + 102: return "ESP_ERR_ESPNOW_ARG";
+        case 0x3000 + 103: return "ESP_ERR_ESPNOW_NO_MEM";
+        case 0x3000 + 104: return "ESP_ERR_ESPNOW_FULL";
+        case 0x3000 + 105: return "ESP_ERR_ESPNOW_NOT_FOUND";
+        case 0x3000 + 106: return "ESP_ERR_ESPNOW_INTERNAL";
+        case 0x3000 + 107: return "ESP_ERR_ESPNOW_EXIST";
+        case 0x3000 + 108: return "ESP_ERR_ESPNOW_IF";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+    return ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t gpio, int level) {
+    (void)gpio;
+    (void)level;
+    return ESP_OK;
+}
+
+void esp_deep_sleep_start() {
+    Serial.println("[native] esp_deep_sleep_start(): exiting");
+    fflush(stdout);
+    _exit(0);
+}
+
+TwoWire Wire;
+
+namespace NativeHal {
+
+void setPinLevel(uint8_t pin, int level) {
+    if (pin >= kPinCount) return;
+    void (*handler)(void*) = nullptr;
+    void (*plainHandler)(void) = nullptr;
+    void* arg = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        PinState& state = pins[pin];
+        int previous = state.level;
+        state.level = level ? HIGH : LOW;
+        bool rising = previous == LOW && state.level == HIGH;
+        bool falling = previous == HIGH && state.level == LOW;
+        bool fire = (state.edge == CHANGE && (rising || falling)) ||
+                    (state.edge == RISING && rising) ||
+                    (state.edge == FALLING && falling);
+        if (fire) {
+            handler = state.handler;
+            plainHandler = state.plainHandler;
+            arg = state.arg;
+        }
+    }
+    // The "ISR" runs on the thread that moved the pin.
+    if (handler) handler(arg);
+    if (plainHandler) plainHandler();
+}
+
+int getPinLevel(uint8_t pin) {
+    return digitalRead(pin);
+}
+
+void setAnalogValue(uint8_t pin, uint16_t value) {
+    if (pin >= kPinCount) return;
+    std::lock_guard<std::mutex> lock(pinMutex);
+    pins[pin].analog = value;
+}
+
+} // namespace NativeHal
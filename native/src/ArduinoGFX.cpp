@@ -0,0 +1,169 @@
+// ArduinoGFX.cpp - host stand-in for Arduino_GFX rendering into RAM
+#include "Arduino_GFX.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+const int kGlyphWidth = 6;  // 5 px glyph + 1 px spacing, like the classic GFX font
+const int kGlyphHeight = 8; // 7 px glyph + 1 px spacing
+
+bool traceText() {
+    static const bool enabled = getenv("NUGGETS_TRACE_TEXT") != nullptr;
+    return enabled;
+}
+} // namespace
+
+Arduino_GFX::Arduino_GFX(int16_t w, int16_t h)
+    : width_(w), height_(h), framebuffer_((size_t)w * (size_t)h, BLACK) {}
+
+bool Arduino_GFX::begin(int32_t speed) {
+    (void)speed;
+    return true;
+}
+
+void Arduino_GFX::fillClipped(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    int x0 = std::max<int>(0, x);
+    int y0 = std::max<int>(0, y);
+    int x1 = std::min<int>(width_, (int)x + w);
+    int y1 = std::min<int>(height_, (int)y + h);
+    if (x0 >= x1 || y0 >= y1) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int row = y0; row < y1; ++row) {
+        uint16_t* line = &framebuffer_[(size_t)row * width_];
+        std::fill(line + x0, line + x1, color);
+    }
+    pixelsWritten_ += (uint64_t)(x1 - x0) * (uint64_t)(y1 - y0);
+}
+
+void Arduino_GFX::fillScreen(uint16_t color) {
+    fillClipped(0, 0, width_, height_, color);
+}
+
+void Arduino_GFX::drawPixel(int16_t x, int16_t y, uint16_t color) {
+    fillClipped(x, y, 1, 1, color);
+}
+
+void Arduino_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    fillClipped(x, y, w, 1, color);
+}
+
+void Arduino_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    fillClipped(x, y, 1, h, color);
+}
+
+void Arduino_GFX::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+    int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+    while (true) {
+        drawPixel(x0, y0, color);
+        if (x0 == x1 && y0 == y1) break;
+        int e2 = 2 * err;
+        if (e2 >= dy) { err += dy; x0 += sx; }
+        if (e2 <= dx) { err += dx; y0 += sy; }
+    }
+}
+
+void Arduino_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y, h, color);
+    drawFastVLine(x + w - 1, y, h, color);
+}
+
+void Arduino_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    fillClipped(x, y, w, h, color);
+}
+
+void Arduino_GFX::draw16bitRGBBitmap(int16_t x, int16_t y, const uint16_t* bitmap, int16_t w, int16_t h) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int row = 0; row < h; ++row) {
+        int py = y + row;
+        if (py < 0 || py >= height_) continue;
+        for (int col = 0; col < w; ++col) {
+            int px = x + col;
+            if (px < 0 || px >= width_) continue;
+            framebuffer_[(size_t)py * width_ + px] = bitmap[(size_t)row * w + col];
+        }
+    }
+    pixelsWritten_ += (uint64_t)w * (uint64_t)h;
+}
+
+void Arduino_GFX::draw16bitRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap, int16_t w, int16_t h) {
+    draw16bitRGBBitmap(x, y, (const uint16_t*)bitmap, w, h);
+}
+
+void Arduino_GFX::getTextBounds(const char* str, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w,
+                                uint16_t* h) {
+    int longest = 0, current = 0, lines = 1;
+    for (const char* p = str; p && *p; ++p) {
+        if (*p == '\n') {
+            ++lines;
+            current = 0;
+            continue;
+        }
+        if ((unsigned char)*p >= 0x80 && ((unsigned char)*p & 0xC0) == 0x80) continue; // UTF-8 continuation
+        longest = std::max(longest, ++current);
+    }
+    *x1 = x;
+    *y1 = y;
+    *w = (uint16_t)(longest * kGlyphWidth * textSize_);
+    *h = (uint16_t)(lines * kGlyphHeight * textSize_);
+}
+
+void Arduino_GFX::getTextBounds(const String& str, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w,
+                                uint16_t* h) {
+    getTextBounds(str.c_str(), x, y, x1, y1, w, h);
+}
+
+void Arduino_GFX::flushTrace() {
+    if (traceLine_.empty()) return;
+    fprintf(stderr, "[gfx %3d,%3d] %s\n", cursorX_, cursorY_, traceLine_.c_str());
+    traceLine_.clear();
+}
+
+size_t Arduino_GFX::write(uint8_t c) {
+    if (traceText()) {
+        if (c == '\n') flushTrace();
+        else if (c != '\r') traceLine_ += (char)c;
+    }
+    if (c == '\n') {
+        cursorX_ = 0;
+        cursorY_ += kGlyphHeight * textSize_;
+        return 1;
+    }
+    if (c == '\r') return 1;
+    if (wrap_ && cursorX_ + kGlyphWidth * textSize_ > width_) {
+        cursorX_ = 0;
+        cursorY_ += kGlyphHeight * textSize_;
+    }
+    if (textBg_ != textColor_) {
+        fillClipped(cursorX_, cursorY_, kGlyphWidth * textSize_, kGlyphHeight * textSize_, textBg_);
+    }
+    if (c != ' ') {
+        fillClipped(cursorX_, cursorY_, (kGlyphWidth - 1) * textSize_, (kGlyphHeight - 1) * textSize_, textColor_);
+    }
+    cursorX_ += kGlyphWidth * textSize_;
+    return 1;
+}
+
+uint16_t Arduino_GFX::pixel(int16_t x, int16_t y) const {
+    if (x < 0 || y < 0 || x >= width_ || y >= height_) return 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return framebuffer_[(size_t)y * width_ + x];
+}
+
+bool Arduino_GFX::dumpPPM(const char* path) const {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    fprintf(file, "P6\n%d %d\n255\n", width_, height_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint16_t c : framebuffer_) {
+        uint8_t rgb[3] = {(uint8_t)(((c >> 11) & 0x1F) << 3), (uint8_t)(((c >> 5) & 0x3F) << 2),
+                          (uint8_t)((c & 0x1F) << 3)};
+        fwrite(rgb, 1, 3, file);
+    }
+    fclose(file);
+    return true;
+}
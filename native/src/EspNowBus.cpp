@@ -0,0 +1,578 @@
+// EspNowBus.cpp - host stand-in for Wi-Fi/ESP-NOW: an in-process radio bus
+//
+// The node (this firmware) and any number of simulated peers share one
+// medium. Frames are serialised by an airtime model, 1 Mbit/s unless set
+// otherwise, subject to the
+// configured loss and latency, and every callback the firmware registered is
+// invoked from a dedicated bus thread, which plays the role of the Wi-Fi task.
+#include "Arduino.h"
+#include "NativeHal.h"
+#include "WiFi.h"
+#include "esp_now.h"
+#include "esp_wifi.h"
+
+#include <array>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::array<uint8_t, 6> Mac;
+typedef std::chrono::steady_clock Clock;
+
+const Mac kBroadcast = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+const size_t kMaxPendingTx = 16;   // the driver's internal TX queue
+const uint32_t kPhyOverheadBytes = 60; // MAC header, vendor IE, FCS and preamble
+const uint32_t kAirtimeNsPerByte = 8000; // at 1 Mbit/s
+
+Mac toMac(const uint8_t* mac) {
+    Mac m;
+    memcpy(m.data(), mac, 6);
+    return m;
+}
+
+struct SimPeer {
+    NativeHal::PeerHandler handler;
+    uint8_t channel;
+    int8_t rssi;
+};
+
+struct Frame {
+    Clock::time_point due;
+    uint64_t order;
+    bool outbound; // node -> peer(s)
+    Mac src;
+    Mac dst;
+    std::vector<uint8_t> data;
+
+    bool operator>(const Frame& other) const {
+        return due != other.due ? due > other.due : order > other.order;
+    }
+};
+
+struct Bus {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::condition_variable idle;
+    std::priority_queue<Frame, std::vector<Frame>, std::greater<Frame>> frames;
+    std::thread thread;
+    bool busy = false;
+    uint64_t order = 0;
+    size_t pendingTx = 0;
+    Clock::time_point mediumFreeAt = Clock::now();
+
+    Mac self = {{0x24, 0x0A, 0xC4, 0x00, 0x00, 0x01}};
+    uint8_t channel = 1;
+    bool wifiStarted = false;
+    wifi_ps_type_t powerSave = WIFI_PS_MIN_MODEM;
+
+    bool nowInitialized = false;
+    esp_now_recv_cb_t recvCb = nullptr;
+    esp_now_send_cb_t sendCb = nullptr;
+    std::map<Mac, uint8_t> registeredPeers;
+
+    bool promiscuous = false;
+    wifi_promiscuous_cb_t promiscuousCb = nullptr;
+    uint32_t promiscuousFilter = WIFI_PROMIS_FILTER_MASK_ALL;
+    std::map<uint8_t, uint32_t> channelNoise;
+    Clock::time_point nextNoise = Clock::now();
+
+    std::map<Mac, SimPeer> simPeers;
+    double lossProbability = 0.0;
+    uint32_t latencyUs = 0;
+    uint32_t phyRateMbps = 1;
+    std::mt19937 rng{4242};
+    NativeHal::BusStats stats = {};
+
+    Bus() {
+        thread = std::thread([this]() { run(); });
+        thread.detach();
+    }
+
+    bool lost() {
+        if (lossProbability <= 0.0) return false;
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        return dist(rng) < lossProbability;
+    }
+
+    Clock::time_point reserveAirtime(size_t len) {
+        Clock::time_point now = Clock::now();
+        Clock::time_point start = std::max(now, mediumFreeAt);
+        mediumFreeAt = start + std::chrono::nanoseconds((len + kPhyOverheadBytes) * kAirtimeNsPerByte /
+                                                        phyRateMbps);
+        return mediumFreeAt + std::chrono::microseconds(latencyUs);
+    }
+
+    void push(bool outbound, const Mac& src, const Mac& dst, const uint8_t* data, size_t len) {
+        Frame frame;
+        frame.due = reserveAirtime(len);
+        frame.order = order++;
+        frame.outbound = outbound;
+        frame.src = src;
+        frame.dst = dst;
+        frame.data.assign(data, data + len);
+        frames.push(std::move(frame));
+        cv.notify_all();
+    }
+
+    void deliverPromiscuous(const Mac& src, const Mac& dst, const std::vector<uint8_t>& data, int8_t rssi,
+                            wifi_promiscuous_cb_t cb) {
+        // 802.11 action frame: 24-byte header, vendor-specific category and
+        // Espressif OUI, then the ESP-NOW element carrying the payload.
+        std::vector<uint8_t> buffer(sizeof(wifi_promiscuous_pkt_t) + 24 + 15 + data.size(), 0);
+        wifi_promiscuous_pkt_t* pkt = reinterpret_cast<wifi_promiscuous_pkt_t*>(buffer.data());
+        pkt->rx_ctrl.rssi = rssi;
+        pkt->rx_ctrl.channel = channel;
+        pkt->rx_ctrl.noise_floor = -95;
+        pkt->rx_ctrl.sig_len = (unsigned)(24 + 15 + data.size());
+        pkt->rx_ctrl.timestamp = (unsigned)micros();
+        uint8_t* hdr = pkt->payload;
+        hdr[0] = 0xD0; // management / action
+        memcpy(hdr + 4, dst.data(), 6);
+        memcpy(hdr + 10, src.data(), 6);
+        memcpy(hdr + 16, kBroadcast.data(), 6);
+        hdr[24] = 127; // vendor specific
+        hdr[25] = 0x18;
+        hdr[26] = 0xFE;
+        hdr[27] = 0x34;
+        if (!data.empty()) memcpy(hdr + 39, data.data(), data.size());
+        cb(pkt, WIFI_PKT_MGMT);
+    }
+
+    void process(Frame& frame, std::unique_lock<std::mutex>& lock) {
+        if (frame.outbound) {
+            pendingTx--;
+            std::vector<std::pair<NativeHal::PeerHandler, bool>> targets;
+            bool broadcast = frame.dst == kBroadcast;
+            for (auto& entry : simPeers) {
+                if (!broadcast && entry.first != frame.dst) continue;
+                bool ok = entry.second.channel == channel && !lost();
+                targets.push_back(std::make_pair(entry.second.handler, ok));
+            }
+            bool delivered = broadcast;
+            for (auto& target : targets) {
+                if (target.second) {
+                    stats.framesDelivered++;
+                    delivered = true;
+                } else {
+                    stats.framesLost++;
+                }
+            }
+            if (!broadcast && targets.empty()) stats.framesLost++;
+            esp_now_send_cb_t sendCb = this->sendCb;
+            Mac self = this->self;
+            lock.unlock();
+            for (auto& target : targets) {
+                if (target.second && target.first) target.first(self.data(), frame.data.data(), (int)frame.data.size());
+            }
+            if (sendCb) sendCb(frame.dst.data(), delivered ? ESP_NOW_SEND_SUCCESS : ESP_NOW_SEND_FAIL);
+            lock.lock();
+            return;
+        }
+
+        auto peer = simPeers.find(frame.src);
+        int8_t rssi = peer != simPeers.end() ? peer->second.rssi : -70;
+        bool onChannel = peer == simPeers.end() || peer->second.channel == channel;
+        if (!nowInitialized || !onChannel || lost()) {
+            stats.framesLost++;
+            return;
+        }
+        stats.framesReceived++;
+        stats.bytesReceived += frame.data.size();
+        esp_now_recv_cb_t recvCb = this->recvCb;
+        wifi_promiscuous_cb_t promiscuousCb =
+            promiscuous && (promiscuousFilter & WIFI_PROMIS_FILTER_MASK_MGMT) ? this->promiscuousCb : nullptr;
+        lock.unlock();
+        if (promiscuousCb) deliverPromiscuous(frame.src, frame.dst, frame.data, rssi, promiscuousCb);
+        if (recvCb) recvCb(frame.src.data(), frame.data.data(), (int)frame.data.size());
+        lock.lock();
+    }
+
+    void emitNoise(std::unique_lock<std::mutex>& lock) {
+        auto noise = channelNoise.find(channel);
+        wifi_promiscuous_cb_t cb = promiscuous ? promiscuousCb : nullptr;
+        if (noise == channelNoise.end() || noise->second == 0 || !cb) return;
+        // One 10 ms slice worth of foreign frames.
+        uint32_t count = std::max<uint32_t>(1, noise->second / 100);
+        std::uniform_int_distribution<int> rssiDist(-90, -60);
+        std::vector<int8_t> levels;
+        for (uint32_t i = 0; i < count; ++i) levels.push_back((int8_t)rssiDist(rng));
+        lock.unlock();
+        const Mac foreign = {{0x02, 0x00, 0x00, 0x00, 0x00, 0x99}};
+        std::vector<uint8_t> empty;
+        for (int8_t level : levels) deliverPromiscuous(foreign, kBroadcast, empty, level, cb);
+        lock.lock();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            Clock::time_point now = Clock::now();
+            if (promiscuous && now >= nextNoise) {
+                nextNoise = now + std::chrono::milliseconds(10);
+                emitNoise(lock);
+                continue;
+            }
+            if (!frames.empty() && frames.top().due <= now) {
+                Frame frame = frames.top();
+                frames.pop();
+                busy = true;
+                process(frame, lock);
+                busy = false;
+                if (frames.empty()) idle.notify_all();
+                continue;
+            }
+            Clock::time_point wake = now + std::chrono::milliseconds(100);
+            if (!frames.empty()) wake = std::min(wake, frames.top().due);
+            if (promiscuous) wake = std::min(wake, nextNoise);
+            cv.wait_until(lock, wake);
+        }
+    }
+};
+
+Bus& bus() {
+    static Bus* instance = new Bus();
+    return *instance;
+}
+
+} // namespace
+
+// --- Arduino WiFi -----------------------------------------------------------
+
+WiFiClass WiFi;
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+    mode_ = mode;
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.wifiStarted = mode != WIFI_MODE_NULL;
+    return true;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+    (void)eraseAp;
+    if (wifiOff) mode(WIFI_MODE_NULL);
+    return true;
+}
+
+bool WiFiClass::setSleep(bool enabled) {
+    sleep_ = enabled;
+    return esp_wifi_set_ps(enabled ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE) == ESP_OK;
+}
+
+String WiFiClass::macAddress() {
+    uint8_t mac[6];
+    macAddress(mac);
+    char buf[18];
+    snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return String(buf);
+}
+
+uint8_t* WiFiClass::macAddress(uint8_t* mac) {
+    esp_wifi_get_mac(WIFI_IF_STA, mac);
+    return mac;
+}
+
+int32_t WiFiClass::channel() {
+    uint8_t primary = 0;
+    wifi_second_chan_t second;
+    esp_wifi_get_channel(&primary, &second);
+    return primary;
+}
+
+// --- esp_wifi ---------------------------------------------------------------
+
+esp_err_t esp_wifi_start() {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.wifiStarted = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop() {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.wifiStarted = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second) {
+    (void)second;
+    if (primary < 1 || primary > 14) return ESP_ERR_INVALID_ARG;
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.channel = primary;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_channel(uint8_t* primary, wifi_second_chan_t* second) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    if (primary) *primary = b.channel;
+    if (second) *second = WIFI_SECOND_CHAN_NONE;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous(bool enable) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.promiscuous = enable;
+    b.cv.notify_all();
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_promiscuous(bool* enable) {
+    if (!enable) return ESP_ERR_INVALID_ARG;
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    *enable = b.promiscuous;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t cb) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.promiscuousCb = cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_filter(const wifi_promiscuous_filter_t* filter) {
+    if (!filter) return ESP_ERR_INVALID_ARG;
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.promiscuousFilter = filter->filter_mask;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.powerSave = type;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_ps(wifi_ps_type_t* type) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    if (type) *type = b.powerSave;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_country(wifi_country_t* country) {
+    if (!country) return ESP_ERR_INVALID_ARG;
+    // The driver's default, "CN": channels 1 to 13
+    memset(country, 0, sizeof(*country));
+    memcpy(country->cc, "CN", 3);
+    country->schan = 1;
+    country->nchan = 13;
+    country->max_tx_power = 20;
+    country->policy = WIFI_COUNTRY_POLICY_AUTO;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mac(wifi_interface_t ifx, uint8_t mac[6]) {
+    (void)ifx;
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    memcpy(mac, b.self.data(), 6);
+    return ESP_OK;
+}
+
+// --- esp_now ----------------------------------------------------------------
+
+esp_err_t esp_now_init() {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    if (!b.wifiStarted) return ESP_ERR_WIFI_NOT_STARTED;
+    b.nowInitialized = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_deinit() {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.nowInitialized = false;
+    b.recvCb = nullptr;
+    b.sendCb = nullptr;
+    b.registeredPeers.clear();
+    return ESP_OK;
+}
+
+esp_err_t esp_now_get_version(uint32_t* version) {
+    if (!version) return ESP_ERR_ESPNOW_ARG;
+    *version = 1;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    if (!b.nowInitialized) return ESP_ERR_ESPNOW_NOT_INIT;
+    b.recvCb = cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_unregister_recv_cb() {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.recvCb = nullptr;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    if (!b.nowInitialized) return ESP_ERR_ESPNOW_NOT_INIT;
+    b.sendCb = cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_unregister_send_cb() {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.sendCb = nullptr;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_send(const uint8_t* peer_addr, const uint8_t* data, size_t len) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    if (!b.nowInitialized) return ESP_ERR_ESPNOW_NOT_INIT;
+#ifdef ESP_NOW_MAX_DATA_LEN_V2
+    if (!data || len == 0 || len > ESP_NOW_MAX_DATA_LEN_V2) return ESP_ERR_ESPNOW_ARG;
+#else
+    if (!data || len == 0 || len > ESP_NOW_MAX_DATA_LEN) return ESP_ERR_ESPNOW_ARG;
+#endif
+    Mac dst = peer_addr ? toMac(peer_addr) : kBroadcast;
+    if (dst != kBroadcast && !b.registeredPeers.count(dst)) return ESP_ERR_ESPNOW_NOT_FOUND;
+    if (b.pendingTx >= kMaxPendingTx) return ESP_ERR_ESPNOW_NO_MEM;
+    b.pendingTx++;
+    b.stats.framesSent++;
+    b.stats.bytesSent += len;
+    b.push(true, b.self, dst, data, len);
+    return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer) {
+    if (!peer) return ESP_ERR_ESPNOW_ARG;
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    if (!b.nowInitialized) return ESP_ERR_ESPNOW_NOT_INIT;
+    Mac mac = toMac(peer->peer_addr);
+    if (b.registeredPeers.count(mac)) return ESP_ERR_ESPNOW_EXIST;
+    if (b.registeredPeers.size() >= ESP_NOW_MAX_TOTAL_PEER_NUM) return ESP_ERR_ESPNOW_FULL;
+    b.registeredPeers[mac] = peer->channel;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_del_peer(const uint8_t* peer_addr) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    return b.registeredPeers.erase(toMac(peer_addr)) ? ESP_OK : ESP_ERR_ESPNOW_NOT_FOUND;
+}
+
+esp_err_t esp_now_mod_peer(const esp_now_peer_info_t* peer) {
+    if (!peer) return ESP_ERR_ESPNOW_ARG;
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    auto it = b.registeredPeers.find(toMac(peer->peer_addr));
+    if (it == b.registeredPeers.end()) return ESP_ERR_ESPNOW_NOT_FOUND;
+    it->second = peer->channel;
+    return ESP_OK;
+}
+
+bool esp_now_is_peer_exist(const uint8_t* peer_addr) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    return b.registeredPeers.count(toMac(peer_addr)) != 0;
+}
+
+// --- Host control -----------------------------------------------------------
+
+namespace NativeHal {
+
+void setSelfMac(const uint8_t mac[6]) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.self = toMac(mac);
+}
+
+void attachPeer(const uint8_t mac[6], PeerHandler handler, uint8_t channel, int8_t rssi) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    SimPeer peer;
+    peer.handler = handler;
+    peer.channel = channel;
+    peer.rssi = rssi;
+    b.simPeers[toMac(mac)] = peer;
+}
+
+void detachPeer(const uint8_t mac[6]) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.simPeers.erase(toMac(mac));
+}
+
+void setPeerChannel(const uint8_t mac[6], uint8_t channel) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    auto it = b.simPeers.find(toMac(mac));
+    if (it != b.simPeers.end()) it->second.channel = channel;
+}
+
+void deliverFrame(const uint8_t srcMac[6], const uint8_t* data, int len) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.push(false, toMac(srcMac), b.self, data, (size_t)len);
+}
+
+void setLinkLoss(double probability) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.lossProbability = probability;
+}
+
+void setLinkLatencyUs(uint32_t latencyUs) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.latencyUs = latencyUs;
+}
+
+void setPhyRateMbps(uint32_t mbps) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.phyRateMbps = mbps > 0 ? mbps : 1;
+}
+
+void setChannelNoise(uint8_t channel, uint32_t framesPerSecond) {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.channelNoise[channel] = framesPerSecond;
+}
+
+BusStats busStats() {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    return b.stats;
+}
+
+void resetBusStats() {
+    Bus& b = bus();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.stats = BusStats();
+}
+
+void flushBus() {
+    Bus& b = bus();
+    std::unique_lock<std::mutex> lock(b.mutex);
+    b.idle.wait(lock, [&b]() { return b.frames.empty() && !b.busy; });
+}
+
+} // namespace NativeHal
@@ -0,0 +1,265 @@
+// FreeRTOS.cpp - host stand-in for FreeRTOS tasks, notifications and queues
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct NativeTask {
+    std::string name;
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t notifyValue = 0;
+    bool notifyPending = false;
+    std::atomic<bool> deleted{false};
+};
+
+struct NativeQueue {
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<std::vector<uint8_t>> items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+};
+
+namespace {
+
+// Unwinds a task thread after vTaskDelete().
+struct TaskDeleted {};
+
+thread_local NativeTask* currentTask = nullptr;
+
+NativeTask* self() {
+    if (!currentTask) {
+        currentTask = new NativeTask();
+        currentTask->name = "loopTask";
+    }
+    return currentTask;
+}
+
+void checkDeleted() {
+    NativeTask* task = currentTask;
+    if (task && task->deleted.load()) throw TaskDeleted();
+}
+
+// Waits on a condition variable in short slices so deletion is noticed.
+template <typename Lock, typename Predicate>
+bool waitTicks(std::condition_variable& cv, Lock& lock, TickType_t ticks, Predicate ready) {
+    using namespace std::chrono;
+    if (ticks == portMAX_DELAY) {
+        while (!ready()) {
+            cv.wait_for(lock, milliseconds(50));
+            if (currentTask && currentTask->deleted.load()) {
+                lock.unlock();
+                throw TaskDeleted();
+            }
+        }
+        return true;
+    }
+    auto deadline = steady_clock::now() + milliseconds(ticks);
+    while (!ready()) {
+        if (cv.wait_until(lock, std::min(deadline, steady_clock::now() + milliseconds(50))) == std::cv_status::timeout &&
+            steady_clock::now() >= deadline) {
+            return ready();
+        }
+        if (currentTask && currentTask->deleted.load()) {
+            lock.unlock();
+            throw TaskDeleted();
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+BaseType_t xPortInIsrContext() {
+    return pdFALSE;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                                   void* parameter, UBaseType_t priority, TaskHandle_t* createdTask,
+                                   BaseType_t coreId) {
+    (void)stackDepth;
+    (void)priority;
+    (void)coreId;
+    NativeTask* task = new NativeTask();
+    task->name = name ? name : "task";
+    if (createdTask) *createdTask = task;
+    std::thread([function, parameter, task]() {
+        currentTask = task;
+        try {
+            function(parameter);
+        } catch (const TaskDeleted&) {
+        }
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                       void* parameter, UBaseType_t priority, TaskHandle_t* createdTask) {
+    return xTaskCreatePinnedToCore(function, name, stackDepth, parameter, priority, createdTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (!task || task == currentTask) {
+        if (currentTask) currentTask->deleted.store(true);
+        throw TaskDeleted();
+    }
+    task->deleted.store(true);
+    task->cv.notify_all();
+}
+
+void vTaskDelay(TickType_t ticks) {
+    NativeTask* task = self();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    waitTicks(task->cv, lock, ticks ? ticks : 1, []() { return false; });
+    checkDeleted();
+}
+
+TickType_t xTaskGetTickCount() {
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return (TickType_t)duration_cast<milliseconds>(steady_clock::now() - start).count();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return self();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+    NativeTask* task = self();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    if (ticksToWait) {
+        waitTicks(task->cv, lock, ticksToWait, [task]() { return task->notifyValue != 0; });
+    }
+    uint32_t value = task->notifyValue;
+    if (value) task->notifyValue = clearCountOnExit ? 0 : value - 1;
+    task->notifyPending = false;
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    xTaskNotify(task, 0, eIncrement);
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    if (!task) return pdFAIL;
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        switch (action) {
+            case eSetBits: task->notifyValue |= value; break;
+            case eIncrement: task->notifyValue++; break;
+            case eSetValueWithOverwrite: task->notifyValue = value; break;
+            case eSetValueWithoutOverwrite:
+                if (task->notifyPending) return pdFAIL;
+                task->notifyValue = value;
+                break;
+            case eNoAction: break;
+        }
+        task->notifyPending = true;
+    }
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action,
+                              BaseType_t* higherPriorityTaskWoken) {
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+    return xTaskNotify(task, value, action);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t bitsToClearOnEntry, uint32_t bitsToClearOnExit,
+                           uint32_t* notificationValue, TickType_t ticksToWait) {
+    NativeTask* task = self();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    if (!task->notifyPending) task->notifyValue &= ~bitsToClearOnEntry;
+    bool got = task->notifyPending;
+    if (!got && ticksToWait) {
+        got = waitTicks(task->cv, lock, ticksToWait, [task]() { return task->notifyPending; });
+    }
+    if (notificationValue) *notificationValue = task->notifyValue;
+    if (got) {
+        task->notifyValue &= ~bitsToClearOnExit;
+        task->notifyPending = false;
+    }
+    return got ? pdTRUE : pdFALSE;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    NativeQueue* queue = new NativeQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    // Tasks blocked on the queue may still hold a reference; leak it rather
+    // than race them (the target has the same "don't do that" contract).
+    (void)queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    if (!queue) return errQUEUE_FULL;
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    bool ok = queue->items.size() < queue->length;
+    if (!ok && ticksToWait) {
+        ok = waitTicks(queue->notFull, lock, ticksToWait, [queue]() { return queue->items.size() < queue->length; });
+    }
+    if (!ok) return errQUEUE_FULL;
+    const uint8_t* bytes = static_cast<const uint8_t*>(item);
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    lock.unlock();
+    queue->notEmpty.notify_one();
+    return pdPASS;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return xQueueSend(queue, item, ticksToWait);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* higherPriorityTaskWoken) {
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticksToWait) {
+    if (!queue) return pdFALSE;
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    bool ok = !queue->items.empty();
+    if (!ok && ticksToWait) {
+        ok = waitTicks(queue->notEmpty, lock, ticksToWait, [queue]() { return !queue->items.empty(); });
+    }
+    if (!ok) return pdFALSE;
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    lock.unlock();
+    queue->notFull.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    if (!queue) return pdFAIL;
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->items.clear();
+    queue->notFull.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    if (!queue) return 0;
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return (UBaseType_t)queue->items.size();
+}
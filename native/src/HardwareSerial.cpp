@@ -0,0 +1,69 @@
+// HardwareSerial.cpp - host stand-in for the ESP32 UARTs
+#include "Arduino.h"
+#include "NativeHal.h"
+
+#include <cstdio>
+
+HardwareSerial Serial(0);
+HardwareSerial Serial2(2);
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin) {
+    (void)baud;
+    (void)config;
+    (void)rxPin;
+    (void)txPin;
+}
+
+void HardwareSerial::end() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rx_.clear();
+}
+
+int HardwareSerial::available() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return (int)rx_.size();
+}
+
+int HardwareSerial::read() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (rx_.empty()) return -1;
+    int c = rx_.front();
+    rx_.pop_front();
+    return c;
+}
+
+int HardwareSerial::peek() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rx_.empty() ? -1 : rx_.front();
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    // Only the console reaches stdout; UART2 output goes nowhere.
+    if (port_ == 0 && echo_) {
+        fwrite(buffer, 1, size, stdout);
+        fflush(stdout);
+    }
+    return size;
+}
+
+void HardwareSerial::inject(const char* data, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < length; ++i) rx_.push_back((uint8_t)data[i]);
+}
+
+namespace NativeHal {
+
+void injectSerialInput(int port, const char* text) {
+    HardwareSerial& serial = port == 2 ? Serial2 : Serial;
+    serial.inject(text, strlen(text));
+}
+
+void setSerialEcho(bool echo) {
+    Serial.setEcho(echo);
+}
+
+} // namespace NativeHal
@@ -0,0 +1,988 @@
+// NativeMain.cpp - host runner for the firmware
+//
+// Runs setup() once and loop() until the requested duration has passed,
+// while a script thread drives the simulated buttons, serial console and
+// NFC field. Usage:
+//
+//   nuggets [--duration MS] [--script FILE] [--press NAME@MS ...] [--dump FILE.ppm]
+//           [--remote MAC [--link-latency US] [--link-loss P] [--legacy-peer]
+//           [--relay MAC] [--peer-frame BYTES]] [--noise CHANNEL:FPS ...]
+//           [--fleet COUNT[:SILENT[:LEGACY]]] [--flow-benchmark] [--session-restart]
+//
+// --remote starts in remote control mode paired with MAC, where a loopback
+// peer on the ESP-NOW bus acks every command the way the receiver does. In a
+// NUGGETS_BENCHMARKS build, press SET to get the input-to-ack latency report.
+// --legacy-peer makes that peer behave like firmware without the compact
+// wire format. --relay puts the remote MAC out of range: the loopback peer
+// is then a relay with that MAC, which announces the remote MAC as its
+// neighbour and answers for it. --noise fills a channel with foreign
+// traffic for the channel survey of the link diagnostics screen (BACK).
+// --peer-frame is the largest frame the peer says it takes, WIRE_MAX_FRAME
+// by default; 0 makes it firmware that never says. Build with
+// -DNATIVE_ESP_NOW_V2 for the ESP-NOW v2 frame size.
+//
+// --fleet replaces the stored MAC addresses with COUNT simulated nodes and
+// starts on the sync screen (press SET to sync). Each node acks the
+// CMD_SYNC_NODES frame routed to it, except the last SILENT, which never
+// answer. The LEGACY before those ack in the legacy format, as firmware
+// older than the compact one does. --link-loss applies to them too.
+//
+// Script lines are "<ms> <command> [args]", '#' starts a comment:
+//   500 press UP [holdMs]   tap a button (UP DOWN LEFT RIGHT CENTER SET BACK A1 A2)
+//   600 down BACK / up BACK hold or release a button
+//   700 serial text          feed the console (a newline is appended)
+//   800 tag 213|215|216      put a blank NTAG in the field; "untag" removes it
+//   900 dump frame.ppm       write the current frame buffer
+//   950 draw [screens]       the --remote peer draws a screen on the node, as
+//                            one CMD_BATCH frame if the node speaks compact
+//   990 blit [frames]        the --remote peer streams an animated image to the
+//                            node in CMD_BLIT fragments, later frames as deltas
+//   995 text [bytes]         the --remote peer shows a message too long for one
+//                            frame, in CMD_FRAGMENT commands (compact nodes only)
+//
+// --session-restart skips the script, streams a blit and plot points from
+// one RemoteService session and checks that a command from a new session
+// opened straight after it is acted on by a peer that drops replays; it
+// exits 1 if not.
+//
+// --flow-benchmark (NUGGETS_BENCHMARKS builds) skips the script and has a
+// RemoteService stream plot points to a simulated receiver that renders
+// slower than the link, with and without the credit in its acks.
+#include <Arduino.h>
+#include "NativeHal.h"
+#include "Device.h"
+#include "Application.h"
+#include "StateFactory.h"
+#include "Communication/MessageTypes.h"
+#include "Communication/WireFormat.h"
+#include "Communication/CommandBatch.h"
+#include "Communication/DisplayCodec.h"
+#include "Communication/Blit.h"
+#include "Communication/Fragmentation.h"
+#include "Communication/MacAddressStorage.h"
+#include "Communication/RemoteService.h"
+#include "Communication/ReplayWindow.h"
+#include "Communication/RoutingTable.h"
+#ifdef NUGGETS_BENCHMARKS
+#include <deque>
+#include <set>
+#endif
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+void setup();
+void loop();
+
+using NuggetsInc::Device;
+using NuggetsInc::BlitEncoder;
+using NuggetsInc::BlitImage;
+using NuggetsInc::CommandBatch;
+using NuggetsInc::DisplayArgs;
+using NuggetsInc::DisplayCodec;
+using NuggetsInc::Fragmenter;
+using NuggetsInc::TileDiff;
+using NuggetsInc::WireFormat;
+using NuggetsInc::WireMessage;
+using NuggetsInc::WireVersion;
+
+namespace {
+
+struct ScriptStep {
+    uint32_t atMs;
+    std::string command;
+    std::string argument;
+    uint32_t value;
+};
+
+int pinForName(const std::string& name) {
+    if (name == "UP") return Device::JOY_UP_PIN;
+    if (name == "DOWN") return Device::JOY_DOWN_PIN;
+    if (name == "LEFT") return Device::JOY_LEFT_PIN;
+    if (name == "RIGHT") return Device::JOY_RIGHT_PIN;
+    if (name == "CENTER") return Device::JOY_CENTER_PIN;
+    if (name == "SET" || name == "SELECT") return Device::SET_BUTTON_PIN;
+    if (name == "BACK") return Device::BACK_BUTTON_PIN;
+    if (name == "A1") return Device::ACTION_ONE_BUTTON_PIN;
+    if (name == "A2") return Device::ACTION_TWO_BUTTON_PIN;
+    return -1;
+}
+
+bool parseLine(const std::string& line, ScriptStep& step) {
+    std::string trimmed = line.substr(0, line.find('#'));
+    std::istringstream in(trimmed);
+    if (!(in >> step.atMs >> step.command)) return false;
+    step.value = 0;
+    if (step.command == "serial") {
+        std::getline(in >> std::ws, step.argument);
+        return true;
+    }
+    in >> step.argument >> step.value;
+    return true;
+}
+
+void drawFromPeer(uint32_t screens);
+void blitFromPeer(uint32_t frames);
+void textFromPeer(size_t bytes);
+
+void runStep(const ScriptStep& step) {
+    if (step.command == "press" || step.command == "down" || step.command == "up") {
+        int pin = pinForName(step.argument);
+        if (pin < 0) {
+            fprintf(stderr, "script: unknown button '%s'\n", step.argument.c_str());
+            return;
+        }
+        if (step.command != "up") NativeHal::setPinLevel((uint8_t)pin, LOW);
+        if (step.command == "press") {
+            std::this_thread::sleep_for(std::chrono::milliseconds(step.value ? step.value : 60));
+        }
+        if (step.command != "down") NativeHal::setPinLevel((uint8_t)pin, HIGH);
+    } else if (step.command == "serial") {
+        NativeHal::injectSerialInput(0, (step.argument + "\n").c_str());
+    } else if (step.command == "tag") {
+        NativeHal::presentTag(NativeHal::makeBlankNtag(step.argument.empty() ? 213 : atoi(step.argument.c_str())));
+    } else if (step.command == "untag") {
+        NativeHal::removeTag();
+    } else if (step.command == "dump") {
+        Device::getInstance().getDisplay()->dumpPPM(step.argument.c_str());
+    } else if (step.command == "draw") {
+        drawFromPeer(step.argument.empty() ? 1 : (uint32_t)strtoul(step.argument.c_str(), nullptr, 10));
+    } else if (step.command == "blit") {
+        blitFromPeer(step.argument.empty() ? 1 : (uint32_t)strtoul(step.argument.c_str(), nullptr, 10));
+    } else if (step.command == "text") {
+        textFromPeer(step.argument.empty() ? 600 : (size_t)strtoul(step.argument.c_str(), nullptr, 10));
+    } else {
+        fprintf(stderr, "script: unknown command '%s'\n", step.command.c_str());
+    }
+}
+
+bool parseMac(const std::string& text, uint8_t mac[6]) {
+    unsigned int b[6];
+    if (sscanf(text.c_str(), "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6) {
+        return false;
+    }
+    for (int i = 0; i < 6; ++i) mac[i] = (uint8_t)b[i];
+    return true;
+}
+
+struct LoopbackPeer {
+    bool attached;
+    bool legacyOnly;
+    std::atomic<bool> nodeSpeaksCompact;
+    std::atomic<uint32_t> nextMessageID;
+    std::array<uint8_t, 6> mac;
+    bool relaying;
+    std::array<uint8_t, 6> far; // the node behind the relay
+    std::atomic<uint8_t> channel;
+    uint16_t frameSize;                   // what it advertises, 0 for none
+    std::atomic<uint16_t> nodeFrameSize;  // what the node advertised, 0 until it has
+    std::atomic<bool> owesFrameSize;
+};
+LoopbackPeer loopback;
+
+// Largest frame on the link between the peer and the node
+size_t peerFrameSize() {
+    uint16_t node = loopback.nodeFrameSize;
+    if (loopback.frameSize <= NuggetsInc::WIRE_V1_FRAME || node <= NuggetsInc::WIRE_V1_FRAME) {
+        return NuggetsInc::WIRE_V1_FRAME;
+    }
+    return loopback.frameSize < node ? loopback.frameSize : node;
+}
+
+void sendFromPeer(const WireMessage& original, bool compact) {
+    WireMessage message = original;
+    if (compact && loopback.frameSize != 0) {
+        // Asks for the node's frame size until it has it, and answers when asked
+        bool request = loopback.frameSize > NuggetsInc::WIRE_V1_FRAME && loopback.nodeFrameSize == 0;
+        if (request || loopback.owesFrameSize.exchange(false)) {
+            message.frameSize = loopback.frameSize;
+            message.frameSizeRequest = request;
+        }
+    }
+    uint8_t frame[WireFormat::MAX_FRAME_SIZE];
+    size_t length = WireFormat::encode(message, compact ? NuggetsInc::WIRE_COMPACT : NuggetsInc::WIRE_LEGACY,
+                                       loopback.mac.data(), frame, sizeof(frame));
+    if (length == 0 || length > peerFrameSize()) {
+        fprintf(stderr, "loopback: command %u does not fit the frame\n", message.commandID);
+        return;
+    }
+    if (loopback.legacyOnly) {
+        // Older firmware leaves the rest of messageType zeroed
+        memset(frame + offsetof(struct_message, messageType) + 4, 0, 6);
+    }
+    NativeHal::deliverFrame(loopback.mac.data(), frame, (int)length);
+}
+
+// Older firmware only knows the text form of the display arguments
+void sendUnbatched(uint8_t commandID, const char* data, size_t length, bool typed, void*) {
+    char text[NuggetsInc::WIRE_MAX_PAYLOAD + 1];
+    if (typed) {
+        DisplayArgs args;
+        if (!DisplayCodec::decode(commandID, (const uint8_t*)data, length, args) ||
+            DisplayCodec::formatText(commandID, args, text, sizeof(text)) == 0) {
+            fprintf(stderr, "loopback: cannot convert command %u to text\n", commandID);
+            return;
+        }
+        data = text;
+    }
+    WireMessage message;
+    WireFormat::initCommand(message, loopback.nextMessageID++, commandID, data);
+    sendFromPeer(message, false);
+}
+
+DisplayArgs colorArgs(uint16_t color) {
+    DisplayArgs args;
+    args.color.color = color;
+    return args;
+}
+
+DisplayArgs textSizeArgs(uint8_t size) {
+    DisplayArgs args;
+    args.textSize.size = size;
+    return args;
+}
+
+DisplayArgs cursorArgs(int16_t x, int16_t y) {
+    DisplayArgs args;
+    args.cursor.x = x;
+    args.cursor.y = y;
+    return args;
+}
+
+DisplayArgs rectArgs(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    DisplayArgs args;
+    args.rect.x = x;
+    args.rect.y = y;
+    args.rect.w = w;
+    args.rect.h = h;
+    args.rect.color = color;
+    return args;
+}
+
+// What a device driving the remote's screen sends for one status screen
+void drawFromPeer(uint32_t screens) {
+    if (!loopback.attached) {
+        fprintf(stderr, "script: draw needs --remote\n");
+        return;
+    }
+    for (uint32_t i = 0; i < screens; ++i) {
+        char line[32];
+        snprintf(line, sizeof(line), "Screen %u", i + 1);
+        CommandBatch batch;
+        batch.add(CMD_FILL_SCREEN, colorArgs(0));
+        batch.add(CMD_SET_TEXT_COLOR, colorArgs(65535));
+        batch.add(CMD_SET_TEXT_SIZE, textSizeArgs(3));
+        batch.add(CMD_SET_CURSOR, cursorArgs(20, 20));
+        batch.add(CMD_PRINTLN, line);
+        batch.add(CMD_SET_TEXT_SIZE, textSizeArgs(2));
+        batch.add(CMD_SET_CURSOR, cursorArgs(20, 70));
+        batch.add(CMD_PRINTLN, "Battery 87%");
+        batch.add(CMD_SET_CURSOR, cursorArgs(20, 100));
+        batch.add(CMD_PRINTLN, "Signal -54 dBm");
+        batch.add(CMD_DRAW_RECT, rectArgs(10, 10, 300, 130, 2016));
+        batch.add(CMD_FILL_RECT, rectArgs(20, 150, 200, 20, 63488));
+
+        if (loopback.nodeSpeaksCompact && !loopback.legacyOnly) {
+            WireMessage message;
+            WireFormat::initCommand(message, loopback.nextMessageID++, CMD_BATCH,
+                                    batch.data(), batch.size());
+            sendFromPeer(message, true);
+        } else {
+            CommandBatch::forEach(batch.data(), batch.size(), sendUnbatched, nullptr);
+        }
+    }
+}
+
+struct PeerBlit {
+    std::vector<uint16_t> pixels;
+    BlitImage image;
+    TileDiff tiles;
+    uint32_t frame;
+};
+PeerBlit peerBlit;
+
+// A gauge panel: gradient title bar, bar chart and a marker that moves
+void renderBlitFrame(uint32_t frame) {
+    const int16_t w = 192, h = 96;
+    std::vector<uint16_t>& pixels = peerBlit.pixels;
+    pixels.assign((size_t)w * h, 0x0841);
+    for (int16_t y = 0; y < 16; ++y) {
+        for (int16_t x = 0; x < w; ++x) pixels[(size_t)y * w + x] = (uint16_t)((x / 6) << 11 | 0x001F);
+    }
+    for (int16_t bar = 0; bar < 8; ++bar) {
+        int16_t height = 10 + (int16_t)((bar * 7 + frame * (bar == 3 ? 5 : 0)) % 50);
+        for (int16_t y = 90 - height; y < 90; ++y) {
+            for (int16_t x = 8 + bar * 22; x < 24 + bar * 22; ++x) pixels[(size_t)y * w + x] = 0x07E0;
+        }
+    }
+    int16_t markerX = (int16_t)(frame * 12 % (w - 8));
+    for (int16_t y = 20; y < 28; ++y) {
+        for (int16_t x = markerX; x < markerX + 8; ++x) pixels[(size_t)y * w + x] = 0xF800;
+    }
+    peerBlit.image.format = NuggetsInc::BLIT_RGB565;
+    peerBlit.image.pixels = pixels.data();
+    peerBlit.image.width = w;
+    peerBlit.image.height = h;
+}
+
+struct BlitTally {
+    uint32_t fragments;
+    uint32_t bytes;
+    uint32_t pixels;
+};
+
+void streamBlitRegion(int16_t x, int16_t y, int16_t w, int16_t h, void* context) {
+    BlitTally* tally = static_cast<BlitTally*>(context);
+    BlitEncoder encoder;
+    encoder.begin(peerBlit.image, x, y, w, h, 40 + x, 40 + y);
+    uint8_t payload[NuggetsInc::WIRE_MAX_PAYLOAD];
+    while (!encoder.done()) {
+        size_t length = encoder.next(payload, peerFrameSize() - NuggetsInc::WIRE_COMPACT_OVERHEAD);
+        if (length == 0) break;
+        WireMessage message;
+        WireFormat::initCommand(message, loopback.nextMessageID++, CMD_BLIT, payload, length);
+        message.typed = true;
+        sendFromPeer(message, true);
+        tally->fragments++;
+        tally->bytes += (uint32_t)length;
+        // Paced so the node's receive queue keeps up
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    tally->pixels += (uint32_t)w * h;
+}
+
+void blitFromPeer(uint32_t frames) {
+    if (!loopback.attached || !loopback.nodeSpeaksCompact || loopback.legacyOnly) {
+        fprintf(stderr, "script: blit needs --remote and a node speaking compact\n");
+        return;
+    }
+    for (uint32_t i = 0; i < frames; ++i) {
+        renderBlitFrame(peerBlit.frame);
+        BlitTally tally = {0, 0, 0};
+        uint16_t tiles = peerBlit.tiles.diff(peerBlit.image, streamBlitRegion, &tally);
+        printf("blit frame %u: %u tiles, %u px in %u fragments, %u bytes (raw %u)\n",
+               peerBlit.frame, tiles, tally.pixels, tally.fragments, tally.bytes,
+               tally.pixels * 2);
+        peerBlit.frame++;
+    }
+}
+
+void textFromPeer(size_t bytes) {
+    if (!loopback.attached || !loopback.nodeSpeaksCompact || loopback.legacyOnly) {
+        fprintf(stderr, "script: text needs --remote and a node speaking compact\n");
+        return;
+    }
+    std::string text;
+    while (text.size() < bytes) {
+        char word[16];
+        snprintf(word, sizeof(word), "word%u ", (unsigned)(text.size() / 6));
+        text += word;
+    }
+    text.resize(bytes < Fragmenter::MAX_MESSAGE_SIZE ? bytes : Fragmenter::MAX_MESSAGE_SIZE);
+
+    static uint16_t transferID = 1;
+    uint8_t count = Fragmenter::count(text.size());
+    // Last fragment first, so the node has to put them back in order
+    for (uint8_t i = 0; i < count; ++i) {
+        uint8_t index = (uint8_t)((i + count - 1) % count);
+        uint8_t payload[NuggetsInc::WIRE_MAX_PAYLOAD];
+        size_t length = Fragmenter::write(transferID, CMD_DISPLAY_MESSAGE, false,
+                                          (const uint8_t*)text.data(), text.size(), index,
+                                          payload, sizeof(payload));
+        WireMessage message;
+        WireFormat::initCommand(message, loopback.nextMessageID++, CMD_FRAGMENT,
+                                payload, length);
+        message.typed = true;
+        sendFromPeer(message, true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    printf("text: %u bytes in %u fragments\n", (unsigned)text.size(), count);
+    transferID++;
+}
+
+void announceFromPeer() {
+    uint8_t entry[NuggetsInc::RoutingTable::ANNOUNCE_ENTRY_SIZE];
+    size_t length = 0;
+    if (loopback.relaying) {
+        // The far node is a neighbour: one hop, reached directly
+        memcpy(entry, loopback.far.data(), 6);
+        entry[6] = 1;
+        memcpy(entry + 7, loopback.far.data(), 6);
+        length = sizeof(entry);
+    }
+    WireMessage announcement;
+    WireFormat::initCommand(announcement, 0, CMD_RELAY_CONNECTION, entry, length);
+    announcement.typed = true;
+    sendFromPeer(announcement, true);
+}
+
+// Switches once the ack is on the air, then says hello on the new channel
+void followChannel(const WireMessage& message) {
+    if (message.payloadLength != 1) return;
+    uint8_t channel = (uint8_t)message.payload[0];
+    if (loopback.channel.exchange(channel) == channel) return;
+    std::thread([channel]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        NativeHal::setPeerChannel(loopback.mac.data(), channel);
+        printf("peer: now on channel %u\n", channel);
+        announceFromPeer();
+    }).detach();
+}
+
+// Acks every command frame, echoing its messageID like the receiving device.
+// It speaks the compact format to anyone advertising it and legacy otherwise,
+// so --legacy-peer makes it behave like older firmware.
+//
+// It answers the node's route announcements with its own, as firmware does on
+// its timer, and follows CMD_SET_CHANNEL a moment after acking it.
+//
+// As a relay (farMac set) its announcements list farMac as a neighbour, and
+// it acks commands routed to farMac as farMac would, back through itself.
+void attachLoopbackPeer(const uint8_t peerMac[6], bool legacyOnly, const uint8_t* farMac,
+                        uint16_t frameSize) {
+    memcpy(loopback.mac.data(), peerMac, 6);
+    loopback.legacyOnly = legacyOnly;
+    loopback.frameSize = frameSize;
+    loopback.nodeFrameSize = 0;
+    loopback.owesFrameSize = false;
+    loopback.nodeSpeaksCompact = false;
+    loopback.nextMessageID = 1;
+    loopback.relaying = farMac != nullptr;
+    loopback.channel = 1;
+    if (farMac) memcpy(loopback.far.data(), farMac, 6);
+    loopback.attached = true;
+    NativeHal::attachPeer(peerMac, [](const uint8_t*, const uint8_t* data, int len) {
+        WireMessage message;
+        WireVersion version;
+        bool advertisesCompact;
+        if (!WireFormat::decode(data, len, message, version, advertisesCompact)) return;
+        if (loopback.legacyOnly && version != NuggetsInc::WIRE_LEGACY) return;
+        if (advertisesCompact) loopback.nodeSpeaksCompact = true;
+        if (message.frameSize != 0 && loopback.frameSize != 0) {
+            loopback.nodeFrameSize = message.frameSize;
+            if (message.frameSizeRequest) loopback.owesFrameSize = true;
+        }
+        if (message.type != NuggetsInc::WIRE_CMD) return;
+
+        if (message.commandID == CMD_RELAY_CONNECTION && message.typed) {
+            if (!loopback.legacyOnly) announceFromPeer();
+            return;
+        }
+        if (message.commandID == CMD_SET_CHANNEL && message.typed && message.messageID == 0) {
+            followChannel(message);
+            return;
+        }
+
+        WireMessage ack;
+        WireFormat::initAck(ack, message.messageID);
+        if (loopback.relaying) {
+            if (!message.routed || memcmp(message.destination, loopback.far.data(), 6) != 0) return;
+            ack.routed = true;
+            memcpy(ack.origin, loopback.far.data(), 6);
+            memcpy(ack.destination, message.origin, 6);
+            ack.hopCount = 1;
+            memcpy(ack.hops[0], loopback.mac.data(), 6);
+        }
+        sendFromPeer(ack, loopback.nodeSpeaksCompact && !loopback.legacyOnly);
+        if (message.commandID == CMD_SET_CHANNEL && message.typed) followChannel(message);
+    });
+}
+
+// Stored as 02:00:00:00:10:01 onwards; the silent ones are not on the bus
+void attachFleet(uint8_t count, uint8_t silent, uint8_t legacy) {
+    NuggetsInc::MacAddressStorage& storage = NuggetsInc::MacAddressStorage::getInstance();
+    storage.clearAllMacAddresses();
+    for (uint8_t i = 0; i < count; i++) {
+        std::array<uint8_t, 6> mac = {{0x02, 0x00, 0x00, 0x00, 0x10, (uint8_t)(i + 1)}};
+        char text[18];
+        snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2],
+                 mac[3], mac[4], mac[5]);
+        storage.saveMacAddress(String(text));
+        if (i >= count - silent) continue;
+        bool legacyOnly = i >= count - silent - legacy;
+
+        NativeHal::attachPeer(mac.data(), [mac, legacyOnly](const uint8_t*, const uint8_t* data, int len) {
+            WireMessage message;
+            WireVersion version;
+            bool advertisesCompact;
+            if (!WireFormat::decode(data, len, message, version, advertisesCompact)) return;
+            if (message.type != NuggetsInc::WIRE_CMD || message.commandID != CMD_SYNC_NODES) return;
+            if (!message.routed || memcmp(message.destination, mac.data(), 6) != 0) return;
+
+            WireMessage ack;
+            WireFormat::initAck(ack, message.messageID);
+            bool compact = !legacyOnly && (advertisesCompact || version == NuggetsInc::WIRE_COMPACT);
+            uint8_t frame[WireFormat::MAX_FRAME_SIZE];
+            size_t length = WireFormat::encode(ack, compact ? NuggetsInc::WIRE_COMPACT : NuggetsInc::WIRE_LEGACY,
+                                               mac.data(), frame, sizeof(frame));
+            if (length == 0) return;
+            if (legacyOnly) memset(frame + offsetof(struct_message, messageType) + 4, 0, 6);
+            NativeHal::deliverFrame(mac.data(), frame, (int)length);
+        });
+    }
+}
+
+// A node that acts on a command only if its ReplayWindow has not seen the
+// messageID, as the firmware does, and acks it either way
+struct ReplayCheckingPeer {
+    std::array<uint8_t, 6> mac;
+    std::mutex mutex;
+    NuggetsInc::ReplayWindow window;
+    uint32_t executed = 0;
+    uint32_t replays = 0;
+};
+
+// Sends until everything queued is acked or given up on
+bool drain(NuggetsInc::RemoteService& service, uint32_t timeoutMs) {
+    uint32_t startMs = millis();
+    while (millis() - startMs < timeoutMs) {
+        service.poll();
+        NuggetsInc::RemoteService::DeliveryStats stats = service.getDeliveryStats();
+        if (!service.isBlitting() && stats.queued == stats.delivered + stats.failed) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    return false;
+}
+
+const uint32_t SESSION_RESTART_POINTS = 600;
+const uint32_t SESSION_RESTART_PHY_MBPS = 24;
+
+void ignoreCompletion(uint32_t, bool, void*) {}
+
+// A remote that streams a blit and plots over it, is left and is opened
+// again within the peer's ReplayWindow::SESSION_IDLE_MS. The first session's
+// IDs run ahead of millis(), so the second session's command is only acted
+// on if its IDs carry on from them.
+bool runSessionRestart() {
+    using NuggetsInc::RemoteService;
+    ReplayCheckingPeer peer;
+    peer.mac = {{0x02, 0x00, 0x00, 0x00, 0x00, 0x51}};
+    ReplayCheckingPeer* target = &peer;
+    NativeHal::attachPeer(peer.mac.data(), [target](const uint8_t* src, const uint8_t* data, int len) {
+        WireMessage message;
+        WireVersion version;
+        bool advertisesCompact;
+        if (!WireFormat::decode(data, len, message, version, advertisesCompact) ||
+            message.type != NuggetsInc::WIRE_CMD || message.messageID == 0) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(target->mutex);
+            if (target->window.isReplay(src, message.messageID)) {
+                target->replays++;
+            } else {
+                target->executed++;
+            }
+        }
+        WireMessage ack;
+        WireFormat::initAck(ack, message.messageID);
+        uint8_t frame[WireFormat::MAX_FRAME_SIZE];
+        size_t length = WireFormat::encode(ack, NuggetsInc::WIRE_COMPACT, target->mac.data(),
+                                           frame, sizeof(frame));
+        NativeHal::deliverFrame(target->mac.data(), frame, (int)length);
+    });
+
+    // Noise, so that every frame of the image is a run of full fragments
+    std::vector<uint16_t> pixels((size_t)192 * 96);
+    uint32_t seed = 12345;
+    for (uint16_t& pixel : pixels) {
+        seed = seed * 1103515245 + 12345;
+        pixel = (uint16_t)(seed >> 16);
+    }
+    BlitImage image;
+    image.format = NuggetsInc::BLIT_RGB565;
+    image.pixels = pixels.data();
+    image.width = 192;
+    image.height = 96;
+
+    // At 1 Mbit/s a command and its ack take about a millisecond of air;
+    // a faster PHY rate lets the IDs outrun millis() as they do on a busy
+    // link set to one
+    NativeHal::setPhyRateMbps(SESSION_RESTART_PHY_MBPS);
+    uint32_t firstID;
+    uint32_t sessionMs;
+    bool settled;
+    {
+        RemoteService session;
+        session.begin(peer.mac.data());
+        session.sendCommand(CMD_BOOOP);
+        settled = drain(session, 1000);
+        firstID = NuggetsInc::WireFormat::lastMessageID();
+        uint32_t startMs = millis();
+        settled = settled && session.sendBlit(image, 0, 0) && drain(session, 5000);
+        // Then points plotted over it, small frames that go out faster
+        // than one a millisecond
+        uint32_t plotted = 0;
+        while (settled && plotted < SESSION_RESTART_POINTS) {
+            RemoteService::DeliveryStats stats = session.getDeliveryStats();
+            if (stats.queued - stats.delivered - stats.failed <
+                RemoteService::QUEUE_SIZE - RemoteService::CONTROL_RESERVED_SLOTS) {
+                // With a callback, so none is coalesced away
+                plotted += session.sendCommandNonBlocking(CMD_PLOT_POINT, nullptr, ignoreCompletion,
+                                                          nullptr) ? 1 : 0;
+            }
+            session.poll();
+        }
+        settled = settled && drain(session, 1000);
+        sessionMs = millis() - startMs;
+    }
+    uint32_t used = NuggetsInc::WireFormat::lastMessageID() - firstID;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    uint32_t executedBefore;
+    {
+        std::lock_guard<std::mutex> lock(peer.mutex);
+        executedBefore = peer.executed;
+    }
+    {
+        RemoteService session;
+        session.begin(peer.mac.data());
+        session.sendCommand(CMD_BOOOP);
+        settled = drain(session, 1000) && settled;
+    }
+    NativeHal::detachPeer(peer.mac.data());
+    NativeHal::setPhyRateMbps(1);
+
+    bool executed = peer.executed > executedBefore;
+    printf("session restart: %u IDs in %u ms, then the next session's command was %s"
+           " (%u replays dropped)\n",
+           used, sessionMs, executed ? "executed" : "taken for a replay", peer.replays);
+    return settled && executed;
+}
+
+#ifdef NUGGETS_BENCHMARKS
+// A receiver with a render queue smaller than the sender's window, as when
+// other peers' frames hold some of its buffers: frames that find the queue
+// full are dropped, the rest are drawn one per renderUs and only then acked.
+struct SlowReceiver {
+    std::array<uint8_t, 6> mac;
+    size_t capacity;
+    uint32_t renderUs;
+    bool advertisesCredit;
+
+    std::mutex mutex;
+    std::deque<WireMessage> queue;
+    std::set<uint32_t> seen;
+    uint32_t received = 0;
+    uint32_t dropped = 0;
+    uint32_t rendered = 0;
+    std::atomic<bool> running{true};
+};
+
+const uint32_t FLOW_RENDER_QUEUE = 6;
+const uint32_t FLOW_RENDER_US = 1500;
+const uint32_t FLOW_POINTS = 1000;
+
+void renderLoop(SlowReceiver* receiver) {
+    while (receiver->running.load()) {
+        WireMessage message;
+        {
+            std::lock_guard<std::mutex> lock(receiver->mutex);
+            if (receiver->queue.empty()) {
+                message.type = NuggetsInc::WIRE_ACK;
+            } else {
+                message = receiver->queue.front();
+            }
+        }
+        if (message.type != NuggetsInc::WIRE_CMD) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(receiver->renderUs));
+
+        WireMessage ack;
+        WireFormat::initAck(ack, message.messageID);
+        {
+            std::lock_guard<std::mutex> lock(receiver->mutex);
+            receiver->queue.pop_front();
+            if (receiver->seen.insert(message.messageID).second) receiver->rendered++;
+            size_t available = receiver->capacity - receiver->queue.size();
+            uint8_t reserve = NuggetsInc::RemoteService::RX_CREDIT_RESERVE;
+            ack.hasCredit = receiver->advertisesCredit;
+            ack.credit = available > reserve ? (uint8_t)(available - reserve) : 0;
+        }
+        uint8_t frame[WireFormat::MAX_FRAME_SIZE];
+        size_t length = WireFormat::encode(ack, NuggetsInc::WIRE_COMPACT, receiver->mac.data(),
+                                           frame, sizeof(frame));
+        NativeHal::deliverFrame(receiver->mac.data(), frame, (int)length);
+    }
+}
+
+struct FlowResult {
+    uint32_t elapsedMs;
+    uint32_t offered;
+    NuggetsInc::RemoteService::DeliveryStats stats;
+    uint32_t received;
+    uint32_t dropped;
+    uint32_t rendered;
+};
+
+void countCompletion(uint32_t, bool, void* context) {
+    (*static_cast<uint32_t*>(context))++;
+}
+
+// Without `coalesce`, FLOW_POINTS points are sent and each has to arrive.
+// With it, a point is offered twice per render time for as long as the
+// receiver would take to draw FLOW_POINTS, and any waiting one may be replaced.
+FlowResult runFlow(bool credit, bool coalesce) {
+    using NuggetsInc::RemoteService;
+    SlowReceiver receiver;
+    receiver.mac = {{0x02, 0x00, 0x00, 0x00, 0x00, 0x42}};
+    receiver.mac[5] += (credit ? 1 : 0) + (coalesce ? 2 : 0);
+    receiver.capacity = FLOW_RENDER_QUEUE;
+    receiver.renderUs = FLOW_RENDER_US;
+    receiver.advertisesCredit = credit;
+    SlowReceiver* target = &receiver;
+    NativeHal::attachPeer(receiver.mac.data(), [target](const uint8_t*, const uint8_t* data, int len) {
+        WireMessage message;
+        WireVersion version;
+        bool advertisesCompact;
+        if (!WireFormat::decode(data, len, message, version, advertisesCompact) ||
+            message.type != NuggetsInc::WIRE_CMD || message.messageID == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(target->mutex);
+        target->received++;
+        if (target->queue.size() >= target->capacity) {
+            target->dropped++;
+            return;
+        }
+        target->queue.push_back(message);
+    });
+    std::thread renderer(renderLoop, &receiver);
+
+    FlowResult result = {};
+    {
+        RemoteService service;
+        service.begin(receiver.mac.data());
+        uint32_t completed = 0;
+        uint32_t startMs = millis();
+        uint32_t offerUs = micros();
+        const uint32_t offerEndUs = offerUs + FLOW_POINTS * FLOW_RENDER_US;
+        while (true) {
+            RemoteService::DeliveryStats stats = service.getDeliveryStats();
+            uint32_t outstanding = stats.queued - stats.delivered - stats.failed;
+            if (coalesce ? (int32_t)(micros() - offerEndUs) >= 0 : result.offered >= FLOW_POINTS) {
+                if (outstanding == 0) break;
+            } else if (coalesce ? (int32_t)(micros() - offerUs) >= 0
+                                : result.offered - completed <
+                                      RemoteService::QUEUE_SIZE - RemoteService::CONTROL_RESERVED_SLOTS) {
+                DisplayArgs args;
+                args.point.x = (int16_t)(result.offered % 100);
+                args.point.y = (int16_t)(result.offered % 37);
+                args.point.color = 0xFFFF;
+                bool queued = coalesce ? service.sendDisplayCommand(CMD_PLOT_POINT, args)
+                                       : service.sendCommandNonBlocking(CMD_PLOT_POINT, nullptr,
+                                                                        countCompletion, &completed);
+                if (coalesce && queued) {
+                    offerUs += FLOW_RENDER_US / 2;
+                }
+                result.offered += queued ? 1 : 0;
+            }
+            service.poll();
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        result.elapsedMs = millis() - startMs;
+        result.stats = service.getDeliveryStats();
+    }
+
+    receiver.running.store(false);
+    renderer.join();
+    NativeHal::detachPeer(receiver.mac.data());
+    result.received = receiver.received;
+    result.dropped = receiver.dropped;
+    result.rendered = receiver.rendered;
+    return result;
+}
+
+void printFlow(const char* name, const FlowResult& r) {
+    printf("  %-20s %5u ms  %6.0f points/s  offered %u  rejected %u  coalesced %u  failed %u"
+           "  retransmissions %u  receiver dropped %u of %u  drawn %u\n",
+           name, r.elapsedMs, r.elapsedMs ? r.rendered * 1000.0 / r.elapsedMs : 0.0, r.offered,
+           r.stats.rejected, r.stats.coalesced, r.stats.failed, r.stats.retransmissions,
+           r.dropped, r.received, r.rendered);
+}
+
+void runFlowBenchmark() {
+    printf("Flow control: plot points to a receiver drawing one per %u us from a %u-frame queue\n",
+           FLOW_RENDER_US, FLOW_RENDER_QUEUE);
+    printFlow("no credit", runFlow(false, false));
+    printFlow("credit", runFlow(true, false));
+    printFlow("credit, coalescing", runFlow(true, true));
+}
+#endif // NUGGETS_BENCHMARKS
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t durationMs = 3000;
+    std::string dumpPath;
+    std::vector<ScriptStep> script;
+    bool remote = false;
+    bool legacyPeer = false;
+    uint16_t peerFrame = NuggetsInc::WIRE_MAX_FRAME;
+    bool relay = false;
+    bool flowBenchmark = false;
+    bool sessionRestart = false;
+    unsigned fleet = 0;
+    unsigned fleetSilent = 0;
+    unsigned fleetLegacy = 0;
+    uint8_t remoteMac[6];
+    uint8_t relayMac[6];
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--duration" && hasValue) {
+            durationMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--dump" && hasValue) {
+            dumpPath = argv[++i];
+        } else if (arg == "--script" && hasValue) {
+            std::ifstream file(argv[++i]);
+            if (!file) {
+                fprintf(stderr, "cannot open script %s\n", argv[i]);
+                return 2;
+            }
+            std::string line;
+            ScriptStep step;
+            while (std::getline(file, line)) {
+                if (parseLine(line, step)) script.push_back(step);
+            }
+        } else if (arg == "--remote" && hasValue) {
+            if (!parseMac(argv[++i], remoteMac)) {
+                fprintf(stderr, "bad MAC address %s\n", argv[i]);
+                return 2;
+            }
+            remote = true;
+        } else if (arg == "--link-latency" && hasValue) {
+            NativeHal::setLinkLatencyUs((uint32_t)strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--link-loss" && hasValue) {
+            NativeHal::setLinkLoss(strtod(argv[++i], nullptr));
+        } else if (arg == "--legacy-peer") {
+            legacyPeer = true;
+        } else if (arg == "--peer-frame" && hasValue) {
+            peerFrame = (uint16_t)strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--relay" && hasValue) {
+            if (!parseMac(argv[++i], relayMac)) {
+                fprintf(stderr, "bad MAC address %s\n", argv[i]);
+                return 2;
+            }
+            relay = true;
+        } else if (arg == "--noise" && hasValue) {
+            unsigned channel = 0, fps = 0;
+            if (sscanf(argv[++i], "%u:%u", &channel, &fps) != 2) {
+                fprintf(stderr, "bad noise spec %s\n", argv[i]);
+                return 2;
+            }
+            NativeHal::setChannelNoise((uint8_t)channel, fps);
+        } else if (arg == "--fleet" && hasValue) {
+            int fields = sscanf(argv[++i], "%u:%u:%u", &fleet, &fleetSilent, &fleetLegacy);
+            if (fields < 1 || fleet == 0 || fleet > NuggetsInc::MacAddressStorage::MAX_MAC_ADDRESSES ||
+                fleetSilent + fleetLegacy > fleet) {
+                fprintf(stderr, "bad fleet spec %s\n", argv[i]);
+                return 2;
+            }
+        } else if (arg == "--flow-benchmark") {
+            flowBenchmark = true;
+        } else if (arg == "--session-restart") {
+            sessionRestart = true;
+        } else if (arg == "--press" && hasValue) {
+            std::string spec = argv[++i];
+            size_t at = spec.find('@');
+            ScriptStep step;
+            step.command = "press";
+            step.argument = spec.substr(0, at);
+            step.atMs = at == std::string::npos ? 0 : (uint32_t)strtoul(spec.c_str() + at + 1, nullptr, 10);
+            step.value = 0;
+            script.push_back(step);
+        } else {
+            fprintf(stderr,
+                    "usage: %s [--duration MS] [--script FILE] [--press NAME@MS] [--dump FILE.ppm]"
+                    " [--remote MAC [--link-latency US] [--link-loss P] [--legacy-peer]"
+                    " [--relay MAC] [--peer-frame BYTES]] [--noise CHANNEL:FPS] [--fleet COUNT[:SILENT[:LEGACY]]]"
+                    " [--flow-benchmark] [--session-restart]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    std::stable_sort(script.begin(), script.end(),
+                     [](const ScriptStep& a, const ScriptStep& b) { return a.atMs < b.atMs; });
+
+    setup();
+    if (sessionRestart) {
+        return runSessionRestart() ? 0 : 1;
+    }
+    if (flowBenchmark) {
+#ifdef NUGGETS_BENCHMARKS
+        runFlowBenchmark();
+        return 0;
+#else
+        fprintf(stderr, "--flow-benchmark needs a NUGGETS_BENCHMARKS build\n");
+        return 2;
+#endif
+    }
+    if (remote) {
+        if (relay) {
+            attachLoopbackPeer(relayMac, legacyPeer, remoteMac, peerFrame);
+        } else {
+            attachLoopbackPeer(remoteMac, legacyPeer, nullptr, peerFrame);
+        }
+        NuggetsInc::Application::getInstance().changeState(
+            NuggetsInc::StateFactory::createState(NuggetsInc::REMOTE_CONTROL_STATE, remoteMac));
+    } else if (fleet > 0) {
+        attachFleet((uint8_t)fleet, (uint8_t)fleetSilent, (uint8_t)fleetLegacy);
+        NuggetsInc::Application::getInstance().changeState(
+            NuggetsInc::StateFactory::createState(NuggetsInc::SYNC_NODES_STATE));
+    }
+
+    std::atomic<bool> running(true);
+    uint32_t start = millis();
+    std::thread driver([&script, &running, start]() {
+        for (const ScriptStep& step : script) {
+            while (running.load() && (uint32_t)(millis() - start) < step.atMs) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (!running.load()) return;
+            runStep(step);
+        }
+    });
+
+    // The main loop sleeps while idle, so the stop request has to wake it.
+    std::atomic<bool> stop(false);
+    std::thread stopper([&stop, durationMs]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
+        stop.store(true);
+        NuggetsInc::Application::getInstance().wake();
+    });
+
+    while (!stop.load()) {
+        loop();
+    }
+    running.store(false);
+    driver.join();
+    stopper.join();
+
+    if (remote || fleet > 0) {
+        NativeHal::BusStats stats = NativeHal::busStats();
+        printf("ESP-NOW: sent %u frames / %u bytes, received %u frames / %u bytes\n",
+               stats.framesSent, stats.bytesSent, stats.framesReceived, stats.bytesReceived);
+    }
+
+    if (!dumpPath.empty() && !Device::getInstance().getDisplay()->dumpPPM(dumpPath.c_str())) {
+        fprintf(stderr, "cannot write %s\n", dumpPath.c_str());
+        return 1;
+    }
+    fflush(stdout);
+    // Task threads never return; skip static destructors they may still use.
+    _exit(0);
+}
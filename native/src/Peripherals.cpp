@@ -0,0 +1,169 @@
+// Peripherals.cpp - host stand-ins for the PN532 reader and the IR transceiver
+#include "Adafruit_PN532.h"
+#include "IRremote.hpp"
+#include "NativeHal.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::mutex tagMutex;
+std::vector<uint8_t> tagPages; // empty when no tag is in the field
+int detectionIrqPin = -1;      // armed InListPassiveTarget, if any
+
+// The reader answers a pending detection a few ms after the tag arrives.
+// Called with tagMutex held.
+void signalDetectionLocked() {
+    if (detectionIrqPin < 0 || tagPages.size() < 16) return;
+    uint8_t pin = (uint8_t)detectionIrqPin;
+    std::thread([pin]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        std::lock_guard<std::mutex> lock(tagMutex);
+        if (detectionIrqPin == pin) NativeHal::setPinLevel(pin, LOW);
+    }).detach();
+}
+
+// Any new command cancels a pending detection and releases IRQ.
+void cancelDetection() {
+    int pin;
+    {
+        std::lock_guard<std::mutex> lock(tagMutex);
+        pin = detectionIrqPin;
+        detectionIrqPin = -1;
+    }
+    if (pin >= 0) NativeHal::setPinLevel((uint8_t)pin, HIGH);
+}
+
+bool readUidLocked(uint8_t* uid, uint8_t* uidLength) {
+    if (tagPages.size() < 16) return false;
+    // NTAG21x UID: bytes 0-2 of page 0 and bytes 0-3 of page 1
+    const uint8_t uidBytes[7] = {tagPages[0], tagPages[1], tagPages[2], tagPages[4],
+                                 tagPages[5], tagPages[6], tagPages[7]};
+    memcpy(uid, uidBytes, sizeof(uidBytes));
+    *uidLength = 7;
+    return true;
+}
+
+} // namespace
+
+uint32_t Adafruit_PN532::getFirmwareVersion() {
+    return 0x32010607; // PN532, firmware 1.6, supports ISO14443A/B and FeliCa
+}
+
+bool Adafruit_PN532::readPassiveTargetID(uint8_t cardBaudRate, uint8_t* uid, uint8_t* uidLength, uint16_t timeout) {
+    (void)cardBaudRate;
+    cancelDetection();
+    {
+        std::lock_guard<std::mutex> lock(tagMutex);
+        if (readUidLocked(uid, uidLength)) return true;
+    }
+    // The real reader blocks for the whole timeout when nothing answers.
+    if (timeout) std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+    *uidLength = 0;
+    return false;
+}
+
+bool Adafruit_PN532::startPassiveTargetIDDetection(uint8_t cardBaudRate) {
+    (void)cardBaudRate;
+    cancelDetection();
+    NativeHal::setPinLevel(irq_, HIGH);
+    std::lock_guard<std::mutex> lock(tagMutex);
+    detectionIrqPin = irq_;
+    signalDetectionLocked();
+    return true;
+}
+
+bool Adafruit_PN532::readDetectedPassiveTargetID(uint8_t* uid, uint8_t* uidLength) {
+    bool found;
+    {
+        std::lock_guard<std::mutex> lock(tagMutex);
+        found = readUidLocked(uid, uidLength);
+    }
+    cancelDetection();
+    return found;
+}
+
+uint8_t Adafruit_PN532::ntag2xx_ReadPage(uint8_t page, uint8_t* buffer) {
+    cancelDetection();
+    std::lock_guard<std::mutex> lock(tagMutex);
+    size_t offset = (size_t)page * 4;
+    if (offset + 4 > tagPages.size()) return 0;
+    memcpy(buffer, &tagPages[offset], 4);
+    return 1;
+}
+
+uint8_t Adafruit_PN532::ntag2xx_WritePage(uint8_t page, uint8_t* data) {
+    cancelDetection();
+    std::lock_guard<std::mutex> lock(tagMutex);
+    size_t offset = (size_t)page * 4;
+    if (page < 4 || offset + 4 > tagPages.size()) return 0;
+    memcpy(&tagPages[offset], data, 4);
+    return 1;
+}
+
+namespace NativeHal {
+
+void presentTag(const std::vector<uint8_t>& pages) {
+    std::lock_guard<std::mutex> lock(tagMutex);
+    tagPages = pages;
+    signalDetectionLocked();
+}
+
+void removeTag() {
+    std::lock_guard<std::mutex> lock(tagMutex);
+    tagPages.clear();
+}
+
+std::vector<uint8_t> tagImage() {
+    std::lock_guard<std::mutex> lock(tagMutex);
+    return tagPages;
+}
+
+std::vector<uint8_t> makeBlankNtag(int type) {
+    int pages = type == 216 ? 231 : type == 215 ? 135 : 45;
+    uint8_t cc = type == 216 ? 0x6D : type == 215 ? 0x3E : 0x12;
+    std::vector<uint8_t> image((size_t)pages * 4, 0);
+    const uint8_t header[16] = {
+        0x04, 0x6A, 0x1C, 0x82,  // UID0-2, BCC0
+        0xA2, 0x4B, 0x5D, 0x80,  // UID3-6
+        0x37, 0x48, 0x00, 0x00,  // BCC1, internal, static lock bytes
+        0xE1, 0x10, cc,   0x00,  // capability container
+    };
+    memcpy(image.data(), header, sizeof(header));
+    // Empty NDEF TLV followed by the terminator
+    image[16] = 0x03;
+    image[17] = 0x00;
+    image[18] = 0xFE;
+    return image;
+}
+
+} // namespace NativeHal
+
+IRrecv IrReceiver;
+IRsend IrSender;
+
+bool IRrecv::decode() {
+    return active_ && pending_;
+}
+
+void IRrecv::inject(const uint16_t* rawMicros, uint8_t length) {
+    if (length + 1 > RAW_BUFFER_LENGTH) length = RAW_BUFFER_LENGTH - 1;
+    irparams.rawbuf[0] = 0;
+    for (uint8_t i = 0; i < length; ++i) irparams.rawbuf[i + 1] = (IRRawbufType)(rawMicros[i] / MICROS_PER_TICK);
+    irparams.rawlen = (IRRawlenType)(length + 1);
+    pending_ = true;
+    if (active_ && callback_) callback_();
+}
+
+void IRsend::sendRaw(const uint16_t* buffer, uint_fast16_t length, uint_fast8_t khz) {
+    (void)buffer;
+    (void)khz;
+    // Roughly the time the carrier would be modulated for.
+    uint32_t totalMicros = 0;
+    for (uint_fast16_t i = 0; i < length; ++i) totalMicros += buffer[i];
+    std::this_thread::sleep_for(std::chrono::microseconds(totalMicros));
+    framesSent_++;
+}
@@ -0,0 +1,144 @@
+// Storage.cpp - host stand-in for LittleFS backed by a directory
+#include "LittleFS.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs {
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    if (!handle_) return 0;
+    return fwrite(buffer, 1, size, handle_.get());
+}
+
+int File::available() {
+    if (!handle_) return 0;
+    long pos = ftell(handle_.get());
+    return (int)(size() - (pos < 0 ? 0 : (size_t)pos));
+}
+
+int File::read() {
+    if (!handle_) return -1;
+    int c = fgetc(handle_.get());
+    return c == EOF ? -1 : c;
+}
+
+int File::peek() {
+    if (!handle_) return -1;
+    int c = fgetc(handle_.get());
+    if (c != EOF) ungetc(c, handle_.get());
+    return c == EOF ? -1 : c;
+}
+
+void File::flush() {
+    if (handle_) fflush(handle_.get());
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+    if (!handle_) return 0;
+    return fread(buffer, 1, size, handle_.get());
+}
+
+bool File::seek(uint32_t position) {
+    return handle_ && fseek(handle_.get(), (long)position, SEEK_SET) == 0;
+}
+
+size_t File::position() const {
+    if (!handle_) return 0;
+    long pos = ftell(handle_.get());
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const {
+    if (!handle_) return 0;
+    struct stat st;
+    if (fstat(fileno(handle_.get()), &st) != 0) return 0;
+    return (size_t)st.st_size;
+}
+
+std::string FS::resolve(const char* path) const {
+    std::string p = path ? path : "";
+    if (p.empty() || p[0] != '/') p = "/" + p;
+    return root_ + p;
+}
+
+File FS::open(const char* path, const char* mode, bool create) {
+    (void)create;
+    std::string full = resolve(path);
+    std::string m = mode ? mode : "r";
+    const char* stdioMode = m == "w" ? "wb" : m == "a" ? "ab" : "rb";
+    FILE* handle = fopen(full.c_str(), stdioMode);
+    if (!handle) return File();
+    return File(handle, path);
+}
+
+bool FS::exists(const char* path) {
+    struct stat st;
+    return stat(resolve(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) {
+    return ::remove(resolve(path).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+    return ::mkdir(resolve(path).c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+} // namespace fs
+
+namespace {
+std::string defaultRoot() {
+    const char* env = getenv("NUGGETS_NATIVE_FS");
+    return env && *env ? env : ".native_fs";
+}
+} // namespace
+
+LittleFSFS LittleFS;
+
+LittleFSFS::LittleFSFS() : fs::FS(defaultRoot().c_str()) {}
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+    (void)basePath;
+    (void)maxOpenFiles;
+    (void)partitionLabel;
+    if (mounted_) return true;
+    struct stat st;
+    if (stat(root_.c_str(), &st) != 0) {
+        if (!formatOnFail) return false;
+        if (::mkdir(root_.c_str(), 0755) != 0) return false;
+    }
+    mounted_ = true;
+    return true;
+}
+
+bool LittleFSFS::format() {
+    DIR* dir = opendir(root_.c_str());
+    if (!dir) return ::mkdir(root_.c_str(), 0755) == 0;
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        ::remove((root_ + "/" + name).c_str());
+    }
+    closedir(dir);
+    return true;
+}
+
+size_t LittleFSFS::usedBytes() {
+    size_t used = 0;
+    DIR* dir = opendir(root_.c_str());
+    if (!dir) return 0;
+    while (struct dirent* entry = readdir(dir)) {
+        struct stat st;
+        if (stat((root_ + "/" + entry->d_name).c_str(), &st) == 0 && S_ISREG(st.st_mode)) used += (size_t)st.st_size;
+    }
+    closedir(dir);
+    return used;
+}
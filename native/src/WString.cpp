@@ -0,0 +1,141 @@
+// WString.cpp - host stand-in for the Arduino String and Print classes
+#include "Arduino.h"
+
+#include <cctype>
+#include <chrono>
+#include <thread>
+
+bool String::equalsIgnoreCase(const String& other) const {
+    if (s_.size() != other.s_.size()) return false;
+    for (size_t i = 0; i < s_.size(); ++i) {
+        if (tolower((unsigned char)s_[i]) != tolower((unsigned char)other.s_[i])) return false;
+    }
+    return true;
+}
+
+bool String::endsWith(const String& suffix) const {
+    if (suffix.s_.size() > s_.size()) return false;
+    return s_.compare(s_.size() - suffix.s_.size(), suffix.s_.size(), suffix.s_) == 0;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= s_.size()) return String();
+    if (to > s_.size()) to = (unsigned int)s_.size();
+    return String(s_.substr(from, to - from));
+}
+
+void String::trim() {
+    size_t begin = 0;
+    while (begin < s_.size() && isspace((unsigned char)s_[begin])) ++begin;
+    size_t end = s_.size();
+    while (end > begin && isspace((unsigned char)s_[end - 1])) --end;
+    s_ = s_.substr(begin, end - begin);
+}
+
+void String::toUpperCase() {
+    for (char& c : s_) c = (char)toupper((unsigned char)c);
+}
+
+void String::toLowerCase() {
+    for (char& c : s_) c = (char)tolower((unsigned char)c);
+}
+
+void String::replace(const String& find, const String& replacement) {
+    if (find.s_.empty()) return;
+    size_t pos = 0;
+    while ((pos = s_.find(find.s_, pos)) != std::string::npos) {
+        s_.replace(pos, find.s_.size(), replacement.s_);
+        pos += replacement.s_.size();
+    }
+}
+
+void String::fromSigned(long long value, unsigned char base) {
+    if (base == 10) {
+        s_ = std::to_string(value);
+        return;
+    }
+    fromUnsigned((unsigned long long)value, base);
+}
+
+void String::fromUnsigned(unsigned long long value, unsigned char base) {
+    if (base < 2 || base > 36) base = 10;
+    char buf[72];
+    int pos = (int)sizeof(buf) - 1;
+    buf[pos] = '\0';
+    do {
+        int digit = (int)(value % base);
+        buf[--pos] = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value && pos > 0);
+    s_ = &buf[pos];
+}
+
+void String::fromDouble(double value, unsigned int decimalPlaces) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimalPlaces, value);
+    s_ = buf;
+}
+
+String operator+(const String& lhs, const String& rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, const char* rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const char* lhs, const String& rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, char rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, int rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, unsigned int rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, long rhs) { String r(lhs); r += rhs; return r; }
+String operator+(const String& lhs, unsigned long rhs) { String r(lhs); r += rhs; return r; }
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char stackBuf[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(stackBuf, sizeof(stackBuf), format, args);
+    va_end(args);
+    if (len < 0) return 0;
+    if ((size_t)len < sizeof(stackBuf)) return write((const uint8_t*)stackBuf, (size_t)len);
+
+    std::string heapBuf((size_t)len + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&heapBuf[0], heapBuf.size(), format, args);
+    va_end(args);
+    return write((const uint8_t*)heapBuf.data(), (size_t)len);
+}
+
+String Stream::readStringUntil(char terminator) {
+    String result;
+    unsigned long start = millis();
+    while ((unsigned long)(millis() - start) < timeoutMs_) {
+        int c = read();
+        if (c < 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (c == terminator) break;
+        result += (char)c;
+    }
+    return result;
+}
+
+String Stream::readString() {
+    String result;
+    int c;
+    while ((c = read()) >= 0) result += (char)c;
+    return result;
+}
+
+size_t Stream::readBytes(uint8_t* buffer, size_t length) {
+    size_t n = 0;
+    while (n < length) {
+        int c = read();
+        if (c < 0) break;
+        buffer[n++] = (uint8_t)c;
+    }
+    return n;
+}
@@ -0,0 +1,350 @@
+#include "Blit.h"
+#include <string.h>
+#include "Device.h"
+
+namespace NuggetsInc {
+
+namespace {
+
+// Shorter repeats are cheaper as part of a literal run
+const uint32_t MIN_REPEAT = 3;
+
+size_t putVarint(uint32_t value, uint8_t* out, size_t capacity) {
+    size_t n = 0;
+    do {
+        if (n == capacity) {
+            return 0;
+        }
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        out[n++] = value ? (byte | 0x80) : byte;
+    } while (value);
+    return n;
+}
+
+size_t getVarint(const uint8_t* data, size_t len, uint32_t& value) {
+    value = 0;
+    for (size_t i = 0; i < len && i < 5; i++) {
+        value |= (uint32_t)(data[i] & 0x7F) << (7 * i);
+        if ((data[i] & 0x80) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+size_t varintSize(uint32_t value) {
+    size_t n = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        n++;
+    }
+    return n;
+}
+
+void putPixel(uint16_t pixel, size_t pixelBytes, uint8_t* out) {
+    out[0] = pixel & 0xFF;
+    if (pixelBytes == 2) {
+        out[1] = pixel >> 8;
+    }
+}
+
+struct BlitHeader {
+    BlitFormat format;
+    int16_t left;
+    int16_t top;
+    int16_t width;
+    uint32_t start;
+    size_t tokens; // offset of the first token
+};
+
+bool parseHeader(const uint8_t* payload, size_t length, BlitHeader& header) {
+    if (payload == nullptr || length < BlitEncoder::HEADER_SIZE + 1) {
+        return false;
+    }
+    if (payload[0] != BLIT_RGB565 && payload[0] != BLIT_PALETTE8) {
+        return false;
+    }
+    header.format = (BlitFormat)payload[0];
+    header.left = (int16_t)(payload[1] | (payload[2] << 8));
+    header.top = (int16_t)(payload[3] | (payload[4] << 8));
+    header.width = (int16_t)(payload[5] | (payload[6] << 8));
+    if (header.width <= 0) {
+        return false;
+    }
+    size_t used = getVarint(payload + BlitEncoder::HEADER_SIZE,
+                            length - BlitEncoder::HEADER_SIZE, header.start);
+    if (used == 0) {
+        return false;
+    }
+    header.tokens = BlitEncoder::HEADER_SIZE + used;
+    return true;
+}
+
+} // namespace
+
+BlitEncoder::BlitEncoder()
+    : srcX_(0), srcY_(0), width_(0), dstX_(0), dstY_(0), position_(0), total_(0) {
+    memset(&image_, 0, sizeof(image_));
+}
+
+void BlitEncoder::begin(const BlitImage& image, int16_t srcX, int16_t srcY, int16_t w, int16_t h,
+                        int16_t dstX, int16_t dstY) {
+    image_ = image;
+    srcX_ = srcX;
+    srcY_ = srcY;
+    width_ = w;
+    dstX_ = dstX;
+    dstY_ = dstY;
+    position_ = 0;
+    total_ = (w > 0 && h > 0) ? (uint32_t)w * (uint32_t)h : 0;
+}
+
+uint16_t BlitEncoder::pixelAt(uint32_t position) const {
+    size_t index = (size_t)(srcY_ + position / width_) * image_.width + srcX_ + position % width_;
+    if (image_.format == BLIT_RGB565) {
+        return static_cast<const uint16_t*>(image_.pixels)[index];
+    }
+    return static_cast<const uint8_t*>(image_.pixels)[index];
+}
+
+uint32_t BlitEncoder::repeatLength(uint32_t position) const {
+    uint16_t pixel = pixelAt(position);
+    uint32_t end = position + 1;
+    while (end < total_ && pixelAt(end) == pixel) {
+        end++;
+    }
+    return end - position;
+}
+
+size_t BlitEncoder::next(uint8_t* out, size_t capacity) {
+    size_t pixelBytes = image_.format == BLIT_RGB565 ? 2 : 1;
+    if (done() || capacity < HEADER_SIZE + varintSize(position_) + 5 + pixelBytes) {
+        return 0;
+    }
+
+    size_t n = 0;
+    out[n++] = image_.format;
+    out[n++] = dstX_ & 0xFF;
+    out[n++] = (uint16_t)dstX_ >> 8;
+    out[n++] = dstY_ & 0xFF;
+    out[n++] = (uint16_t)dstY_ >> 8;
+    out[n++] = width_ & 0xFF;
+    out[n++] = (uint16_t)width_ >> 8;
+    n += putVarint(position_, out + n, capacity - n);
+
+    while (position_ < total_) {
+        size_t room = capacity - n;
+        uint32_t run = repeatLength(position_);
+        if (run >= MIN_REPEAT) {
+            uint32_t token = ((run - 1) << 1) | 1;
+            if (room < varintSize(token) + pixelBytes) break;
+            n += putVarint(token, out + n, room);
+            putPixel(pixelAt(position_), pixelBytes, out + n);
+            n += pixelBytes;
+            position_ += run;
+            continue;
+        }
+
+        // Literal pixels up to where the next worthwhile repeat starts, or
+        // as many as could fit
+        uint32_t count = run;
+        uint32_t most = room / pixelBytes;
+        while (position_ + count < total_ && count < most) {
+            uint16_t pixel = pixelAt(position_ + count);
+            uint32_t ahead = 1;
+            while (ahead < MIN_REPEAT && position_ + count + ahead < total_ &&
+                   pixelAt(position_ + count + ahead) == pixel) {
+                ahead++;
+            }
+            if (ahead >= MIN_REPEAT) break;
+            count += ahead;
+        }
+        if (room <= varintSize((count - 1) << 1)) break;
+        uint32_t fits = (room - varintSize((count - 1) << 1)) / pixelBytes;
+        if (fits == 0) break;
+        if (fits > count) fits = count;
+
+        n += putVarint((fits - 1) << 1, out + n, room);
+        for (uint32_t i = 0; i < fits; i++) {
+            putPixel(pixelAt(position_ + i), pixelBytes, out + n);
+            n += pixelBytes;
+        }
+        position_ += fits;
+        if (fits < count) break;
+    }
+    return n;
+}
+
+BlitDecoder::BlitDecoder() {
+    memset(palette_, 0, sizeof(palette_));
+}
+
+bool BlitDecoder::validate(const uint8_t* payload, size_t length) {
+    BlitHeader header;
+    if (!parseHeader(payload, length, header)) {
+        return false;
+    }
+    // The region has to lie on the screen, and the pixels have to end
+    // within it, so a fragment costs no more drawing than one screen's worth
+    if (header.left < 0 || header.top < 0 || header.left + header.width > SCREEN_WIDTH ||
+        header.top >= SCREEN_HEIGHT) {
+        return false;
+    }
+    uint32_t limit = (uint32_t)header.width * (uint32_t)(SCREEN_HEIGHT - header.top);
+    size_t pixelBytes = header.format == BLIT_RGB565 ? 2 : 1;
+    uint32_t end = header.start;
+    size_t n = header.tokens;
+    if (n == length || end >= limit) {
+        return false;
+    }
+    while (n < length) {
+        uint32_t token;
+        size_t used = getVarint(payload + n, length - n, token);
+        if (used == 0) return false;
+        n += used;
+        uint32_t count = (token >> 1) + 1;
+        bool repeat = (token & 1) != 0;
+        if (count > limit - end || (!repeat && count > (length - n) / pixelBytes)) {
+            return false;
+        }
+        size_t bytes = repeat ? pixelBytes : count * pixelBytes;
+        if (length - n < bytes) return false;
+        end += count;
+        n += bytes;
+    }
+    return true;
+}
+
+bool BlitDecoder::draw(const uint8_t* payload, size_t length, RowSink sink, void* context) {
+    if (!validate(payload, length)) {
+        return false;
+    }
+    BlitHeader header;
+    parseHeader(payload, length, header);
+    size_t pixelBytes = header.format == BLIT_RGB565 ? 2 : 1;
+
+    int16_t y = header.top + header.start / header.width;
+    int16_t column = header.start % header.width;
+    int16_t segmentColumn = column;
+    int16_t buffered = 0;
+
+    size_t n = header.tokens;
+    while (n < length) {
+        uint32_t token;
+        n += getVarint(payload + n, length - n, token);
+        uint32_t count = (token >> 1) + 1;
+        bool repeat = (token & 1) != 0;
+        for (uint32_t i = 0; i < count; i++) {
+            const uint8_t* source = payload + n + (repeat ? 0 : i * pixelBytes);
+            line_[buffered++] = header.format == BLIT_RGB565
+                                    ? (uint16_t)(source[0] | (source[1] << 8))
+                                    : palette_[source[0]];
+            column++;
+            if (buffered == BLIT_SEGMENT || column == header.width) {
+                sink(header.left + segmentColumn, y, line_, buffered, context);
+                buffered = 0;
+                if (column == header.width) {
+                    column = 0;
+                    y++;
+                }
+                segmentColumn = column;
+            }
+        }
+        n += repeat ? pixelBytes : count * pixelBytes;
+    }
+    if (buffered > 0) {
+        sink(header.left + segmentColumn, y, line_, buffered, context);
+    }
+    return true;
+}
+
+bool BlitDecoder::setPalette(const uint8_t* payload, size_t length) {
+    if (payload == nullptr || length < 3 || (length - 1) % 2 != 0) {
+        return false;
+    }
+    size_t first = payload[0];
+    size_t count = (length - 1) / 2;
+    if (first + count > 256) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        palette_[first + i] = payload[1 + 2 * i] | (payload[2 + 2 * i] << 8);
+    }
+    return true;
+}
+
+TileDiff::TileDiff() : width_(0), height_(0), valid_(false) {
+    memset(hashes_, 0, sizeof(hashes_));
+}
+
+void TileDiff::reset() {
+    valid_ = false;
+}
+
+uint32_t TileDiff::hashTile(const BlitImage& image, int16_t x, int16_t y, int16_t w,
+                            int16_t h) const {
+    // FNV-1a over the pixel values
+    uint32_t hash = 2166136261u;
+    for (int16_t row = y; row < y + h; row++) {
+        size_t index = (size_t)row * image.width + x;
+        for (int16_t col = 0; col < w; col++, index++) {
+            uint16_t pixel = image.format == BLIT_RGB565
+                                 ? static_cast<const uint16_t*>(image.pixels)[index]
+                                 : static_cast<const uint8_t*>(image.pixels)[index];
+            hash = (hash ^ (pixel & 0xFF)) * 16777619u;
+            hash = (hash ^ (pixel >> 8)) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+uint16_t TileDiff::diff(const BlitImage& image, RectVisitor visitor, void* context) {
+    int16_t columns = (image.width + TILE_SIZE - 1) / TILE_SIZE;
+    int16_t rows = (image.height + TILE_SIZE - 1) / TILE_SIZE;
+    if (columns <= 0 || rows <= 0) {
+        return 0;
+    }
+    if ((uint32_t)columns * rows > MAX_TILES) {
+        valid_ = false;
+        visitor(0, 0, image.width, image.height, context);
+        return columns * rows;
+    }
+
+    bool fresh = !valid_ || width_ != image.width || height_ != image.height;
+    uint16_t changed = 0;
+    for (int16_t ty = 0; ty < rows; ty++) {
+        int16_t y = ty * TILE_SIZE;
+        int16_t h = image.height - y < TILE_SIZE ? image.height - y : TILE_SIZE;
+        int16_t runStart = -1;
+        for (int16_t tx = 0; tx <= columns; tx++) {
+            bool tileChanged = false;
+            if (tx < columns) {
+                int16_t x = tx * TILE_SIZE;
+                int16_t w = image.width - x < TILE_SIZE ? image.width - x : TILE_SIZE;
+                uint32_t hash = hashTile(image, x, y, w, h);
+                uint32_t& stored = hashes_[ty * columns + tx];
+                tileChanged = fresh || hash != stored;
+                stored = hash;
+            }
+            if (tileChanged) {
+                changed++;
+                if (runStart < 0) {
+                    runStart = tx;
+                }
+            } else if (runStart >= 0) {
+                int16_t x = runStart * TILE_SIZE;
+                int16_t end = tx * TILE_SIZE < image.width ? tx * TILE_SIZE : image.width;
+                visitor(x, y, end - x, h, context);
+                runStart = -1;
+            }
+        }
+    }
+
+    width_ = image.width;
+    height_ = image.height;
+    valid_ = true;
+    return changed;
+}
+
+} // namespace NuggetsInc
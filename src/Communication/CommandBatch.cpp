@@ -0,0 +1,87 @@
+#include "CommandBatch.h"
+#include "MessageTypes.h"
+#include <string.h>
+
+namespace NuggetsInc {
+
+CommandBatch::CommandBatch() : length_(0), count_(0) {}
+
+bool CommandBatch::add(uint8_t commandID, const char* data) {
+    if (commandID == CMD_BATCH || (commandID & TYPED_ENTRY)) {
+        return false;
+    }
+    return append(commandID, reinterpret_cast<const uint8_t*>(data), data ? strlen(data) : 0);
+}
+
+bool CommandBatch::add(uint8_t commandID, const DisplayArgs& args) {
+    if (commandID & TYPED_ENTRY) {
+        return false;
+    }
+    uint8_t encoded[CAPACITY];
+    size_t encodedLength = DisplayCodec::encode(commandID, args, encoded, sizeof(encoded));
+    if (encodedLength == 0) {
+        return false;
+    }
+    return append(commandID | TYPED_ENTRY, encoded, encodedLength);
+}
+
+bool CommandBatch::append(uint8_t tag, const uint8_t* data, size_t dataLength) {
+    if (dataLength > 0xFF || CAPACITY - length_ < ENTRY_OVERHEAD + dataLength) {
+        return false;
+    }
+
+    buffer_[length_++] = tag;
+    buffer_[length_++] = (uint8_t)dataLength;
+    memcpy(buffer_ + length_, data, dataLength);
+    length_ += dataLength;
+    count_++;
+    return true;
+}
+
+void CommandBatch::clear() {
+    length_ = 0;
+    count_ = 0;
+}
+
+bool CommandBatch::validate(const uint8_t* payload, size_t length) {
+    if (length == 0) {
+        return false;
+    }
+    size_t offset = 0;
+    while (offset < length) {
+        uint8_t commandID = payload[offset] & ~TYPED_ENTRY;
+        if (length - offset < ENTRY_OVERHEAD || commandID == CMD_BATCH) {
+            return false;
+        }
+        size_t dataLength = payload[offset + 1];
+        offset += ENTRY_OVERHEAD;
+        if (length - offset < dataLength) {
+            return false;
+        }
+        offset += dataLength;
+    }
+    return true;
+}
+
+bool CommandBatch::forEach(const uint8_t* payload, size_t length, Visitor visitor, void* context) {
+    if (!validate(payload, length)) {
+        return false;
+    }
+
+    // An entry's length is one byte, whatever the size of the batch around
+    // it; reassembled batches are far longer than one frame
+    char data[0xFF + 1];
+    size_t offset = 0;
+    while (offset < length) {
+        uint8_t tag = payload[offset];
+        size_t dataLength = payload[offset + 1];
+        offset += ENTRY_OVERHEAD;
+        memcpy(data, payload + offset, dataLength);
+        data[dataLength] = '\0';
+        offset += dataLength;
+        visitor(tag & ~TYPED_ENTRY, data, dataLength, (tag & TYPED_ENTRY) != 0, context);
+    }
+    return true;
+}
+
+} // namespace NuggetsInc
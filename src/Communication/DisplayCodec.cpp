@@ -0,0 +1,244 @@
+#include "DisplayCodec.h"
+#include "MessageTypes.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace NuggetsInc {
+
+namespace {
+
+enum FieldKind : uint8_t {
+    FIELD_INT16,  // coordinates and sizes, -32768..32767
+    FIELD_COLOR,  // RGB565
+    FIELD_UINT8,
+    FIELD_TITLE,  // NUL-terminated char array of `capacity` bytes
+};
+
+struct Field {
+    FieldKind kind;
+    uint8_t offset;
+    uint8_t capacity;
+};
+
+struct Schema {
+    uint8_t commandID;
+    const char* name;
+    uint8_t fieldCount;
+    Field fields[6];
+};
+
+#define INT16_FIELD(type, member) {FIELD_INT16, offsetof(type, member), 0}
+#define COLOR_FIELD(type, member) {FIELD_COLOR, offsetof(type, member), 0}
+#define UINT8_FIELD(type, member) {FIELD_UINT8, offsetof(type, member), 0}
+#define TITLE_FIELD(type, member) {FIELD_TITLE, offsetof(type, member), sizeof(((type*)0)->member)}
+
+// Every member of DisplayArgs starts at offset 0, so the offsets below apply
+// to the union as well
+const Schema SCHEMAS[] = {
+    {CMD_SET_CURSOR, "SET_CURSOR", 2,
+     {INT16_FIELD(CursorArgs, x), INT16_FIELD(CursorArgs, y)}},
+    {CMD_SET_TEXT_SIZE, "SET_TEXT_SIZE", 1,
+     {UINT8_FIELD(TextSizeArgs, size)}},
+    {CMD_SET_TEXT_COLOR, "SET_TEXT_COLOR", 1,
+     {COLOR_FIELD(ColorArgs, color)}},
+    {CMD_FILL_SCREEN, "FILL_SCREEN", 1,
+     {COLOR_FIELD(ColorArgs, color)}},
+    {CMD_DRAW_RECT, "DRAW_RECT", 5,
+     {INT16_FIELD(RectArgs, x), INT16_FIELD(RectArgs, y), INT16_FIELD(RectArgs, w),
+      INT16_FIELD(RectArgs, h), COLOR_FIELD(RectArgs, color)}},
+    {CMD_FILL_RECT, "FILL_RECT", 5,
+     {INT16_FIELD(RectArgs, x), INT16_FIELD(RectArgs, y), INT16_FIELD(RectArgs, w),
+      INT16_FIELD(RectArgs, h), COLOR_FIELD(RectArgs, color)}},
+    {CMD_PLOT_POINT, "PLOT_POINT", 3,
+     {INT16_FIELD(PlotPointArgs, x), INT16_FIELD(PlotPointArgs, y),
+      COLOR_FIELD(PlotPointArgs, color)}},
+    {CMD_BEGIN_PLOT, "BEGIN_PLOT", 6,
+     {INT16_FIELD(BeginPlotArgs, minX), INT16_FIELD(BeginPlotArgs, maxX),
+      INT16_FIELD(BeginPlotArgs, minY), INT16_FIELD(BeginPlotArgs, maxY),
+      TITLE_FIELD(BeginPlotArgs, xTitle), TITLE_FIELD(BeginPlotArgs, yTitle)}},
+};
+
+#undef INT16_FIELD
+#undef COLOR_FIELD
+#undef UINT8_FIELD
+#undef TITLE_FIELD
+
+const Schema* findSchema(uint8_t commandID) {
+    for (size_t i = 0; i < sizeof(SCHEMAS) / sizeof(SCHEMAS[0]); i++) {
+        if (SCHEMAS[i].commandID == commandID) {
+            return &SCHEMAS[i];
+        }
+    }
+    return nullptr;
+}
+
+// The 16-bit fields are read and written through memcpy; the union gives no
+// alignment guarantees the compiler could rely on for a cast
+uint16_t loadU16(const uint8_t* base, uint8_t offset) {
+    uint16_t value;
+    memcpy(&value, base + offset, sizeof(value));
+    return value;
+}
+
+void storeU16(uint8_t* base, uint8_t offset, uint16_t value) {
+    memcpy(base + offset, &value, sizeof(value));
+}
+
+bool inRange(long value, FieldKind kind) {
+    switch (kind) {
+        case FIELD_INT16: return value >= -32768 && value <= 32767;
+        // Older senders write colours as whatever int they had
+        case FIELD_COLOR: return value >= -32768 && value <= 65535;
+        case FIELD_UINT8: return value >= 0 && value <= 255;
+        default: return false;
+    }
+}
+
+} // namespace
+
+bool DisplayCodec::hasSchema(uint8_t commandID) {
+    return findSchema(commandID) != nullptr;
+}
+
+const char* DisplayCodec::name(uint8_t commandID) {
+    const Schema* schema = findSchema(commandID);
+    return schema ? schema->name : "?";
+}
+
+size_t DisplayCodec::encode(uint8_t commandID, const DisplayArgs& args, uint8_t* out,
+                            size_t capacity) {
+    const Schema* schema = findSchema(commandID);
+    if (schema == nullptr) {
+        return 0;
+    }
+
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(&args);
+    size_t n = 0;
+    for (uint8_t i = 0; i < schema->fieldCount; i++) {
+        const Field& field = schema->fields[i];
+        if (field.kind == FIELD_UINT8) {
+            if (capacity - n < 1) return 0;
+            out[n++] = base[field.offset];
+        } else if (field.kind == FIELD_TITLE) {
+            const char* title = reinterpret_cast<const char*>(base + field.offset);
+            size_t length = strnlen(title, field.capacity - 1);
+            if (capacity - n < 1 + length) return 0;
+            out[n++] = (uint8_t)length;
+            memcpy(out + n, title, length);
+            n += length;
+        } else {
+            if (capacity - n < 2) return 0;
+            uint16_t value = loadU16(base, field.offset);
+            out[n++] = value & 0xFF;
+            out[n++] = value >> 8;
+        }
+    }
+    return n;
+}
+
+bool DisplayCodec::decode(uint8_t commandID, const uint8_t* data, size_t length,
+                          DisplayArgs& args) {
+    const Schema* schema = findSchema(commandID);
+    if (schema == nullptr) {
+        return false;
+    }
+
+    memset(&args, 0, sizeof(args));
+    uint8_t* base = reinterpret_cast<uint8_t*>(&args);
+    size_t n = 0;
+    for (uint8_t i = 0; i < schema->fieldCount; i++) {
+        const Field& field = schema->fields[i];
+        if (field.kind == FIELD_UINT8) {
+            if (length - n < 1) return false;
+            base[field.offset] = data[n++];
+        } else if (field.kind == FIELD_TITLE) {
+            if (length - n < 1) return false;
+            size_t titleLength = data[n++];
+            if (length - n < titleLength || titleLength >= field.capacity) return false;
+            memcpy(base + field.offset, data + n, titleLength);
+            n += titleLength;
+        } else {
+            if (length - n < 2) return false;
+            storeU16(base, field.offset, (uint16_t)(data[n] | (data[n + 1] << 8)));
+            n += 2;
+        }
+    }
+    return n == length;
+}
+
+bool DisplayCodec::parseText(uint8_t commandID, const char* text, DisplayArgs& args) {
+    const Schema* schema = findSchema(commandID);
+    if (schema == nullptr || text == nullptr) {
+        return false;
+    }
+
+    memset(&args, 0, sizeof(args));
+    uint8_t* base = reinterpret_cast<uint8_t*>(&args);
+    const char* cursor = text;
+    for (uint8_t i = 0; i < schema->fieldCount; i++) {
+        const Field& field = schema->fields[i];
+        if (i > 0) {
+            if (*cursor != ',') return false;
+            cursor++;
+        }
+
+        if (field.kind == FIELD_TITLE) {
+            size_t titleLength = strcspn(cursor, ",");
+            if (titleLength == 0 || titleLength >= field.capacity) return false;
+            memcpy(base + field.offset, cursor, titleLength);
+            cursor += titleLength;
+            continue;
+        }
+
+        char* end;
+        long value = strtol(cursor, &end, 10);
+        if (end == cursor || !inRange(value, field.kind)) return false;
+        cursor = end;
+        while (*cursor == ' ') {
+            cursor++;
+        }
+        if (field.kind == FIELD_UINT8) {
+            base[field.offset] = (uint8_t)value;
+        } else {
+            storeU16(base, field.offset, (uint16_t)value);
+        }
+    }
+    return *cursor == '\0';
+}
+
+size_t DisplayCodec::formatText(uint8_t commandID, const DisplayArgs& args, char* out,
+                                size_t capacity) {
+    const Schema* schema = findSchema(commandID);
+    if (schema == nullptr || capacity == 0) {
+        return 0;
+    }
+
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(&args);
+    size_t n = 0;
+    for (uint8_t i = 0; i < schema->fieldCount; i++) {
+        const Field& field = schema->fields[i];
+        const char* separator = i > 0 ? "," : "";
+        int written;
+        if (field.kind == FIELD_TITLE) {
+            written = snprintf(out + n, capacity - n, "%s%.*s", separator, (int)field.capacity - 1,
+                               reinterpret_cast<const char*>(base + field.offset));
+        } else if (field.kind == FIELD_UINT8) {
+            written = snprintf(out + n, capacity - n, "%s%u", separator, base[field.offset]);
+        } else if (field.kind == FIELD_COLOR) {
+            written = snprintf(out + n, capacity - n, "%s%u", separator,
+                               loadU16(base, field.offset));
+        } else {
+            written = snprintf(out + n, capacity - n, "%s%d", separator,
+                               (int16_t)loadU16(base, field.offset));
+        }
+        if (written < 0 || (size_t)written >= capacity - n) {
+            return 0;
+        }
+        n += written;
+    }
+    return n;
+}
+
+} // namespace NuggetsInc
@@ -1,7 +1,7 @@
 #include "EnterRemoteControlState.h"
 #include "StateFactory.h"
 #include "Application.h"
-#include "RemoteControlState.h"
+#include "Device.h"
 #include "Config.h"
 
 namespace NuggetsInc
@@ -9,30 +9,30 @@ namespace NuggetsInc
     EnterRemoteControlState *EnterRemoteControlState::activeInstance = nullptr;
 
     EnterRemoteControlState::EnterRemoteControlState()
-        : nfcLogic(new NFCLogic(PN532_IRQ, PN532_RESET)) {}
+        : displayUtils(Device::getInstance().getDisplay()),
+          nfcLogic(NFCLogic::getInstance()),
+          currentTagData(nullptr) {}
 
     EnterRemoteControlState::~EnterRemoteControlState()
     {
-        delete nfcLogic;
-        delete displayUtils;
+        nfcLogic.stopTagDetection();
+        delete currentTagData;
     }
 
     void EnterRemoteControlState::onEnter()
     {
         activeInstance = this;
-        displayUtils = new DisplayUtils(Device::getInstance().getDisplay());
-        displayUtils->newTerminalDisplay("Verifying NFC chip");
+        displayUtils.newTerminalDisplay("Verifying NFC chip");
 
-        if (!nfcLogic->initialize())
+        if (!nfcLogic.initialize())
         {
-            displayUtils->displayMessage("PN532 not found");
-            delay(2000);
-            Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
+            displayUtils.displayMessage("PN532 not found");
+            Application::getInstance().changeStateAfter(2000, MENU_STATE);
             return;
         }
 
-        displayUtils->addToTerminalDisplay("NFC module Found");
-        displayUtils->clearDisplay();
+        displayUtils.addToTerminalDisplay("NFC module Found");
+        displayUtils.clearDisplay();
     }
 
     void EnterRemoteControlState::onExit()
@@ -49,28 +49,36 @@ namespace NuggetsInc
         {
             if (event.type == EVENT_BACK || event.type == EVENT_ACTION_TWO)
             {
-                Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
+                Application::getInstance().popState();
                 return;
             }
         }
 
-        readNFCTag();
+        if (nfcLogic.tagCheckDue())
+        {
+            readNFCTag();
+        }
+    }
+
+    uint32_t EnterRemoteControlState::getUpdateDelay()
+    {
+        return nfcLogic.msUntilTagCheck();
     }
 
     void EnterRemoteControlState::readNFCTag()
     {
-        if (nfcLogic->isTagPresent())
+        if (nfcLogic.isTagPresent())
         {
-            displayUtils->displayMessage("NFC Tag Detected: Keep steady");
+            displayUtils.displayMessage("NFC Tag Detected: Keep steady");
 
             TagData tag;
-            const std::vector<uint8_t> &rawData = nfcLogic->readRawData();
+            const std::vector<uint8_t> &rawData = nfcLogic.readRawData();
             TagData newTagData = tag.parseRawData(rawData);
 
             if (tag.ValidateTagData(newTagData) != 0)
             {
-                displayUtils->displayMessage("Unsupported Tag");
-                delay(1500);
+                displayUtils.displayMessage("Unsupported Tag");
+                Application::getInstance().holdState(1500);
                 return;
             }
 
@@ -79,22 +87,18 @@ namespace NuggetsInc
 
             if (!macAddress)
             {
-                displayUtils->displayMessage("No MAC Address found");
-                delay(1000);
-                Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
+                displayUtils.displayMessage("No MAC Address found");
+                Application::getInstance().changeStateAfter(1000, MENU_STATE);
                 return;
             }
 
             memcpy(device2MAC, macAddress, sizeof(device2MAC));
-            displayUtils->displayMessage("MAC Address Found");
-            delay(500);
-
-            Application::getInstance().changeState(new RemoteControlState(device2MAC));
+            displayUtils.displayMessage("MAC Address Found");
+            Application::getInstance().changeStateAfter(500, REMOTE_CONTROL_STATE, device2MAC);
         }
         else
         {
-            displayUtils->displayMessage("Please Scan NFC Tag To Connect to a Device");
-            delay(100);
+            displayUtils.displayMessage("Please Scan NFC Tag To Connect to a Device");
         }
     }
 } // namespace NuggetsInc
@@ -0,0 +1,283 @@
+#include "EspNowManager.h"
+#include "Diagnostics/Profiler.h"
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+#include <string.h>
+
+namespace NuggetsInc {
+
+namespace {
+
+const uint8_t BROADCAST_MAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// Guards the subscriber list against the Wi-Fi task
+portMUX_TYPE subscriberLock = portMUX_INITIALIZER_UNLOCKED;
+
+} // namespace
+
+EspNowManager& EspNowManager::getInstance() {
+    static EspNowManager instance;
+    return instance;
+}
+
+EspNowManager::EspNowManager()
+    : subscriberCount_(0), dispatching_(0), channel_(HOME_CHANNEL), ready_(false),
+      promiscuous_(false) {
+    memset(subscribers_, 0, sizeof(subscribers_));
+    memset(peers_, 0, sizeof(peers_));
+}
+
+bool EspNowManager::begin() {
+    if (ready_) {
+        return true;
+    }
+    PROFILE_BLOCKING("espnow.bringUp");
+
+    WiFi.mode(WIFI_STA);
+    WiFi.disconnect();
+    delay(WIFI_SETTLE_MS);
+    setChannel(HOME_CHANNEL);
+
+    if (esp_now_init() != ESP_OK) {
+        Serial.println("ESP-NOW initialization failed");
+        return false;
+    }
+    esp_now_register_send_cb(onDataSent);
+    esp_now_register_recv_cb(onDataReceived);
+
+    // Promiscuous receive, for the RSSI of management frames, which is what
+    // ESP-NOW frames are. It is only switched on while a subscriber wants
+    // them; see updatePromiscuous().
+    setPromiscuousFilter(WIFI_PROMIS_FILTER_MASK_MGMT);
+    esp_wifi_set_promiscuous_rx_cb(onPromiscuous);
+
+    esp_now_peer_info_t peerInfo = {};
+    memcpy(peerInfo.peer_addr, BROADCAST_MAC, 6);
+    peerInfo.channel = 0;
+    peerInfo.encrypt = false;
+    esp_now_add_peer(&peerInfo);
+
+    ready_ = true;
+    setAwake(subscriberCount_ > 0);
+    return true;
+}
+
+bool EspNowManager::subscribe(const Subscriber& subscriber) {
+    if (!begin()) {
+        return false;
+    }
+    portENTER_CRITICAL(&subscriberLock);
+    bool added = subscriberCount_ < MAX_SUBSCRIBERS;
+    if (added) {
+        subscribers_[subscriberCount_++] = subscriber;
+    }
+    portEXIT_CRITICAL(&subscriberLock);
+
+    if (!added) {
+        Serial.println("Cannot subscribe to ESP-NOW: too many subscribers");
+        return false;
+    }
+    if (subscriberCount_ == 1) {
+        setAwake(true);
+    } else {
+        updatePromiscuous();
+    }
+    return true;
+}
+
+void EspNowManager::unsubscribe(void* context) {
+    portENTER_CRITICAL(&subscriberLock);
+    for (uint8_t i = 0; i < subscriberCount_; i++) {
+        if (subscribers_[i].context == context) {
+            subscribers_[i] = subscribers_[--subscriberCount_];
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&subscriberLock);
+
+    // A callback that copied the list before we changed it may still be
+    // using the context
+    while (dispatching_ > 0) {
+        delay(1);
+    }
+    if (subscriberCount_ == 0) {
+        setAwake(false);
+    } else {
+        updatePromiscuous();
+    }
+}
+
+uint8_t EspNowManager::beginDispatch(Subscriber* out) {
+    portENTER_CRITICAL(&subscriberLock);
+    uint8_t count = subscriberCount_;
+    memcpy(out, subscribers_, count * sizeof(Subscriber));
+    dispatching_++;
+    portEXIT_CRITICAL(&subscriberLock);
+    return count;
+}
+
+void EspNowManager::endDispatch() {
+    portENTER_CRITICAL(&subscriberLock);
+    dispatching_--;
+    portEXIT_CRITICAL(&subscriberLock);
+}
+
+void EspNowManager::onDataSent(const uint8_t* mac, esp_now_send_status_t status) {
+    EspNowManager& manager = getInstance();
+    Subscriber subscribers[MAX_SUBSCRIBERS];
+    uint8_t count = manager.beginDispatch(subscribers);
+    for (uint8_t i = 0; i < count; i++) {
+        if (subscribers[i].onSent) {
+            subscribers[i].onSent(mac, status == ESP_NOW_SEND_SUCCESS, subscribers[i].context);
+        }
+    }
+    manager.endDispatch();
+}
+
+void EspNowManager::onDataReceived(const uint8_t* mac, const uint8_t* data, int length) {
+    EspNowManager& manager = getInstance();
+    Subscriber subscribers[MAX_SUBSCRIBERS];
+    uint8_t count = manager.beginDispatch(subscribers);
+    for (uint8_t i = 0; i < count; i++) {
+        if (subscribers[i].onReceive) {
+            subscribers[i].onReceive(mac, data, length, subscribers[i].context);
+        }
+    }
+    manager.endDispatch();
+}
+
+void EspNowManager::onPromiscuous(void* buffer, wifi_promiscuous_pkt_type_t type) {
+    EspNowManager& manager = getInstance();
+    const wifi_promiscuous_pkt_t* packet = static_cast<const wifi_promiscuous_pkt_t*>(buffer);
+    Subscriber subscribers[MAX_SUBSCRIBERS];
+    uint8_t count = manager.beginDispatch(subscribers);
+    for (uint8_t i = 0; i < count; i++) {
+        if (subscribers[i].onPromiscuous) {
+            subscribers[i].onPromiscuous(packet, type, subscribers[i].context);
+        }
+    }
+    manager.endDispatch();
+}
+
+void EspNowManager::setAwake(bool awake) {
+    if (!ready_) {
+        return;
+    }
+    PROFILE_BLOCKING("espnow.wake");
+    // Minimum modem sleep keeps ESP-NOW initialised and the peers in place;
+    // frames still go out, only with more latency
+    esp_wifi_set_ps(awake ? WIFI_PS_NONE : WIFI_PS_MIN_MODEM);
+    // Asleep, nobody is subscribed, so this switches promiscuous receive off
+    updatePromiscuous();
+}
+
+void EspNowManager::updatePromiscuous() {
+    bool wanted = false;
+    for (uint8_t i = 0; i < subscriberCount_; i++) {
+        wanted |= subscribers_[i].onPromiscuous != nullptr;
+    }
+    if (!ready_ || wanted == promiscuous_) {
+        return;
+    }
+    esp_wifi_set_promiscuous(wanted);
+    promiscuous_ = wanted;
+}
+
+EspNowManager::Peer* EspNowManager::findPeer(const uint8_t mac[6]) {
+    for (uint8_t i = 0; i < MAX_PEERS; i++) {
+        if (peers_[i].used && memcmp(peers_[i].mac, mac, 6) == 0) {
+            return &peers_[i];
+        }
+    }
+    return nullptr;
+}
+
+bool EspNowManager::ensurePeer(const uint8_t mac[6]) {
+    if (!begin()) {
+        return false;
+    }
+    if (memcmp(mac, BROADCAST_MAC, 6) == 0) {
+        return true;
+    }
+
+    msec32 nowMs = millis();
+    Peer* peer = findPeer(mac);
+    if (peer != nullptr) {
+        peer->lastUsedMs = nowMs;
+        return true;
+    }
+
+    // A free slot, or else the least recently used one
+    peer = &peers_[0];
+    for (uint8_t i = 0; i < MAX_PEERS; i++) {
+        if (!peers_[i].used) {
+            peer = &peers_[i];
+            break;
+        }
+        if ((int32_t)(peers_[i].lastUsedMs - peer->lastUsedMs) < 0) {
+            peer = &peers_[i];
+        }
+    }
+    if (peer->used) {
+        esp_now_del_peer(peer->mac);
+        peer->used = false;
+    }
+
+    if (!esp_now_is_peer_exist(mac)) {
+        esp_now_peer_info_t peerInfo = {};
+        memcpy(peerInfo.peer_addr, mac, 6);
+        peerInfo.channel = 0; // whichever the radio is on, so peers follow a switch
+        peerInfo.encrypt = false;
+        esp_err_t result = esp_now_add_peer(&peerInfo);
+        if (result != ESP_OK) {
+            Serial.printf("Failed to add peer %02X:%02X:%02X:%02X:%02X:%02X: %s\n", mac[0],
+                          mac[1], mac[2], mac[3], mac[4], mac[5], esp_err_to_name(result));
+            return false;
+        }
+    }
+    memcpy(peer->mac, mac, 6);
+    peer->used = true;
+    peer->lastUsedMs = nowMs;
+    return true;
+}
+
+bool EspNowManager::setChannel(uint8_t channel) {
+    // The promiscuous toggle is what lets esp_wifi_set_channel() take effect
+    // on a station that is not connected to an access point
+    bool promiscuous = false;
+    esp_wifi_get_promiscuous(&promiscuous);
+    if (!promiscuous) {
+        esp_wifi_set_promiscuous(true);
+    }
+    esp_err_t result = esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+    if (!promiscuous) {
+        esp_wifi_set_promiscuous(false);
+    }
+    if (result != ESP_OK) {
+        Serial.printf("Cannot tune to channel %u: %s\n", channel, esp_err_to_name(result));
+        return false;
+    }
+    channel_ = channel;
+    return true;
+}
+
+void EspNowManager::allowedChannels(uint8_t& first, uint8_t& last) {
+    wifi_country_t country;
+    first = 1;
+    last = 11;
+    if (esp_wifi_get_country(&country) == ESP_OK && country.schan >= 1 && country.nchan >= 1) {
+        first = country.schan;
+        last = country.schan + country.nchan - 1;
+        if (last > MAX_CHANNEL) {
+            last = MAX_CHANNEL;
+        }
+    }
+}
+
+void EspNowManager::setPromiscuousFilter(uint32_t mask) {
+    wifi_promiscuous_filter_t filter = {mask};
+    esp_wifi_set_promiscuous_filter(&filter);
+}
+
+} // namespace NuggetsInc
@@ -0,0 +1,141 @@
+#include "Fragmentation.h"
+#include <string.h>
+
+namespace NuggetsInc {
+
+uint8_t Fragmenter::count(size_t length) {
+    if (length > MAX_MESSAGE_SIZE) {
+        return 0;
+    }
+    return length == 0 ? 1 : (length + DATA_PER_FRAGMENT - 1) / DATA_PER_FRAGMENT;
+}
+
+size_t Fragmenter::write(uint16_t transferID, uint8_t commandID, bool typed, const uint8_t* data,
+                         size_t length, uint8_t index, uint8_t* out, size_t capacity) {
+    uint8_t fragments = count(length);
+    if (index >= fragments) {
+        return 0;
+    }
+    size_t offset = (size_t)index * DATA_PER_FRAGMENT;
+    size_t chunk = length - offset < DATA_PER_FRAGMENT ? length - offset : DATA_PER_FRAGMENT;
+    if (capacity < HEADER_SIZE + chunk) {
+        return 0;
+    }
+
+    out[0] = transferID & 0xFF;
+    out[1] = transferID >> 8;
+    out[2] = index;
+    out[3] = fragments;
+    out[4] = commandID;
+    out[5] = typed ? FLAG_TYPED : 0;
+    out[6] = length & 0xFF;
+    out[7] = length >> 8;
+    memcpy(out + HEADER_SIZE, data + offset, chunk);
+    return HEADER_SIZE + chunk;
+}
+
+uint8_t Fragmenter::commandOf(const uint8_t* payload, size_t length) {
+    return length >= HEADER_SIZE ? payload[4] : 0;
+}
+
+Reassembler::Reassembler() {
+    reset();
+}
+
+void Reassembler::reset() {
+    memset(slots_, 0, sizeof(slots_));
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+Reassembler::Slot* Reassembler::find(const uint8_t source[6], uint16_t transferID,
+                                     msec32 nowMs) {
+    // A timed-out transfer is not continued: the sender may have restarted
+    // and be reusing its transfer IDs
+    for (uint8_t i = 0; i < SLOTS; i++) {
+        if (slots_[i].used && slots_[i].transferID == transferID &&
+            memcmp(slots_[i].source, source, 6) == 0 &&
+            (msec32)(nowMs - slots_[i].lastMs) < TIMEOUT_MS) {
+            return &slots_[i];
+        }
+    }
+    return nullptr;
+}
+
+Reassembler::Slot* Reassembler::claim(msec32 nowMs) {
+    Slot* stalest = nullptr;
+    for (uint8_t i = 0; i < SLOTS; i++) {
+        Slot& slot = slots_[i];
+        if (!slot.used) {
+            return &slot;
+        }
+        if ((msec32)(nowMs - slot.lastMs) >= TIMEOUT_MS &&
+            (stalest == nullptr || (int32_t)(slot.lastMs - stalest->lastMs) < 0)) {
+            stalest = &slot;
+        }
+    }
+    if (stalest != nullptr) {
+        stats_.timedOut++;
+    }
+    return stalest;
+}
+
+const Reassembler::Message* Reassembler::add(const uint8_t source[6], const uint8_t* payload,
+                                             size_t length, msec32 nowMs, Result& result) {
+    result = MALFORMED;
+    if (length < Fragmenter::HEADER_SIZE) {
+        stats_.malformed++;
+        return nullptr;
+    }
+    uint16_t transferID = payload[0] | (uint16_t)payload[1] << 8;
+    uint8_t index = payload[2];
+    uint8_t count = payload[3];
+    uint8_t commandID = payload[4];
+    bool typed = (payload[5] & Fragmenter::FLAG_TYPED) != 0;
+    uint16_t total = payload[6] | (uint16_t)payload[7] << 8;
+
+    // Every fragment but the last is full
+    size_t chunk = length - Fragmenter::HEADER_SIZE;
+    size_t offset = (size_t)index * Fragmenter::DATA_PER_FRAGMENT;
+    if (count != Fragmenter::count(total) || count == 0 || index >= count ||
+        chunk != (index + 1 < count ? Fragmenter::DATA_PER_FRAGMENT : total - offset)) {
+        stats_.malformed++;
+        return nullptr;
+    }
+
+    Slot* slot = find(source, transferID, nowMs);
+    if (slot == nullptr) {
+        slot = claim(nowMs);
+        if (slot == nullptr) {
+            result = NO_BUFFER;
+            stats_.noBuffer++;
+            return nullptr;
+        }
+        slot->used = true;
+        memcpy(slot->source, source, 6);
+        slot->transferID = transferID;
+        slot->count = count;
+        slot->received = 0;
+        slot->message.commandID = commandID;
+        slot->message.typed = typed;
+        slot->message.length = total;
+    } else if (slot->count != count || slot->message.commandID != commandID ||
+               slot->message.length != total) {
+        stats_.malformed++;
+        return nullptr;
+    }
+
+    result = ACCEPTED;
+    memcpy(slot->message.data + offset, payload + Fragmenter::HEADER_SIZE, chunk);
+    slot->received |= 1UL << index;
+    slot->lastMs = nowMs;
+    if (slot->received != (1UL << count) - 1) {
+        return nullptr;
+    }
+
+    slot->message.data[total] = '\0';
+    slot->used = false;
+    stats_.completed++;
+    return &slot->message;
+}
+
+} // namespace NuggetsInc
@@ -0,0 +1,243 @@
+#include "LinkMonitor.h"
+#include <freertos/FreeRTOS.h>
+#include <string.h>
+
+namespace NuggetsInc {
+
+namespace {
+
+// Written from the Wi-Fi task, read from the main loop
+portMUX_TYPE linkLock = portMUX_INITIALIZER_UNLOCKED;
+portMUX_TYPE surveyLock = portMUX_INITIALIZER_UNLOCKED;
+
+// wifi_phy_rate_t of non-HT frames, in 100 kbit/s
+const uint16_t LEGACY_RATES[16] = {10, 20, 55, 110, 10, 20, 55, 110,
+                                   480, 240, 120, 60, 540, 360, 180, 90};
+// HT frames do not say their MCS here; count them at the slowest one
+const uint16_t HT_RATE = 65;
+const uint32_t DSSS_PREAMBLE_US = 192;
+const uint32_t OFDM_PREAMBLE_US = 20;
+
+uint32_t estimateAirtimeUs(const wifi_pkt_rx_ctrl_t& rx) {
+    uint16_t rate = rx.sig_mode == 0 ? LEGACY_RATES[rx.rate & 0x0F] : HT_RATE;
+    uint32_t preamble = rx.sig_mode == 0 && rx.rate < 8 ? DSSS_PREAMBLE_US : OFDM_PREAMBLE_US;
+    return preamble + (uint32_t)rx.sig_len * 80 / rate;
+}
+
+} // namespace
+
+LinkMonitor::LinkMonitor() {
+    memset(links_, 0, sizeof(links_));
+}
+
+LinkMonitor::Link* LinkMonitor::find(const uint8_t mac[6]) {
+    for (uint8_t i = 0; i < MAX_LINKS; i++) {
+        if (links_[i].used && memcmp(links_[i].mac, mac, 6) == 0) {
+            return &links_[i];
+        }
+    }
+    return nullptr;
+}
+
+void LinkMonitor::track(const uint8_t mac[6]) {
+    portENTER_CRITICAL(&linkLock);
+    if (find(mac) == nullptr) {
+        for (uint8_t i = 0; i < MAX_LINKS; i++) {
+            if (!links_[i].used) {
+                memset(&links_[i], 0, sizeof(links_[i]));
+                memcpy(links_[i].mac, mac, 6);
+                links_[i].used = true;
+                break;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&linkLock);
+}
+
+void LinkMonitor::reset() {
+    portENTER_CRITICAL(&linkLock);
+    memset(links_, 0, sizeof(links_));
+    portEXIT_CRITICAL(&linkLock);
+}
+
+void LinkMonitor::recordRssi(const uint8_t mac[6], int8_t rssi) {
+    msec32 nowMs = millis();
+    portENTER_CRITICAL(&linkLock);
+    Link* link = find(mac);
+    if (link != nullptr) {
+        if (link->rxFrames == 0) {
+            link->rssiMin = rssi;
+            link->rssiMax = rssi;
+            link->rssiAvg16 = rssi * 16;
+        } else {
+            link->rssiMin = rssi < link->rssiMin ? rssi : link->rssiMin;
+            link->rssiMax = rssi > link->rssiMax ? rssi : link->rssiMax;
+            // Smoothing of 1/8, like the round trip
+            link->rssiAvg16 += (rssi * 16 - link->rssiAvg16) / 8;
+        }
+        link->rssiLast = rssi;
+        link->rxFrames++;
+        link->lastHeardMs = nowMs;
+    }
+    portEXIT_CRITICAL(&linkLock);
+}
+
+void LinkMonitor::recordSend(const uint8_t mac[6], bool delivered) {
+    portENTER_CRITICAL(&linkLock);
+    Link* link = find(mac);
+    if (link != nullptr) {
+        link->txFrames++;
+        if (!delivered) {
+            link->txFailed++;
+        }
+    }
+    portEXIT_CRITICAL(&linkLock);
+}
+
+void LinkMonitor::recordRtt(const uint8_t mac[6], uint32_t rttUs) {
+    portENTER_CRITICAL(&linkLock);
+    Link* link = find(mac);
+    if (link != nullptr) {
+        link->srttUs = link->srttUs == 0 ? rttUs : (7 * link->srttUs + rttUs) / 8;
+    }
+    portEXIT_CRITICAL(&linkLock);
+}
+
+uint8_t LinkMonitor::snapshot(Link* out, uint8_t capacity) const {
+    uint8_t count = 0;
+    portENTER_CRITICAL(&linkLock);
+    for (uint8_t i = 0; i < MAX_LINKS && count < capacity; i++) {
+        if (links_[i].used) {
+            out[count++] = links_[i];
+        }
+    }
+    portEXIT_CRITICAL(&linkLock);
+    return count;
+}
+
+void LinkMonitor::report(Print& out) const {
+    Link links[MAX_LINKS];
+    uint8_t count = snapshot(links, MAX_LINKS);
+    msec32 nowMs = millis();
+
+    out.println("  links:");
+    for (uint8_t i = 0; i < count; i++) {
+        const Link& link = links[i];
+        const uint8_t* m = link.mac;
+        out.printf("    %02X:%02X:%02X:%02X:%02X:%02X  tx %lu failed %lu  rx %lu",
+                   m[0], m[1], m[2], m[3], m[4], m[5], (unsigned long)link.txFrames,
+                   (unsigned long)link.txFailed, (unsigned long)link.rxFrames);
+        if (link.rxFrames > 0) {
+            out.printf("  rssi %d dBm (avg %d, %d..%d)  heard %lu ms ago", link.rssiLast,
+                       link.rssiAvg16 / 16, link.rssiMin, link.rssiMax,
+                       (unsigned long)(nowMs - link.lastHeardMs));
+        }
+        if (link.srttUs > 0) {
+            out.printf("  srtt %lu us", (unsigned long)link.srttUs);
+        }
+        out.println();
+    }
+}
+
+const uint8_t* LinkMonitor::espNowSender(const wifi_promiscuous_pkt_t* packet,
+                                         wifi_promiscuous_pkt_type_t type) {
+    // An action frame (24-byte header) of the vendor-specific category
+    // with Espressif's OUI
+    const uint8_t* frame = packet->payload;
+    if (type != WIFI_PKT_MGMT || packet->rx_ctrl.sig_len < 28 || frame[0] != 0xD0 ||
+        frame[24] != 127 || frame[25] != 0x18 || frame[26] != 0xFE || frame[27] != 0x34) {
+        return nullptr;
+    }
+    return frame + 10;
+}
+
+ChannelSurvey::ChannelSurvey()
+    : first_(0), last_(0), channel_(0), channelStartMs_(0), active_(false), complete_(false) {
+    memset(results_, 0, sizeof(results_));
+}
+
+void ChannelSurvey::begin(uint8_t first, uint8_t last, msec32 nowMs) {
+    portENTER_CRITICAL(&surveyLock);
+    memset(results_, 0, sizeof(results_));
+    for (uint8_t channel = 0; channel <= MAX_CHANNEL; channel++) {
+        results_[channel].rssiMax = -128;
+    }
+    first_ = first;
+    last_ = last;
+    channel_ = first;
+    channelStartMs_ = nowMs;
+    active_ = true;
+    complete_ = false;
+    portEXIT_CRITICAL(&surveyLock);
+}
+
+bool ChannelSurvey::advance(msec32 nowMs) {
+    portENTER_CRITICAL(&surveyLock);
+    results_[channel_].dwellMs = nowMs - channelStartMs_;
+    channelStartMs_ = nowMs;
+    if (channel_ < last_) {
+        channel_++;
+    } else {
+        active_ = false;
+        complete_ = true;
+    }
+    bool more = active_;
+    portEXIT_CRITICAL(&surveyLock);
+    return more;
+}
+
+void ChannelSurvey::record(const wifi_pkt_rx_ctrl_t& rx) {
+    if (!active_) {
+        return;
+    }
+    // Frames from a neighbouring channel can leak in; each one counts
+    // against the channel the radio was tuned to
+    portENTER_CRITICAL(&surveyLock);
+    Result& result = results_[channel_];
+    result.frames++;
+    result.airtimeUs += estimateAirtimeUs(rx);
+    if (rx.rssi > result.rssiMax) {
+        result.rssiMax = rx.rssi;
+    }
+    portEXIT_CRITICAL(&surveyLock);
+}
+
+ChannelSurvey::Result ChannelSurvey::result(uint8_t channel) const {
+    Result result;
+    memset(&result, 0, sizeof(result));
+    if (channel > MAX_CHANNEL) {
+        return result;
+    }
+    portENTER_CRITICAL(&surveyLock);
+    result = results_[channel];
+    portEXIT_CRITICAL(&surveyLock);
+    return result;
+}
+
+uint16_t ChannelSurvey::busyPermille(uint8_t channel) const {
+    Result r = result(channel);
+    if (r.dwellMs == 0) {
+        return 0;
+    }
+    uint32_t permille = r.airtimeUs / r.dwellMs;
+    return permille > 1000 ? 1000 : permille;
+}
+
+uint8_t ChannelSurvey::recommend(uint8_t current) const {
+    if (!complete_) {
+        return current;
+    }
+    uint8_t best = current;
+    uint16_t bestBusy = current >= first_ && current <= last_ ? busyPermille(current) : 1000;
+    uint16_t currentBusy = bestBusy;
+    for (uint8_t channel = first_; channel <= last_; channel++) {
+        uint16_t busy = busyPermille(channel);
+        if (busy < bestBusy) {
+            best = channel;
+            bestBusy = busy;
+        }
+    }
+    return currentBusy - bestBusy >= SWITCH_MARGIN_PERMILLE ? best : current;
+}
+
+} // namespace NuggetsInc
@@ -9,12 +9,10 @@
 namespace NuggetsInc {
 
 MacAddressMenuState::MacAddressMenuState()
-    : displayUtils(nullptr), selectedIndex(0), scrollOffset(0) {
-    displayUtils = new DisplayUtils(Device::getInstance().getDisplay());
+    : displayUtils(Device::getInstance().getDisplay()), selectedIndex(0), scrollOffset(0) {
 }
 
 MacAddressMenuState::~MacAddressMenuState() {
-    delete displayUtils;
 }
 
 void MacAddressMenuState::onEnter() {
@@ -42,7 +40,7 @@ void MacAddressMenuState::update() {
                 break;
             case EVENT_BACK:
             case EVENT_ACTION_TWO:
-                Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
+                Application::getInstance().popState();
                 return;
             default:
                 break;
@@ -94,21 +92,21 @@ void MacAddressMenuState::scrollDown() {
 }
 
 void MacAddressMenuState::displayMenu() {
-    displayUtils->clearDisplay();
+    displayUtils.clearDisplay();
     
     // Display title
-    displayUtils->setTextColor(COLOR_WHITE);
-    displayUtils->setTextSize(2);
-    displayUtils->setCursor(10, 10);
-    displayUtils->print("Stored MAC Addresses");
+    displayUtils.setTextColor(COLOR_WHITE);
+    displayUtils.setTextSize(2);
+    displayUtils.setCursor(10, 10);
+    displayUtils.print("Stored MAC Addresses");
     
     // Display count
-    displayUtils->setTextSize(1);
-    displayUtils->setCursor(10, 35);
-    displayUtils->print("Count: " + String(macAddresses.size()));
+    displayUtils.setTextSize(1);
+    displayUtils.setCursor(10, 35);
+    displayUtils.print("Count: " + String(macAddresses.size()));
     
     // Display MAC addresses
-    displayUtils->setTextSize(1);
+    displayUtils.setTextSize(1);
     int yPos = 55;
     int lineHeight = 20;
     
@@ -117,12 +115,12 @@ void MacAddressMenuState::displayMenu() {
         
         // Highlight selected item
         if (macIndex == selectedIndex) {
-            displayUtils->setTextColor(COLOR_ORANGE);
+            displayUtils.setTextColor(COLOR_ORANGE);
         } else {
-            displayUtils->setTextColor(COLOR_WHITE);
+            displayUtils.setTextColor(COLOR_WHITE);
         }
         
-        displayUtils->setCursor(10, yPos + (i * lineHeight));
+        displayUtils.setCursor(10, yPos + (i * lineHeight));
         
         // Display index and MAC address
         String displayText = String(macIndex + 1) + ": " + macAddresses[macIndex];
@@ -132,26 +130,26 @@ void MacAddressMenuState::displayMenu() {
             displayText = displayText.substring(0, 22) + "...";
         }
         
-        displayUtils->print(displayText);
+        displayUtils.print(displayText);
     }
     
     // Display scroll indicators if needed
-    displayUtils->setTextColor(COLOR_WHITE);
-    displayUtils->setTextSize(1);
+    displayUtils.setTextColor(COLOR_WHITE);
+    displayUtils.setTextSize(1);
     
     if (scrollOffset > 0) {
-        displayUtils->setCursor(200, 55);
-        displayUtils->print("^");
+        displayUtils.setCursor(200, 55);
+        displayUtils.print("^");
     }
     
     if (scrollOffset + MAX_VISIBLE_ITEMS < macAddresses.size()) {
-        displayUtils->setCursor(200, 200);
-        displayUtils->print("v");
+        displayUtils.setCursor(200, 200);
+        displayUtils.print("v");
     }
     
     // Display instructions
-    displayUtils->setCursor(10, 220);
-    displayUtils->print("UP/DOWN: Navigate  BACK: Return");
+    displayUtils.setCursor(10, 220);
+    displayUtils.print("UP/DOWN: Navigate  BACK: Return");
 }
 
 } // namespace NuggetsInc
@@ -0,0 +1,359 @@
+#include "NodeSync.h"
+#include <WiFi.h>
+#include <esp_now.h>
+#include "Application.h"
+#include "EspNowManager.h"
+#include "MessageTypes.h"
+#include "WireFormat.h"
+
+namespace NuggetsInc {
+
+namespace {
+
+bool isZeroMac(const uint8_t mac[6]) {
+    static const uint8_t zero[6] = {0, 0, 0, 0, 0, 0};
+    return memcmp(mac, zero, 6) == 0;
+}
+
+} // namespace
+
+NodeSync::NodeSync()
+    : nodeCount_(0), listLength_(0), running_(false), subscribed_(false), changed_(false),
+      startMs_(0), finishMs_(0), retryTimer_(TimerService::INVALID_TIMER) {
+    memset(nodes_, 0, sizeof(nodes_));
+    memset(selfMac_, 0, sizeof(selfMac_));
+    list_[0] = '\0';
+}
+
+NodeSync::~NodeSync() {
+    stop();
+    TimerService::getInstance().cancelAll(this);
+}
+
+bool NodeSync::start(const std::vector<String>& macAddresses) {
+    if (running_) {
+        return false;
+    }
+
+    // Everything a frame needs is worked out once, not per frame
+    nodeCount_ = 0;
+    listLength_ = 0;
+    list_[0] = '\0';
+    for (size_t i = 0; i < macAddresses.size() && nodeCount_ < MAX_NODES; i++) {
+        Node& node = nodes_[nodeCount_];
+        const String& text = macAddresses[i];
+        if (sscanf(text.c_str(), "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &node.mac[0], &node.mac[1],
+                   &node.mac[2], &node.mac[3], &node.mac[4], &node.mac[5]) != 6) {
+            Serial.println("Skipping bad MAC address " + text);
+            continue;
+        }
+        size_t needed = listLength_ + (listLength_ > 0 ? 1 : 0) + text.length();
+        if (needed >= sizeof(list_)) {
+            break;
+        }
+        if (listLength_ > 0) {
+            list_[listLength_++] = ',';
+        }
+        memcpy(list_ + listLength_, text.c_str(), text.length());
+        listLength_ += text.length();
+        list_[listLength_] = '\0';
+        nodeCount_++;
+    }
+    if (nodeCount_ == 0) {
+        return false;
+    }
+
+    EspNowManager& radio = EspNowManager::getInstance();
+    if (!radio.begin()) {
+        return false;
+    }
+    EspNowManager::Subscriber subscriber = {onFrameReceived, nullptr, nullptr, this};
+    if (!radio.subscribe(subscriber)) {
+        Serial.println("Sync: no room to subscribe to the radio");
+        return false;
+    }
+    subscribed_ = true;
+    WiFi.macAddress(selfMac_);
+
+    // Each node its own messageID, kept for its retries
+    msec32 nowMs = millis();
+    WireFormat::beginMessageIDs();
+    for (uint8_t i = 0; i < nodeCount_; i++) {
+        Node& node = nodes_[i];
+        node.status = NODE_WAITING;
+        node.attempts = 0;
+        node.messageID = WireFormat::nextMessageID();
+        node.firstSentMs = nowMs;
+        node.retryAtMs = nowMs;
+        node.rttMs = 0;
+        node.addresses = nodeCount_;
+    }
+    running_ = true;
+    changed_ = true;
+    startMs_ = nowMs;
+    finishMs_ = nowMs;
+
+    retransmitDue(nowMs);
+    return true;
+}
+
+void NodeSync::poll() {
+    if (!running_) {
+        return;
+    }
+    drainReceived();
+    if (running_) {
+        retransmitDue(millis());
+    }
+}
+
+void NodeSync::stop() {
+    if (retryTimer_ != TimerService::INVALID_TIMER) {
+        TimerService::getInstance().cancel(retryTimer_);
+        retryTimer_ = TimerService::INVALID_TIMER;
+    }
+    if (subscribed_) {
+        EspNowManager::getInstance().unsubscribe(this);
+        subscribed_ = false;
+    }
+    running_ = false;
+}
+
+uint8_t NodeSync::countNodes(NodeStatus status) const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < nodeCount_; i++) {
+        if (nodes_[i].status == status) {
+            count++;
+        }
+    }
+    return count;
+}
+
+uint32_t NodeSync::getElapsedMs() const {
+    return running_ ? (msec32)(millis() - startMs_) : (msec32)(finishMs_ - startMs_);
+}
+
+bool NodeSync::takeChanged() {
+    bool changed = changed_;
+    changed_ = false;
+    return changed;
+}
+
+size_t NodeSync::listLengthFor(const uint8_t mac[6], WireVersion version,
+                               uint8_t& addresses) const {
+    // As many addresses as the frame takes: a compact frame holds a dozen, a
+    // legacy one only a couple. The compact routing block comes out of the
+    // payload; legacy has fields for it.
+    size_t capacity = WireFormat::maxPayload(mac);
+    if (version == WIRE_COMPACT) {
+        capacity -= WireFormat::ROUTING_SIZE;
+    }
+    size_t length = listLength_;
+    addresses = nodeCount_;
+    while (length > capacity) {
+        // Drop the last address and its comma
+        while (length > 0 && list_[length - 1] != ',') {
+            length--;
+        }
+        if (length > 0) {
+            length--;
+        }
+        addresses--;
+    }
+    return length;
+}
+
+esp_err_t NodeSync::send(Node& node) {
+    // Legacy until the node has answered in the compact format; its ack to
+    // the first frame usually settles that for the retries
+    WireVersion version = WireFormat::peerVersion(node.mac);
+    if (version == WIRE_UNKNOWN) {
+        version = WIRE_LEGACY;
+    }
+
+    char payload[sizeof(list_)];
+    uint8_t addresses;
+    size_t length = listLengthFor(node.mac, version, addresses);
+    memcpy(payload, list_, length);
+    payload[length] = '\0';
+    if (addresses < node.addresses) {
+        node.addresses = addresses;
+    }
+
+    // Routed to the node so that only it acts on the list and acks it
+    WireMessage message;
+    WireFormat::initCommand(message, node.messageID, CMD_SYNC_NODES, payload);
+    message.routed = true;
+    memcpy(message.origin, selfMac_, 6);
+    memcpy(message.destination, node.mac, 6);
+
+    uint8_t frame[WireFormat::MAX_FRAME_SIZE];
+    size_t frameLength = WireFormat::encode(message, version, selfMac_, frame, sizeof(frame));
+    return frameLength > 0 ? esp_now_send(node.mac, frame, frameLength) : ESP_ERR_INVALID_SIZE;
+}
+
+void NodeSync::transmit(Node& node, msec32 nowMs) {
+    esp_err_t result = ESP_ERR_ESPNOW_NOT_FOUND;
+    if (EspNowManager::getInstance().ensurePeer(node.mac)) {
+        result = send(node);
+    }
+    if (result == ESP_ERR_ESPNOW_NO_MEM) {
+        // The radio's queue is full of the frames just sent; not an attempt
+        node.retryAtMs = nowMs + BUSY_RETRY_MS;
+        return;
+    }
+    if (result != ESP_OK) {
+        Serial.printf("Sync to %02X:%02X:%02X:%02X:%02X:%02X failed: %s\n", node.mac[0],
+                      node.mac[1], node.mac[2], node.mac[3], node.mac[4], node.mac[5],
+                      esp_err_to_name(result));
+    }
+
+    if (node.attempts == 0) {
+        node.firstSentMs = nowMs;
+        node.status = NODE_SENT;
+        changed_ = true;
+    }
+    node.attempts++;
+    node.retryAtMs = nowMs + RETRY_MS;
+}
+
+void NodeSync::retransmitDue(msec32 nowMs) {
+    for (uint8_t i = 0; i < nodeCount_; i++) {
+        Node& node = nodes_[i];
+        if ((node.status != NODE_WAITING && node.status != NODE_SENT) ||
+            (int32_t)(nowMs - node.retryAtMs) < 0) {
+            continue;
+        }
+        if (node.attempts >= MAX_ATTEMPTS) {
+            node.status = NODE_FAILED;
+            changed_ = true;
+            continue;
+        }
+        transmit(node, nowMs);
+    }
+
+    finishIfDone();
+    if (running_) {
+        armRetryTimer();
+    }
+}
+
+void NodeSync::drainReceived() {
+    for (uint8_t i = 0; i < RX_BATCH; i++) {
+        RxFrame* frame = rxQueue_.acquire();
+        if (frame == nullptr) {
+            return;
+        }
+
+        WireMessage message;
+        WireVersion version;
+        bool advertisesCompact;
+        if (WireFormat::decode(frame->data, frame->length, message, version, advertisesCompact)) {
+            WireFormat::notePeerVersion(frame->srcMac, advertisesCompact ? WIRE_COMPACT : WIRE_LEGACY);
+            WireFormat::notePeerFrameSize(frame->srcMac, message);
+            bool forSelf = !message.routed || memcmp(message.destination, selfMac_, 6) == 0;
+            if (message.type == WIRE_ACK && forSelf) {
+                // Routed acks are known by where they started
+                bool fromOrigin = message.routed && !isZeroMac(message.origin);
+                handleAck(fromOrigin ? message.origin : frame->srcMac, message.messageID);
+            }
+        }
+        rxQueue_.release(frame);
+    }
+
+    if (rxQueue_.getStats().depth > 0) {
+        Application::getInstance().wake();
+    }
+}
+
+void NodeSync::handleAck(const uint8_t source[6], uint32_t messageID) {
+    for (uint8_t i = 0; i < nodeCount_; i++) {
+        Node& node = nodes_[i];
+        if (node.messageID != messageID || memcmp(node.mac, source, 6) != 0) {
+            continue;
+        }
+        // Too late for a node already given up on counts all the same
+        if (node.status != NODE_SENT && node.status != NODE_FAILED) {
+            return;
+        }
+        msec32 nowMs = millis();
+        node.rttMs = (uint16_t)(nowMs - node.firstSentMs);
+        changed_ = true;
+        uint8_t fits = node.addresses;
+        if (node.addresses < nodeCount_ && WireFormat::peerVersion(node.mac) == WIRE_COMPACT) {
+            listLengthFor(node.mac, WIRE_COMPACT, fits);
+        }
+        if (node.addresses == nodeCount_) {
+            node.status = NODE_SYNCED;
+        } else if (fits > node.addresses) {
+            // The ack was compact: the rest of the list goes in a compact
+            // frame, under an ID the node has not seen, from poll()
+            node.status = NODE_WAITING;
+            node.attempts = 0;
+            node.messageID = WireFormat::nextMessageID();
+            node.retryAtMs = nowMs;
+            node.addresses = nodeCount_;
+        } else {
+            node.status = NODE_PARTIAL;
+        }
+        finishIfDone();
+        return;
+    }
+}
+
+void NodeSync::finishIfDone() {
+    if (!running_) {
+        return;
+    }
+    for (uint8_t i = 0; i < nodeCount_; i++) {
+        if (nodes_[i].status == NODE_WAITING || nodes_[i].status == NODE_SENT) {
+            return;
+        }
+    }
+
+    finishMs_ = millis();
+    stop();
+    Serial.printf("Synced %u of %u nodes (%u partly) in %lu ms\n", countNodes(NODE_SYNCED),
+                  nodeCount_, countNodes(NODE_PARTIAL), (unsigned long)(finishMs_ - startMs_));
+}
+
+void NodeSync::armRetryTimer() {
+    msec32 nowMs = millis();
+    bool pending = false;
+    msec32 dueMs = 0;
+    for (uint8_t i = 0; i < nodeCount_; i++) {
+        const Node& node = nodes_[i];
+        if ((node.status == NODE_WAITING || node.status == NODE_SENT) &&
+            (!pending || (int32_t)(node.retryAtMs - dueMs) < 0)) {
+            dueMs = node.retryAtMs;
+            pending = true;
+        }
+    }
+
+    TimerService& timers = TimerService::getInstance();
+    if (retryTimer_ != TimerService::INVALID_TIMER) {
+        timers.cancel(retryTimer_);
+        retryTimer_ = TimerService::INVALID_TIMER;
+    }
+    if (pending) {
+        uint32_t delayMs = (int32_t)(dueMs - nowMs) > 0 ? dueMs - nowMs : 0;
+        retryTimer_ = timers.scheduleOnce(delayMs, onRetryDue, this);
+    }
+}
+
+void NodeSync::onFrameReceived(const uint8_t* mac, const uint8_t* data, int length,
+                               void* context) {
+    // Wi-Fi task: queue it for poll()
+    NodeSync* sync = static_cast<NodeSync*>(context);
+    if (sync->rxQueue_.push(mac, data, length)) {
+        Application::getInstance().wake();
+    }
+}
+
+void NodeSync::onRetryDue(void* context) {
+    NodeSync* sync = static_cast<NodeSync*>(context);
+    sync->retryTimer_ = TimerService::INVALID_TIMER;
+    sync->poll();
+}
+
+} // namespace NuggetsInc
@@ -5,6 +5,7 @@
 #include "Device.h"
 #include "MessageTypes.h"
 #include "MacAddressStorage.h"
+#include "Diagnostics/LatencyProbe.h"
 #include <Arduino.h>
 
 
@@ -12,8 +13,9 @@ namespace NuggetsInc
 {
     RemoteControlState *RemoteControlState::activeInstance = nullptr;
 
-    RemoteControlState::RemoteControlState(uint8_t *macAddress)
-        : displayUtils(nullptr), remoteService_(nullptr)
+    RemoteControlState::RemoteControlState(const uint8_t *macAddress)
+        : displayUtils(Device::getInstance().getDisplay()), remoteService_(nullptr),
+          linkView_(false), linkViewTimer_(TimerService::INVALID_TIMER)
     {
         // Save the MAC address of the target device
         if (macAddress)
@@ -30,11 +32,6 @@ namespace NuggetsInc
 
     RemoteControlState::~RemoteControlState()
     {
-        if (displayUtils)
-        {
-            delete displayUtils;
-            displayUtils = nullptr;
-        }
 
         if (remoteService_)
         {
@@ -51,7 +48,6 @@ namespace NuggetsInc
     void RemoteControlState::onEnter()
     {
         activeInstance = this;
-        displayUtils = new DisplayUtils(Device::getInstance().getDisplay());
 
         // Initialize RemoteService with target MAC
         if (remoteService_ && remoteService_->begin(device2MAC)) {
@@ -70,22 +66,33 @@ namespace NuggetsInc
         EventManager &eventManager = EventManager::getInstance();
         Event event;
 
+        if (remoteService_)
+        {
+            remoteService_->poll();
+        }
+
         while (eventManager.getNextEvent(event))
         {
-            handleInput(event.type);
+            handleInput(event);
         }
     }
 
-    void RemoteControlState::handleInput(EventType eventType)
+    void RemoteControlState::handleInput(const Event &event)
     {
         if (!remoteService_)
         {
-            displayUtils->displayMessage("Internal Error: RemoteService not initialized");
+            displayUtils.displayMessage("Internal Error: RemoteService not initialized");
+            return;
+        }
+
+        if (linkView_)
+        {
+            handleLinkViewInput(event);
             return;
         }
 
         uint8_t commandID = 0;
-        switch (eventType)
+        switch (event.type)
         {
         case EVENT_UP:
             commandID = CMD_MOVE_UP;
@@ -105,154 +112,261 @@ namespace NuggetsInc
         case EVENT_ACTION_TWO:
             commandID = CMD_BACK;
             break;
+        case EVENT_BACK:
+            openLinkView();
+            return;
+#ifdef NUGGETS_BENCHMARKS
+        case EVENT_SELECT:
+        {
+            LatencyProbe::getInstance().report(Serial);
+            RemoteService::DeliveryStats stats = remoteService_->getDeliveryStats();
+            Serial.printf("  delivered %lu/%lu  failed %lu  retransmissions %lu  rejected %lu"
+                          "  srtt %lu us  rto %lu ms\n",
+                          (unsigned long)stats.delivered, (unsigned long)stats.queued,
+                          (unsigned long)stats.failed, (unsigned long)stats.retransmissions,
+                          (unsigned long)stats.rejected, (unsigned long)stats.srttUs,
+                          (unsigned long)stats.rtoMs);
+            Serial.printf("  peer credit %lu  credit stalls %lu  coalesced %lu\n",
+                          (unsigned long)stats.credit, (unsigned long)stats.creditStalls,
+                          (unsigned long)stats.coalesced);
+            RxQueue::Stats rx = remoteService_->getReceiveStats();
+            Serial.printf("  rx frames %lu  dropped %lu  queued %lu  high water %lu/%lu\n",
+                          (unsigned long)rx.received, (unsigned long)rx.dropped,
+                          (unsigned long)rx.depth, (unsigned long)rx.highWater,
+                          (unsigned long)rx.capacity);
+            remoteService_->reportLanes(Serial);
+            remoteService_->reportRoutes(Serial);
+            remoteService_->reportLinks(Serial);
+            LatencyProbe::getInstance().show(displayUtils);
+            return;
+        }
+#endif
         default:
             return;
         }
 
+#ifdef NUGGETS_BENCHMARKS
+        LatencyProbe::getInstance().beginSample(event);
+#endif
         // Send command via RemoteService
         remoteService_->sendCommandNonBlocking(commandID);
     }
 
+    void RemoteControlState::openLinkView()
+    {
+        linkView_ = true;
+        TimerService::Job refresh = {"remote.linkView", LINK_VIEW_REFRESH_MS, LINK_VIEW_REFRESH_MS / 4, 0};
+        linkViewTimer_ = TimerService::getInstance().schedulePeriodic(refresh, onLinkViewDue, this);
+        drawLinkView();
+    }
+
+    void RemoteControlState::closeLinkView()
+    {
+        TimerService::getInstance().cancel(linkViewTimer_);
+        linkViewTimer_ = TimerService::INVALID_TIMER;
+        linkView_ = false;
+
+        // Whatever the peer drew meanwhile was dropped; have it start over
+        displayUtils.clearDisplay();
+        remoteService_->sendCommand(CMD_BOOOP);
+    }
+
+    void RemoteControlState::handleLinkViewInput(const Event &event)
+    {
+        switch (event.type)
+        {
+        case EVENT_BACK:
+            closeLinkView();
+            break;
+        case EVENT_SELECT:
+            if (remoteService_->startChannelSurvey())
+            {
+                drawLinkView();
+            }
+            break;
+        case EVENT_ACTION_ONE:
+        {
+            uint8_t channel = remoteService_->getSurvey().recommend(remoteService_->getChannel());
+            if (channel != remoteService_->getChannel() && remoteService_->switchChannel(channel))
+            {
+                drawLinkView();
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    void RemoteControlState::drawLinkView()
+    {
+        char line[64];
+        uint8_t channel = remoteService_->getChannel();
+        if (remoteService_->getPendingChannel() != 0)
+        {
+            snprintf(line, sizeof(line), "Link, channel %u -> %u", channel,
+                     remoteService_->getPendingChannel());
+        }
+        else
+        {
+            snprintf(line, sizeof(line), "Link, channel %u", channel);
+        }
+        displayUtils.newTerminalDisplay(line);
+
+        LinkMonitor::Link links[LINK_VIEW_MAX_LINKS];
+        uint8_t count = remoteService_->getLinks(links, LINK_VIEW_MAX_LINKS);
+        for (uint8_t i = 0; i < count; i++)
+        {
+            const LinkMonitor::Link &link = links[i];
+            const uint8_t *m = link.mac;
+            if (link.rxFrames > 0)
+            {
+                snprintf(line, sizeof(line), "%02X:%02X:%02X:%02X:%02X:%02X %d dBm", m[0], m[1],
+                         m[2], m[3], m[4], m[5], link.rssiAvg16 / 16);
+            }
+            else
+            {
+                snprintf(line, sizeof(line), "%02X:%02X:%02X:%02X:%02X:%02X not heard", m[0],
+                         m[1], m[2], m[3], m[4], m[5]);
+            }
+            displayUtils.addToTerminalDisplay(line);
+
+            uint32_t okPercent = link.txFrames > 0
+                                     ? 100 * (link.txFrames - link.txFailed) / link.txFrames
+                                     : 0;
+            snprintf(line, sizeof(line), " sent %lu ok %lu%%  rtt %lu.%lu ms",
+                     (unsigned long)link.txFrames, (unsigned long)okPercent,
+                     (unsigned long)(link.srttUs / 1000), (unsigned long)(link.srttUs % 1000 / 100));
+            displayUtils.addToTerminalDisplay(line);
+        }
+
+        const ChannelSurvey &survey = remoteService_->getSurvey();
+        if (survey.active())
+        {
+            snprintf(line, sizeof(line), "Surveying channel %u...", survey.channel());
+            displayUtils.addToTerminalDisplay(line);
+        }
+        else if (survey.complete())
+        {
+            // Busy percentage of each channel, five to a line
+            size_t used = 0;
+            for (uint8_t ch = survey.first(); ch <= survey.last(); ch++)
+            {
+                used += snprintf(line + used, sizeof(line) - used, "%2u:%3u%% ", ch,
+                                 (survey.busyPermille(ch) + 5) / 10);
+                if ((ch - survey.first()) % 5 == 4 || ch == survey.last())
+                {
+                    displayUtils.addToTerminalDisplay(line);
+                    used = 0;
+                }
+            }
+            snprintf(line, sizeof(line), "Quietest: %u", survey.recommend(channel));
+            displayUtils.addToTerminalDisplay(line);
+        }
+        displayUtils.addToTerminalDisplay("SET survey A1 switch BACK exit");
+    }
+
+    void RemoteControlState::onLinkViewDue(void *context)
+    {
+        static_cast<RemoteControlState *>(context)->drawLinkView();
+    }
+
     void RemoteControlState::handleSyncNodes(const char *data)
     {
+        // A comma-separated list, as many as fitted the sender's frame
         MacAddressStorage &macStorage = MacAddressStorage::getInstance();
-        String macAddress = String(data);
-        macStorage.saveMacAddress(macAddress);
+        String macList = String(data);
+        int start = 0;
+        while (start < (int)macList.length())
+        {
+            int comma = macList.indexOf(',', start);
+            int end = comma < 0 ? macList.length() : comma;
+            String macAddress = macList.substring(start, end);
+            macAddress.trim();
+            if (macAddress.length() > 0)
+            {
+                macStorage.saveMacAddress(macAddress);
+            }
+            start = end + 1;
+        }
     }
 
     void RemoteControlState::handleClearDisplay()
     {
-        displayUtils->clearDisplay();
+        displayUtils.clearDisplay();
     }
 
     void RemoteControlState::handleDisplayMessage(const String &message)
     {
-        displayUtils->displayMessage(message);
+        displayUtils.displayMessage(message);
     }
 
     void RemoteControlState::handleNewTerminalDisplay(const String &message)
     {
-        displayUtils->newTerminalDisplay(message);
+        displayUtils.newTerminalDisplay(message);
     }
 
     void RemoteControlState::handleAddToTerminalDisplay(const String &message)
     {
-        displayUtils->addToTerminalDisplay(message);
+        displayUtils.addToTerminalDisplay(message);
     }
 
     void RemoteControlState::handlePrintln(const String &message)
     {
-        displayUtils->println(message);
+        displayUtils.println(message);
     }
 
     void RemoteControlState::handlePrint(const String &message)
     {
-        displayUtils->print(message);
+        displayUtils.print(message);
     }
 
-    void RemoteControlState::handleSetCursor(const char *data)
+    // The arguments below have been decoded and range-checked by RemoteService
+
+    void RemoteControlState::handleSetCursor(const CursorArgs &args)
     {
-        int x, y;
-        if (sscanf(data, "%d,%d", &x, &y) == 2)
-        {
-            displayUtils->setCursor(x, y);
-        }
-        else
-        {
-            displayUtils->displayMessage("Invalid SET_CURSOR data");
-        }
+        displayUtils.setCursor(args.x, args.y);
     }
 
-    void RemoteControlState::handleSetTextSize(const char *data)
+    void RemoteControlState::handleSetTextSize(const TextSizeArgs &args)
     {
-        int size;
-        if (sscanf(data, "%d", &size) == 1 && size > 0)
-        {
-            displayUtils->setTextSize(static_cast<uint8_t>(size));
-        }
-        else
-        {
-            displayUtils->displayMessage("Invalid SET_TEXT_SIZE data");
-        }
+        displayUtils.setTextSize(args.size);
     }
 
-    void RemoteControlState::handleSetTextColor(const char *data)
+    void RemoteControlState::handleSetTextColor(const ColorArgs &args)
     {
-        int color;
-        if (sscanf(data, "%d", &color) == 1)
-        {
-            displayUtils->setTextColor(static_cast<uint16_t>(color));
-        }
-        else
-        {
-            displayUtils->displayMessage("Invalid SET_TEXT_COLOR data");
-        }
+        displayUtils.setTextColor(args.color);
     }
 
-    void RemoteControlState::handleFillScreen(const char *data)
+    void RemoteControlState::handleFillScreen(const ColorArgs &args)
     {
-        int color;
-        if (sscanf(data, "%d", &color) == 1)
-        {
-            displayUtils->fillScreen(static_cast<uint16_t>(color));
-        }
-        else
-        {
-            displayUtils->displayMessage("Invalid FILL_SCREEN data");
-        }
+        displayUtils.fillScreen(args.color);
     }
 
-    void RemoteControlState::handleDrawRect(const char *data)
+    void RemoteControlState::handleDrawRect(const RectArgs &args)
     {
-        int x, y, w, h, color;
-        if (sscanf(data, "%d,%d,%d,%d,%d", &x, &y, &w, &h, &color) == 5)
-        {
-            displayUtils->drawRect(x, y, w, h, static_cast<uint16_t>(color));
-        }
-        else
-        {
-            displayUtils->displayMessage("Invalid DRAW_RECT data");
-        }
+        displayUtils.drawRect(args.x, args.y, args.w, args.h, args.color);
     }
 
-    void RemoteControlState::handleFillRect(const char *data)
+    void RemoteControlState::handleFillRect(const RectArgs &args)
     {
-        int x, y, w, h, color;
-        if (sscanf(data, "%d,%d,%d,%d,%d", &x, &y, &w, &h, &color) == 5)
-        {
-            displayUtils->fillRect(x, y, w, h, static_cast<uint16_t>(color));
-        }
-        else
-        {
-            displayUtils->displayMessage("Invalid FILL_RECT data");
-        }
+        displayUtils.fillRect(args.x, args.y, args.w, args.h, args.color);
     }
 
-    void RemoteControlState::handleBeginPlot(const char *data)
+    void RemoteControlState::handleBeginPlot(const BeginPlotArgs &args)
     {
-        int minX, maxX, minY, maxY;
-        char xTitle[50], yTitle[50];
-        if (sscanf(data, "%d,%d,%d,%d,%49[^,],%49[^,]", &minX, &maxX, &minY, &maxY, xTitle, yTitle) == 6)
-        {
-            displayUtils->beginPlot(String(xTitle), String(yTitle), minX, maxX, minY, maxY);
-        }
-        else
-        {
-            displayUtils->displayMessage("Invalid BEGIN_PLOT data");
-        }
+        displayUtils.beginPlot(String(args.xTitle), String(args.yTitle), args.minX, args.maxX,
+                               args.minY, args.maxY);
     }
 
-    void RemoteControlState::handlePlotPoint(const char *data)
+    void RemoteControlState::handlePlotPoint(const PlotPointArgs &args)
     {
-        int xValue, yValue, color;
-        if (sscanf(data, "%d,%d, %d", &xValue, &yValue, &color) == 3)
-        {
-            displayUtils->plotPoint(xValue, yValue, static_cast<uint16_t>(color));
-        }
-        else
-        {
-            displayUtils->displayMessage("Invalid PLOT_POINT data");
-        }
+        displayUtils.plotPoint(args.x, args.y, args.color);
+    }
+
+    void RemoteControlState::handleBlitRow(int16_t x, int16_t y, const uint16_t *pixels, int16_t w)
+    {
+        displayUtils.drawBitmap(x, y, pixels, w, 1);
     }
 
 } // namespace NuggetsInc
@@ -1,22 +1,62 @@
 #include "RemoteService.h"
 #include "RemoteControlState.h"
 #include "DisplayUtils.h"
+#include "Application.h"
 #include "Utils/TimeUtils.h"
+#include "Diagnostics/Profiler.h"
+#include "Diagnostics/LatencyProbe.h"
 #include <WiFi.h>
-#include <esp_wifi.h>
 #include <esp_wifi_types.h>
 #include <cstring>
 
 namespace NuggetsInc {
 using namespace NuggetsInc; // For TimeUtils functions
 
-RemoteService* RemoteService::activeInstance_ = nullptr;
+namespace {
 
-RemoteService::RemoteService() : isPeerAdded_(false), selfMAC_(nullptr) {
+const uint8_t BROADCAST_MAC[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// sendBatch() towards a peer that cannot take CMD_BATCH
+struct UnbatchedSend {
+    RemoteService* service;
+    bool allSent;
+};
+
+void sendUnbatched(uint8_t commandID, const char* data, size_t length, bool typed,
+                   void* context) {
+    UnbatchedSend* send = static_cast<UnbatchedSend*>(context);
+    bool sent;
+    if (typed) {
+        DisplayArgs args;
+        sent = DisplayCodec::decode(commandID, (const uint8_t*)data, length, args) &&
+               send->service->sendDisplayCommand(commandID, args);
+    } else {
+        sent = send->service->sendCommand(commandID, data);
+    }
+    if (!sent) {
+        send->allSent = false;
+    }
+}
+
+} // namespace
+
+RemoteService::RemoteService()
+    : selfMAC_(nullptr), isPeerAdded_(false), srttUs_(0), rttvarUs_(0),
+      rtoMs_(INITIAL_RTO_MS), retransmitTimer_(TimerService::INVALID_TIMER), retransmitDueMs_(0),
+      polling_(false), peerCredit_(WINDOW_SIZE), windowClosed_(false), creditBound_(false), nextTransferID_(0), blitDstX_(0), blitDstY_(0), blitRegionCount_(0), blitNextRegion_(0),
+      channel_(EspNowManager::HOME_CHANNEL), pendingChannel_(0), channelTimer_(TimerService::INVALID_TIMER),
+      surveyTimer_(TimerService::INVALID_TIMER), switchedAtMs_(0), lastHeardMs_(0),
+      heardSinceSwitch_(false) {
     memset(targetMAC_, 0, sizeof(targetMAC_));
+    memset(&blitImage_, 0, sizeof(blitImage_));
+    memset(fragmentedSends_, 0, sizeof(fragmentedSends_));
     selfMAC_ = new uint8_t[6];
     memset(selfMAC_, 0, 6);
-    activeInstance_ = this;
+    memset(outgoing_, 0, sizeof(outgoing_));
+    memset(laneStats_, 0, sizeof(laneStats_));
+    memset(passedOver_, 0, sizeof(passedOver_));
+    memset(&stats_, 0, sizeof(stats_));
+    memset(&routingStats_, 0, sizeof(routingStats_));
 }
 
 bool RemoteService::begin(const uint8_t* targetMac) {
@@ -24,49 +64,35 @@ bool RemoteService::begin(const uint8_t* targetMac) {
     
     // Copy target MAC
     memcpy(targetMAC_, targetMac, 6);
+    WireFormat::beginMessageIDs();
+    nextTransferID_ = (uint16_t)millis();
 
     // Set sender MAC
     String selfMac = WiFi.macAddress();
     stringToMac(selfMac, selfMAC_);
-    
-    // Initialize WiFi in station mode
-    WiFi.mode(WIFI_STA);
-    WiFi.disconnect();
-    delay(80);
-    
-    // Set WiFi channel to 1 for ESP-NOW
-    WiFi.setSleep(false);
-    esp_wifi_set_promiscuous(true);
-    esp_wifi_set_channel(1, WIFI_SECOND_CHAN_NONE);
-    esp_wifi_set_promiscuous(false);
-    
-    // Initialize ESP-NOW
-    if (esp_now_init() != ESP_OK) {
-        Serial.println("ESP-NOW initialization failed");
+
+    // The radio is brought up only the first time; after that this just
+    // wakes the modem
+    EspNowManager& radio = EspNowManager::getInstance();
+    EspNowManager::Subscriber subscriber = {onFrameReceived, onFrameSent, onPromiscuousFrame, this};
+    if (!radio.subscribe(subscriber)) {
         return false;
     }
-    
-    // Register callbacks
-    esp_now_register_send_cb(onDataSentCallback);
-    esp_now_register_recv_cb(onDataRecvCallback);
-    
+    // Wherever the mesh was left, which the peers will still be on
+    channel_ = radio.getChannel();
+    lastHeardMs_ = millis();
+
     // Add target as peer
-    if (!esp_now_is_peer_exist(targetMAC_)) {
-        esp_now_peer_info_t peerInfo = {};
-        memcpy(peerInfo.peer_addr, targetMAC_, 6);
-        peerInfo.channel = 1;
-        peerInfo.encrypt = false;
-        
-        if (esp_now_add_peer(&peerInfo) == ESP_OK) {
-            isPeerAdded_ = true;
-        } else {
-            Serial.println("Failed to add target peer");
-            return false;
-        }
-    } else {
-        isPeerAdded_ = true;
-        Serial.println("Target peer already exists");
+    if (!ensurePeer(targetMAC_)) {
+        Serial.println("Failed to add target peer");
+        return false;
     }
+    isPeerAdded_ = true;
+
+    // Tell the neighbours we are here, then keep them up to date
+    TimerService::Job announce = {"remote.announce", ANNOUNCE_INTERVAL_MS, ANNOUNCE_SLACK_MS, 0};
+    TimerService::getInstance().schedulePeriodic(announce, onAnnounceDue, this);
+    announceRoutes();
 
     return true;
 }
@@ -77,127 +103,1205 @@ bool RemoteService::sendCommand(uint8_t commandID, const char* data, uint32_t ti
         return false;
     }
     
-    struct_message message;
-    memset(&message, 0, sizeof(message));
-    message.messageID = (uint32_t)millis();
-    
-    // Set sender MAC (this Remote)
-    memcpy(message.SenderMac, selfMAC_, 6);
-    
-    strcpy(message.messageType, "cmd");
-    message.commandID = commandID;
-    
-    if (data) {
-        strncpy(message.data, data, sizeof(message.data) - 1);
-        message.data[sizeof(message.data) - 1] = '\0';
+    if (data != nullptr && strlen(data) > maxPayload()) {
+        return sendPayload(commandID, (const uint8_t*)data, strlen(data), false, nullptr,
+                           nullptr, timeoutMs);
+    }
+    WireMessage message;
+    WireFormat::initCommand(message, 0, commandID, data);
+    return queueCommand(message, timeoutMs, nullptr, nullptr);
+}
+
+bool RemoteService::sendCommandNonBlocking(uint8_t commandID, const char* data,
+                                           SendCallback onComplete, void* context) {
+    if (!isPeerAdded_) {
+        Serial.println("Cannot send: Target peer not connected");
+        return false;
+    }
+
+    if (data != nullptr && strlen(data) > maxPayload()) {
+        return sendPayload(commandID, (const uint8_t*)data, strlen(data), false, onComplete,
+                           context);
+    }
+    WireMessage message;
+    WireFormat::initCommand(message, 0, commandID, data);
+    return queueCommand(message, DEFAULT_TIMEOUT_MS, onComplete, context);
+}
+
+bool RemoteService::sendPayload(uint8_t commandID, const uint8_t* data, size_t length, bool typed,
+                                SendCallback onComplete, void* context, uint32_t timeoutMs) {
+    if (!isPeerAdded_) {
+        Serial.println("Cannot send: Target peer not connected");
+        return false;
+    }
+    WireMessage message;
+    if (length <= maxPayload()) {
+        WireFormat::initCommand(message, 0, commandID, data, length);
+        message.typed = typed;
+        return queueCommand(message, timeoutMs, onComplete, context);
+    }
+
+    uint8_t count = Fragmenter::count(length);
+    if (count == 0) {
+        Serial.printf("Cannot send command 0x%02X: %u bytes is too large\n", commandID,
+                      (unsigned)length);
+        return false;
+    }
+    if (WireFormat::peerVersion(targetMAC_) != WIRE_COMPACT ||
+        maxPayload() < Fragmenter::MAX_FRAGMENT_SIZE) {
+        Serial.println("Cannot fragment: peer or route does not speak the compact format");
+        return false;
+    }
+
+    // All the fragments or none, so the peer is never left with half a message
+    FragmentedSend* send = nullptr;
+    for (uint8_t i = 0; i < MAX_FRAGMENTED_SENDS && send == nullptr; i++) {
+        send = fragmentedSends_[i].used ? nullptr : &fragmentedSends_[i];
+    }
+    uint8_t freeSlots = 0;
+    for (uint8_t i = 0; i < QUEUE_SIZE; i++) {
+        if (outgoing_[i].status == Outgoing::FREE) {
+            freeSlots++;
+        }
+    }
+    uint8_t reserved = laneFor(commandID) == LANE_CONTROL ? 0 : CONTROL_RESERVED_SLOTS;
+    if (send == nullptr || freeSlots < count + reserved) {
+        stats_.rejected++;
+        laneStats_[laneFor(commandID)].rejected++;
+        Serial.println("Cannot send: delivery queue full");
+        return false;
+    }
+
+    send->used = true;
+    send->failed = false;
+    send->remaining = count;
+    send->firstMessageID = WireFormat::lastMessageID() + 1;
+    send->onComplete = onComplete;
+    send->context = context;
+    send->service = this;
+    uint16_t transferID = nextTransferID_++;
+    stats_.fragmented++;
+
+    // Queued together and sent as the window allows, rather than one
+    // fragment per round trip
+    bool wasPolling = polling_;
+    polling_ = true;
+    for (uint8_t index = 0; index < count; index++) {
+        WireFormat::initCommand(message, 0, CMD_FRAGMENT);
+        message.payloadLength = (uint16_t)Fragmenter::write(
+            transferID, commandID, typed, data, length, index, (uint8_t*)message.payload,
+            WIRE_MAX_PAYLOAD);
+        message.typed = true;
+        queueCommand(message, timeoutMs, onFragmentDone, send);
+    }
+    polling_ = wasPolling;
+    if (!polling_) {
+        poll();
+    }
+    return true;
+}
+
+void RemoteService::onFragmentDone(uint32_t, bool delivered, void* context) {
+    FragmentedSend* send = static_cast<FragmentedSend*>(context);
+    send->failed = send->failed || !delivered;
+    if (--send->remaining > 0) {
+        return;
+    }
+    send->used = false;
+    if (send->failed) {
+        Serial.printf("Fragmented command (id %lu) not delivered\n",
+                      (unsigned long)send->firstMessageID);
+    }
+    if (send->onComplete) {
+        send->onComplete(send->firstMessageID, !send->failed, send->context);
+    }
+}
+
+bool RemoteService::sendDisplayCommand(uint8_t commandID, const DisplayArgs& args) {
+    if (!isPeerAdded_) {
+        Serial.println("Cannot send: Target peer not connected");
+        return false;
+    }
+
+    // Encoded straight into the message, not a second frame-sized buffer
+    WireMessage message;
+    WireFormat::initCommand(message, 0, commandID);
+    size_t length;
+    if (WireFormat::peerVersion(targetMAC_) == WIRE_COMPACT) {
+        length = DisplayCodec::encode(commandID, args, (uint8_t*)message.payload,
+                                      WIRE_MAX_PAYLOAD);
+        message.typed = true;
     } else {
-        message.data[0] = '\0';
+        length = DisplayCodec::formatText(commandID, args, message.payload,
+                                          sizeof(message.payload));
     }
-    
-    // Clear routing fields
-    memset(message.destinationMac, 0, sizeof(message.destinationMac));
-    message.path[0] = '\0';
-    
-    // Send message
-    esp_err_t result = esp_now_send(targetMAC_, (uint8_t*)&message, sizeof(message));
-    if (result == ESP_OK) {
+    if (length == 0) {
+        Serial.printf("Cannot encode display command 0x%02X\n", commandID);
+        return false;
+    }
+    message.payloadLength = (uint16_t)length;
+    return queueCommand(message, DEFAULT_TIMEOUT_MS, nullptr, nullptr);
+}
+
+bool RemoteService::queueCommand(const WireMessage& message, uint32_t timeoutMs,
+                                 SendCallback onComplete, void* context) {
+    // Fragments travel with the command they carry
+    Lane lane = laneFor(message.commandID == CMD_FRAGMENT
+                            ? Fragmenter::commandOf((const uint8_t*)message.payload,
+                                                    message.payloadLength)
+                            : message.commandID);
+    Outgoing* slot = nullptr;
+    uint8_t freeSlots = 0;
+    for (uint8_t i = 0; i < QUEUE_SIZE; i++) {
+        if (outgoing_[i].status == Outgoing::FREE) {
+            slot = slot != nullptr ? slot : &outgoing_[i];
+            freeSlots++;
+        }
+    }
+    // Until the window opens, the newest plot point is all the peer will want
+    if (message.commandID == CMD_PLOT_POINT && onComplete == nullptr && windowClosed_ &&
+        coalesce(message)) {
+        stats_.coalesced++;
         return true;
-    } else {
+    }
+    // The last few slots are for input, however much display traffic waits
+    if (slot == nullptr || (lane != LANE_CONTROL && freeSlots <= CONTROL_RESERVED_SLOTS)) {
+        stats_.rejected++;
+        laneStats_[lane].rejected++;
+        Serial.println("Cannot send: delivery queue full");
+        return false;
+    }
+
+    slot->message = message;
+    slot->lane = lane;
+    slot->message.messageID = nextMessageID();
+    slot->attempts = 0;
+    slot->queuedMs = millis();
+    slot->timeoutMs = timeoutMs;
+    slot->onComplete = onComplete;
+    slot->context = context;
+    slot->status = Outgoing::QUEUED;
+    stats_.queued++;
+    laneStats_[lane].queued++;
+
+    // Goes out straight away when the window has room; inside poll() the
+    // window is filled once the callbacks have run
+    if (!polling_) {
+        poll();
+    }
+    return true;
+}
+
+void RemoteService::poll() {
+    polling_ = true;
+    drainReceived();
+    if (survey_.active()) {
+        // The radio is away from the peers' channel; pick up where we left
+        // off once the survey is done
+        polling_ = false;
+        return;
+    }
+    feedBlit();
+
+    uint32_t nowMs = millis();
+    uint8_t inFlight = 0;
+    for (uint8_t i = 0; i < QUEUE_SIZE; i++) {
+        Outgoing& slot = outgoing_[i];
+        if (slot.status == Outgoing::ACKED) {
+            // Karn's rule: an ack for a retransmitted frame could belong to
+            // any of the copies, so it says nothing about the round trip
+            if (slot.attempts == 1) {
+                sampleRtt(slot.ackUs - slot.sentUs);
+                routes_.recordRtt(targetMAC_, slot.ackUs - slot.sentUs);
+                links_.recordRtt(targetMAC_, slot.ackUs - slot.sentUs);
+            }
+            complete(slot, true);
+        } else if (slot.status == Outgoing::IN_FLIGHT) {
+            if ((int32_t)(nowMs - slot.retransmitAtMs) < 0) {
+                inFlight++;
+            } else if (slot.attempts >= MAX_ATTEMPTS || nowMs - slot.queuedMs >= slot.timeoutMs) {
+                complete(slot, false);
+            } else {
+                stats_.retransmissions++;
+                if (slot.attempts == ROUTE_FAILURE_ATTEMPTS) {
+                    // Whatever path we had is not getting through; go direct
+                    // until the next announcement or frame says otherwise
+                    routes_.forget(targetMAC_);
+                }
+                transmit(slot);
+                inFlight++;
+            }
+        }
+    }
+
+    // Fill the window, highest lane first, as far as the target's credit goes
+    uint8_t window = creditWindow();
+    while (inFlight < window) {
+        Outgoing* next = nextToSend(inFlight);
+        if (next == nullptr) {
+            break;
+        }
+        LaneStats& lane = laneStats_[next->lane];
+        uint32_t waitMs = nowMs - next->queuedMs;
+        lane.sent++;
+        lane.waitMsTotal += waitMs;
+        lane.waitMsMax = waitMs > lane.waitMsMax ? waitMs : lane.waitMsMax;
+        transmit(*next);
+        inFlight++;
+    }
+    // Whatever is left waits for acks
+    bool closed = false;
+    for (uint8_t i = 0; i < QUEUE_SIZE && !closed; i++) {
+        closed = outgoing_[i].status == Outgoing::QUEUED;
+    }
+    bool creditBound = inFlight >= window && window < WINDOW_SIZE;
+    if (closed && creditBound && !(windowClosed_ && creditBound_)) {
+        stats_.creditStalls++;
+    }
+    windowClosed_ = closed;
+    creditBound_ = creditBound;
+
+    polling_ = false;
+    scheduleRetransmit();
+}
+
+RemoteService::Outgoing* RemoteService::nextToSend(uint8_t inFlight) {
+    // The oldest command of each lane
+    Outgoing* heads[LANE_COUNT] = {};
+    for (uint8_t i = 0; i < QUEUE_SIZE; i++) {
+        Outgoing& slot = outgoing_[i];
+        Outgoing*& head = heads[slot.lane];
+        if (slot.status == Outgoing::QUEUED &&
+            (head == nullptr || (int32_t)(slot.message.messageID - head->message.messageID) < 0)) {
+            head = &slot;
+        }
+    }
+
+    // Strict priority, unless a lower lane has waited its turn long enough
+    int8_t lane = -1;
+    bool promoted = false;
+    for (uint8_t l = 0; l < LANE_COUNT; l++) {
+        if (heads[l] == nullptr) {
+            passedOver_[l] = 0;
+        } else if (lane < 0) {
+            lane = l;
+        } else if (passedOver_[l] >= STARVATION_LIMIT) {
+            lane = l;
+            promoted = true;
+            break;
+        }
+    }
+    if (lane < 0 || (lane != LANE_CONTROL && inFlight >= WINDOW_SIZE - CONTROL_RESERVED_WINDOW)) {
+        return nullptr;
+    }
+
+    for (uint8_t l = 0; l < LANE_COUNT; l++) {
+        if (heads[l] != nullptr && l != lane && passedOver_[l] < 255) {
+            passedOver_[l]++;
+        }
+    }
+    passedOver_[lane] = 0;
+    if (promoted) {
+        laneStats_[lane].promoted++;
+    }
+    return heads[lane];
+}
+
+uint8_t RemoteService::creditWindow() const {
+    if (peerCredit_ == 0) {
+        return 1;
+    }
+    return peerCredit_ < WINDOW_SIZE ? peerCredit_ : WINDOW_SIZE;
+}
+
+uint8_t RemoteService::rxCredit(const uint8_t senderMac[6]) const {
+    uint32_t available = rxQueue_.available(WireFormat::peerFrameSize(senderMac));
+    return available > RX_CREDIT_RESERVE ? available - RX_CREDIT_RESERVE : 0;
+}
+
+bool RemoteService::coalesce(const WireMessage& message) {
+    // Only the newest bulk command, so no point jumps ahead of a CMD_BEGIN_PLOT
+    Outgoing* newest = nullptr;
+    for (uint8_t i = 0; i < QUEUE_SIZE; i++) {
+        Outgoing& slot = outgoing_[i];
+        if (slot.status == Outgoing::QUEUED && slot.lane == LANE_BULK &&
+            (newest == nullptr ||
+             (int32_t)(slot.message.messageID - newest->message.messageID) > 0)) {
+            newest = &slot;
+        }
+    }
+    if (newest == nullptr || newest->message.commandID != CMD_PLOT_POINT ||
+        newest->onComplete != nullptr) {
+        return false;
+    }
+    uint32_t messageID = newest->message.messageID;
+    newest->message = message;
+    newest->message.messageID = messageID;
+    newest->queuedMs = millis();
+    return true;
+}
+
+RemoteService::Lane RemoteService::laneFor(uint8_t commandID) {
+    switch (commandID) {
+        case CMD_MOVE_UP:
+        case CMD_MOVE_DOWN:
+        case CMD_MOVE_LEFT:
+        case CMD_MOVE_RIGHT:
+        case CMD_SELECT:
+        case CMD_BACK:
+        case CMD_BOOOP:
+        case CMD_SYNC_NODES:
+        case CMD_SET_CHANNEL:
+            return LANE_CONTROL;
+        // A plot is drawn point by point, so its start stays with the points
+        case CMD_BEGIN_PLOT:
+        case CMD_PLOT_POINT:
+        case CMD_BLIT:
+        case CMD_BLIT_PALETTE:
+            return LANE_BULK;
+        default:
+            return LANE_INTERACTIVE;
+    }
+}
+
+void RemoteService::transmit(Outgoing& slot) {
+    slot.attempts++;
+    slot.retransmitAtMs = millis() + backedOffRto(slot.attempts);
+    slot.sentUs = (uint32_t)micros();
+    slot.status = Outgoing::IN_FLIGHT;
+
+    // A frame ESP-NOW would not take is retried like a lost one
+    esp_err_t result = sendTo(targetMAC_, slot.message);
+#ifdef NUGGETS_BENCHMARKS
+    if (slot.attempts == 1) {
+        LatencyProbe::getInstance().commandSent(slot.message.messageID, result == ESP_OK);
+    }
+#endif
+    if (result != ESP_OK) {
         Serial.printf("Failed to send command: %s\n", esp_err_to_name(result));
+    }
+}
+
+void RemoteService::complete(Outgoing& slot, bool delivered) {
+    SendCallback onComplete = slot.onComplete;
+    void* context = slot.context;
+    uint32_t messageID = slot.message.messageID;
+    if (delivered) {
+        stats_.delivered++;
+        laneStats_[slot.lane].delivered++;
+    } else {
+        stats_.failed++;
+        laneStats_[slot.lane].failed++;
+        Serial.printf("Command 0x%02X (id %lu) not acknowledged after %u attempts\n",
+                      slot.message.commandID, (unsigned long)messageID, slot.attempts);
+    }
+
+    slot.status = Outgoing::FREE;
+
+    // Last, since the callback may queue the next command into this slot
+    if (onComplete) {
+        onComplete(messageID, delivered, context);
+    }
+}
+
+void RemoteService::handleAck(uint32_t messageID, uint32_t receivedUs) {
+    for (uint8_t i = 0; i < QUEUE_SIZE; i++) {
+        Outgoing& slot = outgoing_[i];
+        if (slot.status == Outgoing::IN_FLIGHT && slot.message.messageID == messageID) {
+            slot.status = Outgoing::ACKED;
+            slot.ackUs = receivedUs;
+            break;
+        }
+    }
+}
+
+void RemoteService::sampleRtt(uint32_t rttUs) {
+    // RFC 6298 with alpha 1/8 and beta 1/4
+    if (srttUs_ == 0) {
+        srttUs_ = rttUs > 0 ? rttUs : 1;
+        rttvarUs_ = rttUs / 2;
+    } else {
+        uint32_t deviation = srttUs_ > rttUs ? srttUs_ - rttUs : rttUs - srttUs_;
+        rttvarUs_ = (3 * rttvarUs_ + deviation) / 4;
+        srttUs_ = (7 * srttUs_ + rttUs) / 8;
+    }
+
+    uint32_t rtoMs = (srttUs_ + 4 * rttvarUs_ + 999) / 1000;
+    if (rtoMs < MIN_RTO_MS) {
+        rtoMs = MIN_RTO_MS;
+    } else if (rtoMs > MAX_RTO_MS) {
+        rtoMs = MAX_RTO_MS;
+    }
+    rtoMs_ = rtoMs;
+}
+
+uint32_t RemoteService::backedOffRto(uint8_t attempts) const {
+    uint32_t rto = rtoMs_;
+    for (uint8_t i = 1; i < attempts && rto < MAX_RTO_MS; i++) {
+        rto *= 2;
+    }
+    return rto < MAX_RTO_MS ? rto : MAX_RTO_MS;
+}
+
+void RemoteService::scheduleRetransmit() {
+    bool pending = false;
+    uint32_t dueMs = 0;
+    for (uint8_t i = 0; i < QUEUE_SIZE; i++) {
+        const Outgoing& slot = outgoing_[i];
+        if (slot.status == Outgoing::IN_FLIGHT &&
+            (!pending || (int32_t)(slot.retransmitAtMs - dueMs) < 0)) {
+            dueMs = slot.retransmitAtMs;
+            pending = true;
+        }
+    }
+
+    TimerService& timers = TimerService::getInstance();
+    if (retransmitTimer_ != TimerService::INVALID_TIMER) {
+        if (pending && dueMs == retransmitDueMs_) {
+            return;
+        }
+        timers.cancel(retransmitTimer_);
+        retransmitTimer_ = TimerService::INVALID_TIMER;
+    }
+    if (pending) {
+        int32_t delayMs = (int32_t)(dueMs - millis());
+        retransmitTimer_ = timers.scheduleOnce(delayMs > 0 ? delayMs : 0, onRetransmitDue, this);
+        retransmitDueMs_ = dueMs;
+    }
+}
+
+void RemoteService::onRetransmitDue(void* context) {
+    RemoteService* service = static_cast<RemoteService*>(context);
+    service->retransmitTimer_ = TimerService::INVALID_TIMER;
+    service->poll();
+}
+
+RemoteService::DeliveryStats RemoteService::getDeliveryStats() const {
+    DeliveryStats stats = stats_;
+    stats.credit = peerCredit_;
+    stats.srttUs = srttUs_;
+    stats.rtoMs = rtoMs_;
+    return stats;
+}
+
+bool RemoteService::sendBatch(const CommandBatch& batch) {
+    if (!isPeerAdded_) {
+        Serial.println("Cannot send: Target peer not connected");
+        return false;
+    }
+    if (batch.empty()) {
+        return true;
+    }
+
+    if (WireFormat::peerVersion(targetMAC_) != WIRE_COMPACT) {
+        UnbatchedSend send = {this, true};
+        CommandBatch::forEach(batch.data(), batch.size(), sendUnbatched, &send);
+        return send.allSent;
+    }
+
+    // In fragments if the link only takes v1 frames and the batch is bigger
+    return sendPayload(CMD_BATCH, batch.data(), batch.size(), false);
+}
+
+bool RemoteService::sendBlit(const BlitImage& image, int16_t dstX, int16_t dstY, bool delta) {
+    if (!isPeerAdded_) {
+        Serial.println("Cannot send: Target peer not connected");
+        return false;
+    }
+    if (WireFormat::peerVersion(targetMAC_) != WIRE_COMPACT) {
+        Serial.println("Cannot blit: peer does not speak the compact format");
+        return false;
+    }
+    if (isBlitting()) {
+        Serial.println("Cannot blit: previous image still streaming");
+        return false;
+    }
+
+    blitImage_ = image;
+    blitDstX_ = dstX;
+    blitDstY_ = dstY;
+    blitRegionCount_ = 0;
+    blitNextRegion_ = 0;
+    if (delta) {
+        blitTiles_.diff(image, queueBlitRegion, this);
+    } else {
+        // The peer's screen no longer matches what the tiles remember
+        blitTiles_.reset();
+        queueBlitRegion(0, 0, image.width, image.height, this);
+    }
+
+    if (!polling_) {
+        poll();
+    }
+    return true;
+}
+
+bool RemoteService::sendBlitPalette(const uint16_t* colors, uint8_t first, uint16_t count) {
+    if (first + count > 256) {
+        return false;
+    }
+    if (!isPeerAdded_) {
+        Serial.println("Cannot send: Target peer not connected");
+        return false;
+    }
+    if (WireFormat::peerVersion(targetMAC_) != WIRE_COMPACT) {
+        Serial.println("Cannot blit: peer does not speak the compact format");
+        return false;
+    }
+
+    // All the chunks or none, so the peer never draws with half a palette
+    const uint16_t perFrame = (maxPayload() - 1) / 2;
+    uint16_t chunks = (count + perFrame - 1) / perFrame;
+    uint8_t freeSlots = 0;
+    for (uint8_t i = 0; i < QUEUE_SIZE; i++) {
+        if (outgoing_[i].status == Outgoing::FREE) {
+            freeSlots++;
+        }
+    }
+    uint8_t reserved = laneFor(CMD_BLIT_PALETTE) == LANE_CONTROL ? 0 : CONTROL_RESERVED_SLOTS;
+    if (freeSlots < chunks + reserved) {
+        stats_.rejected++;
+        laneStats_[laneFor(CMD_BLIT_PALETTE)].rejected++;
+        Serial.println("Cannot send: delivery queue full");
+        return false;
+    }
+
+    bool wasPolling = polling_;
+    polling_ = true;
+    uint16_t sent = 0;
+    while (sent < count) {
+        uint16_t chunk = count - sent < perFrame ? count - sent : perFrame;
+        WireMessage message;
+        WireFormat::initCommand(message, 0, CMD_BLIT_PALETTE);
+        uint8_t* payload = (uint8_t*)message.payload;
+        payload[0] = first + sent;
+        for (uint16_t i = 0; i < chunk; i++) {
+            payload[1 + 2 * i] = colors[sent + i] & 0xFF;
+            payload[2 + 2 * i] = colors[sent + i] >> 8;
+        }
+        message.payloadLength = 1 + 2 * chunk;
+        message.typed = true;
+        queueCommand(message, DEFAULT_TIMEOUT_MS, nullptr, nullptr);
+        sent += chunk;
+    }
+    polling_ = wasPolling;
+    if (!polling_) {
+        poll();
+    }
+    return true;
+}
+
+bool RemoteService::isBlitting() const {
+    return !blitEncoder_.done() || blitNextRegion_ < blitRegionCount_;
+}
+
+void RemoteService::queueBlitRegion(int16_t x, int16_t y, int16_t w, int16_t h, void* context) {
+    RemoteService* service = static_cast<RemoteService*>(context);
+    if (service->blitRegionCount_ < MAX_BLIT_REGIONS) {
+        BlitRegion& region = service->blitRegions_[service->blitRegionCount_++];
+        region.x = x;
+        region.y = y;
+        region.w = w;
+        region.h = h;
+        return;
+    }
+
+    // Out of regions: grow the last one to cover this one too
+    BlitRegion& last = service->blitRegions_[MAX_BLIT_REGIONS - 1];
+    int16_t right = last.x + last.w > x + w ? last.x + last.w : x + w;
+    int16_t bottom = last.y + last.h > y + h ? last.y + last.h : y + h;
+    last.x = last.x < x ? last.x : x;
+    last.y = last.y < y ? last.y : y;
+    last.w = right - last.x;
+    last.h = bottom - last.y;
+}
+
+void RemoteService::feedBlit() {
+    uint8_t freeSlots = 0;
+    for (uint8_t i = 0; i < QUEUE_SIZE; i++) {
+        if (outgoing_[i].status == Outgoing::FREE) {
+            freeSlots++;
+        }
+    }
+
+    while (freeSlots > BLIT_RESERVED_SLOTS) {
+        if (blitEncoder_.done()) {
+            if (blitNextRegion_ >= blitRegionCount_) {
+                return;
+            }
+            const BlitRegion& region = blitRegions_[blitNextRegion_++];
+            blitEncoder_.begin(blitImage_, region.x, region.y, region.w, region.h,
+                               blitDstX_ + region.x, blitDstY_ + region.y);
+            continue;
+        }
+
+        // Encoded straight into the message, not a second frame-sized buffer
+        WireMessage message;
+        WireFormat::initCommand(message, 0, CMD_BLIT);
+        size_t length = blitEncoder_.next((uint8_t*)message.payload, maxPayload());
+        message.payloadLength = (uint16_t)length;
+        message.typed = true;
+        if (length == 0 || !queueCommand(message, DEFAULT_TIMEOUT_MS, onBlitFragmentDone, this)) {
+            return;
+        }
+        freeSlots--;
+    }
+}
+
+void RemoteService::onBlitFragmentDone(uint32_t, bool delivered, void* context) {
+    if (!delivered) {
+        // Some tile on the peer's screen is stale; the next delta sends them all
+        static_cast<RemoteService*>(context)->blitTiles_.reset();
+    }
+}
+
+esp_err_t RemoteService::sendFrame(const uint8_t* peerMac, WireMessage& msg) {
+    // Peers we have not heard from yet get the legacy format, which every
+    // firmware understands and which tells newer ones we speak the compact one
+    WireVersion version = WireFormat::peerVersion(peerMac);
+    if (version == WIRE_UNKNOWN) {
+        version = WIRE_LEGACY;
+    }
+
+    uint8_t frame[WireFormat::MAX_FRAME_SIZE];
+    size_t length;
+    if (version == WIRE_COMPACT) {
+        // Until the frame sizes are settled, every frame to the peer can carry ours
+        WireFormat::advertiseFrameSize(peerMac, msg);
+    }
+    length = WireFormat::encode(msg, version, selfMAC_, frame, sizeof(frame));
+    if (length == 0 || length > WireFormat::peerFrameSize(peerMac)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return esp_now_send(peerMac, frame, length);
+}
+
+uint16_t RemoteService::maxPayload() const {
+    uint8_t nextHop[6];
+    uint8_t hops;
+    if (!routes_.nextHop(targetMAC_, millis(), nextHop, hops) || hops <= 1) {
+        return WireFormat::maxPayload(targetMAC_);
+    }
+    if (WireFormat::peerVersion(nextHop) != WIRE_COMPACT) {
+        return WireFormat::MAX_LEGACY_PAYLOAD;
+    }
+    // The links past the first hop may only take v1 frames, and the path
+    // grows at every relay
+    return WIRE_V1_PAYLOAD - WireFormat::ROUTING_SIZE - 6 * WIRE_MAX_HOPS;
+}
+
+esp_err_t RemoteService::sendTo(const uint8_t* destination, WireMessage& msg) {
+    // A retransmission may go another way than the frame before it
+    uint8_t nextHop[6];
+    uint8_t hops;
+    if (!routes_.nextHop(destination, millis(), nextHop, hops) || hops <= 1) {
+        // Re-added if relay peers evicted it, and kept recently used so they do not
+        msg.routed = false;
+        if (!ensurePeer(destination)) {
+            return ESP_ERR_ESPNOW_FULL;
+        }
+        return sendFrame(destination, msg);
+    }
+
+    msg.routed = true;
+    memcpy(msg.origin, selfMAC_, 6);
+    memcpy(msg.destination, destination, 6);
+    msg.hopCount = 0;
+    if (!ensurePeer(nextHop)) {
+        return ESP_ERR_ESPNOW_FULL;
+    }
+    return sendFrame(nextHop, msg);
+}
+
+bool RemoteService::ensurePeer(const uint8_t mac[6]) {
+    if (memcmp(mac, BROADCAST_MAC, 6) != 0) {
+        links_.track(mac);
+    }
+    return EspNowManager::getInstance().ensurePeer(mac);
+}
+
+void RemoteService::learnRoutes(const uint8_t* senderMac, const WireMessage& msg) {
+    msec32 nowMs = millis();
+    routes_.learn(senderMac, senderMac, 1, nowMs);
+    if (!msg.routed) {
+        return;
+    }
+
+    // The relays on the path, nearest last, then the origin behind them
+    for (uint8_t i = 0; i < msg.hopCount; i++) {
+        if (memcmp(msg.hops[i], selfMAC_, 6) != 0) {
+            routes_.learn(msg.hops[i], senderMac, msg.hopCount - i, nowMs);
+        }
+    }
+    if (!isZeroMac(msg.origin) && memcmp(msg.origin, selfMAC_, 6) != 0) {
+        routes_.learn(msg.origin, senderMac, msg.hopCount + 1, nowMs);
+    }
+}
+
+void RemoteService::forward(const uint8_t* senderMac, WireMessage& msg, uint32_t receivedUs) {
+    bool looped = memcmp(msg.origin, selfMAC_, 6) == 0;
+    for (uint8_t i = 0; i < msg.hopCount && !looped; i++) {
+        looped = memcmp(msg.hops[i], selfMAC_, 6) == 0;
+    }
+    if (looped) {
+        routingStats_.looped++;
+        return;
+    }
+    if (msg.hopCount >= WIRE_MAX_HOPS) {
+        routingStats_.hopLimit++;
+        return;
+    }
+
+    uint8_t nextHop[6];
+    uint8_t hops;
+    if (!routes_.nextHop(msg.destination, millis(), nextHop, hops)) {
+        routingStats_.noRoute++;
+        memcpy(nextHop, msg.destination, 6);
+    }
+    if (memcmp(nextHop, senderMac, 6) == 0) {
+        // Sending it back where it came from would only start a loop
+        routingStats_.looped++;
+        return;
+    }
+
+    memcpy(msg.hops[msg.hopCount++], selfMAC_, 6);
+    if (!ensurePeer(nextHop) || sendFrame(nextHop, msg) != ESP_OK) {
+        routingStats_.sendFailures++;
+        return;
+    }
+
+    uint32_t forwardUs = (uint32_t)micros() - receivedUs;
+    routingStats_.forwarded++;
+    routingStats_.forwardUsTotal += forwardUs;
+    if (forwardUs > routingStats_.forwardUsMax) {
+        routingStats_.forwardUsMax = forwardUs;
+    }
+
+    // A relay on the path has to move with the nodes it connects
+    if (msg.type == WIRE_CMD && msg.commandID == CMD_SET_CHANNEL) {
+        followChannelSwitch(msg);
+    }
+}
+
+void RemoteService::announceRoutes() {
+    if (survey_.active()) {
+        return;
+    }
+    // Broadcasts reach v1 nodes too
+    uint8_t payload[WIRE_V1_PAYLOAD];
+    size_t length = routes_.announcement(payload, sizeof(payload), millis());
+    broadcastCommand(CMD_RELAY_CONNECTION, payload, length);
+}
+
+void RemoteService::broadcastCommand(uint8_t commandID, const uint8_t* payload, size_t length) {
+    // Broadcast frames are not acked, so they carry message ID 0, and only
+    // firmware that speaks the compact format knows what to do with them
+    WireMessage message;
+    WireFormat::initCommand(message, 0, commandID, payload, length);
+    message.typed = true;
+    uint8_t frame[WireFormat::MAX_FRAME_SIZE];
+    size_t frameLength = WireFormat::encode(message, WIRE_COMPACT, selfMAC_, frame, sizeof(frame));
+    if (frameLength > 0) {
+        esp_now_send(BROADCAST_MAC, frame, frameLength);
+    }
+}
+
+void RemoteService::onAnnounceDue(void* context) {
+    RemoteService* service = static_cast<RemoteService*>(context);
+    if (service->channel_ != EspNowManager::HOME_CHANNEL && service->pendingChannel_ == 0 &&
+        service->channelTimer_ == TimerService::INVALID_TIMER && !service->survey_.active() &&
+        (msec32)(millis() - service->lastHeardMs_) >= CHANNEL_SILENCE_MS) {
+        // Everyone else has gone, most likely home after a restart
+        Serial.printf("Nothing heard on channel %u for %lu ms, back to channel %u\n",
+                      service->channel_, (unsigned long)CHANNEL_SILENCE_MS, EspNowManager::HOME_CHANNEL);
+        service->tuneTo(EspNowManager::HOME_CHANNEL);
+    }
+    service->announceRoutes();
+}
+
+bool RemoteService::startChannelSurvey() {
+    if (survey_.active() || pendingChannel_ != 0 ||
+        channelTimer_ != TimerService::INVALID_TIMER) {
         return false;
     }
+    uint8_t first, last;
+    EspNowManager::allowedChannels(first, last);
+
+    // Everything on the air counts towards how busy a channel is
+    EspNowManager::getInstance().setPromiscuousFilter(WIFI_PROMIS_FILTER_MASK_ALL);
+    survey_.begin(first, last, millis());
+    EspNowManager::getInstance().setChannel(first);
+    TimerService::Job dwell = {"remote.survey", SURVEY_DWELL_MS, SURVEY_DWELL_MS / 8, 0};
+    surveyTimer_ = TimerService::getInstance().schedulePeriodic(dwell, onSurveyStep, this);
+    return true;
+}
+
+void RemoteService::onSurveyStep(void* context) {
+    RemoteService* service = static_cast<RemoteService*>(context);
+    if (service->survey_.advance(millis())) {
+        EspNowManager::getInstance().setChannel(service->survey_.channel());
+    } else {
+        service->finishSurvey();
+    }
+}
+
+void RemoteService::finishSurvey() {
+    TimerService::getInstance().cancel(surveyTimer_);
+    surveyTimer_ = TimerService::INVALID_TIMER;
+    EspNowManager::getInstance().setPromiscuousFilter(WIFI_PROMIS_FILTER_MASK_MGMT);
+    EspNowManager::getInstance().setChannel(channel_);
+    poll();
 }
 
-bool RemoteService::sendCommandNonBlocking(uint8_t commandID, const char* data) {
-    return sendCommand(commandID, data, 0); 
+bool RemoteService::switchChannel(uint8_t channel) {
+    if (!isPeerAdded_) {
+        Serial.println("Cannot send: Target peer not connected");
+        return false;
+    }
+    uint8_t first, last;
+    EspNowManager::allowedChannels(first, last);
+    if (channel < first || channel > last || channel == channel_ || pendingChannel_ != 0 ||
+        channelTimer_ != TimerService::INVALID_TIMER || survey_.active()) {
+        return false;
+    }
+    if (WireFormat::peerVersion(targetMAC_) != WIRE_COMPACT) {
+        Serial.println("Cannot switch channel: peer does not speak the compact format");
+        return false;
+    }
+
+    // The target first; we follow once it has acked
+    WireMessage message;
+    WireFormat::initCommand(message, 0, CMD_SET_CHANNEL, &channel, 1);
+    message.typed = true;
+    pendingChannel_ = channel;
+    if (!queueCommand(message, DEFAULT_TIMEOUT_MS, onChannelSwitchAcked, this)) {
+        pendingChannel_ = 0;
+        return false;
+    }
+    return true;
+}
+
+void RemoteService::onChannelSwitchAcked(uint32_t, bool delivered, void* context) {
+    RemoteService* service = static_cast<RemoteService*>(context);
+    uint8_t channel = service->pendingChannel_;
+    if (!delivered) {
+        Serial.printf("Channel switch to %u not acknowledged, staying on %u\n", channel,
+                      service->channel_);
+        service->pendingChannel_ = 0;
+        return;
+    }
+
+    // Take the rest of the neighbourhood along
+    service->broadcastCommand(CMD_SET_CHANNEL, &channel, 1);
+    service->scheduleChannelSwitch(channel);
+}
+
+void RemoteService::followChannelSwitch(const WireMessage& msg) {
+    uint8_t first, last;
+    EspNowManager::allowedChannels(first, last);
+    uint8_t channel = msg.payloadLength == 1 ? (uint8_t)msg.payload[0] : 0;
+    if (!msg.typed || channel < first || channel > last) {
+        Serial.println("Ignoring invalid channel switch");
+        return;
+    }
+    if (channel == (pendingChannel_ != 0 ? pendingChannel_ : channel_) || survey_.active()) {
+        return;
+    }
+    scheduleChannelSwitch(channel);
+}
+
+void RemoteService::scheduleChannelSwitch(uint8_t channel) {
+    TimerService& timers = TimerService::getInstance();
+    if (channelTimer_ != TimerService::INVALID_TIMER) {
+        timers.cancel(channelTimer_);
+    }
+    pendingChannel_ = channel;
+    channelTimer_ = timers.scheduleOnce(CHANNEL_SWITCH_DELAY_MS, onChannelSwitchDue, this);
+}
+
+void RemoteService::onChannelSwitchDue(void* context) {
+    RemoteService* service = static_cast<RemoteService*>(context);
+    service->channelTimer_ = TimerService::INVALID_TIMER;
+    uint8_t channel = service->pendingChannel_;
+    service->pendingChannel_ = 0;
+    service->tuneTo(channel);
+
+    // Keep announcing for a while so the others hear us even if they
+    // switched a little later; see onChannelConfirmDue()
+    TimerService::Job confirm = {"remote.channelConfirm", CHANNEL_CONFIRM_INTERVAL_MS,
+                                 CHANNEL_CONFIRM_INTERVAL_MS / 4, 0};
+    service->channelTimer_ =
+        TimerService::getInstance().schedulePeriodic(confirm, onChannelConfirmDue, service);
+    service->announceRoutes();
+}
+
+void RemoteService::onChannelConfirmDue(void* context) {
+    RemoteService* service = static_cast<RemoteService*>(context);
+    if ((msec32)(millis() - service->switchedAtMs_) < CHANNEL_CONFIRM_MS) {
+        service->announceRoutes();
+        return;
+    }
+
+    TimerService::getInstance().cancel(service->channelTimer_);
+    service->channelTimer_ = TimerService::INVALID_TIMER;
+    if (!service->heardSinceSwitch_ && service->channel_ != EspNowManager::HOME_CHANNEL) {
+        Serial.printf("No peers heard on channel %u, back to channel %u\n", service->channel_,
+                      EspNowManager::HOME_CHANNEL);
+        service->tuneTo(EspNowManager::HOME_CHANNEL);
+        service->announceRoutes();
+    }
+}
+
+void RemoteService::tuneTo(uint8_t channel) {
+    if (!EspNowManager::getInstance().setChannel(channel)) {
+        return;
+    }
+    Serial.printf("ESP-NOW on channel %u\n", channel);
+    channel_ = channel;
+    switchedAtMs_ = millis();
+    heardSinceSwitch_ = false;
+}
+
+void RemoteService::reportLinks(Print& out) const {
+    out.printf("  channel %u", channel_);
+    if (pendingChannel_ != 0) {
+        out.printf(", switching to %u", pendingChannel_);
+    }
+    out.println();
+    links_.report(out);
+
+    if (!survey_.complete()) {
+        return;
+    }
+    out.println("  survey (busy per mille, frames, loudest dBm):");
+    for (uint8_t channel = survey_.first(); channel <= survey_.last(); channel++) {
+        ChannelSurvey::Result result = survey_.result(channel);
+        out.printf("    %2u: %4u  %5lu", channel, survey_.busyPermille(channel),
+                   (unsigned long)result.frames);
+        if (result.frames > 0) {
+            out.printf("  %d", result.rssiMax);
+        }
+        out.println(channel == channel_ ? "  <- current" : "");
+    }
+    out.printf("  quietest: %u\n", survey_.recommend(channel_));
+}
+
+void RemoteService::reportLanes(Print& out) const {
+    static const char* const NAMES[LANE_COUNT] = {"control", "interactive", "bulk"};
+    out.println("  lanes:");
+    for (uint8_t l = 0; l < LANE_COUNT; l++) {
+        const LaneStats& lane = laneStats_[l];
+        out.printf("    %-12s queued %lu  delivered %lu  failed %lu  rejected %lu  promoted %lu"
+                   "  wait avg %lu ms max %lu ms\n",
+                   NAMES[l], (unsigned long)lane.queued, (unsigned long)lane.delivered,
+                   (unsigned long)lane.failed, (unsigned long)lane.rejected,
+                   (unsigned long)lane.promoted,
+                   (unsigned long)(lane.sent > 0 ? lane.waitMsTotal / lane.sent : 0),
+                   (unsigned long)lane.waitMsMax);
+    }
+}
+
+void RemoteService::reportRoutes(Print& out) const {
+    const RoutingStats& stats = routingStats_;
+    out.printf("  forwarded %lu (avg %lu us, max %lu us)  looped %lu  hop limit %lu"
+               "  no route %lu  send failures %lu\n",
+               (unsigned long)stats.forwarded,
+               (unsigned long)(stats.forwarded ? stats.forwardUsTotal / stats.forwarded : 0),
+               (unsigned long)stats.forwardUsMax, (unsigned long)stats.looped,
+               (unsigned long)stats.hopLimit, (unsigned long)stats.noRoute,
+               (unsigned long)stats.sendFailures);
+    routes_.report(out, millis());
+}
+
+uint32_t RemoteService::nextMessageID() {
+    return WireFormat::nextMessageID();
 }
 
 String RemoteService::getTargetMacString() const {
     return macToString(targetMAC_);
 }
 
-void RemoteService::onDataSentCallback(const uint8_t *mac_addr, esp_now_send_status_t status) {
-    if (status != ESP_NOW_SEND_SUCCESS) {
+void RemoteService::onFrameSent(const uint8_t* mac, bool delivered, void* context) {
+    static_cast<RemoteService*>(context)->links_.recordSend(mac, delivered);
+    if (!delivered) {
         Serial.println("Message send failed");
     }
 }
 
-void RemoteService::onDataRecvCallback(const uint8_t *mac_addr, const uint8_t *incomingData, int len) {
-    if (activeInstance_ && len >= sizeof(struct_message)) {
-        struct_message receivedMessage;
-        memcpy(&receivedMessage, incomingData, sizeof(struct_message));
-        activeInstance_->processReceivedMessage(mac_addr, receivedMessage);
+void RemoteService::onFrameReceived(const uint8_t* mac, const uint8_t* data, int length,
+                                    void* context) {
+    // Runs on the Wi-Fi task: queue the frame and leave everything else,
+    // drawing above all, to the main loop
+    RemoteService* service = static_cast<RemoteService*>(context);
+    if (service->rxQueue_.push(mac, data, length)) {
+        Application::getInstance().wake();
+    }
+}
+
+void RemoteService::onPromiscuousFrame(const wifi_promiscuous_pkt_t* packet,
+                                       wifi_promiscuous_pkt_type_t type, void* context) {
+    // Wi-Fi task, for every frame the filter lets through
+    RemoteService* service = static_cast<RemoteService*>(context);
+    service->survey_.record(packet->rx_ctrl);
+    const uint8_t* sender = LinkMonitor::espNowSender(packet, type);
+    if (sender != nullptr) {
+        service->links_.recordRssi(sender, packet->rx_ctrl.rssi);
     }
 }
 
-void RemoteService::processReceivedMessage(const uint8_t* senderMac, const struct_message& msg) {
-    // Null-terminate strings for safety
-    struct_message message = msg;
-    message.messageType[sizeof(message.messageType) - 1] = '\0';
-    message.data[sizeof(message.data) - 1] = '\0';
-    message.path[sizeof(message.path) - 1] = '\0';
+void RemoteService::drainReceived() {
+    for (uint8_t i = 0; i < RX_BATCH; i++) {
+        RxFrame* frame = rxQueue_.acquire();
+        if (frame == nullptr) {
+            return;
+        }
+
+        WireMessage message;
+        WireVersion version;
+        bool advertisesCompact;
+        if (WireFormat::decode(frame->data, frame->length, message, version, advertisesCompact)) {
+            WireFormat::notePeerVersion(frame->srcMac, advertisesCompact ? WIRE_COMPACT : WIRE_LEGACY);
+            WireFormat::notePeerFrameSize(frame->srcMac, message);
+            processReceivedMessage(frame->srcMac, message, frame->receivedUs);
+        }
+        rxQueue_.release(frame);
+    }
+
+    // Leave the rest for the next pass so input is not held up behind a
+    // burst of drawing
+    if (rxQueue_.getStats().depth > 0) {
+        Application::getInstance().wake();
+    }
+}
+
+RxQueue::Stats RemoteService::getReceiveStats() const {
+    return rxQueue_.getStats();
+}
 
-    if (strcmp(message.messageType, "cmd") != 0) {
+void RemoteService::processReceivedMessage(const uint8_t* senderMac, WireMessage& message,
+                                           uint32_t receivedUs) {
+    learnRoutes(senderMac, message);
+    lastHeardMs_ = millis();
+    heardSinceSwitch_ = true;
+
+    if (message.type == WIRE_CMD && message.commandID == CMD_RELAY_CONNECTION && message.typed) {
+        routes_.learnAnnouncement(senderMac, (const uint8_t*)message.payload,
+                                  message.payloadLength, selfMAC_, millis());
+        return;
+    }
+    if (message.type == WIRE_CMD && message.commandID == CMD_SET_CHANNEL &&
+        message.messageID == 0) {
+        // A neighbour's broadcast, not acked
+        followChannelSwitch(message);
         return;
     }
 
     if (!isDestinationForSelf(message)) {
+        forward(senderMac, message, receivedUs);
         return;
     }
 
-    if (isDuplicateMessage(senderMac, message.messageID)) {
+    // Routed frames are known by where they started, not by the last relay
+    const uint8_t* source = message.routed && !isZeroMac(message.origin) ? message.origin
+                                                                          : senderMac;
+
+    if (message.type == WIRE_ACK) {
+#ifdef NUGGETS_BENCHMARKS
+        LatencyProbe::getInstance().ackReceived(message.messageID, receivedUs);
+#endif
+        if (memcmp(source, targetMAC_, 6) == 0) {
+            if (message.hasCredit) {
+                peerCredit_ = message.credit;
+            }
+            handleAck(message.messageID, receivedUs);
+        }
         return;
     }
 
-    sendAck(message, senderMac);
-    processDisplayCommand(message.commandID, message.data);
-}
+    if (message.type != WIRE_CMD) {
+        return;
+    }
 
-bool RemoteService::isDuplicateMessage(const uint8_t src[6], uint32_t messageID) {
-    msec32 nowMs = now_ms();
-    const msec32 window = 2000;
-    MsgKey key;
-    memcpy(key.mac, src, 6);
-    key.id = messageID;
-    
-    auto found = recentMsgCache_.find(key);
-    if (found != recentMsgCache_.end()) {
-        return true;
+    if (message.commandID == CMD_BATCH &&
+        !CommandBatch::validate((const uint8_t*)message.payload, message.payloadLength)) {
+        Serial.println("Dropping malformed command batch");
+        return;
     }
-    
-    if (recentMsgCache_.size() > 50) {
-        auto it = recentMsgCache_.begin();
-        while (it != recentMsgCache_.end()) {
-            if (!within_window(it->second, window)) {
-                it = recentMsgCache_.erase(it);
-            } else {
-                ++it;
+
+    // Also catches a copy that came round a loop or by a second path
+    if (isDuplicateMessage(source, message.messageID)) {
+        // Our ack was lost and the sender is retrying
+        sendAck(message, senderMac);
+        return;
+    }
+
+    if (message.commandID == CMD_FRAGMENT) {
+        // Acked once taken in, before the whole is complete, so the sender
+        // keeps the rest coming meanwhile. One that could not be taken in is
+        // left unacked and unrecorded, to come again.
+        Reassembler::Result result;
+        const Reassembler::Message* whole =
+            reassembler_.add(source, (const uint8_t*)message.payload, message.payloadLength,
+                             millis(), result);
+        if (result != Reassembler::ACCEPTED) {
+            replayWindow_.forget(source, message.messageID);
+            return;
+        }
+        sendAck(message, senderMac);
+        if (whole == nullptr) {
+            return;
+        }
+        if (whole->commandID == CMD_BATCH) {
+            if (!CommandBatch::validate((const uint8_t*)whole->data, whole->length)) {
+                Serial.println("Dropping malformed command batch");
+                return;
             }
+            CommandBatch::forEach((const uint8_t*)whole->data, whole->length, runBatchedCommand,
+                                  this);
+            return;
         }
+        processDisplayCommand(whole->commandID, whole->data, whole->length, whole->typed);
+        return;
     }
-    
-    recentMsgCache_[key] = nowMs;
-    return false;
+
+    if (message.commandID == CMD_BATCH) {
+        // Run as a whole before the ack, so the sender never sees a
+        // half-drawn batch acknowledged
+        CommandBatch::forEach((const uint8_t*)message.payload, message.payloadLength,
+                              runBatchedCommand, this);
+        sendAck(message, senderMac);
+        return;
+    }
+
+    sendAck(message, senderMac);
+    if (message.commandID == CMD_SET_CHANNEL) {
+        followChannelSwitch(message);
+        return;
+    }
+    processDisplayCommand(message.commandID, message.payload, message.payloadLength,
+                          message.typed);
 }
 
-void RemoteService::sendAck(const struct_message& originalMsg, const uint8_t* senderMac) {
-    struct_message ackMessage;
-    memset(&ackMessage, 0, sizeof(ackMessage));
-    
-    ackMessage.messageID = originalMsg.messageID;
-    strcpy(ackMessage.messageType, "ack");
-    ackMessage.commandID = 0;
-    ackMessage.data[0] = '\0';
-    
-    // Set sender MAC (this Remote)
-    memcpy(ackMessage.SenderMac, selfMAC_, 6);
-    
-    // Clear routing fields
-    memset(ackMessage.destinationMac, 0, sizeof(ackMessage.destinationMac));
-    ackMessage.path[0] = '\0';
+void RemoteService::runBatchedCommand(uint8_t commandID, const char* data, size_t length,
+                                      bool typed, void* context) {
+    static_cast<RemoteService*>(context)->processDisplayCommand(commandID, data, length, typed);
+}
+
+bool RemoteService::isDuplicateMessage(const uint8_t src[6], uint32_t messageID) {
+    return replayWindow_.isReplay(src, messageID);
+}
+
+void RemoteService::sendAck(const WireMessage& originalMsg, const uint8_t* senderMac) {
+    WireMessage ackMessage;
+    WireFormat::initAck(ackMessage, originalMsg.messageID);
+    ackMessage.hasCredit = true;
+    ackMessage.credit = rxCredit(senderMac);
     
-    // Send ACK back to sender
-    esp_err_t result = esp_now_send(senderMac, (uint8_t*)&ackMessage, sizeof(ackMessage));
+    // Send ACK back to sender, along the route the command came by
+    const uint8_t* source = originalMsg.routed && !isZeroMac(originalMsg.origin)
+                                ? originalMsg.origin
+                                : senderMac;
+    esp_err_t result = sendTo(source, ackMessage);
     if (result == ESP_OK) {
     } else {
         Serial.printf("Failed to send ACK: %s\n", esp_err_to_name(result));
@@ -223,8 +1327,8 @@ uint8_t* RemoteService::stringToMac(const String& s, uint8_t out[6]) {
     return nullptr;
 }
 
-bool RemoteService::isDestinationForSelf(const struct_message& msg) {
-    return isZeroMac(msg.destinationMac) || memcmp(msg.destinationMac, selfMAC_, 6) == 0;
+bool RemoteService::isDestinationForSelf(const WireMessage& msg) {
+    return !msg.routed || isZeroMac(msg.destination) || memcmp(msg.destination, selfMAC_, 6) == 0;
 }
 
 bool RemoteService::isZeroMac(const uint8_t mac[6]) {
@@ -234,13 +1338,37 @@ bool RemoteService::isZeroMac(const uint8_t mac[6]) {
     return true;
 }
 
-void RemoteService::processDisplayCommand(uint8_t commandID, const char* data) {
+void RemoteService::processDisplayCommand(uint8_t commandID, const char* data, size_t length,
+                                          bool typed) {
     auto* remoteState = RemoteControlState::getActiveInstance();
 
     if (!remoteState) {
         Serial.println("No active RemoteControlState to process display command");
         return;
     }
+    if (remoteState->isShowingLinkView()) {
+        // The peer redraws when the view closes
+        return;
+    }
+
+    // Commands with numeric arguments are decoded here, whichever encoding
+    // the sender used; the rest carry text
+    DisplayArgs args;
+    if (DisplayCodec::hasSchema(commandID)) {
+        bool valid = typed ? DisplayCodec::decode(commandID, (const uint8_t*)data, length, args)
+                           : DisplayCodec::parseText(commandID, data, args);
+        if (valid && commandID == CMD_SET_TEXT_SIZE && args.textSize.size == 0) {
+            valid = false;
+        }
+        if (!valid) {
+            remoteState->handleDisplayMessage("Invalid " + String(DisplayCodec::name(commandID)) +
+                                              " data");
+            return;
+        }
+    } else if (typed && commandID != CMD_BLIT && commandID != CMD_BLIT_PALETTE) {
+        Serial.printf("Display command 0x%02X has no binary form\n", commandID);
+        return;
+    }
 
     switch (commandID) {
         case CMD_CLEAR_DISPLAY:
@@ -267,28 +1395,36 @@ void RemoteService::processDisplayCommand(uint8_t commandID, const char* data) {
                 remoteState->handlePrint(String(data));
             break;
         case CMD_SET_CURSOR:
-            remoteState->handleSetCursor(data);
+            remoteState->handleSetCursor(args.cursor);
             break;
         case CMD_SET_TEXT_SIZE:
-            remoteState->handleSetTextSize(data);
+            remoteState->handleSetTextSize(args.textSize);
             break;
         case CMD_SET_TEXT_COLOR:
-            remoteState->handleSetTextColor(data);
+            remoteState->handleSetTextColor(args.color);
             break;
         case CMD_FILL_SCREEN:
-            remoteState->handleFillScreen(data);
+            remoteState->handleFillScreen(args.color);
             break;
         case CMD_DRAW_RECT:
-            remoteState->handleDrawRect(data);
+            remoteState->handleDrawRect(args.rect);
             break;
         case CMD_FILL_RECT:
-            remoteState->handleFillRect(data);
+            remoteState->handleFillRect(args.rect);
             break;
         case CMD_BEGIN_PLOT:
-            remoteState->handleBeginPlot(data);
+            remoteState->handleBeginPlot(args.plot);
             break;
         case CMD_PLOT_POINT:
-            remoteState->handlePlotPoint(data);
+            remoteState->handlePlotPoint(args.point);
+            break;
+        case CMD_BLIT:
+            if (!typed || !blitDecoder_.draw((const uint8_t*)data, length, drawBlitRow, remoteState))
+                remoteState->handleDisplayMessage("Invalid BLIT data");
+            break;
+        case CMD_BLIT_PALETTE:
+            if (!typed || !blitDecoder_.setPalette((const uint8_t*)data, length))
+                remoteState->handleDisplayMessage("Invalid BLIT_PALETTE data");
             break;
         case CMD_SYNC_NODES:
             remoteState->handleSyncNodes(data);
@@ -299,16 +1435,22 @@ void RemoteService::processDisplayCommand(uint8_t commandID, const char* data) {
     }
 }
 
+void RemoteService::drawBlitRow(int16_t x, int16_t y, const uint16_t* pixels, int16_t w,
+                                void* context) {
+    static_cast<RemoteControlState*>(context)->handleBlitRow(x, y, pixels, w);
+}
+
 RemoteService::~RemoteService() {
-    if (activeInstance_ == this) {
-        activeInstance_ = nullptr;
+    TimerService::getInstance().cancelAll(this);
+
+    // The radio stays up for the next state; only leave it where the mesh is
+    EspNowManager& radio = EspNowManager::getInstance();
+    radio.unsubscribe(this);
+    if (survey_.active()) {
+        radio.setPromiscuousFilter(WIFI_PROMIS_FILTER_MASK_MGMT);
+        radio.setChannel(channel_);
     }
 
-    esp_now_deinit();
-    WiFi.disconnect();
-    WiFi.mode(WIFI_OFF);
-    delay(50);
-    
     if (selfMAC_) {
         delete[] selfMAC_;
         selfMAC_ = nullptr;
@@ -0,0 +1,83 @@
+#include "ReplayWindow.h"
+#include <string.h>
+
+namespace NuggetsInc {
+
+ReplayWindow::ReplayWindow() {
+    reset();
+}
+
+void ReplayWindow::reset() {
+    memset(senders_, 0, sizeof(senders_));
+}
+
+ReplayWindow::Sender& ReplayWindow::lookup(const uint8_t mac[6], bool& isNew) {
+    Sender* oldest = &senders_[0];
+    for (uint8_t i = 0; i < MAX_SENDERS; i++) {
+        Sender& sender = senders_[i];
+        if (!sender.used) {
+            oldest = &sender;
+            break;
+        }
+        if (memcmp(sender.mac, mac, 6) == 0) {
+            isNew = false;
+            return sender;
+        }
+        if (oldest->used && (int32_t)(sender.lastSeenMs - oldest->lastSeenMs) < 0) {
+            oldest = &sender;
+        }
+    }
+
+    isNew = true;
+    memcpy(oldest->mac, mac, 6);
+    oldest->used = true;
+    return *oldest;
+}
+
+bool ReplayWindow::isReplay(const uint8_t mac[6], uint32_t sequence) {
+    bool isNew;
+    Sender& sender = lookup(mac, isNew);
+    msec32 nowMs = now_ms();
+    bool idle = !within_window(sender.lastSeenMs, SESSION_IDLE_MS);
+    sender.lastSeenMs = nowMs;
+
+    int32_t ahead = (int32_t)(sequence - sender.highest);
+    if (isNew || (ahead < 0 && (idle || (uint32_t)-ahead > RESET_DISTANCE))) {
+        sender.highest = sequence;
+        sender.seen = 1;
+        return false;
+    }
+
+    if (ahead > 0) {
+        sender.seen = (uint32_t)ahead < WINDOW_BITS ? (sender.seen << ahead) | 1 : 1;
+        sender.highest = sequence;
+        return false;
+    }
+
+    uint32_t behind = (uint32_t)-ahead;
+    if (behind >= WINDOW_BITS) {
+        return true;
+    }
+    uint64_t bit = (uint64_t)1 << behind;
+    if (sender.seen & bit) {
+        return true;
+    }
+    sender.seen |= bit;
+    return false;
+}
+
+void ReplayWindow::forget(const uint8_t mac[6], uint32_t sequence) {
+    for (uint8_t i = 0; i < MAX_SENDERS; i++) {
+        Sender& sender = senders_[i];
+        if (!sender.used || memcmp(sender.mac, mac, 6) != 0) {
+            continue;
+        }
+        uint32_t behind = sender.highest - sequence;
+        if (behind < WINDOW_BITS) {
+            sender.seen &= ~((uint64_t)1 << behind);
+        }
+        return;
+    }
+}
+
+} // namespace NuggetsInc
@@ -0,0 +1,157 @@
+#include "RoutingTable.h"
+#include "WireFormat.h"
+#include <string.h>
+
+namespace NuggetsInc {
+
+namespace {
+
+// A frame carries at most WIRE_MAX_HOPS relays, so a destination further
+// than this cannot be reached
+const uint8_t MAX_ROUTE_HOPS = WIRE_MAX_HOPS + 1;
+
+} // namespace
+
+RoutingTable::RoutingTable() {
+    memset(routes_, 0, sizeof(routes_));
+}
+
+RoutingTable::Route* RoutingTable::find(const uint8_t destination[6]) {
+    for (uint8_t i = 0; i < MAX_ROUTES; i++) {
+        if (routes_[i].used && memcmp(routes_[i].destination, destination, 6) == 0) {
+            return &routes_[i];
+        }
+    }
+    return nullptr;
+}
+
+const RoutingTable::Route* RoutingTable::find(const uint8_t destination[6]) const {
+    return const_cast<RoutingTable*>(this)->find(destination);
+}
+
+void RoutingTable::learn(const uint8_t destination[6], const uint8_t nextHop[6], uint8_t hops,
+                         msec32 nowMs) {
+    if (hops == 0 || hops > MAX_ROUTE_HOPS) {
+        return;
+    }
+
+    Route* route = find(destination);
+    if (route != nullptr) {
+        bool stale = (msec32)(nowMs - route->lastSeenMs) >= ROUTE_TIMEOUT_MS;
+        bool sameHop = memcmp(route->nextHop, nextHop, 6) == 0;
+        if (!stale && !sameHop && hops > route->hops) {
+            return;
+        }
+        if (!sameHop || hops != route->hops) {
+            // The round trip belonged to the old path
+            route->srttUs = 0;
+        }
+    } else {
+        route = &routes_[0];
+        for (uint8_t i = 0; i < MAX_ROUTES; i++) {
+            if (!routes_[i].used) {
+                route = &routes_[i];
+                break;
+            }
+            if ((int32_t)(routes_[i].lastSeenMs - route->lastSeenMs) < 0) {
+                route = &routes_[i];
+            }
+        }
+        memset(route, 0, sizeof(*route));
+        memcpy(route->destination, destination, 6);
+        route->used = true;
+    }
+
+    memcpy(route->nextHop, nextHop, 6);
+    route->hops = hops;
+    route->lastSeenMs = nowMs;
+}
+
+bool RoutingTable::learnAnnouncement(const uint8_t neighbour[6], const uint8_t* payload,
+                                     size_t length, const uint8_t self[6], msec32 nowMs) {
+    if (length % ANNOUNCE_ENTRY_SIZE != 0) {
+        return false;
+    }
+    learn(neighbour, neighbour, 1, nowMs);
+    for (size_t offset = 0; offset < length; offset += ANNOUNCE_ENTRY_SIZE) {
+        const uint8_t* destination = payload + offset;
+        uint8_t hops = payload[offset + 6];
+        const uint8_t* via = payload + offset + 7;
+        // Our own entry, the neighbour's own, or a route that runs back
+        // through us
+        if (memcmp(destination, self, 6) == 0 || memcmp(destination, neighbour, 6) == 0 ||
+            memcmp(via, self, 6) == 0) {
+            continue;
+        }
+        learn(destination, neighbour, hops + 1, nowMs);
+    }
+    return true;
+}
+
+size_t RoutingTable::announcement(uint8_t* out, size_t capacity, msec32 nowMs) const {
+    size_t length = 0;
+    for (uint8_t i = 0; i < MAX_ROUTES; i++) {
+        const Route& route = routes_[i];
+        if (!route.used || route.hops >= MAX_ROUTE_HOPS ||
+            (msec32)(nowMs - route.lastSeenMs) >= ROUTE_TIMEOUT_MS) {
+            continue;
+        }
+        if (capacity - length < ANNOUNCE_ENTRY_SIZE) {
+            break;
+        }
+        memcpy(out + length, route.destination, 6);
+        out[length + 6] = route.hops;
+        memcpy(out + length + 7, route.nextHop, 6);
+        length += ANNOUNCE_ENTRY_SIZE;
+    }
+    return length;
+}
+
+bool RoutingTable::nextHop(const uint8_t destination[6], msec32 nowMs, uint8_t out[6],
+                           uint8_t& hops) const {
+    const Route* route = find(destination);
+    if (route == nullptr || (msec32)(nowMs - route->lastSeenMs) >= ROUTE_TIMEOUT_MS) {
+        return false;
+    }
+    memcpy(out, route->nextHop, 6);
+    hops = route->hops;
+    return true;
+}
+
+void RoutingTable::forget(const uint8_t destination[6]) {
+    Route* route = find(destination);
+    if (route != nullptr) {
+        route->used = false;
+    }
+}
+
+void RoutingTable::recordRtt(const uint8_t destination[6], uint32_t rttUs) {
+    Route* route = find(destination);
+    if (route == nullptr) {
+        return;
+    }
+    route->srttUs = route->srttUs == 0 ? rttUs : (7 * route->srttUs + rttUs) / 8;
+}
+
+void RoutingTable::report(Print& out, msec32 nowMs) const {
+    out.println("  routes:");
+    for (uint8_t i = 0; i < MAX_ROUTES; i++) {
+        const Route& route = routes_[i];
+        if (!route.used) {
+            continue;
+        }
+        const uint8_t* d = route.destination;
+        const uint8_t* n = route.nextHop;
+        out.printf("    %02X:%02X:%02X:%02X:%02X:%02X via %02X:%02X:%02X:%02X:%02X:%02X"
+                   "  %u hops  seen %lu ms ago",
+                   d[0], d[1], d[2], d[3], d[4], d[5], n[0], n[1], n[2], n[3], n[4], n[5],
+                   route.hops, (unsigned long)(nowMs - route.lastSeenMs));
+        if (route.srttUs > 0) {
+            out.printf("  srtt %lu us (%lu per hop)", (unsigned long)route.srttUs,
+                       (unsigned long)(route.srttUs / route.hops));
+        }
+        out.println();
+    }
+}
+
+} // namespace NuggetsInc
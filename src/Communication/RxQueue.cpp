@@ -0,0 +1,79 @@
+#include "RxQueue.h"
+#include <string.h>
+
+namespace NuggetsInc {
+
+RxQueue::RxQueue(RxFrame* frames, uint8_t* storage, uint8_t largeBuffers)
+    : pool(frames), largeCount(largeBuffers), received(0), dropped(0), highWater(0) {
+    for (uint8_t i = 0; i < POOL_SIZE; i++) {
+        pool[i].data = storage + i * WIRE_V1_FRAME;
+        freeSmall.push(i);
+    }
+    uint8_t* large = storage + POOL_SIZE * WIRE_V1_FRAME;
+    for (uint8_t i = 0; i < largeCount; i++) {
+        pool[POOL_SIZE + i].data = large + i * WIRE_MAX_FRAME;
+        freeLarge.push((uint8_t)(POOL_SIZE + i));
+    }
+}
+
+bool RxQueue::push(const uint8_t srcMac[6], const uint8_t* data, int len) {
+    uint8_t index;
+    bool taken = len > 0 && len <= WIRE_MAX_FRAME &&
+                 ((len <= WIRE_V1_FRAME && freeSmall.pop(index)) || freeLarge.pop(index));
+    if (!taken) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    RxFrame& frame = pool[index];
+    memcpy(frame.srcMac, srcMac, 6);
+    memcpy(frame.data, data, len);
+    frame.length = (uint16_t)len;
+    frame.receivedUs = (uint32_t)micros();
+    // Cannot fail: ready holds every index
+    ready.push(index);
+    received.fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t depth = (uint32_t)ready.size();
+    uint32_t mark = highWater.load(std::memory_order_relaxed);
+    while (depth > mark && !highWater.compare_exchange_weak(mark, depth, std::memory_order_relaxed)) {
+    }
+    return true;
+}
+
+RxFrame* RxQueue::acquire() {
+    uint8_t index;
+    if (!ready.pop(index)) {
+        return nullptr;
+    }
+    return &pool[index];
+}
+
+void RxQueue::release(RxFrame* frame) {
+    if (frame == nullptr) {
+        return;
+    }
+    uint8_t index = (uint8_t)(frame - pool);
+    if (index < POOL_SIZE) {
+        freeSmall.push(index);
+    } else {
+        freeLarge.push(index);
+    }
+}
+
+RxQueue::Stats RxQueue::getStats() const {
+    Stats stats;
+    stats.received = received.load(std::memory_order_relaxed);
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    stats.depth = (uint32_t)ready.size();
+    stats.highWater = highWater.load(std::memory_order_relaxed);
+    stats.capacity = POOL_SIZE + largeCount;
+    return stats;
+}
+
+uint32_t RxQueue::available(uint16_t frameSize) const {
+    uint32_t large = (uint32_t)freeLarge.size();
+    return frameSize > WIRE_V1_FRAME ? large : (uint32_t)freeSmall.size() + large;
+}
+
+} // namespace NuggetsInc
@@ -5,37 +5,29 @@
 #include "EventManager.h"
 #include "Colors.h"
 #include "MacAddressStorage.h"
-#include "MessageTypes.h"
+#include "EspNowManager.h"
 
 namespace NuggetsInc {
 
 SyncNodesState* SyncNodesState::activeInstance = nullptr;
 
 SyncNodesState::SyncNodesState()
-    : displayUtils(nullptr), currentBroadcastIndex(0), lastBroadcastTime(0),
-      broadcastStartTime(0), broadcastInProgress(false), broadcastComplete(false) {
-    displayUtils = new DisplayUtils(Device::getInstance().getDisplay());
+    : displayUtils(Device::getInstance().getDisplay()), nodeSync(new NodeSync()),
+      syncStarted(false) {
 }
 
 SyncNodesState::~SyncNodesState() {
-    delete displayUtils;
+    delete nodeSync;
+    nodeSync = nullptr;
 }
 
 void SyncNodesState::onEnter() {
     activeInstance = this;
 
-    // Initialize ESP-NOW if not already initialized
-    WiFi.mode(WIFI_STA);
-
-    // Check if ESP-NOW is already initialized, if not, initialize it
-    esp_err_t initResult = esp_now_init();
-    if (initResult == ESP_OK) {
-        Serial.println("ESP-NOW initialized successfully for sync");
-    } else if (initResult == ESP_ERR_ESPNOW_INTERNAL) {
-        Serial.println("ESP-NOW already initialized, reusing existing system");
-    } else {
-        Serial.println("ESP-NOW initialization failed");
-        displayUtils->displayMessage("ESP-NOW init failed");
+    // Brings the radio up unless remote control already did; either way it
+    // stays on the channel the mesh is using
+    if (!EspNowManager::getInstance().begin()) {
+        displayUtils.displayMessage("ESP-NOW init failed");
         return;
     }
 
@@ -45,43 +37,35 @@ void SyncNodesState::onEnter() {
 
 void SyncNodesState::onExit() {
     activeInstance = nullptr;
+    nodeSync->stop();
 }
 
 void SyncNodesState::update() {
     EventManager& eventManager = EventManager::getInstance();
     Event event;
 
+    // Acks and retries, then one redraw for whatever they changed
+    nodeSync->poll();
+    if (nodeSync->takeChanged()) {
+        updateDisplay();
+    }
+
     while (eventManager.getNextEvent(event)) {
         switch (event.type) {
             case EVENT_SELECT:
             case EVENT_ACTION_ONE:
-                if (!broadcastInProgress && !broadcastComplete) {
-                    startBroadcast();
+                if (!syncStarted) {
+                    startSync();
                 }
                 break;
             case EVENT_BACK:
             case EVENT_ACTION_TWO:
-                Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
+                Application::getInstance().popState();
                 return;
             default:
                 break;
         }
     }
-    
-    if (broadcastInProgress) {
-        unsigned long currentTime = millis();
-
-        if ((unsigned long)(currentTime - broadcastStartTime) > BROADCAST_TIMEOUT) {
-            broadcastInProgress = false;
-            broadcastComplete = true;
-            updateDisplay();
-            return;
-        }
-
-        if ((unsigned long)(currentTime - lastBroadcastTime) > BROADCAST_INTERVAL) {
-            broadcastToNextNode();
-        }
-    }
 }
 
 void SyncNodesState::loadMacAddresses() {
@@ -89,131 +73,96 @@ void SyncNodesState::loadMacAddresses() {
     macAddresses = macStorage.getAllMacAddresses();
 }
 
-void SyncNodesState::startBroadcast() {
+void SyncNodesState::startSync() {
     if (macAddresses.empty()) {
-        displayUtils->displayMessage("No MAC addresses to sync");
+        displayUtils.displayMessage("No MAC addresses to sync");
         return;
     }
-    
-    broadcastInProgress = true;
-    broadcastComplete = false;
-    currentBroadcastIndex = 0;
-    broadcastStartTime = millis();
-    lastBroadcastTime = 0; // Force immediate first broadcast
-    
-    updateDisplay();
-}
 
-void SyncNodesState::broadcastToNextNode() {
-    if (currentBroadcastIndex >= macAddresses.size()) {
-        // Finished broadcasting to all nodes
-        broadcastInProgress = false;
-        broadcastComplete = true;
-        updateDisplay();
+    // Every node at once; update() follows the acks as they come in. Left
+    // unstarted on failure so that SELECT can try again.
+    if (!nodeSync->start(macAddresses)) {
+        displayUtils.displayMessage("Sync failed to start");
         return;
     }
-    
-    String targetMac = macAddresses[currentBroadcastIndex];
-    sendSyncCommand(targetMac);
-    
-    currentBroadcastIndex++;
-    lastBroadcastTime = millis();
+    syncStarted = true;
     updateDisplay();
 }
 
-void SyncNodesState::sendSyncCommand(const String& targetMac) {
-    // Convert MAC string to byte array
-    uint8_t macBytes[6];
-    sscanf(targetMac.c_str(), "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
-           &macBytes[0], &macBytes[1], &macBytes[2],
-           &macBytes[3], &macBytes[4], &macBytes[5]);
-
-    // Check if ESP-NOW is initialized
-    if (!esp_now_is_peer_exist(macBytes)) {
-        // Add peer if not already added
-        esp_now_peer_info_t peerInfo = {};
-        memcpy(peerInfo.peer_addr, macBytes, 6);
-        peerInfo.channel = 0;
-        peerInfo.encrypt = false;
-
-        if (esp_now_add_peer(&peerInfo) != ESP_OK) {
-            Serial.println("Failed to add peer for sync");
-            return;
-        }
-    }
-
-    // Create sync message with all MAC addresses
-    struct_message syncMessage;
-    memset(&syncMessage, 0, sizeof(syncMessage)); // Clear all fields
-    syncMessage.messageID = millis();
-    strcpy(syncMessage.messageType, "cmd");
-    syncMessage.commandID = CMD_SYNC_NODES;
-
-    // Pack MAC addresses into data field (comma-separated)
-    String macList = "";
-    for (int i = 0; i < macAddresses.size() && i < 5; i++) { // Limit to 5 MACs due to data size
-        if (i > 0) macList += ",";
-        macList += macAddresses[i];
-    }
-    strncpy(syncMessage.data, macList.c_str(), sizeof(syncMessage.data) - 1);
-    syncMessage.data[sizeof(syncMessage.data) - 1] = '\0';
-
-    // Set sender MAC
-    String selfMacStr = WiFi.macAddress();
-    selfMacStr.toUpperCase();
-    int b[6];
-    sscanf(selfMacStr.c_str(), "%02x:%02x:%02x:%02x:%02x:%02x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]);
-    for (int i = 0; i < 6; i++) syncMessage.SenderMac[i] = (uint8_t)b[i];
-
-    // Set destination MAC to the target device
-    memcpy(syncMessage.destinationMac, macBytes, 6);
-
-    // Initialize path as empty for direct send
-    syncMessage.path[0] = '\0';
-
-    // Send the message
-    esp_err_t result = esp_now_send(macBytes, (uint8_t*)&syncMessage, sizeof(syncMessage));
-
-    Serial.print("Sending sync to: ");
-    Serial.print(targetMac);
-    Serial.print(" Result: ");
-    Serial.println(result == ESP_OK ? "OK" : "FAIL");
-}
-
 void SyncNodesState::updateDisplay() {
-    displayUtils->clearDisplay();
+    displayUtils.clearDisplay();
     
     // Title
-    displayUtils->setTextColor(COLOR_WHITE);
-    displayUtils->setTextSize(2);
-    displayUtils->setCursor(10, 10);
-    displayUtils->print("Sync Nodes");
+    displayUtils.setTextColor(COLOR_WHITE);
+    displayUtils.setTextSize(2);
+    displayUtils.setCursor(10, 10);
+    displayUtils.print("Sync Nodes");
     
     // Status
-    displayUtils->setTextSize(1);
-    displayUtils->setCursor(10, 40);
+    displayUtils.setTextSize(1);
+    displayUtils.setCursor(10, 40);
     
     if (macAddresses.empty()) {
-        displayUtils->print("No MAC addresses to sync");
-    } else if (!broadcastInProgress && !broadcastComplete) {
-        displayUtils->print("Ready to sync " + String(macAddresses.size()) + " nodes");
-        displayUtils->setCursor(10, 60);
-        displayUtils->print("Press SELECT to start");
-    } else if (broadcastInProgress) {
-        displayUtils->print("Syncing... (" + String(currentBroadcastIndex) + "/" + String(macAddresses.size()) + ")");
-        if (currentBroadcastIndex > 0) {
-            displayUtils->setCursor(10, 60);
-            displayUtils->print("Current: " + macAddresses[currentBroadcastIndex - 1]);
+        displayUtils.print("No MAC addresses to sync");
+    } else if (!syncStarted) {
+        displayUtils.print("Ready to sync " + String(macAddresses.size()) + " nodes");
+        displayUtils.setCursor(10, NODE_LIST_Y);
+        displayUtils.print("Press SELECT to start");
+    } else {
+        uint8_t count = nodeSync->getNodeCount();
+        uint8_t synced = nodeSync->countNodes(NodeSync::NODE_SYNCED);
+        if (nodeSync->isRunning()) {
+            displayUtils.print("Syncing... (" + String(synced) + "/" + String(count) + ")");
+        } else {
+            uint8_t partial = nodeSync->countNodes(NodeSync::NODE_PARTIAL);
+            displayUtils.print("Synced " + String(synced) + " of " + String(count) + " nodes" +
+                               (partial > 0 ? ", " + String(partial) + " partly," : String("")) +
+                               " in " + String(nodeSync->getElapsedMs()) + " ms");
         }
-    } else if (broadcastComplete) {
-        displayUtils->print("Sync complete!");
-        displayUtils->setCursor(10, 60);
-        displayUtils->print("Sent to " + String(macAddresses.size()) + " nodes");
+        for (uint8_t i = 0; i < count; i++) {
+            drawNode(nodeSync->getNode(i), NODE_LIST_Y + i * NODE_LINE_HEIGHT);
+        }
+        displayUtils.setTextColor(COLOR_WHITE);
     }
     
     // Instructions
-    displayUtils->setCursor(10, 200);
-    displayUtils->print("BACK: Return to menu");
+    displayUtils.setCursor(10, 200);
+    displayUtils.print("BACK: Return to menu");
+}
+
+void SyncNodesState::drawNode(const NodeSync::Node& node, int16_t y) {
+    char mac[18];
+    snprintf(mac, sizeof(mac), "%02X:%02X:%02X:%02X:%02X:%02X", node.mac[0], node.mac[1],
+             node.mac[2], node.mac[3], node.mac[4], node.mac[5]);
+    displayUtils.setTextColor(COLOR_WHITE);
+    displayUtils.setCursor(10, y);
+    displayUtils.print(mac);
+
+    displayUtils.setCursor(130, y);
+    switch (node.status) {
+        case NodeSync::NODE_WAITING:
+            displayUtils.print("waiting");
+            break;
+        case NodeSync::NODE_SENT:
+            displayUtils.setTextColor(COLOR_YELLOW);
+            displayUtils.print("sent, try " + String(node.attempts) + "/" +
+                               String(NodeSync::MAX_ATTEMPTS));
+            break;
+        case NodeSync::NODE_SYNCED:
+            displayUtils.setTextColor(COLOR_GREEN);
+            displayUtils.print("synced, " + String(node.rttMs) + " ms");
+            break;
+        case NodeSync::NODE_PARTIAL:
+            // A legacy node: only the addresses its frame had room for
+            displayUtils.setTextColor(COLOR_YELLOW);
+            displayUtils.print("partial, " + String(node.addresses) + "/" +
+                               String(nodeSync->getNodeCount()) + " addresses");
+            break;
+        case NodeSync::NODE_FAILED:
+            displayUtils.setTextColor(COLOR_RED);
+            displayUtils.print("no answer");
+            break;
+    }
 }
 
 } // namespace NuggetsInc
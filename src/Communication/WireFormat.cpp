@@ -0,0 +1,441 @@
+#include "WireFormat.h"
+#include <freertos/FreeRTOS.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+namespace NuggetsInc {
+
+namespace {
+
+struct KnownPeer {
+    uint8_t mac[6];
+    WireVersion version;
+    uint16_t frameSize;      // 0 until the peer sends it
+    bool owesFrameSize;      // the peer asked for ours
+    uint8_t requestsLeft;
+};
+
+// Shared by every sender and receiver, whichever task they run on
+portMUX_TYPE peerLock = portMUX_INITIALIZER_UNLOCKED;
+KnownPeer knownPeers[WireFormat::MAX_KNOWN_PEERS];
+uint8_t knownPeerCount = 0;
+uint8_t nextEviction = 0;
+
+uint32_t lastIssuedID = 0;
+
+// Offset of the capability marker inside the legacy messageType field,
+// clear of "cmd"/"ack" and their terminator
+const size_t LEGACY_MARKER_OFFSET = 8;
+
+size_t putVarint(uint32_t value, uint8_t* out, size_t capacity) {
+    size_t n = 0;
+    do {
+        if (n == capacity) {
+            return 0;
+        }
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        out[n++] = value ? (byte | 0x80) : byte;
+    } while (value);
+    return n;
+}
+
+// Returns the bytes consumed, or 0 if the varint is truncated or too long
+size_t getVarint(const uint8_t* data, size_t len, uint32_t& value) {
+    value = 0;
+    for (size_t i = 0; i < len && i < 5; i++) {
+        value |= (uint32_t)(data[i] & 0x7F) << (7 * i);
+        if ((data[i] & 0x80) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+bool parseMac(const char* text, uint8_t out[6]) {
+    unsigned int b[6];
+    if (sscanf(text, "%02x:%02x:%02x:%02x:%02x:%02x", &b[0], &b[1], &b[2], &b[3], &b[4],
+               &b[5]) != 6) {
+        return false;
+    }
+    for (int i = 0; i < 6; i++) {
+        out[i] = (uint8_t)b[i];
+    }
+    return true;
+}
+
+bool isZeroMac(const uint8_t mac[6]) {
+    for (int i = 0; i < 6; i++) {
+        if (mac[i] != 0) return false;
+    }
+    return true;
+}
+
+// Under peerLock
+KnownPeer* findPeer(const uint8_t mac[6]) {
+    for (uint8_t i = 0; i < knownPeerCount; i++) {
+        if (memcmp(knownPeers[i].mac, mac, 6) == 0) {
+            return &knownPeers[i];
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+void WireFormat::initCommand(WireMessage& message, uint32_t messageID, uint8_t commandID,
+                             const char* payload) {
+    memset(&message, 0, sizeof(message));
+    message.type = WIRE_CMD;
+    message.messageID = messageID;
+    message.commandID = commandID;
+    if (payload) {
+        strncpy(message.payload, payload, WIRE_MAX_PAYLOAD);
+        message.payload[WIRE_MAX_PAYLOAD] = '\0';
+        message.payloadLength = strlen(message.payload);
+    }
+}
+
+void WireFormat::initCommand(WireMessage& message, uint32_t messageID, uint8_t commandID,
+                             const uint8_t* payload, size_t length) {
+    initCommand(message, messageID, commandID);
+    if (length > WIRE_MAX_PAYLOAD) {
+        length = WIRE_MAX_PAYLOAD;
+    }
+    memcpy(message.payload, payload, length);
+    message.payloadLength = (uint16_t)length;
+}
+
+void WireFormat::initAck(WireMessage& message, uint32_t messageID) {
+    memset(&message, 0, sizeof(message));
+    message.type = WIRE_ACK;
+    message.messageID = messageID;
+}
+
+size_t WireFormat::encode(const WireMessage& message, WireVersion version, const uint8_t self[6],
+                          uint8_t* out, size_t capacity) {
+    if (version == WIRE_COMPACT) {
+        return encodeCompact(message, out, capacity);
+    }
+    return encodeLegacy(message, self, out, capacity);
+}
+
+size_t WireFormat::encodeCompact(const WireMessage& message, uint8_t* out, size_t capacity) {
+    if (capacity < 2 || message.hopCount > WIRE_MAX_HOPS) {
+        return 0;
+    }
+    size_t n = 0;
+    out[n++] = COMPACT_MAGIC | COMPACT_VERSION;
+    bool credit = message.type == WIRE_ACK && message.hasCredit;
+    bool frameSize = message.frameSize != 0;
+    out[n++] = (uint8_t)message.type | (message.routed ? FLAG_ROUTED : 0) |
+               (message.typed ? FLAG_TYPED : 0) | (credit ? FLAG_CREDIT : 0) |
+               (frameSize ? FLAG_FRAME_SIZE : 0);
+
+    size_t used = putVarint(message.messageID, out + n, capacity - n);
+    if (used == 0) return 0;
+    n += used;
+
+    if (message.type == WIRE_CMD) {
+        if (n == capacity) return 0;
+        out[n++] = message.commandID;
+        used = putVarint(message.payloadLength, out + n, capacity - n);
+        if (used == 0 || capacity - n - used < message.payloadLength) return 0;
+        n += used;
+        memcpy(out + n, message.payload, message.payloadLength);
+        n += message.payloadLength;
+    }
+
+    if (message.routed) {
+        size_t routing = 6 + 6 + 1 + 6 * (size_t)message.hopCount;
+        if (capacity - n < routing) return 0;
+        memcpy(out + n, message.origin, 6);
+        n += 6;
+        memcpy(out + n, message.destination, 6);
+        n += 6;
+        out[n++] = message.hopCount;
+        memcpy(out + n, message.hops, 6 * (size_t)message.hopCount);
+        n += 6 * (size_t)message.hopCount;
+    }
+
+    // Last, where older decoders will not look
+    if (credit) {
+        if (n == capacity) return 0;
+        out[n++] = message.credit;
+    }
+    if (frameSize) {
+        if (capacity - n < 2) return 0;
+        uint16_t value = (message.frameSize & ~FRAME_SIZE_REQUEST) |
+                         (message.frameSizeRequest ? FRAME_SIZE_REQUEST : 0);
+        out[n++] = value & 0xFF;
+        out[n++] = value >> 8;
+    }
+
+    // A frame of exactly the legacy size could be mistaken for one; decode()
+    // ignores trailing bytes, so one more settles it
+    if (n == sizeof(struct_message)) {
+        if (n == capacity) return 0;
+        out[n++] = 0;
+    }
+    return n;
+}
+
+size_t WireFormat::encodeLegacy(const WireMessage& message, const uint8_t self[6], uint8_t* out,
+                                size_t capacity) {
+    if (capacity < sizeof(struct_message) || message.payloadLength > MAX_LEGACY_PAYLOAD ||
+        message.typed) {
+        return 0;
+    }
+    // The data field is text, so a binary payload would arrive cut short
+    if (memchr(message.payload, '\0', message.payloadLength) != nullptr) {
+        return 0;
+    }
+
+    struct_message legacy;
+    memset(&legacy, 0, sizeof(legacy));
+    legacy.messageID = message.messageID;
+    // A relayed frame still names the node it came from
+    memcpy(legacy.SenderMac, message.routed ? message.origin : self, 6);
+    strcpy(legacy.messageType, message.type == WIRE_ACK ? "ack" : "cmd");
+    legacy.messageType[LEGACY_MARKER_OFFSET] = (char)(COMPACT_MAGIC | COMPACT_VERSION);
+    legacy.commandID = message.commandID;
+    memcpy(legacy.data, message.payload, message.payloadLength);
+
+    if (message.routed) {
+        memcpy(legacy.destinationMac, message.destination, 6);
+        size_t pathLength = 0;
+        for (uint8_t i = 0; i < message.hopCount; i++) {
+            const uint8_t* hop = message.hops[i];
+            int written = snprintf(legacy.path + pathLength, sizeof(legacy.path) - pathLength,
+                                   "%s%02X:%02X:%02X:%02X:%02X:%02X", i ? "," : "", hop[0],
+                                   hop[1], hop[2], hop[3], hop[4], hop[5]);
+            if (written < 0 || pathLength + written >= sizeof(legacy.path)) {
+                return 0;
+            }
+            pathLength += written;
+        }
+    }
+
+    memcpy(out, &legacy, sizeof(legacy));
+    return sizeof(legacy);
+}
+
+bool WireFormat::decode(const uint8_t* data, int len, WireMessage& message, WireVersion& version,
+                        bool& advertisesCompact) {
+    advertisesCompact = false;
+    if (data == nullptr || len < 2) {
+        return false;
+    }
+
+    // The legacy check comes first: its messageID bytes can be anything,
+    // including the compact magic
+    if (len == (int)sizeof(struct_message)) {
+        const char* type = (const char*)data + offsetof(struct_message, messageType);
+        if (strncmp(type, "cmd", 4) == 0 || strncmp(type, "ack", 4) == 0) {
+            version = WIRE_LEGACY;
+            return decodeLegacy(data, message, advertisesCompact);
+        }
+    }
+
+    if ((data[0] & 0xF0) == COMPACT_MAGIC && (data[0] & 0x0F) == COMPACT_VERSION) {
+        version = WIRE_COMPACT;
+        advertisesCompact = true;
+        return decodeCompact(data, len, message);
+    }
+    return false;
+}
+
+bool WireFormat::decodeLegacy(const uint8_t* data, WireMessage& message,
+                              bool& advertisesCompact) {
+    struct_message legacy;
+    memcpy(&legacy, data, sizeof(legacy));
+    legacy.data[sizeof(legacy.data) - 1] = '\0';
+    legacy.path[sizeof(legacy.path) - 1] = '\0';
+
+    uint8_t marker = (uint8_t)legacy.messageType[LEGACY_MARKER_OFFSET];
+    advertisesCompact = (marker & 0xF0) == COMPACT_MAGIC && (marker & 0x0F) >= COMPACT_VERSION;
+
+    memset(&message, 0, sizeof(message));
+    message.type = legacy.messageType[0] == 'a' ? WIRE_ACK : WIRE_CMD;
+    message.messageID = legacy.messageID;
+    message.commandID = legacy.commandID;
+    message.payloadLength = strlen(legacy.data);
+    memcpy(message.payload, legacy.data, message.payloadLength);
+
+    if (!isZeroMac(legacy.destinationMac)) {
+        message.routed = true;
+        memcpy(message.origin, legacy.SenderMac, 6);
+        memcpy(message.destination, legacy.destinationMac, 6);
+        const char* cursor = legacy.path;
+        while (*cursor && message.hopCount < WIRE_MAX_HOPS) {
+            if (!parseMac(cursor, message.hops[message.hopCount])) {
+                break;
+            }
+            message.hopCount++;
+            cursor = strchr(cursor, ',');
+            if (cursor == nullptr) break;
+            cursor++;
+        }
+    }
+    return true;
+}
+
+bool WireFormat::decodeCompact(const uint8_t* data, int len, WireMessage& message) {
+    memset(&message, 0, sizeof(message));
+    size_t length = (size_t)len;
+    size_t n = 1;
+
+    uint8_t typeAndFlags = data[n++];
+    uint8_t type = typeAndFlags & 0x0F;
+    if (type != WIRE_CMD && type != WIRE_ACK) {
+        return false;
+    }
+    message.type = (WireFrameType)type;
+    message.routed = (typeAndFlags & FLAG_ROUTED) != 0;
+    message.typed = (typeAndFlags & FLAG_TYPED) != 0;
+
+    size_t used = getVarint(data + n, length - n, message.messageID);
+    if (used == 0) return false;
+    n += used;
+
+    if (message.type == WIRE_CMD) {
+        if (n == length) return false;
+        message.commandID = data[n++];
+        uint32_t payloadLength;
+        used = getVarint(data + n, length - n, payloadLength);
+        if (used == 0) return false;
+        n += used;
+        if (payloadLength > WIRE_MAX_PAYLOAD || length - n < payloadLength) return false;
+        message.payloadLength = (uint16_t)payloadLength;
+        memcpy(message.payload, data + n, payloadLength);
+        n += payloadLength;
+    }
+
+    if (message.routed) {
+        if (length - n < 13) return false;
+        memcpy(message.origin, data + n, 6);
+        n += 6;
+        memcpy(message.destination, data + n, 6);
+        n += 6;
+        message.hopCount = data[n++];
+        if (message.hopCount > WIRE_MAX_HOPS || length - n < 6 * (size_t)message.hopCount) {
+            return false;
+        }
+        memcpy(message.hops, data + n, 6 * (size_t)message.hopCount);
+        n += 6 * (size_t)message.hopCount;
+    }
+
+    if (message.type == WIRE_ACK && (typeAndFlags & FLAG_CREDIT) != 0) {
+        if (n == length) return false;
+        message.hasCredit = true;
+        message.credit = data[n++];
+    }
+    if ((typeAndFlags & FLAG_FRAME_SIZE) != 0) {
+        if (length - n < 2) return false;
+        uint16_t value = data[n] | (uint16_t)data[n + 1] << 8;
+        n += 2;
+        message.frameSize = value & ~FRAME_SIZE_REQUEST;
+        message.frameSizeRequest = (value & FRAME_SIZE_REQUEST) != 0;
+    }
+    return true;
+}
+
+WireVersion WireFormat::peerVersion(const uint8_t mac[6]) {
+    portENTER_CRITICAL(&peerLock);
+    KnownPeer* entry = findPeer(mac);
+    WireVersion version = entry != nullptr ? entry->version : WIRE_UNKNOWN;
+    portEXIT_CRITICAL(&peerLock);
+    return version;
+}
+
+void WireFormat::notePeerVersion(const uint8_t mac[6], WireVersion version) {
+    portENTER_CRITICAL(&peerLock);
+    KnownPeer* entry = findPeer(mac);
+    if (entry == nullptr) {
+        if (knownPeerCount < MAX_KNOWN_PEERS) {
+            entry = &knownPeers[knownPeerCount++];
+        } else {
+            // Forgetting a peer only costs a legacy frame until it answers again
+            entry = &knownPeers[nextEviction];
+            nextEviction = (nextEviction + 1) % MAX_KNOWN_PEERS;
+        }
+        memset(entry, 0, sizeof(*entry));
+        memcpy(entry->mac, mac, 6);
+        entry->requestsLeft = FRAME_SIZE_REQUESTS;
+    }
+    entry->version = version;
+    portEXIT_CRITICAL(&peerLock);
+}
+
+uint16_t WireFormat::peerFrameSize(const uint8_t mac[6]) {
+    uint16_t size = WIRE_V1_FRAME;
+    portENTER_CRITICAL(&peerLock);
+    KnownPeer* entry = findPeer(mac);
+    if (entry != nullptr && entry->version == WIRE_COMPACT && entry->frameSize > size) {
+        size = entry->frameSize;
+    }
+    portEXIT_CRITICAL(&peerLock);
+    return size < WIRE_MAX_FRAME ? size : WIRE_MAX_FRAME;
+}
+
+uint16_t WireFormat::maxPayload(const uint8_t mac[6]) {
+    if (peerVersion(mac) != WIRE_COMPACT) {
+        return MAX_LEGACY_PAYLOAD;
+    }
+    return peerFrameSize(mac) - WIRE_COMPACT_OVERHEAD;
+}
+
+void WireFormat::notePeerFrameSize(const uint8_t mac[6], const WireMessage& message) {
+    if (message.frameSize == 0) {
+        return;
+    }
+    portENTER_CRITICAL(&peerLock);
+    KnownPeer* entry = findPeer(mac);
+    if (entry != nullptr) {
+        entry->frameSize = message.frameSize;
+        entry->owesFrameSize = entry->owesFrameSize || message.frameSizeRequest;
+    }
+    portEXIT_CRITICAL(&peerLock);
+}
+
+void WireFormat::advertiseFrameSize(const uint8_t mac[6], WireMessage& message) {
+    message.frameSize = 0;
+    message.frameSizeRequest = false;
+    portENTER_CRITICAL(&peerLock);
+    KnownPeer* entry = findPeer(mac);
+    if (entry != nullptr) {
+        // A v1 node has nothing to gain from asking, but still answers
+        bool request = WIRE_MAX_FRAME > WIRE_V1_FRAME && entry->frameSize == 0 &&
+                       entry->requestsLeft > 0;
+        if (request || entry->owesFrameSize) {
+            message.frameSize = WIRE_MAX_FRAME;
+            message.frameSizeRequest = request;
+            entry->owesFrameSize = false;
+            if (request) {
+                entry->requestsLeft--;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&peerLock);
+}
+
+void WireFormat::beginMessageIDs() {
+    uint32_t nowMs = (uint32_t)millis();
+    if ((int32_t)(nowMs - lastIssuedID) > 0) {
+        lastIssuedID = nowMs;
+    }
+}
+
+uint32_t WireFormat::nextMessageID() {
+    if (++lastIssuedID == 0) {
+        lastIssuedID = 1;
+    }
+    return lastIssuedID;
+}
+
+uint32_t WireFormat::lastMessageID() {
+    return lastIssuedID;
+}
+
+} // namespace NuggetsInc
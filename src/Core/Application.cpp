@@ -3,18 +3,38 @@
 #include "Device.h"
 #include "Utils/Sounds.h"
 #include "Communication/MacAddressStorage.h"
+#include "Diagnostics/Benchmarks.h"
+#include "Diagnostics/Profiler.h"
 #include <LittleFS.h>
+#include <string.h>
 
 namespace NuggetsInc {
 
+namespace {
+// Read by wakeFromISR(), which cannot go through getInstance()
+TaskHandle_t wakeTarget = nullptr;
+}
+
 Application& Application::getInstance() {
     static Application instance;
     return instance;
 }
 
-Application::Application() : currentState(nullptr) {}
+Application::Application()
+    : navDepth(0), holding(false), holdTimer(TimerService::INVALID_TIMER),
+      hasPendingState(false), pendingState(MENU_STATE), hasPendingMac(false),
+      loopTaskHandle(nullptr) {
+    for (uint8_t i = 0; i < NAV_STACK_DEPTH; i++) {
+        navStack[i] = nullptr;
+    }
+}
 
 void Application::init() {
+    // The main loop sleeps on this task's notification between updates
+    loopTaskHandle = xTaskGetCurrentTaskHandle();
+    wakeTarget = loopTaskHandle;
+    EventManager::getInstance().setConsumerTask(loopTaskHandle);
+
     Device::getInstance().init();
 
     // Initialize MAC address storage early
@@ -35,25 +55,204 @@ void Application::init() {
     //Sounds::getInstance().playMelody();
     //delay(1000); // Delay to allow the melody to play
 
+#ifdef NUGGETS_BENCHMARKS
+    // Runs while the state storage is still empty
+    runBenchmarks();
+#endif
+#ifdef NUGGETS_PROFILING
+    Profiler::getInstance().begin();
+#endif
+
     // Start with the menu state
     changeState(StateFactory::createState(MENU_STATE));
 }
 
 void Application::run() {
-    Device::getInstance().update(); // Update device to read inputs
-    if (currentState) {
-        currentState->update();
+#ifdef NUGGETS_PROFILING
+    Profiler& profiler = Profiler::getInstance();
+    uint32_t loopStartUs = micros();
+#endif
+
+    TimerService& timers = TimerService::getInstance();
+    timers.runDue();
+
+    AppState* state = currentState();
+#ifdef NUGGETS_PROFILING
+    uint32_t updateStartUs = micros();
+    profiler.recordTimers(updateStartUs - loopStartUs);
+#endif
+    if (state && !holding) {
+        state->update();
+#ifdef NUGGETS_PROFILING
+        profiler.recordUpdate(StateFactory::typeOf(state), micros() - updateStartUs);
+#endif
+    }
+
+    // Sleep until something wakes us, or the state's next deadline or the
+    // next timer is due
+    state = currentState();
+    uint32_t delayMs = state && !holding ? state->getUpdateDelay() : UPDATE_ON_EVENT;
+    uint32_t timerMs = timers.msUntilNext();
+    if (timerMs < delayMs) {
+        delayMs = timerMs;
+    }
+    TickType_t ticks = delayMs == UPDATE_ON_EVENT ? portMAX_DELAY : pdMS_TO_TICKS(delayMs);
+#ifdef NUGGETS_PROFILING
+    profiler.recordLoop(micros() - loopStartUs);
+#endif
+    if (ticks > 0) {
+        ulTaskNotifyTake(pdTRUE, ticks);
     }
 }
 
 void Application::changeState(AppState* newState) {
-    if (currentState) {
-        currentState->onExit();
-        delete currentState;
+    if (newState == nullptr) {
+        Serial.println("changeState: no state to enter, staying put");
+        return;
+    }
+
+    cancelHold();
+    if (returnTo(newState)) {
+        return;
+    }
+
+    if (navDepth == 0) {
+        navDepth = 1;
+    } else {
+        leaveState(navStack[navDepth - 1]);
+    }
+    navStack[navDepth - 1] = newState;
+    newState->onEnter();
+
+    // Give the new state its first update straight away
+    wake();
+}
+
+void Application::pushState(AppState* newState) {
+    if (newState == nullptr) {
+        Serial.println("pushState: no state to enter, staying put");
+        return;
+    }
+
+    cancelHold();
+    if (returnTo(newState)) {
+        return;
+    }
+
+    AppState* parent = currentState();
+    if (!StateFactory::isRetained(parent) || navDepth >= NAV_STACK_DEPTH) {
+        changeState(newState);
+        return;
+    }
+
+    parent->onSuspend();
+    navStack[navDepth++] = newState;
+    newState->onEnter();
+    wake();
+}
+
+void Application::popState() {
+    if (navDepth < 2) {
+        return;
+    }
+    cancelHold();
+    returnTo(navStack[navDepth - 2]);
+}
+
+void Application::popToRoot() {
+    if (navDepth > 0) {
+        cancelHold();
+        returnTo(navStack[0]);
     }
-    currentState = newState;
-    if (currentState) {
-        currentState->onEnter();
+}
+
+AppState* Application::currentState() const {
+    return navDepth > 0 ? navStack[navDepth - 1] : nullptr;
+}
+
+void Application::leaveState(AppState* state) {
+    TimerService::getInstance().cancelAll(state);
+    state->onExit();
+    StateFactory::destroyState(state);
+}
+
+bool Application::returnTo(AppState* state) {
+    int index = -1;
+    for (int i = 0; i < navDepth; i++) {
+        if (navStack[i] == state) {
+            index = i;
+        }
+    }
+    if (index < 0) {
+        return false;
+    }
+    if (index == navDepth - 1) {
+        return true;  // Already there
+    }
+
+    while (navDepth > index + 1) {
+        navDepth--;
+        leaveState(navStack[navDepth]);
+        navStack[navDepth] = nullptr;
+    }
+    state->onResume();
+    wake();
+    return true;
+}
+
+void Application::holdState(uint32_t holdMs) {
+    cancelHold();
+    holdTimer = TimerService::getInstance().scheduleOnce(holdMs, onHoldExpired, this);
+    holding = holdTimer != TimerService::INVALID_TIMER;
+}
+
+void Application::changeStateAfter(uint32_t holdMs, StateType next, const uint8_t* peerMac) {
+    holdState(holdMs);
+    if (!holding) {
+        // No timer to wait on; better to move on now than never
+        changeState(StateFactory::createState(next, peerMac));
+        return;
+    }
+
+    hasPendingState = true;
+    pendingState = next;
+    hasPendingMac = peerMac != nullptr;
+    if (hasPendingMac) {
+        memcpy(pendingMac, peerMac, sizeof(pendingMac));
+    }
+}
+
+void Application::cancelHold() {
+    if (holdTimer != TimerService::INVALID_TIMER) {
+        TimerService::getInstance().cancel(holdTimer);
+        holdTimer = TimerService::INVALID_TIMER;
+    }
+    holding = false;
+    hasPendingState = false;
+}
+
+void Application::onHoldExpired(void* context) {
+    Application* app = static_cast<Application*>(context);
+    app->holdTimer = TimerService::INVALID_TIMER;
+    app->holding = false;
+    if (app->hasPendingState) {
+        app->changeState(StateFactory::createState(app->pendingState,
+                                                   app->hasPendingMac ? app->pendingMac : nullptr));
+    }
+    app->wake();
+}
+
+void Application::wake() {
+    if (loopTaskHandle != nullptr) {
+        xTaskNotifyGive(loopTaskHandle);
+    }
+}
+
+void IRAM_ATTR Application::wakeFromISR() {
+    if (wakeTarget != nullptr) {
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+        vTaskNotifyGiveFromISR(wakeTarget, &higherPriorityTaskWoken);
+        portYIELD_FROM_ISR(higherPriorityTaskWoken);
     }
 }
 
@@ -2,6 +2,9 @@
 
 #include "Device.h"
 #include "Haptics.h"
+#include "InputManager.h"
+#include "TimerService.h"
+#include "Diagnostics/Profiler.h"
 #include "esp_sleep.h"
 
 namespace NuggetsInc {
@@ -11,14 +14,7 @@ Device& Device::getInstance() {
     return instance;
 }
 
-Device::Device()
-    : upPressed(false), downPressed(false), leftPressed(false),
-      rightPressed(false), selectPressed(false), backPressed(false),
-      actionOnePressed(false), actionTwoPressed(false),
-      lastUpPressTime(0), lastDownPressTime(0), lastLeftPressTime(0),
-      lastRightPressTime(0), lastSelectPressTime(0), lastBackPressTime(0),
-      lastActionOnePressTime(0), lastActionTwoPressTime(0),
-      lastBackButtonPressTime(0) {
+Device::Device() {
     // Initialize the data bus and graphics objects
     bus = new Arduino_ESP32QSPI(6, 47, 18, 7, 48, 5);
     gfx = new Arduino_RM67162(bus, 17, 3);
@@ -44,19 +40,11 @@ void Device::init() {
     pinMode(VIBRATOR_PIN, OUTPUT);
     digitalWrite(VIBRATOR_PIN, LOW);
 
-    // Initialize joystick buttons
-    pinMode(JOY_UP_PIN, INPUT_PULLUP);
-    pinMode(JOY_DOWN_PIN, INPUT_PULLUP);
-    pinMode(JOY_LEFT_PIN, INPUT_PULLUP);
-    pinMode(JOY_RIGHT_PIN, INPUT_PULLUP);
-    pinMode(JOY_CENTER_PIN, INPUT_PULLUP);
-    pinMode(SET_BUTTON_PIN, INPUT_PULLUP);
-    pinMode(BACK_BUTTON_PIN, INPUT_PULLUP);
-    pinMode(ACTION_ONE_BUTTON_PIN, INPUT_PULLUP);
-    pinMode(ACTION_TWO_BUTTON_PIN, INPUT_PULLUP);
-
     // Start the haptics task
     Haptics::getInstance().begin();
+
+    // Button pins, edge interrupts and the input task
+    InputManager::getInstance().begin();
 }
 
 void Device::startVibration() {
@@ -94,60 +82,15 @@ void Device::playTone(uint32_t frequency, uint32_t duration) {
     mcpwm_init(MCPWM_UNIT_0, MCPWM_TIMER_0, &pwm_config);
 
     // Wait for duration
-    delay(duration);
+    {
+        PROFILE_BLOCKING("device.playTone");
+        delay(duration);
+    }
 
     // Stop the PWM signal
     mcpwm_set_signal_low(MCPWM_UNIT_0, MCPWM_TIMER_0, MCPWM_OPR_A);
 }
 
-void Device::update() {
-    EventManager& eventManager = EventManager::getInstance();
-    unsigned long currentTime = millis();
-
-    // Macro to simplify debounce handling (rollover-safe)
-    #define DEBOUNCE_BUTTON(pin, pressedFlag, lastPressTime, event) \
-        if (digitalRead(pin) == LOW) { \
-            if (!pressedFlag && ((unsigned long)(currentTime - lastPressTime) >= debounceInterval)) { \
-                pressedFlag = true; \
-                lastPressTime = currentTime; \
-                eventManager.queueEvent({event}); \
-            } \
-        } else { \
-            pressedFlag = false; \
-        }
-
-    // Handle each button with debounce
-    DEBOUNCE_BUTTON(JOY_UP_PIN, upPressed, lastUpPressTime, EVENT_UP);
-    DEBOUNCE_BUTTON(JOY_DOWN_PIN, downPressed, lastDownPressTime, EVENT_DOWN);
-    DEBOUNCE_BUTTON(JOY_LEFT_PIN, leftPressed, lastLeftPressTime, EVENT_LEFT);
-    DEBOUNCE_BUTTON(JOY_RIGHT_PIN, rightPressed, lastRightPressTime, EVENT_RIGHT);
-    DEBOUNCE_BUTTON(SET_BUTTON_PIN, selectPressed, lastSelectPressTime, EVENT_SELECT);
-    DEBOUNCE_BUTTON(ACTION_ONE_BUTTON_PIN, actionOnePressed, lastActionOnePressTime, EVENT_ACTION_ONE);
-    DEBOUNCE_BUTTON(ACTION_TWO_BUTTON_PIN, actionTwoPressed, lastActionTwoPressTime, EVENT_ACTION_TWO);
-
-    // Special handling for BACK_BUTTON_PIN due to double press detection (rollover-safe)
-    if (digitalRead(BACK_BUTTON_PIN) == LOW) {
-        if (!backPressed && ((unsigned long)(currentTime - lastBackPressTime) >= debounceInterval)) {
-            backPressed = true;
-            unsigned long now = millis();
-
-            if ((unsigned long)(now - lastBackButtonPressTime) < doublePressThreshold) {
-                // Double press detected
-                goToDeepSleep();
-            } else {
-                // Single press
-                lastBackButtonPressTime = now;
-                eventManager.queueEvent({EVENT_BACK});
-            }
-            lastBackPressTime = currentTime;
-        }
-    } else {
-        backPressed = false;
-    }
-
-    #undef DEBOUNCE_BUTTON
-}
-
 void Device::goToDeepSleep() {
     // Perform necessary cleanup
     Haptics::getInstance().end();
@@ -155,10 +98,17 @@ void Device::goToDeepSleep() {
     // Configure the wake-up source: BACK_BUTTON_PIN (e.g., GPIO0) on LOW level
     esp_sleep_enable_ext0_wakeup(static_cast<gpio_num_t>(BACK_BUTTON_PIN), 0);
 
-    // Provide feedback before sleeping (optional)
+    // Provide feedback before sleeping (optional). The buzz is ended from a
+    // timer so the caller is not blocked for it.
     startVibration();
-    delay(500);
-    stopVibration();
+    if (TimerService::getInstance().scheduleOnce(SLEEP_VIBRATION_MS, finishDeepSleep, this)
+        == TimerService::INVALID_TIMER) {
+        finishDeepSleep(this);
+    }
+}
+
+void Device::finishDeepSleep(void* context) {
+    static_cast<Device*>(context)->stopVibration();
 
     // Enter deep sleep
     esp_deep_sleep_start();
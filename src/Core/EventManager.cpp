@@ -1,4 +1,5 @@
 #include "EventManager.h"
+#include "Device.h"
 
 namespace NuggetsInc {
 
@@ -7,25 +8,69 @@ EventManager& EventManager::getInstance() {
     return instance;
 }
 
-EventManager::EventManager() {}
+EventManager::EventManager() : overflowCount(0), highWaterMark(0), consumerTask(nullptr) {}
 
-void EventManager::queueEvent(const Event& event) {
-    eventQueue.push(event);
+IRAM_ATTR bool EventManager::enqueue(const Event& event) {
+    Event stamped = event;
+    stamped.queuedUs = (uint32_t)micros();
+    if (stamped.timestampUs == 0) {
+        stamped.timestampUs = stamped.queuedUs;
+    }
+
+    if (!eventQueue.push(stamped)) {
+        overflowCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    uint32_t depth = (uint32_t)eventQueue.size();
+    uint32_t peak = highWaterMark.load(std::memory_order_relaxed);
+    while (depth > peak && !highWaterMark.compare_exchange_weak(peak, depth, std::memory_order_relaxed)) {
+    }
+    return true;
 }
 
-bool EventManager::getNextEvent(Event& event) {
-    if (eventQueue.empty()) {
+bool EventManager::queueEvent(const Event& event) {
+    if (!enqueue(event)) {
         return false;
     }
-    event = eventQueue.front();
-    eventQueue.pop();
+    if (consumerTask != nullptr) {
+        xTaskNotifyGive(consumerTask);
+    }
     return true;
 }
 
+IRAM_ATTR bool EventManager::queueEventFromISR(const Event& event) {
+    if (!enqueue(event)) {
+        return false;
+    }
+    if (consumerTask != nullptr) {
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+        vTaskNotifyGiveFromISR(consumerTask, &higherPriorityTaskWoken);
+        portYIELD_FROM_ISR(higherPriorityTaskWoken);
+    }
+    return true;
+}
+
+bool EventManager::getNextEvent(Event& event) {
+    while (eventQueue.pop(event)) {
+        if (event.type != EVENT_SLEEP_REQUEST) {
+            return true;
+        }
+        Device::getInstance().goToDeepSleep();
+    }
+    return false;
+}
+
 void EventManager::clearEvents() {
-    while (!eventQueue.empty()) {
-        eventQueue.pop();
+    // Drained rather than dropped so that a sleep request is still acted on
+    Event event;
+    while (getNextEvent(event)) {
     }
 }
 
+void EventManager::resetCounters() {
+    overflowCount.store(0, std::memory_order_relaxed);
+    highWaterMark.store((uint32_t)eventQueue.size(), std::memory_order_relaxed);
+}
+
 } // namespace NuggetsInc
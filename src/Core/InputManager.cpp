@@ -0,0 +1,265 @@
+#include "InputManager.h"
+#include "Device.h"
+
+namespace NuggetsInc {
+
+namespace {
+
+struct ButtonPin {
+    uint8_t pin;
+    EventType event;
+    bool repeats; // navigation keys auto-repeat; the rest report long presses
+};
+
+const ButtonPin INPUT_PINS[INPUT_BUTTON_COUNT] = {
+    { Device::JOY_UP_PIN,            EVENT_UP,         true  },
+    { Device::JOY_DOWN_PIN,          EVENT_DOWN,       true  },
+    { Device::JOY_LEFT_PIN,          EVENT_LEFT,       true  },
+    { Device::JOY_RIGHT_PIN,         EVENT_RIGHT,      true  },
+    { Device::JOY_CENTER_PIN,        EVENT_SELECT,     false },
+    { Device::SET_BUTTON_PIN,        EVENT_SELECT,     false },
+    { Device::BACK_BUTTON_PIN,       EVENT_BACK,       false },
+    { Device::ACTION_ONE_BUTTON_PIN, EVENT_ACTION_ONE, false },
+    { Device::ACTION_TWO_BUTTON_PIN, EVENT_ACTION_TWO, false },
+};
+
+const uint32_t NO_DEADLINE = 0xFFFFFFFF;
+
+// Read by the ISR, which cannot go through getInstance()
+InputManager* isrTarget = nullptr;
+
+uint8_t countBits(uint16_t mask) {
+    uint8_t count = 0;
+    while (mask) {
+        mask &= (uint16_t)(mask - 1);
+        count++;
+    }
+    return count;
+}
+
+} // namespace
+
+InputManager& InputManager::getInstance() {
+    static InputManager instance;
+    return instance;
+}
+
+InputManager::InputManager()
+    : inputTaskHandle(nullptr), heldMask(0), lastBackPressMs(0) {
+    for (int i = 0; i < INPUT_BUTTON_COUNT; i++) {
+        buttons[i] = ButtonState();
+        edgeUs[i] = 0;
+        edgeLatched[i] = false;
+    }
+}
+
+void InputManager::begin() {
+    if (inputTaskHandle != nullptr) {
+        return;
+    }
+
+    uint16_t mask = 0;
+    for (int i = 0; i < INPUT_BUTTON_COUNT; i++) {
+        pinMode(INPUT_PINS[i].pin, INPUT_PULLUP);
+
+        // Start from the current level so a button still held from wake-up
+        // does not produce a press, and never reports a long press
+        ButtonState& state = buttons[i];
+        state.pressed = digitalRead(INPUT_PINS[i].pin) == LOW;
+        state.integrator = state.pressed ? DEBOUNCE_SAMPLES : 0;
+        state.longPressSent = state.pressed;
+        state.pressedAtMs = millis();
+        state.nextRepeatMs = state.pressedAtMs;
+        if (state.pressed) {
+            mask |= (uint16_t)(1 << i);
+        }
+    }
+    heldMask = mask;
+
+    xTaskCreatePinnedToCore(
+        inputTask,           // Task function
+        "InputTask",         // Name of the task
+        3072,                // Stack size (in words)
+        this,                // Task input parameter
+        3,                   // Above the haptics task: input must not wait
+        &inputTaskHandle,    // Task handle
+        0                    // Core to run the task on (0 or 1)
+    );
+
+    isrTarget = this;
+    for (int i = 0; i < INPUT_BUTTON_COUNT; i++) {
+        attachInterruptArg(INPUT_PINS[i].pin, onPinChange, reinterpret_cast<void*>((intptr_t)i), CHANGE);
+    }
+}
+
+void InputManager::end() {
+    for (int i = 0; i < INPUT_BUTTON_COUNT; i++) {
+        detachInterrupt(INPUT_PINS[i].pin);
+    }
+    isrTarget = nullptr;
+    if (inputTaskHandle != nullptr) {
+        vTaskDelete(inputTaskHandle);
+        inputTaskHandle = nullptr;
+    }
+}
+
+bool InputManager::isPressed(InputButton button) const {
+    return button < INPUT_BUTTON_COUNT && (heldMask & (1 << button)) != 0;
+}
+
+void IRAM_ATTR InputManager::onPinChange(void* arg) {
+    InputManager* self = isrTarget;
+    if (self == nullptr || self->inputTaskHandle == nullptr) {
+        return;
+    }
+
+    int index = (int)reinterpret_cast<intptr_t>(arg);
+    if (!self->edgeLatched[index]) {
+        self->edgeUs[index] = (uint32_t)micros();
+        self->edgeLatched[index] = true;
+    }
+
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(self->inputTaskHandle, &higherPriorityTaskWoken);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+void InputManager::inputTask(void* parameter) {
+    InputManager* input = static_cast<InputManager*>(parameter);
+
+    while (true) {
+        // Edges that arrive while sampling are picked up by the samples
+        // themselves, so drop the pending count before looking at the pins
+        ulTaskNotifyTake(pdTRUE, 0);
+
+        uint32_t now = millis();
+        bool settled = input->sample(now);
+        uint32_t untilDeadline = input->serviceHeld(now);
+
+        if (!settled) {
+            // Debounce in progress: one sample per tick
+            vTaskDelay(1);
+        } else if (untilDeadline == NO_DEADLINE) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        } else {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(untilDeadline) ? pdMS_TO_TICKS(untilDeadline) : 1);
+        }
+    }
+}
+
+bool InputManager::sample(uint32_t nowMs) {
+    bool settled = true;
+
+    for (int i = 0; i < INPUT_BUTTON_COUNT; i++) {
+        ButtonState& state = buttons[i];
+        bool low = digitalRead(INPUT_PINS[i].pin) == LOW;
+
+        if (low && state.integrator < DEBOUNCE_SAMPLES) {
+            state.integrator++;
+        } else if (!low && state.integrator > 0) {
+            state.integrator--;
+        }
+
+        if (!state.pressed && state.integrator == DEBOUNCE_SAMPLES) {
+            state.pressed = true;
+            onPressed(static_cast<InputButton>(i), nowMs);
+        } else if (state.pressed && state.integrator == 0) {
+            state.pressed = false;
+            onReleased(static_cast<InputButton>(i), nowMs);
+        }
+
+        bool stable = state.pressed ? (low && state.integrator == DEBOUNCE_SAMPLES)
+                                    : (!low && state.integrator == 0);
+        if (stable) {
+            edgeLatched[i] = false;
+        } else {
+            settled = false;
+        }
+    }
+
+    return settled;
+}
+
+uint32_t InputManager::edgeTimestamp(InputButton button) const {
+    // 0 lets EventManager stamp the event if the edge went unseen
+    return edgeLatched[button] ? edgeUs[button] : 0;
+}
+
+void InputManager::onPressed(InputButton button, uint32_t nowMs) {
+    const ButtonPin& pin = INPUT_PINS[button];
+    ButtonState& state = buttons[button];
+    EventManager& eventManager = EventManager::getInstance();
+
+    state.pressedAtMs = nowMs;
+    state.nextRepeatMs = nowMs + REPEAT_DELAY_MS;
+    state.longPressSent = false;
+    heldMask = (uint16_t)(heldMask | (1 << button));
+
+    if (button == INPUT_BACK) {
+        if (nowMs - lastBackPressMs < DOUBLE_PRESS_THRESHOLD_MS) {
+            // Double press detected. Sleeping tears down the haptics task and
+            // queue, which the main loop may be using, so it is left to it.
+            eventManager.queueEvent({EVENT_SLEEP_REQUEST, EVENT_SOURCE_SYSTEM, 0, 0, 0});
+            return;
+        }
+        lastBackPressMs = nowMs;
+    }
+
+    eventManager.queueEvent({pin.event, EVENT_SOURCE_BUTTON, (uint16_t)pin.event, edgeTimestamp(button), 0});
+
+    if (countBits(heldMask) >= 2) {
+        eventManager.queueEvent({EVENT_CHORD, EVENT_SOURCE_BUTTON, heldMask, edgeTimestamp(button), 0});
+    }
+}
+
+void InputManager::onReleased(InputButton button, uint32_t nowMs) {
+    (void)nowMs;
+    const ButtonPin& pin = INPUT_PINS[button];
+    heldMask = (uint16_t)(heldMask & ~(1 << button));
+    EventManager::getInstance().queueEvent({EVENT_RELEASE, EVENT_SOURCE_BUTTON, (uint16_t)pin.event, edgeTimestamp(button), 0});
+}
+
+uint32_t InputManager::serviceHeld(uint32_t nowMs) {
+    EventManager& eventManager = EventManager::getInstance();
+    uint32_t untilDeadline = NO_DEADLINE;
+
+    for (int i = 0; i < INPUT_BUTTON_COUNT; i++) {
+        const ButtonPin& pin = INPUT_PINS[i];
+        ButtonState& state = buttons[i];
+        if (!state.pressed) {
+            continue;
+        }
+
+        uint32_t remaining;
+        if (pin.repeats) {
+            if ((int32_t)(nowMs - state.nextRepeatMs) >= 0) {
+                eventManager.queueEvent({pin.event, EVENT_SOURCE_BUTTON,
+                                         (uint16_t)(pin.event | INPUT_FLAG_REPEAT), 0, 0});
+                state.nextRepeatMs += REPEAT_INTERVAL_MS;
+                if ((int32_t)(nowMs - state.nextRepeatMs) >= 0) {
+                    // Fell behind; don't burst to catch up
+                    state.nextRepeatMs = nowMs + REPEAT_INTERVAL_MS;
+                }
+            }
+            remaining = state.nextRepeatMs - nowMs;
+        } else if (!state.longPressSent) {
+            uint32_t heldFor = nowMs - state.pressedAtMs;
+            if (heldFor >= LONG_PRESS_MS) {
+                eventManager.queueEvent({EVENT_LONG_PRESS, EVENT_SOURCE_BUTTON, (uint16_t)pin.event, 0, 0});
+                state.longPressSent = true;
+                continue;
+            }
+            remaining = LONG_PRESS_MS - heldFor;
+        } else {
+            continue;
+        }
+
+        if (remaining < untilDeadline) {
+            untilDeadline = remaining;
+        }
+    }
+
+    return untilDeadline;
+}
+
+} // namespace NuggetsInc
@@ -16,50 +16,175 @@
 #include "Settings/RemoteBrowserState.h"
 #include "Communication/MacAddressMenuState.h"
 #include "Communication/SyncNodesState.h"
+#include <new>
+#include <type_traits>
 
 namespace NuggetsInc {
 
-AppState* StateFactory::createState(StateType type) {
-    return new ClearState(type);
+namespace {
+
+// Size and alignment of the largest of a list of types
+template <typename... Types>
+struct LargestOf;
+
+template <typename T>
+struct LargestOf<T> {
+    static const size_t size = sizeof(T);
+    static const size_t align = alignof(T);
+};
+
+template <typename T, typename... Rest>
+struct LargestOf<T, Rest...> {
+    static const size_t size = sizeof(T) > LargestOf<Rest...>::size ? sizeof(T) : LargestOf<Rest...>::size;
+    static const size_t align = alignof(T) > LargestOf<Rest...>::align ? alignof(T) : LargestOf<Rest...>::align;
+};
+
+// Every transient state createActualState() can build; build() rejects at
+// compile time any state that would not fit the slot sized from this list
+typedef LargestOf<SnakeGameState, CloneNFCState, EnterRemoteControlState,
+                  RemoteControlState, SetupNFCDeviceState, IRRemoteState,
+                  PowerOptionsState, SettingsState, SetupNewRemoteState,
+                  RemoteBrowserState, MacAddressMenuState, SyncNodesState> ActualStates;
+
+std::aligned_storage<ActualStates::size, ActualStates::align>::type stateSlot;
+std::aligned_storage<sizeof(ClearState), alignof(ClearState)>::type clearSlot;
+bool stateSlotInUse = false;
+bool clearSlotInUse = false;
+StateType stateSlotType = MENU_STATE;
+
+bool isInSlot(const void* state, const void* slot, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(state);
+    const uint8_t* begin = static_cast<const uint8_t*>(slot);
+    return p >= begin && p < begin + size;
 }
 
-AppState* StateFactory::createActualState(StateType type) {
+template <typename T, typename... Args>
+AppState* build(Args... args) {
+    static_assert(sizeof(T) <= sizeof(stateSlot), "state does not fit the state slot");
+    static_assert(alignof(T) <= ActualStates::align, "state needs a stricter alignment than the state slot");
+    stateSlotInUse = true;
+    return new (&stateSlot) T(args...);
+}
+
+template <typename T>
+AppState* resident() {
+    static T instance;
+    return &instance;
+}
+
+AppState* retainedState(StateType type) {
     switch (type) {
         case MENU_STATE:
-            return new MenuState();
+            return resident<MenuState>();
+        case NFC_OPTIONS_STATE:
+            return resident<NFCOptionsState>();
+        case IR_OPTIONS_STATE:
+            return resident<IROptionsState>();
+        case APPLICATION_STATE:
+            return resident<ApplicationState>();
+        default:
+            return nullptr;
+    }
+}
+
+} // namespace
+
+AppState* StateFactory::createState(StateType type, const uint8_t* peerMac) {
+    AppState* retained = retainedState(type);
+    if (retained != nullptr) {
+        return retained;
+    }
+
+    if (clearSlotInUse) {
+        Serial.println("StateFactory: transition already in progress");
+        return nullptr;
+    }
+    clearSlotInUse = true;
+    return new (&clearSlot) ClearState(type, peerMac);
+}
+
+AppState* StateFactory::createActualState(StateType type, const uint8_t* peerMac) {
+    AppState* retained = retainedState(type);
+    if (retained != nullptr) {
+        return retained;
+    }
+
+    if (stateSlotInUse) {
+        Serial.println("StateFactory: previous state still alive");
+        return nullptr;
+    }
+
+    stateSlotType = type;
+    switch (type) {
         case SNAKE_GAME_STATE:
-            return new SnakeGameState();
+            return build<SnakeGameState>();
         case CLONE_NFC_STATE:
-            return new CloneNFCState();
+            return build<CloneNFCState>();
         case ENTER_REMOTE_CONTROL_STATE:
-            return new EnterRemoteControlState();
+            return build<EnterRemoteControlState>();
         case REMOTE_CONTROL_STATE:
-            return new RemoteControlState();
+            return build<RemoteControlState>(peerMac);
         case SETUP_NFC_DEVICE_STATE:
-            return new SetupNFCDeviceState();
-        case APPLICATION_STATE:
-            return new ApplicationState();
-        case IR_OPTIONS_STATE:
-            return new IROptionsState();
+            return build<SetupNFCDeviceState>();
         case IR_REMOTE_STATE:
-            return new IRRemoteState();
-        case NFC_OPTIONS_STATE:
-            return new NFCOptionsState();
+            return build<IRRemoteState>();
         case POWER_OPTIONS_STATE:
-            return new PowerOptionsState();
+            return build<PowerOptionsState>();
         case SETTINGS_STATE:
-            return new SettingsState();
+            return build<SettingsState>();
         case SETUP_NEW_REMOTE_STATE:
-            return new SetupNewRemoteState();
+            return build<SetupNewRemoteState>();
         case REMOTE_BROWSER_STATE:
-            return new RemoteBrowserState();
+            return build<RemoteBrowserState>();
         case MAC_ADDRESS_MENU_STATE:
-            return new MacAddressMenuState();
+            return build<MacAddressMenuState>();
         case SYNC_NODES_STATE:
-            return new SyncNodesState();
+            return build<SyncNodesState>();
         default:
             return nullptr;
     }
 }
 
+void StateFactory::destroyState(AppState* state) {
+    if (state == nullptr) {
+        return;
+    }
+
+    if (isInSlot(state, &clearSlot, sizeof(clearSlot))) {
+        state->~AppState();
+        clearSlotInUse = false;
+    } else if (isInSlot(state, &stateSlot, sizeof(stateSlot))) {
+        state->~AppState();
+        stateSlotInUse = false;
+    }
+}
+
+bool StateFactory::isRetained(const AppState* state) {
+    return state != nullptr &&
+           !isInSlot(state, &clearSlot, sizeof(clearSlot)) &&
+           !isInSlot(state, &stateSlot, sizeof(stateSlot));
+}
+
+StateType StateFactory::typeOf(const AppState* state) {
+    if (isInSlot(state, &clearSlot, sizeof(clearSlot))) {
+        return CLEAR_STATE;
+    }
+    if (isInSlot(state, &stateSlot, sizeof(stateSlot))) {
+        return stateSlotType;
+    }
+
+    static const StateType retainedTypes[] = {MENU_STATE, NFC_OPTIONS_STATE, IR_OPTIONS_STATE,
+                                              APPLICATION_STATE};
+    for (size_t i = 0; i < sizeof(retainedTypes) / sizeof(retainedTypes[0]); i++) {
+        if (retainedState(retainedTypes[i]) == state) {
+            return retainedTypes[i];
+        }
+    }
+    return STATE_TYPE_COUNT;
+}
+
+size_t StateFactory::storageSize() {
+    return sizeof(stateSlot) + sizeof(clearSlot);
+}
+
 } // namespace NuggetsInc
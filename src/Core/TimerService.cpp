@@ -0,0 +1,285 @@
+#include "TimerService.h"
+#include "Application.h"
+#include <freertos/FreeRTOS.h>
+
+namespace NuggetsInc {
+
+namespace {
+
+portMUX_TYPE timerLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Wrap-safe ordering of millis() timestamps
+bool dueBefore(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+} // namespace
+
+TimerService& TimerService::getInstance() {
+    static TimerService instance;
+    return instance;
+}
+
+TimerService::TimerService() : count(0), nextId(INVALID_TIMER), missedDeadlines(0) {}
+
+TimerService::TimerId TimerService::scheduleOnce(uint32_t delayMs, Callback callback, void* context) {
+    Job once = {nullptr, 0, 0, 0};
+    return schedule(delayMs, once, callback, context);
+}
+
+TimerService::TimerId TimerService::schedulePeriodic(uint32_t periodMs, Callback callback, void* context) {
+    // A zero period would run the callback forever within one runDue()
+    Job periodic = {nullptr, periodMs > 0 ? periodMs : 1, 0, 0};
+    return schedule(periodic.periodMs, periodic, callback, context);
+}
+
+TimerService::TimerId TimerService::schedulePeriodic(const Job& job, Callback callback, void* context) {
+    Job periodic = job;
+    if (periodic.periodMs == 0) {
+        periodic.periodMs = 1;
+    }
+    if (periodic.deadlineMs == 0) {
+        periodic.deadlineMs = periodic.periodMs;
+    }
+    return schedule(periodic.periodMs, periodic, callback, context);
+}
+
+TimerService::TimerId TimerService::schedule(uint32_t delayMs, const Job& job,
+                                             Callback callback, void* context) {
+    if (callback == nullptr) {
+        return INVALID_TIMER;
+    }
+
+    Timer timer;
+    timer.dueMs = millis() + delayMs;
+    timer.periodMs = job.periodMs;
+    timer.slackMs = job.slackMs;
+    timer.deadlineMs = job.deadlineMs;
+    timer.callback = callback;
+    timer.context = context;
+    timer.name = job.name;
+    timer.runs = 0;
+    timer.misses = 0;
+    timer.worstLateMs = 0;
+
+    bool earliest;
+    portENTER_CRITICAL(&timerLock);
+    if (count >= MAX_TIMERS) {
+        portEXIT_CRITICAL(&timerLock);
+        Serial.println("TimerService: no free timer slot");
+        return INVALID_TIMER;
+    }
+    if (++nextId == INVALID_TIMER) {
+        ++nextId;
+    }
+    timer.id = nextId;
+    insert(timer);
+    earliest = timers[0].id == timer.id;
+    portEXIT_CRITICAL(&timerLock);
+
+    if (earliest) {
+        // The loop may be asleep on a later deadline
+        Application::getInstance().wake();
+    }
+    return timer.id;
+}
+
+bool TimerService::cancel(TimerId id) {
+    if (id == INVALID_TIMER) {
+        return false;
+    }
+
+    bool found = false;
+    Timer removed;
+    portENTER_CRITICAL(&timerLock);
+    for (uint8_t i = 0; i < count; i++) {
+        if (timers[i].id == id) {
+            removed = timers[i];
+            removeAt(i);
+            found = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&timerLock);
+
+    if (found) {
+        reportRemoved(removed);
+    }
+    return found;
+}
+
+void TimerService::cancelAll(void* context) {
+    Timer removed[MAX_TIMERS];
+    uint8_t removedCount = 0;
+
+    portENTER_CRITICAL(&timerLock);
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (timers[i].context != context) {
+            timers[kept++] = timers[i];
+        } else {
+            removed[removedCount++] = timers[i];
+        }
+    }
+    count = kept;
+    for (int i = count / 2 - 1; i >= 0; i--) {
+        siftDown((uint8_t)i);
+    }
+    portEXIT_CRITICAL(&timerLock);
+
+    for (uint8_t i = 0; i < removedCount; i++) {
+        reportRemoved(removed[i]);
+    }
+}
+
+void TimerService::runDue() {
+    while (true) {
+        uint32_t now = millis();
+
+        portENTER_CRITICAL(&timerLock);
+        if (count == 0 || dueBefore(now, timers[0].dueMs)) {
+            portEXIT_CRITICAL(&timerLock);
+            return;
+        }
+        Timer due = timers[0];
+        removeAt(0);
+        bool firstMiss = false;
+        if (due.deadlineMs > 0) {
+            uint32_t lateMs = now - due.dueMs;
+            firstMiss = lateMs > due.deadlineMs && due.misses == 0;
+            recordLateness(due, lateMs);
+        }
+        if (due.periodMs > 0) {
+            Timer next = due;
+            next.dueMs += due.periodMs;
+            if (!dueBefore(now, next.dueMs)) {
+                // Fell behind; don't burst to catch up
+                next.dueMs = now + due.periodMs;
+            }
+            insert(next);
+        }
+        portEXIT_CRITICAL(&timerLock);
+
+        if (firstMiss) {
+            Serial.printf("TimerService: %s started %lu ms late (deadline %lu ms)\n",
+                          due.name ? due.name : "job", (unsigned long)(now - due.dueMs),
+                          (unsigned long)due.deadlineMs);
+        }
+        due.callback(due.context);
+    }
+}
+
+uint32_t TimerService::msUntilNext() {
+    uint32_t untilNext = NO_TIMER;
+    portENTER_CRITICAL(&timerLock);
+    if (count > 0) {
+        // Sleep until the first timer runs out of slack; everything due by
+        // then runs on the same wakeup
+        uint32_t now = millis();
+        for (uint8_t i = 0; i < count; i++) {
+            uint32_t latest = timers[i].dueMs + timers[i].slackMs;
+            uint32_t until = dueBefore(now, latest) ? latest - now : 0;
+            if (until < untilNext) {
+                untilNext = until;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&timerLock);
+    return untilNext;
+}
+
+void TimerService::report(Print& out) {
+    Timer live[MAX_TIMERS];
+    uint8_t liveCount;
+    portENTER_CRITICAL(&timerLock);
+    liveCount = count;
+    for (uint8_t i = 0; i < count; i++) {
+        live[i] = timers[i];
+    }
+    portEXIT_CRITICAL(&timerLock);
+
+    out.printf("Timers: %u live, %lu deadline misses in total\n", liveCount,
+               (unsigned long)missedDeadlines);
+    for (uint8_t i = 0; i < liveCount; i++) {
+        const Timer& timer = live[i];
+        if (timer.deadlineMs == 0) {
+            continue;
+        }
+        out.printf("  %-20s every %5lu ms  runs %-7lu misses %-5lu worst late %lu ms\n",
+                   timer.name ? timer.name : "job", (unsigned long)timer.periodMs,
+                   (unsigned long)timer.runs, (unsigned long)timer.misses,
+                   (unsigned long)timer.worstLateMs);
+    }
+}
+
+void TimerService::recordLateness(Timer& timer, uint32_t lateMs) {
+    timer.runs++;
+    if (lateMs > timer.worstLateMs) {
+        timer.worstLateMs = lateMs;
+    }
+    if (lateMs > timer.deadlineMs) {
+        timer.misses++;
+        missedDeadlines++;
+    }
+}
+
+void TimerService::reportRemoved(const Timer& timer) {
+    if (timer.misses == 0) {
+        return;
+    }
+    Serial.printf("TimerService: %s missed %lu of %lu deadlines, worst %lu ms late\n",
+                  timer.name ? timer.name : "job", (unsigned long)timer.misses,
+                  (unsigned long)timer.runs, (unsigned long)timer.worstLateMs);
+}
+
+void TimerService::insert(const Timer& timer) {
+    timers[count] = timer;
+    siftUp(count);
+    count++;
+}
+
+void TimerService::removeAt(uint8_t index) {
+    count--;
+    if (index == count) {
+        return;
+    }
+    timers[index] = timers[count];
+    siftDown(index);
+    siftUp(index);
+}
+
+void TimerService::siftUp(uint8_t index) {
+    while (index > 0) {
+        uint8_t parent = (index - 1) / 2;
+        if (!dueBefore(timers[index].dueMs, timers[parent].dueMs)) {
+            break;
+        }
+        Timer swap = timers[index];
+        timers[index] = timers[parent];
+        timers[parent] = swap;
+        index = parent;
+    }
+}
+
+void TimerService::siftDown(uint8_t index) {
+    while (true) {
+        uint8_t smallest = index;
+        uint8_t left = 2 * index + 1;
+        uint8_t right = left + 1;
+        if (left < count && dueBefore(timers[left].dueMs, timers[smallest].dueMs)) {
+            smallest = left;
+        }
+        if (right < count && dueBefore(timers[right].dueMs, timers[smallest].dueMs)) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            return;
+        }
+        Timer swap = timers[index];
+        timers[index] = timers[smallest];
+        timers[smallest] = swap;
+        index = smallest;
+    }
+}
+
+} // namespace NuggetsInc
@@ -0,0 +1,18 @@
+#include "Benchmarks.h"
+
+#ifdef NUGGETS_BENCHMARKS
+
+namespace NuggetsInc {
+
+void runBenchmarks() {
+    Serial.println("=== Benchmarks ===");
+    runStateBenchmark();
+    runNavigationBenchmark();
+    runReplayBenchmark();
+    runDisplayCodecBenchmark();
+    Serial.println("=== Benchmarks done ===");
+}
+
+} // namespace NuggetsInc
+
+#endif // NUGGETS_BENCHMARKS
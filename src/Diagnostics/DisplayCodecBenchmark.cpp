@@ -0,0 +1,161 @@
+#include "Benchmarks.h"
+
+#ifdef NUGGETS_BENCHMARKS
+
+#include "DisplayCodec.h"
+#include "MessageTypes.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace NuggetsInc {
+
+namespace {
+
+struct Sample {
+    uint8_t commandID;
+    DisplayArgs args;
+    char text[64];
+    uint8_t binary[64];
+    size_t binaryLength;
+};
+
+// The mix a plotting or status screen sends: mostly points and rectangles
+uint8_t commandFor(uint32_t i) {
+    static const uint8_t mix[] = {CMD_PLOT_POINT, CMD_PLOT_POINT, CMD_PLOT_POINT, CMD_FILL_RECT,
+                                  CMD_DRAW_RECT,  CMD_SET_CURSOR, CMD_SET_TEXT_COLOR,
+                                  CMD_SET_TEXT_SIZE};
+    return mix[i % (sizeof(mix) / sizeof(mix[0]))];
+}
+
+void makeSample(uint32_t i, Sample& sample) {
+    uint32_t rng = i * 2654435761u;
+    memset(&sample, 0, sizeof(sample));
+    sample.commandID = commandFor(i);
+    DisplayArgs& args = sample.args;
+    switch (sample.commandID) {
+        case CMD_PLOT_POINT:
+            args.point.x = (int16_t)(rng % 536);
+            args.point.y = (int16_t)((rng >> 10) % 240);
+            args.point.color = (uint16_t)(rng >> 16);
+            break;
+        case CMD_FILL_RECT:
+        case CMD_DRAW_RECT:
+            args.rect.x = (int16_t)(rng % 300);
+            args.rect.y = (int16_t)((rng >> 9) % 200);
+            args.rect.w = (int16_t)((rng >> 4) % 200 + 1);
+            args.rect.h = (int16_t)((rng >> 12) % 40 + 1);
+            args.rect.color = (uint16_t)(rng >> 16);
+            break;
+        case CMD_SET_CURSOR:
+            args.cursor.x = (int16_t)(rng % 536);
+            args.cursor.y = (int16_t)((rng >> 10) % 240);
+            break;
+        case CMD_SET_TEXT_COLOR:
+            args.color.color = (uint16_t)(rng >> 16);
+            break;
+        default:
+            args.textSize.size = (uint8_t)(rng % 4 + 1);
+            break;
+    }
+    DisplayCodec::formatText(sample.commandID, args, sample.text, sizeof(sample.text));
+    sample.binaryLength =
+        DisplayCodec::encode(sample.commandID, args, sample.binary, sizeof(sample.binary));
+}
+
+// How RemoteControlState parsed the text before DisplayCodec
+bool sscanfDecode(uint8_t commandID, const char* text, DisplayArgs& args) {
+    int a, b, c, d, e;
+    switch (commandID) {
+        case CMD_PLOT_POINT:
+            if (sscanf(text, "%d,%d, %d", &a, &b, &c) != 3) return false;
+            args.point.x = a;
+            args.point.y = b;
+            args.point.color = c;
+            return true;
+        case CMD_FILL_RECT:
+        case CMD_DRAW_RECT:
+            if (sscanf(text, "%d,%d,%d,%d,%d", &a, &b, &c, &d, &e) != 5) return false;
+            args.rect.x = a;
+            args.rect.y = b;
+            args.rect.w = c;
+            args.rect.h = d;
+            args.rect.color = e;
+            return true;
+        case CMD_SET_CURSOR:
+            if (sscanf(text, "%d,%d", &a, &b) != 2) return false;
+            args.cursor.x = a;
+            args.cursor.y = b;
+            return true;
+        case CMD_SET_TEXT_COLOR:
+            if (sscanf(text, "%d", &a) != 1) return false;
+            args.color.color = a;
+            return true;
+        default:
+            if (sscanf(text, "%d", &a) != 1 || a <= 0) return false;
+            args.textSize.size = a;
+            return true;
+    }
+}
+
+void report(const char* label, uint32_t elapsedUs, uint32_t failures) {
+    Serial.printf("  %-10s %7.3f us/command  failures %u\n", label,
+                  (float)elapsedUs / DISPLAY_CODEC_BENCHMARK_COMMANDS, (unsigned)failures);
+}
+
+} // namespace
+
+void runDisplayCodecBenchmark() {
+    static Sample samples[DISPLAY_CODEC_BENCHMARK_SAMPLES];
+    uint32_t textBytes = 0;
+    uint32_t binaryBytes = 0;
+    for (uint32_t i = 0; i < DISPLAY_CODEC_BENCHMARK_SAMPLES; i++) {
+        makeSample(i, samples[i]);
+        textBytes += strlen(samples[i].text);
+        binaryBytes += samples[i].binaryLength;
+    }
+
+    Serial.printf("Display arguments: %u commands, text %.1f bytes/command, binary %.1f\n",
+                  (unsigned)DISPLAY_CODEC_BENCHMARK_COMMANDS,
+                  (float)textBytes / DISPLAY_CODEC_BENCHMARK_SAMPLES,
+                  (float)binaryBytes / DISPLAY_CODEC_BENCHMARK_SAMPLES);
+
+    // Checked against the source arguments, so a fast but wrong decoder shows up
+    DisplayArgs args;
+    uint32_t failures = 0;
+    uint32_t startUs = micros();
+    for (uint32_t i = 0; i < DISPLAY_CODEC_BENCHMARK_COMMANDS; i++) {
+        const Sample& sample = samples[i % DISPLAY_CODEC_BENCHMARK_SAMPLES];
+        memset(&args, 0, sizeof(args));
+        if (!sscanfDecode(sample.commandID, sample.text, args) ||
+            memcmp(&args, &sample.args, sizeof(args)) != 0) {
+            failures++;
+        }
+    }
+    report("sscanf", micros() - startUs, failures);
+
+    failures = 0;
+    startUs = micros();
+    for (uint32_t i = 0; i < DISPLAY_CODEC_BENCHMARK_COMMANDS; i++) {
+        const Sample& sample = samples[i % DISPLAY_CODEC_BENCHMARK_SAMPLES];
+        if (!DisplayCodec::parseText(sample.commandID, sample.text, args) ||
+            memcmp(&args, &sample.args, sizeof(args)) != 0) {
+            failures++;
+        }
+    }
+    report("parseText", micros() - startUs, failures);
+
+    failures = 0;
+    startUs = micros();
+    for (uint32_t i = 0; i < DISPLAY_CODEC_BENCHMARK_COMMANDS; i++) {
+        const Sample& sample = samples[i % DISPLAY_CODEC_BENCHMARK_SAMPLES];
+        if (!DisplayCodec::decode(sample.commandID, sample.binary, sample.binaryLength, args) ||
+            memcmp(&args, &sample.args, sizeof(args)) != 0) {
+            failures++;
+        }
+    }
+    report("binary", micros() - startUs, failures);
+}
+
+} // namespace NuggetsInc
+
+#endif // NUGGETS_BENCHMARKS
@@ -0,0 +1,88 @@
+#include "LatencyHistogram.h"
+#include <string.h>
+
+namespace NuggetsInc {
+
+namespace {
+
+int highestBit(uint32_t value) {
+    return 31 - __builtin_clz(value);
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    memset(buckets, 0, sizeof(buckets));
+    samples = 0;
+    maxUs = 0;
+}
+
+int LatencyHistogram::bucketFor(uint32_t us) {
+    // 0-7 get a bucket each, then four per power of two
+    if (us < 8) {
+        return us;
+    }
+    int exponent = highestBit(us);
+    int index = 8 + (exponent - 3) * 4 + ((us >> (exponent - 2)) & 3);
+    return index < BUCKETS ? index : BUCKETS - 1;
+}
+
+uint32_t LatencyHistogram::bucketUpperBound(int index) {
+    if (index < 8) {
+        return index;
+    }
+    int exponent = (index - 8) / 4 + 3;
+    uint32_t width = 1UL << (exponent - 2);
+    return (4 + (index - 8) % 4) * width + width - 1;
+}
+
+void LatencyHistogram::record(uint32_t us) {
+    int index = bucketFor(us);
+    if (buckets[index] == 0xFFFF) {
+        for (int i = 0; i < BUCKETS; i++) {
+            buckets[i] >>= 1;
+        }
+    }
+    buckets[index]++;
+    samples++;
+    if (us > maxUs) {
+        maxUs = us;
+    }
+}
+
+uint32_t LatencyHistogram::percentile(uint8_t pct) const {
+    uint32_t total = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        total += buckets[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    // Rank of the sample we want, rounded up so p100 is the last one
+    uint32_t rank = (total * pct + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint32_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            uint32_t bound = bucketUpperBound(i);
+            return bound < maxUs ? bound : maxUs;
+        }
+    }
+    return maxUs;
+}
+
+void LatencyHistogram::print(Print& out, const char* label) const {
+    out.printf("  %-20s n=%-8lu p50 %6lu us  p99 %6lu us  max %6lu us\n", label,
+               (unsigned long)samples, (unsigned long)percentile(50),
+               (unsigned long)percentile(99), (unsigned long)maxUs);
+}
+
+} // namespace NuggetsInc
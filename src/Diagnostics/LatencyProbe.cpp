@@ -0,0 +1,153 @@
+#include "LatencyProbe.h"
+
+#ifdef NUGGETS_BENCHMARKS
+
+#include "DisplayUtils.h"
+#include <freertos/FreeRTOS.h>
+#include <string.h>
+
+namespace NuggetsInc {
+
+namespace {
+
+// Kept thread-safe so the probe can be fed from any task
+portMUX_TYPE probeLock = portMUX_INITIALIZER_UNLOCKED;
+
+String summaryLine(const char* label, const LatencyHistogram& histogram) {
+    char line[64];
+    snprintf(line, sizeof(line), "%-13s p50 %5lu p99 %5lu us", label,
+             (unsigned long)histogram.percentile(50), (unsigned long)histogram.percentile(99));
+    return String(line);
+}
+
+} // namespace
+
+LatencyProbe& LatencyProbe::getInstance() {
+    static LatencyProbe instance;
+    return instance;
+}
+
+LatencyProbe::LatencyProbe() {
+    reset();
+}
+
+void LatencyProbe::reset() {
+    portENTER_CRITICAL(&probeLock);
+    hasOpenSample = false;
+    memset(&openEvent, 0, sizeof(openEvent));
+    dispatchUs = 0;
+    memset(inFlight, 0, sizeof(inFlight));
+    nextSlot = 0;
+    edgeToQueued.reset();
+    queuedToDispatch.reset();
+    dispatchToSent.reset();
+    sentToAck.reset();
+    edgeToAck.reset();
+    sendFailures = 0;
+    lostAcks = 0;
+    unmatchedAcks = 0;
+    portEXIT_CRITICAL(&probeLock);
+}
+
+void LatencyProbe::beginSample(const Event& event) {
+    openEvent = event;
+    dispatchUs = (uint32_t)micros();
+    hasOpenSample = true;
+}
+
+void LatencyProbe::commandSent(uint32_t messageID, bool accepted) {
+    if (!hasOpenSample) {
+        return;
+    }
+    hasOpenSample = false;
+    uint32_t sentUs = (uint32_t)micros();
+
+    portENTER_CRITICAL(&probeLock);
+    edgeToQueued.record(openEvent.queuedUs - openEvent.timestampUs);
+    queuedToDispatch.record(dispatchUs - openEvent.queuedUs);
+    dispatchToSent.record(sentUs - dispatchUs);
+    if (!accepted) {
+        sendFailures++;
+    } else {
+        Sample& slot = inFlight[nextSlot];
+        if (slot.waiting) {
+            lostAcks++;
+        }
+        slot.messageID = messageID;
+        slot.edgeUs = openEvent.timestampUs;
+        slot.sentUs = sentUs;
+        slot.waiting = true;
+        nextSlot = (nextSlot + 1) % MAX_IN_FLIGHT;
+    }
+    portEXIT_CRITICAL(&probeLock);
+}
+
+void LatencyProbe::ackReceived(uint32_t messageID, uint32_t receivedUs) {
+    portENTER_CRITICAL(&probeLock);
+    bool matched = false;
+    for (uint8_t i = 0; i < MAX_IN_FLIGHT; i++) {
+        Sample& sample = inFlight[i];
+        if (sample.waiting && sample.messageID == messageID) {
+            sentToAck.record(receivedUs - sample.sentUs);
+            edgeToAck.record(receivedUs - sample.edgeUs);
+            sample.waiting = false;
+            matched = true;
+            break;
+        }
+    }
+    if (!matched) {
+        unmatchedAcks++;
+    }
+    portEXIT_CRITICAL(&probeLock);
+}
+
+void LatencyProbe::report(Print& out) {
+    // Copied under the lock so a late ack cannot tear the report
+    portENTER_CRITICAL(&probeLock);
+    LatencyHistogram edgeQueued = edgeToQueued;
+    LatencyHistogram queuedDispatch = queuedToDispatch;
+    LatencyHistogram dispatchSent = dispatchToSent;
+    LatencyHistogram sentAck = sentToAck;
+    LatencyHistogram edgeAck = edgeToAck;
+    uint32_t failures = sendFailures;
+    uint32_t lost = lostAcks;
+    uint32_t unmatched = unmatchedAcks;
+    uint32_t waiting = 0;
+    for (uint8_t i = 0; i < MAX_IN_FLIGHT; i++) {
+        waiting += inFlight[i].waiting ? 1 : 0;
+    }
+    portEXIT_CRITICAL(&probeLock);
+
+    out.println("=== Remote control latency ===");
+    edgeQueued.print(out, "edge->queued");
+    queuedDispatch.print(out, "queued->dispatch");
+    dispatchSent.print(out, "dispatch->sent");
+    sentAck.print(out, "sent->ack");
+    edgeAck.print(out, "edge->ack");
+    out.printf("  send failures %lu  lost acks %lu  unmatched acks %lu  awaiting ack %lu\n",
+               (unsigned long)failures, (unsigned long)lost, (unsigned long)unmatched,
+               (unsigned long)waiting);
+}
+
+void LatencyProbe::show(DisplayUtils& display) {
+    portENTER_CRITICAL(&probeLock);
+    LatencyHistogram edgeQueued = edgeToQueued;
+    LatencyHistogram queuedDispatch = queuedToDispatch;
+    LatencyHistogram dispatchSent = dispatchToSent;
+    LatencyHistogram sentAck = sentToAck;
+    LatencyHistogram edgeAck = edgeToAck;
+    uint32_t lost = lostAcks;
+    portEXIT_CRITICAL(&probeLock);
+
+    display.newTerminalDisplay("Latency, " + String(edgeAck.count()) + " acked, " +
+                               String(lost) + " lost");
+    display.addToTerminalDisplay(summaryLine("edge->queue", edgeQueued));
+    display.addToTerminalDisplay(summaryLine("queue->loop", queuedDispatch));
+    display.addToTerminalDisplay(summaryLine("loop->sent", dispatchSent));
+    display.addToTerminalDisplay(summaryLine("sent->ack", sentAck));
+    display.addToTerminalDisplay(summaryLine("edge->ack", edgeAck));
+}
+
+} // namespace NuggetsInc
+
+#endif // NUGGETS_BENCHMARKS
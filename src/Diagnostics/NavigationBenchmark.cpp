@@ -0,0 +1,56 @@
+#include "Benchmarks.h"
+
+#ifdef NUGGETS_BENCHMARKS
+
+#include "Application.h"
+#include "StateFactory.h"
+
+namespace NuggetsInc {
+
+namespace {
+
+struct Timing {
+    uint32_t totalUs;
+    uint32_t worstUs;
+};
+
+void record(Timing& timing, uint32_t elapsedUs) {
+    timing.totalUs += elapsedUs;
+    if (elapsedUs > timing.worstUs) {
+        timing.worstUs = elapsedUs;
+    }
+}
+
+void printTiming(const char* label, const Timing& timing) {
+    Serial.printf("  %-5s avg %.1f us  worst %u us\n", label,
+                  (float)timing.totalUs / NAVIGATION_BENCHMARK_ROUNDS, (unsigned)timing.worstUs);
+}
+
+} // namespace
+
+void runNavigationBenchmark() {
+    Serial.printf("Navigation: %u push/pop rounds between retained menus\n",
+                  (unsigned)NAVIGATION_BENCHMARK_ROUNDS);
+
+    Application& app = Application::getInstance();
+    app.changeState(StateFactory::createState(MENU_STATE));
+
+    Timing push = {0, 0};
+    Timing pop = {0, 0};
+    for (uint32_t i = 0; i < NAVIGATION_BENCHMARK_ROUNDS; i++) {
+        uint32_t startUs = micros();
+        app.pushState(StateFactory::createState(NFC_OPTIONS_STATE));
+        record(push, micros() - startUs);
+
+        startUs = micros();
+        app.popState();
+        record(pop, micros() - startUs);
+    }
+
+    printTiming("push", push);
+    printTiming("pop", pop);
+}
+
+} // namespace NuggetsInc
+
+#endif // NUGGETS_BENCHMARKS
@@ -0,0 +1,166 @@
+#include "Profiler.h"
+
+#ifdef NUGGETS_PROFILING
+
+#include "TimerService.h"
+#include <string.h>
+
+namespace NuggetsInc {
+
+namespace {
+
+// Indexed by StateType
+const char* const stateNames[] = {
+    "Menu",
+    "SnakeGame",
+    "Clear",
+    "CloneNFC",
+    "EnterRemoteControl",
+    "RemoteControl",
+    "SetupNFCDevice",
+    "Application",
+    "IROptions",
+    "IRRemote",
+    "SetupNewRemote",
+    "RemoteBrowser",
+    "NFCOptions",
+    "PowerOptions",
+    "Settings",
+    "MacAddressMenu",
+    "SyncNodes",
+};
+static_assert(sizeof(stateNames) / sizeof(stateNames[0]) == STATE_TYPE_COUNT,
+              "stateNames is out of step with StateType");
+
+} // namespace
+
+Profiler& Profiler::getInstance() {
+    static Profiler instance;
+    return instance;
+}
+
+Profiler::Profiler() : commandLength(0) {
+    reset();
+}
+
+void Profiler::begin() {
+    reset();
+    TimerService::getInstance().schedulePeriodic(CONSOLE_POLL_MS, pollConsole, this);
+}
+
+void Profiler::reset() {
+    loopTimes.reset();
+    timerTimes.reset();
+    for (int i = 0; i < STATE_TYPE_COUNT; i++) {
+        updateTimes[i].reset();
+    }
+    loops = 0;
+    busyUs = 0;
+    windowStartMs = millis();
+
+    memset(blocking, 0, sizeof(blocking));
+    blockingCount = 0;
+    blockingDropped = 0;
+}
+
+void Profiler::recordLoop(uint32_t us) {
+    loopTimes.record(us);
+    loops++;
+    busyUs += us;
+}
+
+void Profiler::recordTimers(uint32_t us) {
+    timerTimes.record(us);
+}
+
+void Profiler::recordUpdate(StateType type, uint32_t us) {
+    if (type < STATE_TYPE_COUNT) {
+        updateTimes[type].record(us);
+    }
+}
+
+void Profiler::recordBlocking(const char* site, uint32_t us) {
+    BlockingSite* entry = nullptr;
+    for (uint8_t i = 0; i < blockingCount; i++) {
+        if (blocking[i].name == site) {
+            entry = &blocking[i];
+            break;
+        }
+    }
+    if (entry == nullptr) {
+        if (blockingCount == MAX_BLOCKING_SITES) {
+            blockingDropped++;
+            return;
+        }
+        entry = &blocking[blockingCount++];
+        entry->name = site;
+    }
+
+    entry->count++;
+    entry->totalUs += us;
+    if (us > entry->maxUs) {
+        entry->maxUs = us;
+    }
+}
+
+void Profiler::dump(Print& out) {
+    uint32_t elapsedMs = millis() - windowStartMs;
+    float seconds = elapsedMs / 1000.0f;
+
+    out.printf("=== Profile over %.1f s ===\n", seconds);
+    out.printf("Loop: %lu iterations, %.1f/s, busy %.2f%%\n", (unsigned long)loops,
+               seconds > 0 ? loops / seconds : 0.0f,
+               elapsedMs > 0 ? busyUs / (elapsedMs * 10.0f) : 0.0f);
+    loopTimes.print(out, "loop (awake)");
+    timerTimes.print(out, "timers");
+
+    out.println("State updates:");
+    for (int i = 0; i < STATE_TYPE_COUNT; i++) {
+        if (updateTimes[i].count() > 0) {
+            updateTimes[i].print(out, stateNames[i]);
+        }
+    }
+
+    out.println("Blocking calls:");
+    for (uint8_t i = 0; i < blockingCount; i++) {
+        const BlockingSite& site = blocking[i];
+        out.printf("  %-20s n=%-8lu total %8lu us  max %6lu us\n", site.name,
+                   (unsigned long)site.count, (unsigned long)site.totalUs,
+                   (unsigned long)site.maxUs);
+    }
+    if (blockingDropped > 0) {
+        out.printf("  (%lu calls from untracked sites)\n", (unsigned long)blockingDropped);
+    }
+    TimerService::getInstance().report(out);
+    out.println("=== Profile end ===");
+}
+
+void Profiler::pollConsole(void* context) {
+    Profiler* profiler = static_cast<Profiler*>(context);
+    while (Serial.available() > 0) {
+        char c = (char)Serial.read();
+        if (c == '\r') {
+            continue;
+        }
+        if (c == '\n') {
+            profiler->command[profiler->commandLength] = '\0';
+            profiler->handleCommand(profiler->command);
+            profiler->commandLength = 0;
+        } else if (profiler->commandLength < sizeof(profiler->command) - 1) {
+            profiler->command[profiler->commandLength++] = c;
+        }
+    }
+}
+
+void Profiler::handleCommand(const char* line) {
+    if (strcmp(line, "prof") == 0) {
+        dump(Serial);
+    } else if (strcmp(line, "prof reset") == 0) {
+        reset();
+        Serial.println("Profile reset");
+    }
+}
+
+} // namespace NuggetsInc
+
+#endif // NUGGETS_PROFILING
@@ -0,0 +1,173 @@
+#include "Benchmarks.h"
+
+#ifdef NUGGETS_BENCHMARKS
+
+#include "ReplayWindow.h"
+#include <map>
+#include <string.h>
+
+namespace NuggetsInc {
+
+namespace {
+
+// Counts the map's node allocations; the heap figures would also pick up
+// whatever the rest of the firmware allocates meanwhile
+uint32_t mapAllocations = 0;
+
+template <typename T>
+struct CountingAllocator {
+    typedef T value_type;
+
+    CountingAllocator() {}
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        mapAllocations++;
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t) { ::operator delete(p); }
+};
+
+template <typename T, typename U>
+bool operator==(const CountingAllocator<T>&, const CountingAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const CountingAllocator<T>&, const CountingAllocator<U>&) { return false; }
+
+// The cache RemoteService used before ReplayWindow, with the clock passed in
+// so the benchmark can play traffic faster than real time
+class MapDeduplicator {
+public:
+    bool isDuplicate(const uint8_t src[6], uint32_t messageID, msec32 nowMs) {
+        const msec32 window = 2000;
+        MsgKey key;
+        memcpy(key.mac, src, 6);
+        key.id = messageID;
+
+        if (cache.find(key) != cache.end()) {
+            return true;
+        }
+        if (cache.size() > 50) {
+            auto it = cache.begin();
+            while (it != cache.end()) {
+                if ((msec32)(nowMs - it->second) >= window) {
+                    it = cache.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        cache[key] = nowMs;
+        return false;
+    }
+
+    size_t size() const { return cache.size(); }
+    // Entry plus the red-black tree node header (colour and three links)
+    static size_t nodeBytes() { return sizeof(Entry) + 4 * sizeof(void*); }
+
+private:
+    struct MsgKey {
+        uint8_t mac[6];
+        uint32_t id;
+    };
+    struct MsgKeyCmp {
+        bool operator()(const MsgKey& a, const MsgKey& b) const {
+            int c = memcmp(a.mac, b.mac, 6);
+            return c < 0 || (c == 0 && a.id < b.id);
+        }
+    };
+    typedef std::pair<const MsgKey, msec32> Entry;
+    std::map<MsgKey, msec32, MsgKeyCmp, CountingAllocator<Entry> > cache;
+};
+
+struct Frame {
+    uint8_t sender;
+    uint32_t sequence;
+    bool retransmission;
+};
+
+// A few senders interleaving fresh commands with retransmissions of recent ones
+Frame nextFrame(uint32_t& rng, uint32_t sequences[]) {
+    rng = rng * 1664525u + 1013904223u;
+    Frame frame;
+    frame.sender = (rng >> 8) % REPLAY_BENCHMARK_SENDERS;
+    frame.retransmission = sequences[frame.sender] > 8 && ((rng >> 16) % 10) == 0;
+    if (frame.retransmission) {
+        frame.sequence = sequences[frame.sender] - ((rng >> 24) % 8);
+    } else {
+        frame.sequence = ++sequences[frame.sender];
+    }
+    return frame;
+}
+
+void senderMac(uint8_t index, uint8_t mac[6]) {
+    static const uint8_t base[6] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x00};
+    memcpy(mac, base, 6);
+    mac[5] = index;
+}
+
+} // namespace
+
+void runReplayBenchmark() {
+    Serial.printf("Duplicate detection: %u frames from %u senders, 10%% retransmitted\n",
+                  (unsigned)REPLAY_BENCHMARK_FRAMES, (unsigned)REPLAY_BENCHMARK_SENDERS);
+
+    uint8_t macs[REPLAY_BENCHMARK_SENDERS][6];
+    for (uint8_t i = 0; i < REPLAY_BENCHMARK_SENDERS; i++) {
+        senderMac(i, macs[i]);
+    }
+
+    // std::map, as before
+    {
+        MapDeduplicator map;
+        uint32_t rng = 1;
+        uint32_t sequences[REPLAY_BENCHMARK_SENDERS] = {};
+        uint32_t flagged = 0;
+        uint32_t wrong = 0;
+        size_t largest = 0;
+        mapAllocations = 0;
+        uint32_t startUs = micros();
+        for (uint32_t i = 0; i < REPLAY_BENCHMARK_FRAMES; i++) {
+            Frame frame = nextFrame(rng, sequences);
+            msec32 nowMs = i * REPLAY_BENCHMARK_FRAME_SPACING_MS;
+            bool duplicate = map.isDuplicate(macs[frame.sender], frame.sequence, nowMs);
+            flagged += duplicate ? 1 : 0;
+            wrong += duplicate != frame.retransmission ? 1 : 0;
+            if (map.size() > largest) {
+                largest = map.size();
+            }
+        }
+        uint32_t elapsedUs = micros() - startUs;
+        Serial.printf("  std::map      %7.3f us/frame  duplicates %u  wrong %u  allocations %u"
+                      "  entries up to %u (%u bytes)\n",
+                      (float)elapsedUs / REPLAY_BENCHMARK_FRAMES, (unsigned)flagged,
+                      (unsigned)wrong, (unsigned)mapAllocations, (unsigned)largest,
+                      (unsigned)(largest * MapDeduplicator::nodeBytes()));
+    }
+
+    // ReplayWindow
+    {
+        static ReplayWindow window;
+        window.reset();
+        uint32_t rng = 1;
+        uint32_t sequences[REPLAY_BENCHMARK_SENDERS] = {};
+        uint32_t flagged = 0;
+        uint32_t wrong = 0;
+        uint32_t startUs = micros();
+        for (uint32_t i = 0; i < REPLAY_BENCHMARK_FRAMES; i++) {
+            Frame frame = nextFrame(rng, sequences);
+            bool duplicate = window.isReplay(macs[frame.sender], frame.sequence);
+            flagged += duplicate ? 1 : 0;
+            wrong += duplicate != frame.retransmission ? 1 : 0;
+        }
+        uint32_t elapsedUs = micros() - startUs;
+        Serial.printf("  ReplayWindow  %7.3f us/frame  duplicates %u  wrong %u  allocations 0"
+                      "  fixed %u bytes\n",
+                      (float)elapsedUs / REPLAY_BENCHMARK_FRAMES, (unsigned)flagged,
+                      (unsigned)wrong, (unsigned)sizeof(ReplayWindow));
+    }
+}
+
+} // namespace NuggetsInc
+
+#endif // NUGGETS_BENCHMARKS
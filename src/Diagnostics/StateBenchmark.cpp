@@ -0,0 +1,100 @@
+#include "Benchmarks.h"
+
+#ifdef NUGGETS_BENCHMARKS
+
+#include "StateFactory.h"
+#include <esp_heap_caps.h>
+
+namespace NuggetsInc {
+
+namespace {
+
+// Transient states whose constructors have no side effects. IRRemoteState
+// and SetupNewRemoteState read flash when built, and RemoteControlState sets
+// up its radio service, so they would measure LittleFS and ESP-NOW instead.
+// Retained menus are never rebuilt; runNavigationBenchmark() covers them.
+const StateType BENCHMARK_STATES[] = {
+    SNAKE_GAME_STATE,
+    CLONE_NFC_STATE,
+    ENTER_REMOTE_CONTROL_STATE,
+    SETUP_NFC_DEVICE_STATE,
+    POWER_OPTIONS_STATE,
+    SETTINGS_STATE,
+    REMOTE_BROWSER_STATE,
+    MAC_ADDRESS_MENU_STATE,
+    SYNC_NODES_STATE,
+};
+
+const size_t BENCHMARK_STATE_COUNT = sizeof(BENCHMARK_STATES) / sizeof(BENCHMARK_STATES[0]);
+const uint32_t HEAP_CAPS = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+
+struct HeapSnapshot {
+    size_t freeBytes;
+    size_t largestBlock;
+    size_t minimumFree;
+};
+
+HeapSnapshot takeHeapSnapshot() {
+    HeapSnapshot snapshot;
+    snapshot.freeBytes = heap_caps_get_free_size(HEAP_CAPS);
+    snapshot.largestBlock = heap_caps_get_largest_free_block(HEAP_CAPS);
+    snapshot.minimumFree = heap_caps_get_minimum_free_size(HEAP_CAPS);
+    return snapshot;
+}
+
+void printHeapSnapshot(const char* label, const HeapSnapshot& snapshot) {
+    // Share of free memory that is not in the largest block
+    float fragmentation = snapshot.freeBytes == 0
+        ? 0.0f
+        : 100.0f * (1.0f - (float)snapshot.largestBlock / (float)snapshot.freeBytes);
+    Serial.printf("  heap %-6s free %u  largest block %u  min free %u  fragmentation %.1f%%\n",
+                  label, (unsigned)snapshot.freeBytes, (unsigned)snapshot.largestBlock,
+                  (unsigned)snapshot.minimumFree, fragmentation);
+}
+
+} // namespace
+
+void runStateBenchmark() {
+    Serial.printf("State transitions: %u through %u states, %u bytes of state storage\n",
+                  (unsigned)STATE_BENCHMARK_TRANSITIONS, (unsigned)BENCHMARK_STATE_COUNT,
+                  (unsigned)StateFactory::storageSize());
+
+    HeapSnapshot before = takeHeapSnapshot();
+    uint32_t totalUs = 0;
+    uint32_t worstUs = 0;
+    uint32_t failures = 0;
+
+    // Same path as Application::changeState, minus onEnter()/onExit(), which
+    // only draw: current -> ClearState -> next state
+    AppState* current = nullptr;
+    for (uint32_t i = 0; i < STATE_BENCHMARK_TRANSITIONS; i++) {
+        uint32_t startUs = micros();
+
+        AppState* clear = StateFactory::createState(BENCHMARK_STATES[i % BENCHMARK_STATE_COUNT]);
+        StateFactory::destroyState(current);
+        current = StateFactory::createActualState(BENCHMARK_STATES[i % BENCHMARK_STATE_COUNT]);
+        StateFactory::destroyState(clear);
+
+        uint32_t elapsedUs = micros() - startUs;
+        totalUs += elapsedUs;
+        if (elapsedUs > worstUs) {
+            worstUs = elapsedUs;
+        }
+        if (clear == nullptr || current == nullptr) {
+            failures++;
+        }
+    }
+    StateFactory::destroyState(current);
+
+    HeapSnapshot after = takeHeapSnapshot();
+
+    Serial.printf("  transition avg %.2f us  worst %u us  failures %u\n",
+                  (float)totalUs / STATE_BENCHMARK_TRANSITIONS, (unsigned)worstUs, (unsigned)failures);
+    printHeapSnapshot("before", before);
+    printHeapSnapshot("after", after);
+    Serial.printf("  heap delta %d bytes\n", (int)after.freeBytes - (int)before.freeBytes);
+}
+
+} // namespace NuggetsInc
+
+#endif // NUGGETS_BENCHMARKS
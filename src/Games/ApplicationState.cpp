@@ -9,19 +9,14 @@ namespace NuggetsInc
 {
 
     ApplicationState::ApplicationState()
-        : menuIndex(0),
-          displayUtils(nullptr)
+        : menuIndex(0)
     {
         // Define menu options
         menu[0] = "Snake Game";
-
-        // Initialize DisplayUtils
-        displayUtils = new DisplayUtils(Device::getInstance().getDisplay());
     }
 
     ApplicationState::~ApplicationState()
     {
-        delete displayUtils;
     }
 
     void ApplicationState::onEnter()
@@ -44,23 +39,17 @@ namespace NuggetsInc
             switch (event.type)
             {
             case EVENT_UP:
-                menuIndex--;
-                if (menuIndex < 0)
-                    menuIndex = menuItems - 1; // Wrap to last menu item
-                displayMenu();
+                moveSelection(-1);
                 break;
             case EVENT_DOWN:
-                menuIndex++;
-                if (menuIndex >= menuItems)
-                    menuIndex = 0; // Wrap to first menu item
-                displayMenu();
+                moveSelection(1);
                 break;
             case EVENT_ACTION_ONE:
                 executeSelection();
-                break;
+                return;
             case EVENT_ACTION_TWO:
-                Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
-                break;
+                Application::getInstance().popState();
+                return;
             default:
                 break;
             }
@@ -69,25 +58,39 @@ namespace NuggetsInc
 
     void ApplicationState::displayMenu()
     {
-        Arduino_GFX *gfx = Device::getInstance().getDisplay();
-        gfx->fillScreen(COLOR_BLACK);
-        gfx->setTextSize(2);
-
+        // Each row clears its own band, so the screen is painted once
         for (int i = 0; i < menuItems; i++)
         {
-            if (i == menuIndex)
-            {
-                gfx->setTextColor(COLOR_ORANGE); // Highlight selected item
-            }
-            else
-            {
-                gfx->setTextColor(COLOR_WHITE);
-            }
-            gfx->setCursor(10, i * 30);
-            gfx->println(menu[i].c_str());
+            drawMenuItem(i);
+        }
+        Arduino_GFX *gfx = Device::getInstance().getDisplay();
+        int listBottom = menuItems * rowHeight;
+        if (listBottom < gfx->height())
+        {
+            gfx->fillRect(0, listBottom, gfx->width(), gfx->height() - listBottom, COLOR_BLACK);
         }
     }
 
+    void ApplicationState::moveSelection(int step)
+    {
+        int previous = menuIndex;
+        menuIndex = (menuIndex + step + menuItems) % menuItems;
+
+        // Only the two rows whose highlight changed need repainting
+        drawMenuItem(previous);
+        drawMenuItem(menuIndex);
+    }
+
+    void ApplicationState::drawMenuItem(int index)
+    {
+        Arduino_GFX *gfx = Device::getInstance().getDisplay();
+        gfx->fillRect(0, index * rowHeight, gfx->width(), rowHeight, COLOR_BLACK);
+        gfx->setTextSize(2);
+        gfx->setTextColor(index == menuIndex ? COLOR_ORANGE : COLOR_WHITE);
+        gfx->setCursor(10, index * rowHeight);
+        gfx->println(menu[index]);
+    }
+
     void ApplicationState::executeSelection()
     {
         Application &app = Application::getInstance();
@@ -95,7 +98,7 @@ namespace NuggetsInc
         switch (menuIndex)
         {
         case 0: // Snake Game
-            app.changeState(StateFactory::createState(SNAKE_GAME_STATE));
+            app.pushState(StateFactory::createState(SNAKE_GAME_STATE));
             break;
         default:
             // Handle unexpected cases gracefully
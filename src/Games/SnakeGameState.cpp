@@ -8,7 +8,7 @@
 namespace NuggetsInc {
 
 SnakeGameState::SnakeGameState()
-    : snakeLength(5), snakeDirection(1), lastUpdateTime(0),
+    : snakeLength(5), snakeDirection(1), tickTimer(TimerService::INVALID_TIMER),
       updateInterval(200), score(0), updateScore(true) {
     prevApple.x = -1;
     prevApple.y = -1;
@@ -24,7 +24,6 @@ void SnakeGameState::onExit() {
 }
 
 void SnakeGameState::update() {
-    Device::getInstance().update(); // Update device to read inputs
     EventManager& eventManager = EventManager::getInstance();
     Event event;
 
@@ -49,18 +48,18 @@ void SnakeGameState::update() {
                 break;
             case EVENT_ACTION_TWO:
             case EVENT_BACK:
-                Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
+                Application::getInstance().popState();
                 return;
             default:
                 break;
         }
     }
+}
 
-    unsigned long currentTime = millis();
-    if (currentTime - lastUpdateTime > updateInterval) {
-        lastUpdateTime = currentTime;
-        updateSnake();
-        drawGame();
+void SnakeGameState::onTick(void* context) {
+    SnakeGameState* game = static_cast<SnakeGameState*>(context);
+    if (game->updateSnake()) {
+        game->drawGame();
     }
 }
 
@@ -81,7 +80,10 @@ void SnakeGameState::initGame() {
     spawnApple(); // Spawn the first apple
     score = 0;
     updateScore = true; // Ensure the score is drawn initially
-    lastUpdateTime = millis();
+
+    // The snake moves on a timer; Application cancels it when we leave
+    TimerService::Job tick = {"snake.tick", (uint32_t)updateInterval, TICK_SLACK_MS, TICK_DEADLINE_MS};
+    tickTimer = TimerService::getInstance().schedulePeriodic(tick, onTick, this);
 
     // Initialize the display
     Arduino_GFX* gfx = Device::getInstance().getDisplay();
@@ -126,7 +128,7 @@ void SnakeGameState::spawnApple() {
     }
 }
 
-void SnakeGameState::updateSnake() {
+bool SnakeGameState::updateSnake() {
     // Compute the intended new head position
     Point intendedHead = snake[0];
     switch (snakeDirection) {
@@ -148,14 +150,14 @@ void SnakeGameState::updateSnake() {
     if (intendedHead.x < 0 || (intendedHead.x + SNAKE_SIZE) > SCREEN_WIDTH ||
         intendedHead.y < SCORE_AREA_HEIGHT || (intendedHead.y + SNAKE_SIZE) > (SCREEN_HEIGHT - BOTTOM_MARGIN)) {
         gameOver();
-        return;
+        return false;
     }
 
     // Check for collision with self
     for (int i = 0; i < snakeLength; i++) {
         if (intendedHead.x == snake[i].x && intendedHead.y == snake[i].y) {
             gameOver();
-            return;
+            return false;
         }
     }
 
@@ -181,6 +183,7 @@ void SnakeGameState::updateSnake() {
     }
     snake[0] = intendedHead;
     newHead = snake[0];
+    return true;
 }
 
 void SnakeGameState::drawGame() {
@@ -216,6 +219,8 @@ void SnakeGameState::drawGame() {
 
 void SnakeGameState::gameOver() {
     EventManager::getInstance().clearEvents();  
+    TimerService::getInstance().cancel(tickTimer);
+    tickTimer = TimerService::INVALID_TIMER;
 
     Haptics::getInstance().doubleVibration();
 
@@ -231,10 +236,9 @@ void SnakeGameState::gameOver() {
     gfx->println(score);
     gfx->setCursor(80, (SCREEN_HEIGHT / 2) + 30);
     gfx->println("Returning to Menu");
-    delay(3000);
 
-    // Transition to MenuState
-    Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
+    // Leave the score up for a moment, then go back to MenuState
+    Application::getInstance().changeStateAfter(3000, MENU_STATE);
 }
 
 } // namespace NuggetsInc
@@ -1,6 +1,7 @@
 // IRCommon.cpp
 
 #include "IRCommon.h"
+#include "Application.h"
 #include <LittleFS.h>
 
 // Define LEDC channel for ESP32S3 before including IRremote
@@ -204,6 +205,8 @@ namespace NuggetsInc
     void BeginIrReceiver()
     {
         IrReceiver.begin(IR_RECEIVE_PIN);
+        // Each completed frame wakes the main loop to decode it
+        IrReceiver.registerReceiveCompleteCallback(Application::wakeFromISR);
         Serial.println("IR Receiver initialized.");
     }
 
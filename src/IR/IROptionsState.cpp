@@ -8,18 +8,13 @@
 namespace NuggetsInc {
 
 IROptionsState::IROptionsState()
-    : menuIndex(0),
-      displayUtils(nullptr) {
+    : menuIndex(0) {
     
     // Define menu options
     menu[0] = "Setup New Remote";
-
-    // Initialize DisplayUtils
-    displayUtils = new DisplayUtils(Device::getInstance().getDisplay());
 }
 
 IROptionsState::~IROptionsState() {
-    delete displayUtils;
 }
 
 void IROptionsState::onEnter() {
@@ -37,23 +32,17 @@ void IROptionsState::update() {
     while (eventManager.getNextEvent(event)) {
         switch (event.type) {
             case EVENT_UP:
-                menuIndex--;
-                if (menuIndex < 0)
-                    menuIndex = menuItems - 1; // Wrap to last menu item
-                displayMenu();
+                moveSelection(-1);
                 break;
             case EVENT_DOWN:
-                menuIndex++;
-                if (menuIndex >= menuItems)
-                    menuIndex = 0; // Wrap to first menu item
-                displayMenu();
+                moveSelection(1);
                 break;
             case EVENT_ACTION_ONE:
                 executeSelection();
-                break;
+                return;
             case EVENT_ACTION_TWO:
-                Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
-                break;
+                Application::getInstance().popState();
+                return;
             default:
                 break;
         }
@@ -61,27 +50,41 @@ void IROptionsState::update() {
 }
 
 void IROptionsState::displayMenu() {
-    Arduino_GFX* gfx = Device::getInstance().getDisplay();
-    gfx->fillScreen(COLOR_BLACK);
-    gfx->setTextSize(2);
-
+    // Each row clears its own band, so the screen is painted once
     for (int i = 0; i < menuItems; i++) {
-        if (i == menuIndex) {
-            gfx->setTextColor(COLOR_ORANGE); // Highlight selected item
-        } else {
-            gfx->setTextColor(COLOR_WHITE);
-        }
-        gfx->setCursor(10, i * 30);
-        gfx->println(menu[i].c_str());
+        drawMenuItem(i);
+    }
+    Arduino_GFX* gfx = Device::getInstance().getDisplay();
+    int listBottom = menuItems * rowHeight;
+    if (listBottom < gfx->height()) {
+        gfx->fillRect(0, listBottom, gfx->width(), gfx->height() - listBottom, COLOR_BLACK);
     }
 }
 
+void IROptionsState::moveSelection(int step) {
+    int previous = menuIndex;
+    menuIndex = (menuIndex + step + menuItems) % menuItems;
+
+    // Only the two rows whose highlight changed need repainting
+    drawMenuItem(previous);
+    drawMenuItem(menuIndex);
+}
+
+void IROptionsState::drawMenuItem(int index) {
+    Arduino_GFX* gfx = Device::getInstance().getDisplay();
+    gfx->fillRect(0, index * rowHeight, gfx->width(), rowHeight, COLOR_BLACK);
+    gfx->setTextSize(2);
+    gfx->setTextColor(index == menuIndex ? COLOR_ORANGE : COLOR_WHITE);
+    gfx->setCursor(10, index * rowHeight);
+    gfx->println(menu[index]);
+}
+
 void IROptionsState::executeSelection() {
     Application& app = Application::getInstance();
 
     switch (menuIndex) {
         case 0: // Remote Browser
-            app.changeState(StateFactory::createState(SETUP_NEW_REMOTE_STATE));
+            app.pushState(StateFactory::createState(SETUP_NEW_REMOTE_STATE));
             break;
     }
 }
@@ -9,7 +9,7 @@
 namespace NuggetsInc
 {
     IRRemoteState::IRRemoteState()
-        : displayUtils(nullptr),
+        : displayUtils(Device::getInstance().getDisplay()),
           selectedSlot(0),
           slotSelected(false)
     {
@@ -19,21 +19,15 @@ namespace NuggetsInc
 
     IRRemoteState::~IRRemoteState()
     {
-        if (displayUtils)
-        {
-            delete displayUtils;
-            displayUtils = nullptr;
-        }
     }
 
     void IRRemoteState::onEnter()
     {
         Serial.println("Entering IRRemoteState.");
         
-        displayUtils = new DisplayUtils(Device::getInstance().getDisplay());
-        displayUtils->clearDisplay();
-        displayUtils->setTextSize(2);
-        displayUtils->setTextColor(WHITE);
+        displayUtils.clearDisplay();
+        displayUtils.setTextSize(2);
+        displayUtils.setTextColor(WHITE);
         InitializeSendTask(remotes);
         promptSlotSelection();
     }
@@ -42,11 +36,6 @@ namespace NuggetsInc
     {
         Serial.println("Exiting IRRemoteState.");
         
-        if (displayUtils)
-        {
-            delete displayUtils;
-            displayUtils = nullptr;
-        }
     }
 
     void IRRemoteState::update()
@@ -76,16 +65,16 @@ namespace NuggetsInc
                         {
                             if (NuggetsInc::EnqueueSendRequest(button, selectedSlot))
                             {
-                                displayUtils->addToTerminalDisplay("IR send request enqueued.");
+                                displayUtils.addToTerminalDisplay("IR send request enqueued.");
                             }
                             else
                             {
-                                displayUtils->addToTerminalDisplay("Failed to enqueue IR send request.");
+                                displayUtils.addToTerminalDisplay("Failed to enqueue IR send request.");
                             }
                         }
                         else
                         {
-                            displayUtils->addToTerminalDisplay("No IR data stored for button.");
+                            displayUtils.addToTerminalDisplay("No IR data stored for button.");
                         }
                     }
                 }
@@ -144,8 +133,8 @@ namespace NuggetsInc
             break;
         case BUTTON_ACTION_ONE:
             slotSelected = true;
-            displayUtils->clearDisplay();
-            displayUtils->displayMessage("Slot " + String(selectedSlot) + " selected.");
+            displayUtils.clearDisplay();
+            displayUtils.displayMessage("Slot " + String(selectedSlot) + " selected.");
             Serial.println("Slot " + String(selectedSlot) + " selected.");
             break;
         default:
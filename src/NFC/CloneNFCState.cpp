@@ -17,13 +17,12 @@ namespace NuggetsInc
         : tagDetected(false),
           cloneTagData(false),
           displayNeedsRefresh(false),
-          currentTabIndex(0),
-          displayUtils(nullptr),
-          currentTabWindow("Default", DisplayArea{0, 0, 0, 0}, Device::getInstance().getDisplay())
+          currentTabWindow("Default", DisplayArea{0, 0, 0, 0}, Device::getInstance().getDisplay()),
+          nfcLogic(NFCLogic::getInstance()),
+          displayUtils(Device::getInstance().getDisplay()),
+          currentTagData(nullptr),
+          currentTabIndex(0)
     {
-        nfcLogic = new NFCLogic(PN532_IRQ, PN532_RESET);
-        displayUtils = new DisplayUtils(Device::getInstance().getDisplay());
-
         // Initialize tabs with proper display areas
         Arduino_GFX *display = Device::getInstance().getDisplay();
 
@@ -38,24 +37,22 @@ namespace NuggetsInc
 
     CloneNFCState::~CloneNFCState()
     {
-        delete nfcLogic;
-        delete displayUtils;
+        nfcLogic.stopTagDetection();
         delete currentTagData;
     }
 
     void CloneNFCState::onEnter()
     {
-        displayUtils->newTerminalDisplay("Verifying NFC chip");
+        displayUtils.newTerminalDisplay("Verifying NFC chip");
 
-        if (!nfcLogic->initialize())
+        if (!nfcLogic.initialize())
         {
-            displayUtils->displayMessage("PN532 not found");
-            delay(2000);
-            Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
+            displayUtils.displayMessage("PN532 not found");
+            Application::getInstance().changeStateAfter(2000, MENU_STATE);
             return;
         }
 
-        displayUtils->addToTerminalDisplay("NFC module Found");
+        displayUtils.addToTerminalDisplay("NFC module Found");
         tagDetected = false;
     }
 
@@ -72,7 +69,7 @@ namespace NuggetsInc
         {
             if (event.type == EVENT_BACK || event.type == EVENT_ACTION_TWO)
             {
-                Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
+                Application::getInstance().popState();
                 return;
             }
             else if (event.type == EVENT_UP || event.type == EVENT_DOWN ||
@@ -95,7 +92,10 @@ namespace NuggetsInc
 
         if (!tagDetected)
         {
-            readNFCTag();
+            if (nfcLogic.tagCheckDue())
+            {
+                readNFCTag();
+            }
         }
         else if (!cloneTagData && displayNeedsRefresh)
         {
@@ -103,8 +103,21 @@ namespace NuggetsInc
         }
         else if (cloneTagData)
         {
-            cloneTag();
+            if (nfcLogic.tagCheckDue())
+            {
+                cloneTag();
+            }
+        }
+    }
+
+    uint32_t CloneNFCState::getUpdateDelay()
+    {
+        // Only waiting for a tag needs a wake-up besides input
+        if (!tagDetected || cloneTagData)
+        {
+            return nfcLogic.msUntilTagCheck();
         }
+        return UPDATE_ON_EVENT;
     }
 
     void CloneNFCState::populateTabs()
@@ -200,27 +213,26 @@ namespace NuggetsInc
     bool CloneNFCState::cloneTag()
     {
         // Check that a tag is present
-        if (!nfcLogic->isTagPresent())
+        if (!nfcLogic.isTagPresent())
         {
-            displayUtils->displayMessage("Searching For NFC Tag");
+            displayUtils.displayMessage("Searching For NFC Tag");
             return false;
         }
         else {
-            displayUtils->displayMessage("NFC Tag Detected: Keep Steady");
+            displayUtils.displayMessage("NFC Tag Detected: Keep Steady");
         }
 
         if (currentTagData == nullptr)
         {
-            displayUtils->displayMessage("No Tag Data Available");
+            displayUtils.displayMessage("No Tag Data Available");
             return false;
         }
 
         // Write tag data (clone)
-        if (nfcLogic->writeTagData(*currentTagData))
+        if (nfcLogic.writeTagData(*currentTagData))
         {
-            displayUtils->displayMessage("Tag Cloned Successfully");
-            delay(2000);
-            Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
+            displayUtils.displayMessage("Tag Cloned Successfully");
+            Application::getInstance().changeStateAfter(2000, MENU_STATE);
         }
 
         return false;
@@ -261,19 +273,19 @@ namespace NuggetsInc
 
     void CloneNFCState::readNFCTag()
     {
-        if (nfcLogic->isTagPresent())
+        if (nfcLogic.isTagPresent())
         {
-            displayUtils->displayMessage("NFC Tag Detected: Keep steady");
+            displayUtils.displayMessage("NFC Tag Detected: Keep steady");
 
             TagData tag;
-            const std::vector<uint8_t> &rawData = nfcLogic->readRawData();
+            const std::vector<uint8_t> &rawData = nfcLogic.readRawData();
             TagData NewtagData = tag.parseRawData(rawData);
 
             int validationCode = tag.ValidateTagData(NewtagData);
             if (validationCode != 0)
             {
-                displayUtils->displayMessage("Un-Supported Tag");
-                delay(1500);
+                displayUtils.displayMessage("Un-Supported Tag");
+                Application::getInstance().holdState(1500);
                 return;
             }
             else
@@ -282,16 +294,15 @@ namespace NuggetsInc
                 populateTabs();
             }
 
-            displayUtils->displayMessage("Verified NFC Tag");
-            delay(1500);
+            displayUtils.displayMessage("Verified NFC Tag");
+            Application::getInstance().holdState(1500);
 
             tagDetected = true;
             displayNeedsRefresh = true;
         }
         else
         {
-            displayUtils->displayMessage("Searching for NFC Tag");
-            delay(100);
+            displayUtils.displayMessage("Searching for NFC Tag");
         }
     }
 
@@ -300,12 +311,12 @@ namespace NuggetsInc
     // while wiping (clearing) user data (NDEF records and raw data).
     bool CloneNFCState::reformatChip()
     {
-        if (!nfcLogic->isTagPresent())
+        if (!nfcLogic.isTagPresent())
         {
-            displayUtils->displayMessage("Searching For NFC Tag");
+            displayUtils.displayMessage("Searching For NFC Tag");
             return false;
         }
-        displayUtils->displayMessage("Reformatting NFC Chip...");
+        displayUtils.displayMessage("Reformatting NFC Chip...");
 
         TagData formattedData;
         if (currentTagData != nullptr)
@@ -314,22 +325,21 @@ namespace NuggetsInc
         }
         else
         {
-            displayUtils->displayMessage("No Tag Data Available for Formatting");
-            delay(1500);
+            displayUtils.displayMessage("No Tag Data Available for Formatting");
+            Application::getInstance().holdState(1500);
             return false;
         }
 
-        if (nfcLogic->overwriteRecords(formattedData.tagType))
+        if (nfcLogic.overwriteRecords(formattedData.tagType))
         {
-            displayUtils->displayMessage("Chip Reformatted Successfully");
-            delay(2000);
-            Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
+            displayUtils.displayMessage("Chip Reformatted Successfully");
+            Application::getInstance().changeStateAfter(2000, MENU_STATE);
             return true;
         }
         else
         {
-            displayUtils->displayMessage("Error Reformating Chip");
-            delay(2000);
+            displayUtils.displayMessage("Error Reformating Chip");
+            Application::getInstance().holdState(2000);
             return false;
         }
     }
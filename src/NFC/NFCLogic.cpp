@@ -4,17 +4,31 @@
 #include <Wire.h>
 #include "Config.h"
 #include "Haptics.h"
+#include "Application.h"
+#include "TimeUtils.h"
+#include "Diagnostics/Profiler.h"
 
 namespace NuggetsInc
 {
 
+    NFCLogic& NFCLogic::getInstance()
+    {
+        static NFCLogic instance(PN532_IRQ, PN532_RESET);
+        return instance;
+    }
+
     NFCLogic::NFCLogic(uint8_t irqPin, uint8_t resetPin)
-        : nfc(irqPin, resetPin), authenticated(false) {}
+        : nfc(irqPin, resetPin), authenticated(false), irqPin(irqPin), irqAttached(false),
+          detectionArmed(false), irqFired(false), lastTagCheckMs(0) {}
 
-    NFCLogic::~NFCLogic() {}
+    NFCLogic::~NFCLogic()
+    {
+        stopTagDetection();
+    }
 
     bool NFCLogic::initialize()
     {
+        PROFILE_BLOCKING("nfc.initialize");
         Wire.begin(I2C_SDA, I2C_SCL);
         nfc.begin();
         uint32_t versiondata = nfc.getFirmwareVersion();
@@ -29,14 +43,74 @@ namespace NuggetsInc
 
     bool NFCLogic::isTagPresent()
     {
+        PROFILE_BLOCKING("nfc.isTagPresent");
         uint8_t uid[7];
         uint8_t uidLength = 0;
 
         return nfc.readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength, 100);
     }
 
+    bool NFCLogic::tagCheckDue()
+    {
+        if (!detectionArmed)
+        {
+            // Any other PN532 command cancels a pending detection, so arm it
+            // again now that the previous check has finished
+            if (!irqAttached)
+            {
+                attachInterruptArg(irqPin, onIrq, this, FALLING);
+                irqAttached = true;
+            }
+            irqFired = false;
+            detectionArmed = nfc.startPassiveTargetIDDetection(PN532_MIFARE_ISO14443A);
+            lastTagCheckMs = now_ms();
+            return false;
+        }
+
+        if (irqFired || has_elapsed(lastTagCheckMs, TAG_CHECK_FALLBACK_MS))
+        {
+            irqFired = false;
+            detectionArmed = false;
+            lastTagCheckMs = now_ms();
+            return true;
+        }
+        return false;
+    }
+
+    uint32_t NFCLogic::msUntilTagCheck() const
+    {
+        if (!detectionArmed || irqFired)
+        {
+            return 0;
+        }
+        msec32 elapsed = elapsed_ms(lastTagCheckMs);
+        return elapsed >= TAG_CHECK_FALLBACK_MS ? 0 : TAG_CHECK_FALLBACK_MS - elapsed;
+    }
+
+    void NFCLogic::stopTagDetection()
+    {
+        if (irqAttached)
+        {
+            detachInterrupt(irqPin);
+            irqAttached = false;
+        }
+        detectionArmed = false;
+        irqFired = false;
+    }
+
+    void IRAM_ATTR NFCLogic::onIrq(void *arg)
+    {
+        NFCLogic *self = static_cast<NFCLogic *>(arg);
+        if (self->detectionArmed)
+        {
+            self->irqFired = true;
+            Application::wakeFromISR();
+        }
+    }
+
     const std::vector<uint8_t> &NFCLogic::readRawData()
     {
+        PROFILE_BLOCKING("nfc.readRawData");
        Haptics::getInstance().singleVibration();
 
         static std::vector<uint8_t> rawData;
@@ -121,6 +195,7 @@ namespace NuggetsInc
 
     bool NFCLogic::writeTagData(const TagData &tagData)
     {
+        PROFILE_BLOCKING("nfc.writeTagData");
         // Verify that a tag is present before writing
         if (!isTagPresent())
         {
@@ -216,6 +291,7 @@ namespace NuggetsInc
 
     bool NFCLogic::overwriteRecords(uint16_t tagType)
     {
+        PROFILE_BLOCKING("nfc.overwriteRecords");
         // Verify that a tag is present before overwriting.
         if (!isTagPresent())
         {
@@ -8,19 +8,14 @@
 namespace NuggetsInc {
 
 NFCOptionsState::NFCOptionsState()
-    : menuIndex(0),
-      displayUtils(nullptr) {
+    : menuIndex(0) {
     
     // Define menu options
     menu[0] = "Setup NFC Device";
     menu[1] = "Clone NFC Chip";
-
-    // Initialize DisplayUtils
-    displayUtils = new DisplayUtils(Device::getInstance().getDisplay());
 }
 
 NFCOptionsState::~NFCOptionsState() {
-    delete displayUtils;
 }
 
 void NFCOptionsState::onEnter() {
@@ -38,23 +33,17 @@ void NFCOptionsState::update() {
     while (eventManager.getNextEvent(event)) {
         switch (event.type) {
             case EVENT_UP:
-                menuIndex--;
-                if (menuIndex < 0)
-                    menuIndex = menuItems - 1; // Wrap to last menu item
-                displayMenu();
+                moveSelection(-1);
                 break;
             case EVENT_DOWN:
-                menuIndex++;
-                if (menuIndex >= menuItems)
-                    menuIndex = 0; // Wrap to first menu item
-                displayMenu();
+                moveSelection(1);
                 break;
             case EVENT_ACTION_ONE:
                 executeSelection();
-                break;
+                return;
             case EVENT_ACTION_TWO:
-                Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
-                break;
+                Application::getInstance().popState();
+                return;
             default:
                 break;
         }
@@ -62,30 +51,44 @@ void NFCOptionsState::update() {
 }
 
 void NFCOptionsState::displayMenu() {
-    Arduino_GFX* gfx = Device::getInstance().getDisplay();
-    gfx->fillScreen(COLOR_BLACK);
-    gfx->setTextSize(2);
-
+    // Each row clears its own band, so the screen is painted once
     for (int i = 0; i < menuItems; i++) {
-        if (i == menuIndex) {
-            gfx->setTextColor(COLOR_ORANGE); // Highlight selected item
-        } else {
-            gfx->setTextColor(COLOR_WHITE);
-        }
-        gfx->setCursor(10, i * 30);
-        gfx->println(menu[i].c_str());
+        drawMenuItem(i);
+    }
+    Arduino_GFX* gfx = Device::getInstance().getDisplay();
+    int listBottom = menuItems * rowHeight;
+    if (listBottom < gfx->height()) {
+        gfx->fillRect(0, listBottom, gfx->width(), gfx->height() - listBottom, COLOR_BLACK);
     }
 }
 
+void NFCOptionsState::moveSelection(int step) {
+    int previous = menuIndex;
+    menuIndex = (menuIndex + step + menuItems) % menuItems;
+
+    // Only the two rows whose highlight changed need repainting
+    drawMenuItem(previous);
+    drawMenuItem(menuIndex);
+}
+
+void NFCOptionsState::drawMenuItem(int index) {
+    Arduino_GFX* gfx = Device::getInstance().getDisplay();
+    gfx->fillRect(0, index * rowHeight, gfx->width(), rowHeight, COLOR_BLACK);
+    gfx->setTextSize(2);
+    gfx->setTextColor(index == menuIndex ? COLOR_ORANGE : COLOR_WHITE);
+    gfx->setCursor(10, index * rowHeight);
+    gfx->println(menu[index]);
+}
+
 void NFCOptionsState::executeSelection() {
     Application& app = Application::getInstance();
 
     switch (menuIndex) {
         case 0: // Setup NFC Device
-            app.changeState(StateFactory::createState(SETUP_NFC_DEVICE_STATE));
+            app.pushState(StateFactory::createState(SETUP_NFC_DEVICE_STATE));
             break;
         case 1: // Clone NFC Chip
-            app.changeState(StateFactory::createState(CLONE_NFC_STATE));
+            app.pushState(StateFactory::createState(CLONE_NFC_STATE));
             break;
         default:
             // Handle unexpected cases gracefully
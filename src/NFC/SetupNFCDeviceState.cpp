@@ -11,13 +11,14 @@ namespace NuggetsInc
 {
 
     SetupNFCDeviceState::SetupNFCDeviceState()
-        : nfcLogic(new NFCLogic(PN532_IRQ, PN532_RESET)),
-          displayUtils(nullptr),
+        : nfcLogic(NFCLogic::getInstance()),
+          displayUtils(Device::getInstance().getDisplay()),
           macAddressFound(false),
           readingStarted(false),
           cloningStarted(false),
           tagDetected(false),
           startTime(0),
+          currentTagData(nullptr),
           // --- initialize manual input members ---
           manualInputMode(false),
           manualInputCursor(0),
@@ -26,15 +27,10 @@ namespace NuggetsInc
 
     SetupNFCDeviceState::~SetupNFCDeviceState()
     {
-        delete nfcLogic;
-        nfcLogic = nullptr;
+        nfcLogic.stopTagDetection();
         macAddressFound = false;
         macAddress = "";
-        if (displayUtils)
-        {
-            delete displayUtils;
-            displayUtils = nullptr;
-        }
+        delete currentTagData;
     }
 
     void SetupNFCDeviceState::onEnter()
@@ -45,24 +41,21 @@ namespace NuggetsInc
             ;
         }
 
-        // Initialize DisplayUtils
-        displayUtils = new DisplayUtils(Device::getInstance().getDisplay());
 
-        displayUtils->newTerminalDisplay("Verifying NFC chip");
+        displayUtils.newTerminalDisplay("Verifying NFC chip");
 
-        if (!nfcLogic->initialize())
+        if (!nfcLogic.initialize())
         {
-            displayUtils->displayMessage("PN532 not found");
-            delay(2000);
-            Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
+            displayUtils.displayMessage("PN532 not found");
+            Application::getInstance().changeStateAfter(2000, MENU_STATE);
             return;
         }
 
-        displayUtils->addToTerminalDisplay("NFC module Found");
+        displayUtils.addToTerminalDisplay("NFC module Found");
         tagDetected = false;
 
         // Display initial message
-        displayUtils->newTerminalDisplay("Looking For Device...");
+        displayUtils.newTerminalDisplay("Looking For Device...");
 
         // Define UART2 pins (assuming RX=40, TX=41)
         const int RX_PIN = 40;
@@ -83,11 +76,6 @@ namespace NuggetsInc
 
     void SetupNFCDeviceState::onExit()
     {
-        if (displayUtils)
-        {
-            delete displayUtils;
-            displayUtils = nullptr;
-        }
         Serial2.end();
     }
 
@@ -119,7 +107,7 @@ namespace NuggetsInc
         {
             if (event.type == EVENT_BACK || event.type == EVENT_ACTION_TWO)
             {
-                Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
+                Application::getInstance().popState();
                 return;
             }
             else if (event.type == EVENT_ACTION_ONE)
@@ -135,14 +123,14 @@ namespace NuggetsInc
                     if (manualMac.charAt(manualInputCursor) == ':')
                         manualInputCursor = 1;
                     // Clear display once for the new manual input session.
-                    displayUtils->clearDisplay();
+                    displayUtils.clearDisplay();
                     updateManualInputDisplay();
                     return;
                 }
                 // If a MAC was already found, then EVENT_ACTION_ONE begins cloning.
                 else if (macAddressFound)
                 {
-                    displayUtils->clearDisplay();
+                    displayUtils.clearDisplay();
                     cloningStarted = true;
                 }
             }
@@ -152,14 +140,14 @@ namespace NuggetsInc
         if (!readingStarted && !macAddressFound)
         {
             readingStarted = true;
-            displayUtils->displayMessage("Reading MAC Address. Connect Rx/Tx Pins");
+            displayUtils.displayMessage("Reading MAC Address. Connect Rx/Tx Pins");
             startTime = millis();
             Serial2.println("GET_MAC");
         }
 
         if (readingStarted && !macAddressFound)
         {
-            if (millis() - startTime >= 50)
+            if (millis() - startTime >= MAC_RESPONSE_WINDOW_MS)
             {
                 readingStarted = false;
                 return;
@@ -192,7 +180,7 @@ namespace NuggetsInc
                     }
                     if (colonCount != 5)
                     {
-                        displayUtils->addToTerminalDisplay("Invalid MAC Format (colon count): [" + response + "]");
+                        displayUtils.addToTerminalDisplay("Invalid MAC Format (colon count): [" + response + "]");
                         continue;
                     }
 
@@ -205,8 +193,8 @@ namespace NuggetsInc
                         macAddress = macAddress.substring(1);
                     }
 
-                    displayUtils->addToTerminalDisplay("Device Found!");
-                    displayUtils->addToTerminalDisplay("MAC Address: " + macAddress);
+                    displayUtils.addToTerminalDisplay("Device Found!");
+                    displayUtils.addToTerminalDisplay("MAC Address: " + macAddress);
 
                     Haptics::getInstance().doubleVibration();
 
@@ -216,7 +204,7 @@ namespace NuggetsInc
                 }
                 else
                 {
-                    displayUtils->addToTerminalDisplay("Invalid Response: [" + response + "]");
+                    displayUtils.addToTerminalDisplay("Invalid Response: [" + response + "]");
                 }
             }
         }
@@ -226,7 +214,7 @@ namespace NuggetsInc
             displaySetupInstructions();
         }
 
-        if (cloningStarted && !tagDetected)
+        if (cloningStarted && !tagDetected && nfcLogic.tagCheckDue())
         {
             readNFCTag();
         }
@@ -234,23 +222,54 @@ namespace NuggetsInc
         if (tagDetected)
         {
             // Proceed to write tag data.
-            if (nfcLogic->writeTagData(*currentTagData))
+            if (nfcLogic.writeTagData(*currentTagData))
             {
-                displayUtils->displayMessage("Tag Cloned Successfully");
-                delay(2000);
-                Application::getInstance().changeState(StateFactory::createState(MENU_STATE));
+                displayUtils.displayMessage("Tag Cloned Successfully");
+                Application::getInstance().changeStateAfter(2000, MENU_STATE);
             }
         }
     }
 
+    uint32_t SetupNFCDeviceState::getUpdateDelay()
+    {
+        if (manualInputMode)
+        {
+            return UPDATE_ON_EVENT;
+        }
+
+        if (!macAddressFound)
+        {
+            // Poll Serial2 until the current GET_MAC window closes
+            if (!readingStarted)
+            {
+                return 0;
+            }
+            unsigned long elapsed = millis() - startTime;
+            return elapsed >= MAC_RESPONSE_WINDOW_MS ? 0 : MAC_RESPONSE_WINDOW_MS - elapsed;
+        }
+
+        if (cloningStarted && !tagDetected)
+        {
+            return nfcLogic.msUntilTagCheck();
+        }
+
+        if (tagDetected)
+        {
+            // Retry the write until it succeeds
+            return NFCLogic::TAG_CHECK_FALLBACK_MS;
+        }
+
+        return UPDATE_ON_EVENT;
+    }
+
     // ----- Manual Input Helper Methods -----
 
     // This routine now only prints the current state of manual input.
     // It does not clear the display on its own.
     void SetupNFCDeviceState::updateManualInputDisplay()
     {
-        displayUtils->println("Enter MAC:");
-        displayUtils->println(manualMac);
+        displayUtils.println("Enter MAC:");
+        displayUtils.println(manualMac);
 
         // Build a caret line (a '^' under the active digit)
         String caretLine = "";
@@ -258,7 +277,7 @@ namespace NuggetsInc
         {
             caretLine += (i == manualInputCursor) ? "^" : " ";
         }
-        displayUtils->println(caretLine);
+        displayUtils.println(caretLine);
     }
 
     // Process a single event while in manual input mode.
@@ -274,7 +293,7 @@ namespace NuggetsInc
                 {
                     char newChar = incrementHexDigit(curChar);
                     manualMac.setCharAt(manualInputCursor, newChar);
-                    displayUtils->clearDisplay();
+                    displayUtils.clearDisplay();
                     updateManualInputDisplay();
                 }
                 break;
@@ -286,7 +305,7 @@ namespace NuggetsInc
                 {
                     char newChar = decrementHexDigit(curChar);
                     manualMac.setCharAt(manualInputCursor, newChar);
-                    displayUtils->clearDisplay();
+                    displayUtils.clearDisplay();
                     updateManualInputDisplay();
                 }
                 break;
@@ -299,7 +318,7 @@ namespace NuggetsInc
                 if (newCursor >= 0)
                 {
                     manualInputCursor = newCursor;
-                    displayUtils->clearDisplay();
+                    displayUtils.clearDisplay();
                     updateManualInputDisplay();
                 }
                 break;
@@ -312,7 +331,7 @@ namespace NuggetsInc
                 if (newCursor < manualMac.length())
                 {
                     manualInputCursor = newCursor;
-                    displayUtils->clearDisplay();
+                    displayUtils.clearDisplay();
                     updateManualInputDisplay();
                 }
                 break;
@@ -324,9 +343,9 @@ namespace NuggetsInc
                 macAddress.toUpperCase();
                 macAddressFound = true;
                 manualInputMode = false;
-                displayUtils->clearDisplay();
-                displayUtils->addToTerminalDisplay("Device Found!");
-                displayUtils->addToTerminalDisplay("MAC Address: " + macAddress);
+                displayUtils.clearDisplay();
+                displayUtils.addToTerminalDisplay("Device Found!");
+                displayUtils.addToTerminalDisplay("MAC Address: " + macAddress);
                 Haptics::getInstance().doubleVibration();
                 break;
             }
@@ -334,8 +353,8 @@ namespace NuggetsInc
             {
                 // Cancel manual input mode.
                 manualInputMode = false;
-                displayUtils->displayMessage("Manual input canceled");
-                delay(1000);
+                displayUtils.displayMessage("Manual input canceled");
+                Application::getInstance().holdState(1000);
                 break;
             }
             default:
@@ -374,26 +393,26 @@ namespace NuggetsInc
     // -------------------------------
     void SetupNFCDeviceState::displaySetupInstructions()
     {
-        displayUtils->displayMessage("Mac Address Found: " + macAddress +
+        displayUtils.displayMessage("Mac Address Found: " + macAddress +
                                      "\n Press SELECT to Begin Transfer to NFC");
     }
 
     void SetupNFCDeviceState::readNFCTag()
     {
-        if (nfcLogic->isTagPresent())
+        if (nfcLogic.isTagPresent())
         {
-            displayUtils->displayMessage("NFC Tag Detected: Keep steady");
+            displayUtils.displayMessage("NFC Tag Detected: Keep steady");
 
             TagData tag;
-            const std::vector<uint8_t> &rawData = nfcLogic->readRawData();
+            const std::vector<uint8_t> &rawData = nfcLogic.readRawData();
             TagData NewtagData = tag.parseRawData(rawData);
 
             int validationCode = tag.ValidateTagData(NewtagData);
 
             if (validationCode != 0)
             {
-                displayUtils->displayMessage("Un-Supported Tag");
-                delay(1500);
+                displayUtils.displayMessage("Un-Supported Tag");
+                Application::getInstance().holdState(1500);
                 return;
             }
             else
@@ -402,15 +421,14 @@ namespace NuggetsInc
                 currentTagData->addTextRecord(std::string(macAddress.c_str()), "NI");
             }
 
-            displayUtils->displayMessage("Verified NFC Tag");
-            delay(1500);
+            displayUtils.displayMessage("Verified NFC Tag");
+            Application::getInstance().holdState(1500);
 
             tagDetected = true;
         }
         else
         {
-            displayUtils->displayMessage("Searching for NFC Tag");
-            delay(100);
+            displayUtils.displayMessage("Searching for NFC Tag");
         }
     }
 
@@ -10,8 +10,7 @@
 namespace NuggetsInc {
 
 MenuState::MenuState()
-    : menuIndex(0),
-      displayUtils(nullptr) {
+    : menuIndex(0) {
 
     menu[0] = "ESP-Connect";
     menu[1] = "Remote Control";
@@ -21,12 +20,9 @@ MenuState::MenuState()
     menu[5] = "MAC Addresses";
     menu[6] = "Sync Nodes";
     menu[7] = "Power";
-
-    displayUtils = new DisplayUtils(Device::getInstance().getDisplay());
 }
 
 MenuState::~MenuState() {
-    delete displayUtils;
 }
 
 void MenuState::onEnter() {
@@ -44,20 +40,14 @@ void MenuState::update() {
     while (eventManager.getNextEvent(event)) {
         switch (event.type) {
             case EVENT_UP:
-                menuIndex--;
-                if (menuIndex < 0)
-                    menuIndex = menuItems - 1;
-                displayMenu();
+                moveSelection(-1);
                 break;
             case EVENT_DOWN:
-                menuIndex++;
-                if (menuIndex >= menuItems)
-                    menuIndex = 0;
-                displayMenu();
+                moveSelection(1);
                 break;
             case EVENT_ACTION_ONE:
                 executeSelection();
-                break;
+                return;
             case EVENT_ACTION_TWO:
                 break;
             default:
@@ -67,53 +57,66 @@ void MenuState::update() {
 }
 
 void MenuState::displayMenu() {
-    Arduino_GFX* gfx = Device::getInstance().getDisplay();
-    gfx->fillScreen(COLOR_BLACK);
-    gfx->setTextSize(2);
-
+    // Each row clears its own band, so the screen is painted once
     for (int i = 0; i < menuItems; i++) {
-        if (i == menuIndex) {
-            gfx->setTextColor(COLOR_ORANGE);
-        }
-        else {
-            gfx->setTextColor(COLOR_WHITE);
-        }
-        gfx->setCursor(10, i * 30);
-        gfx->println(menu[i].c_str());
+        drawMenuItem(i);
+    }
+    Arduino_GFX* gfx = Device::getInstance().getDisplay();
+    int listBottom = menuItems * rowHeight;
+    if (listBottom < gfx->height()) {
+        gfx->fillRect(0, listBottom, gfx->width(), gfx->height() - listBottom, COLOR_BLACK);
     }
 }
 
+void MenuState::moveSelection(int step) {
+    int previous = menuIndex;
+    menuIndex = (menuIndex + step + menuItems) % menuItems;
+
+    // Only the two rows whose highlight changed need repainting
+    drawMenuItem(previous);
+    drawMenuItem(menuIndex);
+}
+
+void MenuState::drawMenuItem(int index) {
+    Arduino_GFX* gfx = Device::getInstance().getDisplay();
+    gfx->fillRect(0, index * rowHeight, gfx->width(), rowHeight, COLOR_BLACK);
+    gfx->setTextSize(2);
+    gfx->setTextColor(index == menuIndex ? COLOR_ORANGE : COLOR_WHITE);
+    gfx->setCursor(10, index * rowHeight);
+    gfx->println(menu[index]);
+}
+
 void MenuState::executeSelection() {
     Application& app = Application::getInstance();
     Arduino_GFX* gfx = Device::getInstance().getDisplay();
 
     switch (menuIndex) {
     case 0: // ESP-Connect
-            app.changeState(StateFactory::createState(ENTER_REMOTE_CONTROL_STATE));
+            app.pushState(StateFactory::createState(ENTER_REMOTE_CONTROL_STATE));
             break;
         case 1: // Remote Control
-            app.changeState(StateFactory::createState(IR_REMOTE_STATE));
+            app.pushState(StateFactory::createState(IR_REMOTE_STATE));
             break;
         case 2: // NFC Options
-            app.changeState(StateFactory::createState(NFC_OPTIONS_STATE));
+            app.pushState(StateFactory::createState(NFC_OPTIONS_STATE));
             break;
         case 3: // IR Options
-            app.changeState(StateFactory::createState(IR_OPTIONS_STATE));
+            app.pushState(StateFactory::createState(IR_OPTIONS_STATE));
             break;
         case 4: // Applications
-            app.changeState(StateFactory::createState(APPLICATION_STATE));
+            app.pushState(StateFactory::createState(APPLICATION_STATE));
             break;
         case 5: // MAC Addresses
-            app.changeState(StateFactory::createState(MAC_ADDRESS_MENU_STATE));
+            app.pushState(StateFactory::createState(MAC_ADDRESS_MENU_STATE));
             break;
         case 6: // Sync Nodes
-            app.changeState(StateFactory::createState(SYNC_NODES_STATE));
+            app.pushState(StateFactory::createState(SYNC_NODES_STATE));
             break;
         case 7: // Power
-            app.changeState(StateFactory::createState(POWER_OPTIONS_STATE));
+            app.pushState(StateFactory::createState(POWER_OPTIONS_STATE));
             break;
         //case 8: // Settings
-            //app.changeState(StateFactory::createState(SETTINGS_STATE));
+            //app.pushState(StateFactory::createState(SETTINGS_STATE));
            // break;
         default:
             break;
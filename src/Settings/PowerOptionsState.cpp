@@ -1,14 +1,15 @@
 #include "PowerOptionsState.h"
 #include "DisplayUtils.h"
 #include "Device.h"
+#include "TimerService.h"
 
 #define VOLTAGE_DIVIDER_FACTOR 2.0 // Update based on your voltage divider
 #define UPDATE_INTERVAL 500       // Update interval in milliseconds
+#define UPDATE_SLACK 100          // How late a refresh may run to share a wakeup
 
 namespace NuggetsInc
 {
-    PowerOptionsState::PowerOptionsState()
-        : lastUpdateTime(0) {}
+    PowerOptionsState::PowerOptionsState() {}
 
     PowerOptionsState::~PowerOptionsState() {}
 
@@ -16,7 +17,10 @@ namespace NuggetsInc
     {
         Serial.println("Entering PowerOptionsState.");
         pinMode(PIN_BAT_VOLT, INPUT);
-        lastUpdateTime = millis(); // Initialize the timer
+
+        // Cancelled by Application when this state is left
+        TimerService::Job refresh = {"power.battery", UPDATE_INTERVAL, UPDATE_SLACK, 0};
+        TimerService::getInstance().schedulePeriodic(refresh, onRefresh, this);
     }
 
     void PowerOptionsState::onExit()
@@ -26,34 +30,35 @@ namespace NuggetsInc
 
     void PowerOptionsState::update()
     {
-        // Check if the update interval has passed (rollover-safe)
-        unsigned long currentTime = millis();
-        if ((unsigned long)(currentTime - lastUpdateTime) >= UPDATE_INTERVAL)
-        {
-            lastUpdateTime = currentTime; // Reset the timer
+        // The battery reading is refreshed by the timer
+    }
 
-            // Read the raw ADC value
-            int rawValue = analogRead(PIN_BAT_VOLT);
-            Serial.println("Raw ADC Value: " + String(rawValue));
+    void PowerOptionsState::onRefresh(void* context)
+    {
+        static_cast<PowerOptionsState*>(context)->refreshBattery();
+    }
 
-            // Convert raw ADC value to voltage
-            float batteryVoltage = rawValue * (3.3 / 4095.0) * VOLTAGE_DIVIDER_FACTOR;
-            Serial.println("Battery Voltage: " + String(batteryVoltage, 2) + "V");
+    void PowerOptionsState::refreshBattery()
+    {
+        // Read the raw ADC value
+        int rawValue = analogRead(PIN_BAT_VOLT);
+        Serial.println("Raw ADC Value: " + String(rawValue));
 
-            // Calculate battery percentage
-            float batteryPercentage = calculateBatteryPercentage(batteryVoltage);
-            Serial.println("Battery Percentage: " + String(batteryPercentage, 1) + "%");
+        // Convert raw ADC value to voltage
+        float batteryVoltage = rawValue * (3.3 / 4095.0) * VOLTAGE_DIVIDER_FACTOR;
+        Serial.println("Battery Voltage: " + String(batteryVoltage, 2) + "V");
 
-            // Display battery percentage
-            DisplayUtils *displayUtils = new DisplayUtils(Device::getInstance().getDisplay());
-            displayUtils->clearDisplay();
-            displayUtils->setTextSize(2);
-            displayUtils->setTextColor(COLOR_WHITE);
-            displayUtils->setCursor(10, 10);
-            displayUtils->println("Battery: " + String(batteryPercentage, 1) + "%");
+        // Calculate battery percentage
+        float batteryPercentage = calculateBatteryPercentage(batteryVoltage);
+        Serial.println("Battery Percentage: " + String(batteryPercentage, 1) + "%");
 
-            delete displayUtils; // Clean up dynamically allocated memory
-        }
+        // Display battery percentage
+        DisplayUtils displayUtils(Device::getInstance().getDisplay());
+        displayUtils.clearDisplay();
+        displayUtils.setTextSize(2);
+        displayUtils.setTextColor(COLOR_WHITE);
+        displayUtils.setCursor(10, 10);
+        displayUtils.println("Battery: " + String(batteryPercentage, 1) + "%");
     }
 
     float PowerOptionsState::calculateBatteryPercentage(float voltage)
@@ -9,17 +9,11 @@
 namespace NuggetsInc
 {
     RemoteBrowserState::RemoteBrowserState()
-        : displayUtils(nullptr)
     {
     }
 
     RemoteBrowserState::~RemoteBrowserState()
     {
-        if (displayUtils)
-        {
-            delete displayUtils;
-            displayUtils = nullptr;
-        }
     }
 
     void RemoteBrowserState::onEnter()
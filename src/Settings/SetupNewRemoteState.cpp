@@ -8,7 +8,7 @@
 namespace NuggetsInc
 {
     SetupNewRemoteState::SetupNewRemoteState()
-        : displayUtils(nullptr),
+        : displayUtils(Device::getInstance().getDisplay()),
           selectedSlot(0),
           slotSelected(false),
           recordingButton(BUTTON_COUNT),
@@ -20,30 +20,19 @@ namespace NuggetsInc
 
     SetupNewRemoteState::~SetupNewRemoteState()
     {
-        if (displayUtils)
-        {
-            delete displayUtils;
-            displayUtils = nullptr;
-        }
     }
 
     void SetupNewRemoteState::onEnter()
     {
-        displayUtils = new DisplayUtils(Device::getInstance().getDisplay());
-        displayUtils->clearDisplay();
-        displayUtils->setTextSize(2);
-        displayUtils->setTextColor(COLOR_WHITE);
+        displayUtils.clearDisplay();
+        displayUtils.setTextSize(2);
+        displayUtils.setTextColor(COLOR_WHITE);
 
         promptSlotSelection();
     }
 
     void SetupNewRemoteState::onExit()
     {
-        if (displayUtils)
-        {
-            delete displayUtils;
-            displayUtils = nullptr;
-        }
 
         StopIrReceiver();
     }
@@ -76,7 +65,7 @@ namespace NuggetsInc
                         {
                             pressCount = 1;
                              recordingButton = button;
-                            displayUtils->addToTerminalDisplay("Recording IR signal for button...");
+                            displayUtils.addToTerminalDisplay("Recording IR signal for button...");
                         }
 
                         lastPressTime = currentTime;
@@ -91,7 +80,7 @@ namespace NuggetsInc
                     {
                         
                             recordingButton = button;
-                            displayUtils->addToTerminalDisplay("Recording IR signal for button...");
+                            displayUtils.addToTerminalDisplay("Recording IR signal for button...");
                             BeginIrReceiver();
                         
                     }
@@ -105,7 +94,7 @@ namespace NuggetsInc
             {
                 remotes[selectedSlot].buttonIRData[recordingButton] = DecodeIRData();
 
-                displayUtils->addToTerminalDisplay("Stored IR signal for button.");
+                displayUtils.addToTerminalDisplay("Stored IR signal for button.");
                 recordingButton = BUTTON_COUNT;
             }
 
@@ -121,11 +110,11 @@ namespace NuggetsInc
     {
         if (button == BUTTON_ACTION_TWO)
         {
-            displayUtils->addToTerminalDisplay("Double press detected. Saving IR data to flash...");
+            displayUtils.addToTerminalDisplay("Double press detected. Saving IR data to flash...");
 
             if (!LittleFS.begin(true))
             {
-                displayUtils->addToTerminalDisplay("Failed to mount LittleFS.");
+                displayUtils.addToTerminalDisplay("Failed to mount LittleFS.");
                 return;
             }
 
@@ -133,7 +122,7 @@ namespace NuggetsInc
             File file = LittleFS.open(filename, FILE_WRITE);
             if (!file)
             {
-                displayUtils->addToTerminalDisplay("Failed to open file for writing.");
+                displayUtils.addToTerminalDisplay("Failed to open file for writing.");
                 return;
             }
 
@@ -142,11 +131,11 @@ namespace NuggetsInc
             size_t bytesWritten = file.write(reinterpret_cast<const uint8_t *>(remotes[selectedSlot].buttonIRData), sizeof(remotes[selectedSlot].buttonIRData));
             if (bytesWritten != sizeof(remotes[selectedSlot].buttonIRData))
             {
-                displayUtils->addToTerminalDisplay("Failed to write all IR data to flash.");
+                displayUtils.addToTerminalDisplay("Failed to write all IR data to flash.");
             }
             else
             {
-                displayUtils->addToTerminalDisplay("IR data successfully saved to flash.");
+                displayUtils.addToTerminalDisplay("IR data successfully saved to flash.");
             }
 
             file.close();
@@ -202,8 +191,8 @@ namespace NuggetsInc
         case BUTTON_ACTION_ONE:
             slotSelected = true;
 
-            displayUtils->clearDisplay();
-            displayUtils->displayMessage("Slot " + String(selectedSlot) + " selected.");
+            displayUtils.clearDisplay();
+            displayUtils.displayMessage("Slot " + String(selectedSlot) + " selected.");
             break;
         default:
             break;
@@ -6,16 +6,21 @@
 
 namespace NuggetsInc {
 
-ClearState::ClearState(StateType nextState) : nextState(nextState) {}
+ClearState::ClearState(StateType nextState, const uint8_t* peerMac)
+    : nextState(nextState), hasPeerMac(peerMac != nullptr) {
+    if (hasPeerMac) {
+        memcpy(this->peerMac, peerMac, sizeof(this->peerMac));
+    }
+}
 
 void ClearState::onEnter() {
     Device::getInstance().getDisplay()->fillScreen(BLACK);
-    delay(100);  // Brief delay to ensure screen is cleared
 }
 
 void ClearState::update() {
     // Transition to the specified next state without wrapping
-    Application::getInstance().changeState(StateFactory::createActualState(nextState));
+    Application::getInstance().changeState(
+        StateFactory::createActualState(nextState, hasPeerMac ? peerMac : nullptr));
 }
 
 void ClearState::onExit() {
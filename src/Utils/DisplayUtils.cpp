@@ -5,7 +5,7 @@
 namespace NuggetsInc {
 
 DisplayUtils::DisplayUtils(Arduino_GFX* display)
-    : gfx(display) {}
+    : gfx(display), plotCount(0) {}
 
 DisplayUtils::~DisplayUtils() {}
 
@@ -72,6 +72,10 @@ void DisplayUtils::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t
     gfx->fillRect(x, y, w, h, color);
 }
 
+void DisplayUtils::drawBitmap(int16_t x, int16_t y, const uint16_t* pixels, int16_t w, int16_t h) {
+    gfx->draw16bitRGBBitmap(x, y, pixels, w, h);
+}
+
 void DisplayUtils::beginPlot(const String &xTitle, const String &yTitle, int _minX, int _maxX, int _minY, int _maxY)
 {
     // Set the maximum number of points to plot.
@@ -124,8 +128,6 @@ void DisplayUtils::plotPoint(int xValue, int yValue, uint16_t color)
     // Draw the point on the graph.
     gfx->drawPixel(mappedX, mappedY, color);
 
-    // Store the y-value in the plot buffer.
-    plotBuffer[plotCount] = yValue;
     plotCount++;
     
     if (plotCount >= maxPlotPoints)
@@ -65,17 +65,26 @@ void Haptics::hapticsTask(void* parameter) {
     Haptics* haptics = static_cast<Haptics*>(parameter);
 
     VibrationPattern currentPattern = NONE;
-    unsigned long patternStartTime = 0;
+    unsigned long stepStartTime = 0;
     unsigned long vibrationDurations[4];
     uint8_t vibrationStep = 0;
 
     while (true) {
+        // Sleep until the current step is over, or for good when idle; a new
+        // command wakes the task either way
+        TickType_t wait = portMAX_DELAY;
+        if (currentPattern != NONE) {
+            unsigned long elapsed = millis() - stepStartTime;
+            unsigned long remaining = elapsed >= vibrationDurations[vibrationStep]
+                                          ? 0
+                                          : vibrationDurations[vibrationStep] - elapsed;
+            wait = pdMS_TO_TICKS(remaining);
+        }
+
         VibrationCommand cmd;
-        // Check if a new command is received
-        if (xQueueReceive(haptics->hapticsQueue, &cmd, 0)) {
-            // New command received
+        if (xQueueReceive(haptics->hapticsQueue, &cmd, wait)) {
+            // New command received; it replaces whatever is playing
             currentPattern = cmd.pattern;
-            patternStartTime = 0;
             vibrationStep = 0;
 
             if (currentPattern == SINGLE) {
@@ -89,43 +98,36 @@ void Haptics::hapticsTask(void* parameter) {
                 vibrationDurations[2] = 250; // Vibration on
                 vibrationDurations[3] = 0;   // End of pattern
             }
-        }
 
-        if (currentPattern != NONE) {
-            unsigned long currentTime = millis();
-
-            if (patternStartTime == 0) {
-                // Pattern just started
-                patternStartTime = currentTime;
+            if (currentPattern != NONE) {
+                stepStartTime = millis();
                 Device::getInstance().startVibration();
+            } else {
+                Device::getInstance().stopVibration();
             }
+            continue;
+        }
 
-            if (currentTime - patternStartTime >= vibrationDurations[vibrationStep]) {
-                patternStartTime = currentTime;
-                vibrationStep++;
-
-                if (vibrationDurations[vibrationStep] == 0) {
-                    // End of pattern
-                    Device::getInstance().stopVibration();
-                    currentPattern = NONE;
-                    vibrationStep = 0;
-                    patternStartTime = 0;
-                } else {
-                    if (vibrationStep % 2 == 0) {
-                        // Even step: vibration on
-                        Device::getInstance().startVibration();
-                    } else {
-                        // Odd step: vibration off
-                        Device::getInstance().stopVibration();
-                    }
-                }
-            }
+        if (currentPattern == NONE) {
+            continue;
+        }
+
+        // The current step has run its course
+        stepStartTime = millis();
+        vibrationStep++;
+
+        if (vibrationDurations[vibrationStep] == 0) {
+            // End of pattern
+            Device::getInstance().stopVibration();
+            currentPattern = NONE;
+            vibrationStep = 0;
+        } else if (vibrationStep % 2 == 0) {
+            // Even step: vibration on
+            Device::getInstance().startVibration();
         } else {
-            // Ensure vibration is off when there's no pattern
+            // Odd step: vibration off
             Device::getInstance().stopVibration();
         }
-        // Yield to other tasks
-        vTaskDelay(10 / portTICK_PERIOD_MS);
     }
 }
 
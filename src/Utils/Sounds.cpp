@@ -1,5 +1,6 @@
 #include "Sounds.h"
 #include "Device.h"
+#include "Diagnostics/Profiler.h"
 
 namespace NuggetsInc {
 
@@ -23,6 +24,7 @@ void Sounds::playMelody() {
 
     for (uint16_t i = 0; i < numNotes; i++) {
         playTone(melody[i], noteDurations[i]);
+        PROFILE_BLOCKING("sounds.noteGap");
         delay(50); // Short pause between notes
     }
 }